@@ -0,0 +1,294 @@
+#include "../src/sdk.h"
+#include <boost/asio/io_context.hpp>
+#include <boost/json/src.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/game_handler.h"
+#include "../src/json_loader.h"
+#include "../src/rng.h"
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace po = boost::program_options;
+namespace game = game_handler;
+
+/*
+* Безголовый бенчмарк игровых сессий: без сети и без базы данных.
+* Запускает заданное количество сессий на картах из конфигурации, заполняет их ботами,
+* и с фиксированным шагом времени вызывает MovePlayer и UpdateState, как это делает сервер на тике.
+* Сессии делятся между рабочими потоками по кругу, тик заканчивается когда все потоки обновили свои сессии.
+* Выбывших по простою ботов сразу заменяют новые, чтобы нагрузка не менялась,
+* а их токены удаляются из обработчика так же, как при фиксации тика на сервере.
+*/
+
+namespace {
+
+    struct BenchArguments {
+        bool show_help_list = false;                      // флаг показа листа с помощью
+        std::string config_json_path;                     // путь к конфигурационному файлу config.json
+        std::string map_id;                               // карта всех сессий, по умолчанию карты чередуются
+        unsigned sessions = 4;                            // количество игровых сессий
+        unsigned players = 100;                           // количество ботов в каждой сессии
+        unsigned threads = 1;                             // количество рабочих потоков
+        unsigned ticks = 2000;                            // количество измеряемых тиков
+        unsigned warmup_ticks = 100;                      // количество тиков прогрева, не попадающих в статистику
+        int tick_period = 50;                             // шаг времени тика в миллисекундах
+        double turn_chance = 0.1;                         // вероятность смены направления ботом на тике
+        uint64_t seed = 42;                               // зерно генераторов случайных чисел
+        bool randomize_spawn_points = false;              // флаг случайного размещения ботов
+    };
+
+    BenchArguments ParseBenchCommandLine(int argc, const char* const argv[]) {
+        po::options_description description{ "All options"s };
+        BenchArguments arguments;
+        description.add_options()
+            ("help,h", "produce help message")
+            ("config-file,c", po::value(&arguments.config_json_path)->value_name("file"), "set config file path")
+            ("map,m", po::value(&arguments.map_id)->value_name("id"), "run all sessions on one map")
+            ("sessions,s", po::value(&arguments.sessions)->value_name("count"), "set game sessions count")
+            ("players,p", po::value(&arguments.players)->value_name("count"), "set bot players count per session")
+            ("threads,n", po::value(&arguments.threads)->value_name("count"), "set worker threads count")
+            ("ticks", po::value(&arguments.ticks)->value_name("count"), "set measured ticks count")
+            ("warmup", po::value(&arguments.warmup_ticks)->value_name("count"), "set warmup ticks count")
+            ("tick-period,t", po::value(&arguments.tick_period)->value_name("milliseconds"), "set tick period")
+            ("turn-chance", po::value(&arguments.turn_chance)->value_name("probability"), "set bot turn probability per tick")
+            ("random-seed", po::value(&arguments.seed)->value_name("seed"), "seed game model random generators")
+            ("randomize-spawn-points", "spawn bots at random free positions");
+
+        po::variables_map variables_map;
+        po::store(po::parse_command_line(argc, argv, description), variables_map);
+        po::notify(variables_map);
+
+        if (variables_map.contains("help"s)) {
+            std::cout << description;
+            arguments.show_help_list = true;
+            return arguments;
+        }
+        if (!variables_map.contains("config-file"s)) {
+            throw std::runtime_error("Config file have not been specified"s);
+        }
+        if (variables_map.contains("randomize-spawn-points"s)) {
+            arguments.randomize_spawn_points = true;
+        }
+        if (arguments.sessions == 0 || arguments.threads == 0 || arguments.ticks == 0 || arguments.tick_period <= 0) {
+            throw std::runtime_error("Sessions, threads, ticks and tick period must be positive"s);
+        }
+
+        arguments.threads = std::min(arguments.threads, arguments.sessions);
+        return arguments;
+    }
+
+    // открывает бенчмарку защищённый интерфейс игровой сессии, которым пользуется GameHandler
+    class BenchSession : public game::GameSession {
+    public:
+        using GameSession::GameSession;
+        using GameSession::AddPlayer;
+        using GameSession::MovePlayer;
+        using GameSession::UpdateState;
+        using GameSession::ReservePlace;
+        using GameSession::TakeRetiredPlayers;
+        using GameSession::SetTickProfile;
+
+        // добавляет бота, возвращает false если места нет
+        bool AddBot() {
+            return ReservePlace() && AddPlayer("bot"sv) != nullptr;
+        }
+    };
+
+    // открывает бенчмарку фиксацию тика, без базы данных она только удаляет токены выбывших игроков
+    class BenchHandler : public game::GameHandler {
+    public:
+        using GameHandler::GameHandler;
+        using GameHandler::CommitRetiredPlayers;
+    };
+
+    // рабочий поток бенчмарка со своими сессиями и профилем фаз
+    struct BenchWorker {
+        BenchHandler* handler = nullptr;
+        std::vector<std::shared_ptr<BenchSession>> sessions;
+        game::TickProfile profile;
+        model::Rng rng{ 0 };
+        size_t moves = 0;
+
+        // один тик: боты меняют направление, сессии обновляются, токены выбывших ботов удаляются, а сами боты заменяются
+        void Tick(const BenchArguments& arguments) {
+            static constexpr game::PlayerMove __BOT_MOVES__[] = {
+                game::PlayerMove::UP, game::PlayerMove::DOWN, game::PlayerMove::LEFT, game::PlayerMove::RIGHT, game::PlayerMove::STAY
+            };
+
+            std::vector<game::RetiredPlayer> retired;
+            for (auto& session : sessions) {
+                for (const auto& [token, player] : session->GetPlayers()) {
+                    if (rng.NextDouble() < arguments.turn_chance) {
+                        session->MovePlayer(token, __BOT_MOVES__[rng.NextInteger(0, static_cast<int>(std::size(__BOT_MOVES__)) - 1)]);
+                        ++moves;
+                    }
+                }
+
+                session->UpdateState(arguments.tick_period);
+
+                auto session_retired = session->TakeRetiredPlayers();
+                for (size_t i = session_retired.size(); i != 0; --i) {
+                    session->AddBot();
+                }
+                std::move(session_retired.begin(), session_retired.end(), std::back_inserter(retired));
+            }
+
+            // как и на сервере, токены удаляются одной фиксацией на тик
+            handler->CommitRetiredPlayers(std::move(retired));
+        }
+    };
+
+    double ToMicroseconds(std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    void PrintReport(const BenchArguments& arguments, std::vector<std::chrono::nanoseconds>& tick_times,
+        std::chrono::nanoseconds total, const game::TickProfile& profile, size_t moves) {
+
+        std::sort(tick_times.begin(), tick_times.end());
+        auto percentile = [&tick_times](double p) {
+            size_t index = static_cast<size_t>(p * static_cast<double>(tick_times.size() - 1) + 0.5);
+            return ToMicroseconds(tick_times[index]);
+        };
+
+        double seconds = std::chrono::duration<double>(total).count();
+        double ticks = static_cast<double>(tick_times.size());
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "sessions " << arguments.sessions << ", players " << arguments.players << " per session, threads "
+            << arguments.threads << ", tick " << arguments.tick_period << " ms, ticks " << arguments.ticks << std::endl;
+        std::cout << "ticks/s          " << ticks / seconds << std::endl;
+        std::cout << "moves/s          " << static_cast<double>(moves) / seconds << std::endl;
+        std::cout << "tick time, us    p50 " << percentile(0.5) << ", p99 " << percentile(0.99)
+            << ", max " << ToMicroseconds(tick_times.back()) << std::endl;
+        std::cout << "phase time per tick, us, summed over sessions" << std::endl;
+        std::cout << "  future positions " << ToMicroseconds(profile.future_positions_) / ticks << std::endl;
+        std::cout << "  collisions       " << ToMicroseconds(profile.collisions_) / ticks << std::endl;
+        std::cout << "  retirement       " << ToMicroseconds(profile.retirement_) / ticks << std::endl;
+        std::cout << "  moving           " << ToMicroseconds(profile.moving_) / ticks << std::endl;
+        std::cout << "  loot generation  " << ToMicroseconds(profile.loot_generation_) / ticks << std::endl;
+    }
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+
+    try
+    {
+        BenchArguments arguments = ParseBenchCommandLine(argc, argv);
+        if (arguments.show_help_list) {
+            return EXIT_SUCCESS;
+        }
+
+        model::Rng::SetGlobalSeed(arguments.seed);
+
+        // модель для сессий бенчмарка, обработчик нужен сессиям для токенов и времени простоя
+        model::Game model = json_loader::LoadGameConfiguration(arguments.config_json_path);
+        net::io_context ioc;
+        BenchHandler handler(arguments.config_json_path, std::vector<game::SessionExecutor>{ ioc.get_executor() });
+
+        std::vector<const model::Map*> maps;
+        if (!arguments.map_id.empty()) {
+            const model::Map* map = model.FindMap(model::Map::Id{ arguments.map_id });
+            if (map == nullptr) {
+                throw std::runtime_error("Map {" + arguments.map_id + "} not found");
+            }
+            maps.push_back(map);
+        }
+        else {
+            for (const auto& map : model.GetMaps()) {
+                maps.push_back(&map);
+            }
+        }
+
+        std::vector<BenchWorker> workers(arguments.threads);
+        for (auto& worker : workers) {
+            worker.handler = &handler;
+        }
+        for (unsigned i = 0; i != arguments.sessions; ++i) {
+            auto session = std::make_shared<BenchSession>(i, handler, ioc.get_executor(), model.GetLootGenConfig(),
+                maps[i % maps.size()], std::max<size_t>(arguments.players, 1), arguments.randomize_spawn_points);
+            for (unsigned p = 0; p != arguments.players; ++p) {
+                session->AddBot();
+            }
+            workers[i % workers.size()].sessions.push_back(std::move(session));
+        }
+        for (size_t i = 0; i != workers.size(); ++i) {
+            workers[i].rng.Seed(model::Rng::StreamSeed(arguments.sessions + i));
+        }
+
+        // прогрев без профилирования
+        for (unsigned t = 0; t != arguments.warmup_ticks; ++t) {
+            for (auto& worker : workers) {
+                worker.Tick(arguments);
+            }
+        }
+        for (auto& worker : workers) {
+            worker.moves = 0;
+            for (auto& session : worker.sessions) {
+                session->SetTickProfile(&worker.profile);
+            }
+        }
+
+        std::vector<std::chrono::nanoseconds> tick_times;
+        tick_times.reserve(arguments.ticks);
+
+        auto bench_start = std::chrono::steady_clock::now();
+        if (workers.size() == 1) {
+            // в одном потоке тики идут без синхронизации, чтобы в статистику не попадало пробуждение потоков
+            for (unsigned t = 0; t != arguments.ticks; ++t) {
+                auto tick_start = std::chrono::steady_clock::now();
+                workers.front().Tick(arguments);
+                tick_times.push_back(std::chrono::steady_clock::now() - tick_start);
+            }
+        }
+        else {
+            // главный поток отмечает начало и конец каждого тика, рабочие потоки обновляют свои сессии между отметками
+            std::barrier sync_point(static_cast<std::ptrdiff_t>(workers.size() + 1));
+            std::vector<std::jthread> threads;
+            for (auto& worker : workers) {
+                threads.emplace_back([&worker, &arguments, &sync_point]() {
+                    for (unsigned t = 0; t != arguments.ticks; ++t) {
+                        sync_point.arrive_and_wait();
+                        worker.Tick(arguments);
+                        sync_point.arrive_and_wait();
+                    }
+                });
+            }
+
+            for (unsigned t = 0; t != arguments.ticks; ++t) {
+                auto tick_start = std::chrono::steady_clock::now();
+                sync_point.arrive_and_wait();
+                sync_point.arrive_and_wait();
+                tick_times.push_back(std::chrono::steady_clock::now() - tick_start);
+            }
+        }
+        auto total = std::chrono::steady_clock::now() - bench_start;
+
+        game::TickProfile profile;
+        size_t moves = 0;
+        for (auto& worker : workers) {
+            profile += worker.profile;
+            moves += worker.moves;
+        }
+
+        PrintReport(arguments, tick_times, total, profile, moves);
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,559 @@
+#include "../src/sdk.h"
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/json/src.hpp>
+#include <boost/program_options.hpp>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/rng.h"
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace json = boost::json;
+namespace po = boost::program_options;
+using tcp = net::ip::tcp;
+
+/*
+* Генератор HTTP-нагрузки на игровой сервер, нативная замена static/load_simulator.html.
+* Открывает заданное количество keep-alive соединений, каждое подключает игрока через /api/v1/game/join
+* и затем со случайными паузами шлёт /player/action и /state, а при желании и статические файлы,
+* как это делает страница симулятора. Отдельное соединение может двигать время через /tick.
+* По окончании выводит гистограмму задержек и количество ошибок по каждому виду запросов.
+*/
+
+namespace {
+
+    struct LoadArguments {
+        bool show_help_list = false;                      // флаг показа листа с помощью
+        std::string host = "127.0.0.1"s;                  // адрес сервера
+        std::string port = "8080"s;                       // порт сервера
+        std::string map_id;                               // карта игроков, по умолчанию случайная из /api/v1/maps
+        unsigned connections = 100;                       // количество соединений с игроками
+        unsigned threads = 1;                             // количество потоков ввода-вывода
+        unsigned duration = 10;                           // длительность нагрузки в секундах
+        double action_rate = 2.0;                         // запросов /player/action в секунду на соединение
+        double state_rate = 5.0;                          // запросов /state в секунду на соединение
+        double static_rate = 0.0;                         // запросов статических файлов в секунду на соединение
+        int tick_period = 0;                              // период запросов /tick в миллисекундах, 0 - не слать
+        int timeout = 5000;                               // таймаут запроса в миллисекундах
+        uint64_t seed = 42;                               // зерно генераторов случайных чисел
+    };
+
+    LoadArguments ParseLoadCommandLine(int argc, const char* const argv[]) {
+        po::options_description description{ "All options"s };
+        LoadArguments arguments;
+        description.add_options()
+            ("help,h", "produce help message")
+            ("host", po::value(&arguments.host)->value_name("address"), "set server address")
+            ("port,p", po::value(&arguments.port)->value_name("port"), "set server port")
+            ("map,m", po::value(&arguments.map_id)->value_name("id"), "join all players to one map")
+            ("connections,c", po::value(&arguments.connections)->value_name("count"), "set player connections count")
+            ("threads,n", po::value(&arguments.threads)->value_name("count"), "set io threads count")
+            ("duration,d", po::value(&arguments.duration)->value_name("seconds"), "set load duration")
+            ("action-rate", po::value(&arguments.action_rate)->value_name("rps"), "set player action requests per second per connection")
+            ("state-rate", po::value(&arguments.state_rate)->value_name("rps"), "set game state requests per second per connection")
+            ("static-rate", po::value(&arguments.static_rate)->value_name("rps"), "set static file requests per second per connection")
+            ("tick-period,t", po::value(&arguments.tick_period)->value_name("milliseconds"), "drive game time through /tick with this period")
+            ("timeout", po::value(&arguments.timeout)->value_name("milliseconds"), "set request timeout")
+            ("random-seed", po::value(&arguments.seed)->value_name("seed"), "seed client random generators");
+
+        po::variables_map variables_map;
+        po::store(po::parse_command_line(argc, argv, description), variables_map);
+        po::notify(variables_map);
+
+        if (variables_map.contains("help"s)) {
+            std::cout << description;
+            arguments.show_help_list = true;
+            return arguments;
+        }
+        if (arguments.threads == 0 || arguments.duration == 0 || arguments.timeout <= 0) {
+            throw std::runtime_error("Threads, duration and timeout must be positive"s);
+        }
+        if (arguments.action_rate < 0.0 || arguments.state_rate < 0.0 || arguments.static_rate < 0.0 || arguments.tick_period < 0) {
+            throw std::runtime_error("Request rates and tick period must not be negative"s);
+        }
+        if (arguments.connections != 0 && arguments.action_rate + arguments.state_rate + arguments.static_rate == 0.0) {
+            throw std::runtime_error("At least one request rate must be positive"s);
+        }
+        if (arguments.connections == 0 && arguments.tick_period == 0) {
+            throw std::runtime_error("Nothing to do without connections and tick period"s);
+        }
+        return arguments;
+    }
+
+    // виды запросов генератора, по ним ведётся статистика
+    enum class Endpoint : size_t {
+        join, action, state, tick, static_file, count
+    };
+
+    constexpr std::string_view __ENDPOINT_NAMES__[] = { "join"sv, "action"sv, "state"sv, "tick"sv, "static"sv };
+
+    // статические файлы из static/load_simulator.html, включая заведомо отсутствующий
+    constexpr std::string_view __STATIC_TARGETS__[] = {
+        "/enter_game.html"sv, "/favicon-16x16.png"sv, "/favicon-32x32.png"sv, "/favicon.ico"sv,
+        "/file%20with%20spaces.html"sv, "/game.html"sv, "/api/v1/maps"sv, "/abracadabra"sv
+    };
+
+    constexpr std::string_view __PLAYER_MOVES__[] = { "U"sv, "D"sv, "L"sv, "R"sv, ""sv };
+
+    /*
+    * Гистограмма задержек в микросекундах с логарифмическими корзинами.
+    * Каждая степень двойки делится на __SUB_BUCKETS__ равных корзин, поэтому относительная
+    * погрешность перцентилей не больше 1 / __SUB_BUCKETS__. Запись безблокировочная,
+    * в гистограмму одновременно пишут все потоки ввода-вывода.
+    */
+    class LatencyHistogram {
+    public:
+        void Record(std::chrono::nanoseconds latency) {
+            uint64_t value = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+            buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+
+            uint64_t max = max_.load(std::memory_order_relaxed);
+            while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        uint64_t Count() const {
+            return count_.load(std::memory_order_relaxed);
+        }
+        uint64_t Max() const {
+            return max_.load(std::memory_order_relaxed);
+        }
+
+        // возвращает верхнюю границу корзины, в которую попадает перцентиль p
+        uint64_t Percentile(double p) const {
+            uint64_t count = Count();
+            if (count == 0) {
+                return 0;
+            }
+            uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * static_cast<double>(count) + 0.5));
+            uint64_t seen = 0;
+            for (size_t i = 0; i != buckets_.size(); ++i) {
+                seen += buckets_[i].load(std::memory_order_relaxed);
+                if (seen >= rank) {
+                    return std::min(GetBucketUpperBound(i), Max());
+                }
+            }
+            return Max();
+        }
+
+        // печатает количество запросов по степеням двойки, пустые строки пропускаются
+        void Print(std::ostream& out) const {
+            uint64_t count = Count();
+            for (size_t group = 0; group * __SUB_BUCKETS__ < buckets_.size(); ++group) {
+                uint64_t group_count = 0;
+                for (size_t i = group * __SUB_BUCKETS__; i != (group + 1) * __SUB_BUCKETS__; ++i) {
+                    group_count += buckets_[i].load(std::memory_order_relaxed);
+                }
+                if (group_count == 0) {
+                    continue;
+                }
+                out << "    <= " << std::setw(9) << GetBucketUpperBound((group + 1) * __SUB_BUCKETS__ - 1) << " us "
+                    << std::setw(10) << group_count << "  " << std::setw(5)
+                    << 100.0 * static_cast<double>(group_count) / static_cast<double>(count) << '%' << std::endl;
+            }
+        }
+
+    private:
+        static constexpr size_t __SUB_BUCKETS_BITS__ = 3;
+        static constexpr size_t __SUB_BUCKETS__ = size_t{ 1 } << __SUB_BUCKETS_BITS__;
+        static constexpr size_t __BUCKETS_COUNT__ = (64 - __SUB_BUCKETS_BITS__ + 1) * __SUB_BUCKETS__;
+
+        std::array<std::atomic<uint64_t>, __BUCKETS_COUNT__> buckets_{};
+        std::atomic<uint64_t> count_ = 0;
+        std::atomic<uint64_t> max_ = 0;
+
+        // значения меньше __SUB_BUCKETS__ лежат каждое в своей корзине, дальше по __SUB_BUCKETS__ корзин на степень двойки
+        static size_t GetBucketIndex(uint64_t value) {
+            if (value < __SUB_BUCKETS__) {
+                return static_cast<size_t>(value);
+            }
+            size_t exponent = static_cast<size_t>(std::bit_width(value)) - 1;
+            size_t sub_bucket = static_cast<size_t>(value >> (exponent - __SUB_BUCKETS_BITS__)) & (__SUB_BUCKETS__ - 1);
+            return (exponent - __SUB_BUCKETS_BITS__ + 1) * __SUB_BUCKETS__ + sub_bucket;
+        }
+        static uint64_t GetBucketUpperBound(size_t index) {
+            if (index < __SUB_BUCKETS__) {
+                return index;
+            }
+            size_t exponent = index / __SUB_BUCKETS__ + __SUB_BUCKETS_BITS__ - 1;
+            uint64_t sub_bucket = index % __SUB_BUCKETS__;
+            uint64_t width = uint64_t{ 1 } << (exponent - __SUB_BUCKETS_BITS__);
+            return (uint64_t{ 1 } << exponent) + (sub_bucket + 1) * width - 1;
+        }
+    };
+
+    // статистика одного вида запросов
+    struct EndpointStats {
+        LatencyHistogram latency;
+        std::atomic<uint64_t> http_errors = 0;            // ответы со статусом не 2xx
+        std::atomic<uint64_t> io_errors = 0;              // ошибки сети и таймауты
+    };
+
+    struct LoadStats {
+        std::array<EndpointStats, static_cast<size_t>(Endpoint::count)> endpoints;
+        std::atomic<uint64_t> connect_errors = 0;         // неудачные подключения
+        std::atomic<uint64_t> rejoins = 0;                // повторные подключения игроков после потери токена
+        std::atomic<bool> stopped = false;                // флаг окончания нагрузки
+
+        EndpointStats& operator[](Endpoint endpoint) {
+            return endpoints[static_cast<size_t>(endpoint)];
+        }
+    };
+
+    /*
+    * Одно keep-alive соединение генератора.
+    * Соединение игрока сначала входит в игру, потом шлёт запросы со случайной паузой,
+    * средняя частота каждого вида запросов равна заданной. Если сервер перестал узнавать токен,
+    * например игрок выбыл по простою, соединение входит в игру заново.
+    * Соединение тика только шлёт /tick с заданным периодом.
+    * Все обработчики выполняются в стренде соединения, при ошибке сети соединение переподключается.
+    */
+    class LoadClient : public std::enable_shared_from_this<LoadClient> {
+    public:
+        LoadClient(net::io_context& ioc, const LoadArguments& arguments, const tcp::resolver::results_type& endpoints,
+            const std::vector<std::string>& maps, LoadStats& stats, uint64_t seed, bool ticker)
+            : stream_(net::make_strand(ioc))
+            , timer_(stream_.get_executor())
+            , arguments_(arguments)
+            , endpoints_(endpoints)
+            , maps_(maps)
+            , stats_(stats)
+            , rng_(seed)
+            , ticker_(ticker) {
+        }
+
+        void Run() {
+            net::dispatch(stream_.get_executor(), [self = shared_from_this()]() {
+                self->Connect();
+            });
+        }
+
+    private:
+        beast::tcp_stream stream_;
+        net::steady_timer timer_;
+        beast::flat_buffer buffer_;
+        http::request<http::string_body> request_;
+        http::response<http::string_body> response_;
+
+        const LoadArguments& arguments_;
+        const tcp::resolver::results_type& endpoints_;
+        const std::vector<std::string>& maps_;
+        LoadStats& stats_;
+        model::Rng rng_;
+        bool ticker_;
+
+        std::string token_;                                 // токен игрока соединения
+        Endpoint endpoint_ = Endpoint::join;                // вид текущего запроса
+        std::chrono::steady_clock::time_point sent_at_;     // время отправки текущего запроса
+        uint64_t counter_ = 0;                              // счётчик запросов статики, как в симуляторе
+
+        void Connect() {
+            if (stats_.stopped.load(std::memory_order_relaxed)) {
+                return;
+            }
+            buffer_.clear();
+            stream_.expires_after(std::chrono::milliseconds(arguments_.timeout));
+            stream_.async_connect(endpoints_, [self = shared_from_this()](beast::error_code ec, const tcp::endpoint&) {
+                self->OnConnect(ec);
+            });
+        }
+
+        void OnConnect(beast::error_code ec) {
+            if (ec) {
+                stats_.connect_errors.fetch_add(1, std::memory_order_relaxed);
+                return Reconnect();
+            }
+            stream_.socket().set_option(tcp::no_delay(true));
+
+            if (!ticker_ && token_.empty()) {
+                return SendJoin();
+            }
+            ScheduleNext();
+        }
+
+        void Reconnect() {
+            beast::error_code ignored;
+            stream_.socket().shutdown(tcp::socket::shutdown_both, ignored);
+            stream_.close();
+
+            timer_.expires_after(100ms);
+            timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (!ec) {
+                    self->Connect();
+                }
+            });
+        }
+
+        // ждёт случайную паузу со средним значением 1 / суммарную частоту запросов, или период тика
+        void ScheduleNext() {
+            if (stats_.stopped.load(std::memory_order_relaxed)) {
+                beast::error_code ignored;
+                stream_.socket().shutdown(tcp::socket::shutdown_both, ignored);
+                return;
+            }
+
+            if (ticker_) {
+                timer_.expires_after(std::chrono::milliseconds(arguments_.tick_period));
+            }
+            else {
+                double total_rate = arguments_.action_rate + arguments_.state_rate + arguments_.static_rate;
+                timer_.expires_after(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(rng_.NextDouble(0.0, 2.0 / total_rate))));
+            }
+
+            timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (!ec && !self->stats_.stopped.load(std::memory_order_relaxed)) {
+                    self->SendNext();
+                }
+            });
+        }
+
+        void SendNext() {
+            if (ticker_) {
+                return Send(Endpoint::tick, http::verb::post, "/api/v1/game/tick"sv,
+                    "{\"timeDelta\": " + std::to_string(arguments_.tick_period) + "}");
+            }
+
+            // вид запроса выбирается пропорционально заданным частотам
+            double choice = rng_.NextDouble(0.0, arguments_.action_rate + arguments_.state_rate + arguments_.static_rate);
+            if (choice < arguments_.action_rate) {
+                auto move = __PLAYER_MOVES__[rng_.NextInteger(0, static_cast<int>(std::size(__PLAYER_MOVES__)) - 1)];
+                Send(Endpoint::action, http::verb::post, "/api/v1/game/player/action"sv,
+                    "{\"move\": \"" + std::string(move) + "\"}");
+            }
+            else if (choice < arguments_.action_rate + arguments_.state_rate) {
+                Send(Endpoint::state, http::verb::get, "/api/v1/game/state"sv, {});
+            }
+            else {
+                std::string target(__STATIC_TARGETS__[rng_.NextInteger(0, static_cast<int>(std::size(__STATIC_TARGETS__)) - 1)]);
+                if (rng_.NextDouble() < 0.5) {
+                    target += "?counter=" + std::to_string(counter_);
+                }
+                ++counter_;
+                Send(Endpoint::static_file, http::verb::get, target, {});
+            }
+        }
+
+        void ScheduleJoin() {
+            timer_.expires_after(100ms);
+            timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (!ec && !self->stats_.stopped.load(std::memory_order_relaxed)) {
+                    self->SendJoin();
+                }
+            });
+        }
+
+        void SendJoin() {
+            const std::string& map = arguments_.map_id.empty()
+                ? maps_[rng_.NextInteger(0, static_cast<int>(maps_.size()) - 1)] : arguments_.map_id;
+            Send(Endpoint::join, http::verb::post, "/api/v1/game/join"sv,
+                "{\"userName\": \"load\", \"mapId\": \"" + map + "\"}");
+        }
+
+        void Send(Endpoint endpoint, http::verb verb, std::string_view target, std::string body) {
+            endpoint_ = endpoint;
+            request_ = {};
+            request_.method(verb);
+            request_.target(beast::string_view(target.data(), target.size()));
+            request_.version(11);
+            request_.keep_alive(true);
+            request_.set(http::field::host, arguments_.host);
+            if (endpoint == Endpoint::action || endpoint == Endpoint::state) {
+                request_.set(http::field::authorization, "Bearer " + token_);
+            }
+            if (verb == http::verb::post) {
+                request_.set(http::field::content_type, "application/json");
+                request_.body() = std::move(body);
+            }
+            request_.prepare_payload();
+            response_ = {};
+
+            sent_at_ = std::chrono::steady_clock::now();
+            stream_.expires_after(std::chrono::milliseconds(arguments_.timeout));
+            http::async_write(stream_, request_, [self = shared_from_this()](beast::error_code ec, size_t) {
+                self->OnWrite(ec);
+            });
+        }
+
+        void OnWrite(beast::error_code ec) {
+            if (ec) {
+                stats_[endpoint_].io_errors.fetch_add(1, std::memory_order_relaxed);
+                return Reconnect();
+            }
+            http::async_read(stream_, buffer_, response_, [self = shared_from_this()](beast::error_code ec, size_t) {
+                self->OnRead(ec);
+            });
+        }
+
+        void OnRead(beast::error_code ec) {
+            if (ec) {
+                stats_[endpoint_].io_errors.fetch_add(1, std::memory_order_relaxed);
+                return Reconnect();
+            }
+
+            EndpointStats& stats = stats_[endpoint_];
+            stats.latency.Record(std::chrono::steady_clock::now() - sent_at_);
+
+            unsigned status = response_.result_int();
+            if (status / 100 != 2) {
+                stats.http_errors.fetch_add(1, std::memory_order_relaxed);
+                if (status == 401 && (endpoint_ == Endpoint::action || endpoint_ == Endpoint::state)) {
+                    token_.clear();
+                    stats_.rejoins.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            else if (endpoint_ == Endpoint::join) {
+                ParseJoinResponse();
+            }
+
+            if (response_.need_eof()) {
+                return Reconnect();
+            }
+            if (!ticker_ && token_.empty() && !stats_.stopped.load(std::memory_order_relaxed)) {
+                // после неудачного входа повторяем его с паузой, чтобы не долбить сервер
+                return endpoint_ == Endpoint::join ? ScheduleJoin() : SendJoin();
+            }
+            ScheduleNext();
+        }
+
+        // разбор ответа на вход в игру, при ошибке разбора вход считается неудачным
+        void ParseJoinResponse() {
+            try
+            {
+                json::value value = json::parse(response_.body());
+                token_ = std::string(value.as_object().at("authToken").as_string());
+            }
+            catch (const std::exception&) {
+                stats_[Endpoint::join].http_errors.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // синхронно запрашивает список карт, заодно проверяя доступность сервера
+    std::vector<std::string> LoadMapsList(net::io_context& ioc, const LoadArguments& arguments, const tcp::resolver::results_type& endpoints) {
+        beast::tcp_stream stream(ioc);
+        stream.connect(endpoints);
+
+        http::request<http::string_body> request{ http::verb::get, "/api/v1/maps", 11 };
+        request.set(http::field::host, arguments.host);
+        http::write(stream, request);
+
+        beast::flat_buffer buffer;
+        http::response<http::string_body> response;
+        http::read(stream, buffer, response);
+
+        beast::error_code ignored;
+        stream.socket().shutdown(tcp::socket::shutdown_both, ignored);
+
+        std::vector<std::string> maps;
+        json::value maps_list = json::parse(response.body());
+        for (const json::value& map : maps_list.as_array()) {
+            maps.push_back(std::string(map.as_object().at("id").as_string()));
+        }
+        if (maps.empty()) {
+            throw std::runtime_error("Server has no maps"s);
+        }
+        return maps;
+    }
+
+    void PrintReport(const LoadArguments& arguments, const LoadStats& stats, std::chrono::steady_clock::duration total) {
+        double seconds = std::chrono::duration<double>(total).count();
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "connections " << arguments.connections << ", threads " << arguments.threads
+            << ", duration " << seconds << " s" << std::endl;
+        std::cout << "connect errors " << stats.connect_errors << ", rejoins " << stats.rejoins << std::endl;
+
+        for (size_t i = 0; i != stats.endpoints.size(); ++i) {
+            const EndpointStats& endpoint = stats.endpoints[i];
+            uint64_t count = endpoint.latency.Count();
+            uint64_t errors = endpoint.http_errors + endpoint.io_errors;
+            if (count == 0 && errors == 0) {
+                continue;
+            }
+
+            double error_rate = 100.0 * static_cast<double>(errors) / static_cast<double>(count + endpoint.io_errors);
+            std::cout << __ENDPOINT_NAMES__[i] << ": requests " << count << ", rps " << static_cast<double>(count) / seconds
+                << ", errors " << error_rate << "% (http " << endpoint.http_errors << ", io " << endpoint.io_errors << ")" << std::endl;
+            std::cout << "  latency, us    p50 " << endpoint.latency.Percentile(0.5) << ", p90 " << endpoint.latency.Percentile(0.9)
+                << ", p99 " << endpoint.latency.Percentile(0.99) << ", max " << endpoint.latency.Max() << std::endl;
+            endpoint.latency.Print(std::cout);
+        }
+    }
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+
+    try
+    {
+        LoadArguments arguments = ParseLoadCommandLine(argc, argv);
+        if (arguments.show_help_list) {
+            return EXIT_SUCCESS;
+        }
+
+        model::Rng::SetGlobalSeed(arguments.seed);
+
+        net::io_context ioc(static_cast<int>(arguments.threads));
+        tcp::resolver resolver(ioc);
+        const auto endpoints = resolver.resolve(arguments.host, arguments.port);
+
+        std::vector<std::string> maps;
+        if (arguments.map_id.empty() && arguments.connections != 0) {
+            maps = LoadMapsList(ioc, arguments, endpoints);
+        }
+
+        LoadStats stats;
+        for (unsigned i = 0; i != arguments.connections; ++i) {
+            std::make_shared<LoadClient>(ioc, arguments, endpoints, maps, stats, model::Rng::StreamSeed(i), false)->Run();
+        }
+        if (arguments.tick_period != 0) {
+            std::make_shared<LoadClient>(ioc, arguments, endpoints, maps, stats, model::Rng::StreamSeed(arguments.connections), true)->Run();
+        }
+
+        // по окончании времени соединения дожидаются текущих ответов и закрываются, после чего io_context останавливается сам
+        auto load_start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration total{};
+        net::steady_timer stop_timer(ioc, std::chrono::seconds(arguments.duration));
+        stop_timer.async_wait([&](beast::error_code) {
+            total = std::chrono::steady_clock::now() - load_start;
+            stats.stopped = true;
+        });
+
+        std::vector<std::jthread> threads;
+        for (unsigned i = 1; i < arguments.threads; ++i) {
+            threads.emplace_back([&ioc]() {
+                ioc.run();
+            });
+        }
+        ioc.run();
+        threads.clear();
+
+        PrintReport(arguments, stats, total);
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,273 @@
+#include "../src/sdk.h"
+#include <boost/json/src.hpp>
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/collision_handler.h"
+#include "../src/boost_json.h"
+#include "../src/request_handler.h"            // подключит game_handler.h и serialization_handler.h
+#include "../src/token.h"
+#include "../src/rng.h"
+
+using namespace std::literals;
+namespace game = game_handler;
+namespace net = boost::asio;
+
+/*
+* Микробенчмарки горячих участков кода, которые регулярно настраиваются вручную.
+* По умолчанию результаты выводятся в JSON (--benchmark_format=json), чтобы сравнивать сборки,
+* например через compare.py из google benchmark. Путь к конфигурации для бенчмарков
+* с игровым обработчиком задаётся ключом --config-file=<path>, по умолчанию data/config.json.
+*/
+
+namespace {
+
+    std::string config_json_path = "data/config.json";
+
+    const model::LootType __BENCH_LOOT_TYPE__{ "key", "assets/key.obj", "obj", 90, "#338844", 0.03, 10 };
+
+    // провайдер коллизий с заранее разложенными игроками, лутом и офисами
+    class BenchCollisionProvider : public game::CollisionProvider {
+    public:
+        BenchCollisionProvider(size_t players, size_t loots, bool with_broadphase) {
+            model::Rng rng(players * 1000003 + loots);
+            tokens_.reserve(players);
+
+            for (size_t i = 0; i != players; ++i) {
+                tokens_.emplace_back(game::detail::GenerateToken32Hex());
+                auto& player = players_.Add(&tokens_.back(), i, "bench"sv, 3);
+
+                double x = rng.NextDouble(0.0, 100.0);
+                double y = rng.NextDouble(0.0, 100.0);
+                // половина игроков идёт по горизонтали, половина по вертикали, как по дорогам
+                player.SetCurrentPosition(x, y);
+                i % 2 ? player.SetFuturePosition(x + rng.NextDouble(0.5, 5.0), y)
+                      : player.SetFuturePosition(x, y + rng.NextDouble(0.5, 5.0));
+            }
+            for (size_t i = 0; i != loots; ++i) {
+                loots_.emplace(i, game::GameLoot(__BENCH_LOOT_TYPE__, 0, i,
+                    game::PlayerPosition{ rng.NextDouble(0.0, 100.0), rng.NextDouble(0.0, 100.0) }));
+            }
+            for (int i = 0; i != 4; ++i) {
+                offices_.emplace_back(model::Office::Id{ "office" + std::to_string(i) }, model::Point{ i * 25, i * 25 }, model::Offset{ 0, 0 });
+            }
+
+            if (with_broadphase) {
+                broadphase_ = std::make_unique<game::RoadSegmentBroadphase>();
+            }
+        }
+
+        // перестраивает индекс, как игровая сессия делает это на каждом тике перед поиском коллизий
+        void RebuildBroadphase() {
+            if (broadphase_) {
+                broadphase_->Rebuild(*this);
+            }
+        }
+
+        size_t OfficesCount() const override {
+            return offices_.size();
+        }
+        const model::Office& GetOffice(size_t idx) const override {
+            return offices_[idx];
+        }
+        const game::SessionPlayers& GetPlayers() const override {
+            return players_;
+        }
+        const game::SessionLoots& GetLoots() const override {
+            return loots_;
+        }
+        const game::CollisionBroadphase* GetBroadphase() const override {
+            return broadphase_.get();
+        }
+
+    private:
+        std::vector<game::Token> tokens_;
+        game::SessionPlayers players_;
+        game::SessionLoots loots_;
+        model::Offices offices_;
+        std::unique_ptr<game::CollisionBroadphase> broadphase_;
+    };
+
+    // карта с сеткой из lines горизонтальных и lines вертикальных дорог по 1000 единиц
+    model::Map MakeGridMap(int lines) {
+        model::Map map(model::Map::Id{ "grid" }, "grid");
+        for (int i = 0; i != lines; ++i) {
+            map.AddRoad(model::Road(model::Road::HORIZONTAL, { 0, i * 10 }, 1000));
+            map.AddRoad(model::Road(model::Road::VERTICAL, { i * 10, 0 }, 1000));
+        }
+        return map;
+    }
+
+    // добавляет игроков в игровой обработчик теми же запросами, что и сервер, и выполняет очередь стрендов
+    void JoinPlayers(game::GameHandler& handler, net::io_context& ioc, size_t players) {
+        for (size_t i = 0; i != players; ++i) {
+            http_handler::StringRequest req{ boost::beast::http::verb::post, "/api/v1/game/join", 11 };
+            req.set(boost::beast::http::field::content_type, "application/json");
+            req.body() = R"({"userName": "bench", "mapId": "map1"})";
+            req.prepare_payload();
+            handler.JoinGameResponse(std::move(req), [](http_handler::Response&&) {});
+        }
+        ioc.restart();
+        ioc.run();
+    }
+
+}  // namespace
+
+static void BM_CheckPossibleCollision(benchmark::State& state) {
+    model::Rng rng(1);
+    std::vector<game::PlayerPosition> points(1024);
+    for (auto& point : points) {
+        point = { rng.NextDouble(0.0, 10.0), rng.NextDouble(0.0, 10.0) };
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& item = points[i++ & 1023];
+        benchmark::DoNotOptimize(game::CheckPossibleCollision({ 0.0, 0.0 }, { 10.0, 0.5 }, item));
+    }
+}
+BENCHMARK(BM_CheckPossibleCollision);
+
+static void BM_FindCollisionEvents(benchmark::State& state) {
+    BenchCollisionProvider provider(state.range(0), state.range(1), state.range(2) != 0);
+
+    // перестройка индекса входит в замер, иначе сравнение с полным перебором не учитывает цену тика
+    for (auto _ : state) {
+        provider.RebuildBroadphase();
+        benchmark::DoNotOptimize(game::FindCollisionEvents(provider));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FindCollisionEvents)
+    ->ArgNames({ "players", "loot", "broadphase" })
+    ->ArgsProduct({ { 10, 100, 200 }, { 10, 100, 1000 }, { 0, 1 } });
+
+static void BM_GetHorizontalRoad(benchmark::State& state) {
+    model::Map map = MakeGridMap(static_cast<int>(state.range(0)));
+    model::Rng rng(2);
+    const int max_y = static_cast<int>(state.range(0)) * 10;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.GetHorizontalRoad({ rng.NextInteger(0, 1000), rng.NextInteger(0, max_y) }));
+    }
+}
+BENCHMARK(BM_GetHorizontalRoad)->ArgName("lines")->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_GetVerticalRoad(benchmark::State& state) {
+    model::Map map = MakeGridMap(static_cast<int>(state.range(0)));
+    model::Rng rng(3);
+    const int max_x = static_cast<int>(state.range(0)) * 10;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.GetVerticalRoad({ rng.NextInteger(0, max_x), rng.NextInteger(0, 1000) }));
+    }
+}
+BENCHMARK(BM_GetVerticalRoad)->ArgName("lines")->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_GetSessionStateList(benchmark::State& state) {
+    BenchCollisionProvider provider(state.range(0), state.range(0), false);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(json_detail::GetSessionStateList(provider.GetPlayers(), provider.GetLoots()));
+    }
+}
+BENCHMARK(BM_GetSessionStateList)->ArgName("players")->Arg(10)->Arg(100)->Arg(200);
+
+// запись того же состояния в двоичной кодировке application/x-game-state в переиспользуемый буфер
+static void BM_WriteSessionStateBinary(benchmark::State& state) {
+    BenchCollisionProvider provider(state.range(0), state.range(0), false);
+    std::string buffer;
+
+    for (auto _ : state) {
+        buffer.clear();
+        json_detail::WriteSessionStateList(buffer, provider.GetPlayers(), provider.GetLoots(), game::StateEncoding::BINARY);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    // размеры тел в обеих кодировках, чтобы видеть выигрыш в трафике
+    state.counters["binary_bytes"] = static_cast<double>(buffer.size());
+    state.counters["json_bytes"] = static_cast<double>(
+        json_detail::GetSessionStateList(provider.GetPlayers(), provider.GetLoots()).size());
+}
+BENCHMARK(BM_WriteSessionStateBinary)->ArgName("players")->Arg(10)->Arg(100)->Arg(200);
+
+static void BM_GenerateToken32Hex(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(game::detail::GenerateToken32Hex());
+    }
+}
+BENCHMARK(BM_GenerateToken32Hex);
+
+static void BM_DecodeStaticPath(benchmark::State& state) {
+    const std::string target = "/images/some%20folder/./file%20with+spaces%21%5bv2%5d.png"s;
+    http_handler::StaticPathBuffer buffer;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(http_handler::DecodeStaticPath(target, buffer));
+    }
+}
+BENCHMARK(BM_DecodeStaticPath);
+
+static void BM_MatchRoute(benchmark::State& state) {
+    const std::vector<std::string> targets = {
+        "/api/v1/game/state"s, "/api/v1/game/state?afterVersion=12&baseVersion=10"s, "/api/v1/game/player/action"s,
+        "/api/v1/maps/town"s, "/api/v1/game/records?start=0&maxItems=100"s, "/api/v1/unknown"s, "/index.html"s
+    };
+    size_t i = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(http_handler::MatchRoute(targets[i++ % targets.size()]));
+    }
+}
+BENCHMARK(BM_MatchRoute);
+
+static void BM_SerializeGameData(benchmark::State& state) {
+    net::io_context ioc;
+    auto handler = std::make_shared<game::GameHandler>(config_json_path,
+        std::vector<game::SessionExecutor>{ ioc.get_executor() });
+    JoinPlayers(*handler, ioc, state.range(0));
+    game::SerialHandler serializer(handler);
+
+    for (auto _ : state) {
+        std::ostringstream stream;
+        serializer.SerializeGameData(stream);
+        benchmark::DoNotOptimize(stream.tellp());
+    }
+}
+BENCHMARK(BM_SerializeGameData)->ArgName("players")->Arg(10)->Arg(100)->Arg(200);
+
+int main(int argc, char** argv) {
+
+    // собственный ключ с путём к конфигурации забираем до google benchmark, он не знает таких ключей
+    std::vector<char*> args;
+    bool format_set = false;
+    for (int i = 0; i != argc; ++i) {
+        if (std::strncmp(argv[i], "--config-file=", 14) == 0) {
+            config_json_path = argv[i] + 14;
+            continue;
+        }
+        format_set |= std::strncmp(argv[i], "--benchmark_format=", 19) == 0;
+        args.push_back(argv[i]);
+    }
+
+    // по умолчанию выводим JSON, чтобы результаты разных сборок можно было сравнить
+    std::string json_format = "--benchmark_format=json";
+    if (!format_set) {
+        args.push_back(json_format.data());
+    }
+
+    model::Rng::SetGlobalSeed(42);
+
+    int args_count = static_cast<int>(args.size());
+    benchmark::Initialize(&args_count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(args_count, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
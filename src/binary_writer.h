@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cmath>
+
+namespace binary_detail {
+
+	// число долей единицы в координатах и скоростях с фиксированной точкой, точность 0.001
+	static const double __FIXED_POINT_SCALE__ = 1000.0;
+
+	/*
+	* Компактная двоичная запись прямо в строковый буфер, пара к json_detail::JsonWriter.
+	* Беззнаковые числа пишутся как varint: по 7 бит на байт, старший бит - признак продолжения,
+	* числа 0..127 занимают один байт. Знаковые числа предварительно кодируются zigzag (0, -1, 1, -2 -> 0, 1, 2, 3),
+	* чтобы небольшие отрицательные значения тоже были короткими.
+	* Числа с плавающей точкой переводятся в фиксированную точку с шагом 1 / __FIXED_POINT_SCALE__ и пишутся как знаковые.
+	* Буфер не очищается, запись идёт в конец, поэтому один буфер можно переиспользовать между ответами.
+	*
+	* Пример:
+	*
+	*  std::string buffer;
+	*  BinaryWriter writer(buffer);
+	*  writer.Varint(300).Fixed(-2.5);
+	*  // buffer == "\xac\x02\x87\x27": 300 и zigzag(-2500) = 4999
+	*/
+	class BinaryWriter {
+	public:
+		explicit BinaryWriter(std::string& buffer)
+			: buffer_(buffer) {
+		}
+
+		BinaryWriter& Byte(uint8_t value) {
+			buffer_.push_back(static_cast<char>(value));
+			return *this;
+		}
+
+		BinaryWriter& Varint(uint64_t value) {
+			while (value >= 0x80) {
+				buffer_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+				value >>= 7;
+			}
+			buffer_.push_back(static_cast<char>(value));
+			return *this;
+		}
+
+		BinaryWriter& Zigzag(int64_t value) {
+			return Varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+		}
+
+		// записывает число с фиксированной точкой, округляя до ближайшего шага
+		BinaryWriter& Fixed(double value) {
+			return Zigzag(std::llround(value * __FIXED_POINT_SCALE__));
+		}
+
+	private:
+		std::string& buffer_;
+	};
+
+} // namespace binary_detail
@@ -1,5 +1,7 @@
 ﻿#include "boost_json.h"
 
+#include <algorithm>
+
 namespace json_detail {
 
 	// парсер входящей строки из текста в boost::json
@@ -19,20 +21,29 @@ namespace json_detail {
 
 	// возвращает строковое представление json-словаря с полной информацией по запрошенной карте
 	std::string GetMapInfo(const model::Map* data) {
+		std::string result;
+		result.reserve(__MAP_INFO_RESERVE__);
+		WriteMapInfo(result, data);
+		return result;
+	}
 
-		json::object result;          // базовый ресурс ответа
-
-		result.emplace("id", *data->GetId());
-		result.emplace("name", data->GetName());
+	// дописывает в буфер json-словарь с полной информацией по запрошенной карте
+	void WriteMapInfo(std::string& buffer, const model::Map* data) {
+		JsonWriter writer(buffer);
 
-		result.emplace("roads", detail::GetMapRoads(data));
-		result.emplace("buildings", detail::GetMapBuilds(data));
-		result.emplace("offices", detail::GetMapOffices(data));
+		writer.StartObject();
+		writer.Key("id").String(*data->GetId());
+		writer.Key("name").String(data->GetName());
 
-		result.emplace("lootTypes",
-			data->GetRawExtraDataAs<boost::json::array>("lootTypes"));
+		writer.Key("roads");
+		detail::WriteMapRoads(writer, data);
+		writer.Key("buildings");
+		detail::WriteMapBuilds(writer, data);
+		writer.Key("offices");
+		detail::WriteMapOffices(writer, data);
 
-		return json::serialize(result);
+		writer.Key("lootTypes").Value(data->GetRawExtraDataAs<boost::json::array>("lootTypes"));
+		writer.EndObject();
 	}
 
 	// возвращает строковое представление json-массива с полной информацией по вектору карт игры
@@ -66,115 +77,90 @@ namespace json_detail {
 
 	// возвращает строковое представление json_словаря с информацией о всех игроках в указанной сессии
 	std::string GetSessionPlayersList(game_handler::SPIterator begin, game_handler::SPIterator end) {
+		std::string result;
+		JsonWriter writer(result);
 
-		json::object result;          // базовый ресурс ответа
-
+		writer.StartObject();
 		for (game_handler::SPIterator it = begin; it != end; it++) {
-
-			result.emplace(
-				std::to_string(it->second.GetId()),
-				json::object{ {"name", it->second.GetName()} }
-			);
+			writer.Key(it->second.GetId()).StartObject().Key("name").String(it->second.GetName()).EndObject();
 		}
+		writer.EndObject();
 
-		return json::serialize(result);
+		return result;
 	}
 
 	// возвращает строковое представление json_словаря с информацией о всех игроках в указанной сессии
 	std::string GetSessionPlayersList(const game_handler::SessionPlayers& players) {
+		std::string result;
+		result.reserve(2 + players.size() * __PLAYERS_LIST_ITEM_RESERVE__);
+		WriteSessionPlayersList(result, players);
+		return result;
+	}
 
-		json::object result;          // базовый ресурс ответа
+	// дописывает в буфер json_словарь с информацией о всех игроках в указанной сессии
+	void WriteSessionPlayersList(std::string& buffer, const game_handler::SessionPlayers& players) {
+		JsonWriter writer(buffer);
 
+		writer.StartObject();
 		for (const auto& it : players) {
-
-			result.emplace(
-				std::to_string(it.second.GetId()),
-				json::object{ {"name", it.second.GetName()} }
-			);
+			writer.Key(it.second.GetId()).StartObject().Key("name").String(it.second.GetName()).EndObject();
 		}
-
-		return json::serialize(result);
+		writer.EndObject();
 	}
 
 	// возвращает строковое представление json_словаря с информацией о состоянии в указанной сессии
 	std::string GetSessionStateList(const game_handler::SessionPlayers& players, const game_handler::SessionLoots& loots) {
+		std::string result;
+		result.reserve(32 + players.size() * __STATE_PLAYER_RESERVE__ + loots.size() * __STATE_LOOT_RESERVE__);
+		WriteSessionStateList(result, players, loots);
+		return result;
+	}
 
-		json::object players_list;                  // базовый словарь с данными о игроках
-
-		for (const auto& [token, player] : players) {
-
-			json::object player_data;               // объект игрок в котором будут все данные
-
-			json::array pos {                       // данные по позиции
-				player.GetCurrentPosition().x_,
-				player.GetCurrentPosition().y_ };
-
-			json::array speed{                      // данные по скорости
-				player.GetSpeed().xV_,
-				player.GetSpeed().yV_ };
-
-			player_data.emplace("pos", pos);
-			player_data.emplace("speed", speed);
-
-			switch (player.GetDirection())      // данные по направлению
-			{
-			default:
-				case game_handler::PlayerDirection::NORTH:
-					player_data.emplace("dir", "U");
-					break;
-				case game_handler::PlayerDirection::SOUTH:
-					player_data.emplace("dir", "D");
-					break;
-				case game_handler::PlayerDirection::WEST:
-					player_data.emplace("dir", "L");
-					break;
-				case game_handler::PlayerDirection::EAST:
-					player_data.emplace("dir", "R");
-					break;
-				break;
-			}
-
-			// загружаем инвентарь игрока
-			player_data.emplace("bag", detail::GetPlayerBag(player));
-			
-			// загружаем данные о очках игрока
-			player_data.emplace("score", player.GetScore());
+	// дописывает в буфер словарь с информацией о состоянии в указанной сессии
+	void WriteSessionStateList(std::string& buffer, const game_handler::SessionPlayers& players, const game_handler::SessionLoots& loots,
+		game_handler::StateEncoding encoding) {
 
-			players_list.emplace(
-				std::to_string(player.GetId()), player_data);
+		if (encoding == game_handler::StateEncoding::BINARY) {
+			detail::BinaryStateEncoder encoder(buffer);
+			return detail::EncodeSessionState(encoder, players, loots, nullptr);
 		}
 
-		json::object loots_list;                    // базовый словарь с данными о луте в сессии
-
-		for (const auto& [id, loot] : loots) {
+		detail::JsonStateEncoder encoder(buffer);
+		detail::EncodeSessionState(encoder, players, loots, nullptr);
+	}
 
-			json::array pos { loot.pos_.x_, loot.pos_.y_ };    // данные по позиции
-			json::object loot_data{ {"type", loot.type_}, {"pos", pos} };  // данные по луту
+	// дописывает в буфер словарь с изменениями состояния сессии относительно версии delta.base_version_
+	void WriteSessionStateDelta(std::string& buffer, const game_handler::SessionPlayers& players,
+		const game_handler::SessionLoots& loots, const game_handler::StateDelta& delta, game_handler::StateEncoding encoding) {
 
-			// записываем данные о луте на карте сессии
-			loots_list.emplace(std::to_string(id), loot_data);
+		if (encoding == game_handler::StateEncoding::BINARY) {
+			detail::BinaryStateEncoder encoder(buffer);
+			return detail::EncodeSessionState(encoder, players, loots, &delta);
 		}
 
-		return json::serialize(json::object{ {"players", players_list}, {"lostObjects", loots_list } });
+		detail::JsonStateEncoder encoder(buffer);
+		detail::EncodeSessionState(encoder, players, loots, &delta);
 	}
 
 	// возвращает строковое представление json_массива с информацией о игровых рекордах
 	std::string GetRecordsTable(const std::optional<std::vector<postgres::detail::DBGameRecord>>& records) {
-		json::array result;
+		std::string result;
+		JsonWriter writer(result);
 
+		writer.StartArray();
 		if (records.has_value()) {
+			result.reserve(2 + records->size() * __RECORDS_ITEM_RESERVE__);
 			for (const auto& record : records.value()) {
-				json::object item;
-
-				item.emplace("name", record.name_);
-				item.emplace("score", record.score_);
-				item.emplace("playTime", (static_cast<double>(record.time_ms_) / game_handler::__MS_IN_ONE_SECOND__));
-
-				result.push_back(item);
+				writer.StartObject()
+					.Key("name").String(record.name_)
+					.Key("score").Uint(record.score_)
+					.Key("playTime").Double(static_cast<double>(record.time_ms_) / game_handler::__MS_IN_ONE_SECOND__)
+					.EndObject();
 			}
 		}
+		writer.EndArray();
 
-		return json::serialize(result);
+		return result;
 	}
 
 	namespace detail {
@@ -195,89 +181,277 @@ namespace json_detail {
 			};
 		}
 
-		// возвращает json-массив с информацией о офисах по запрошенной карте
-		json::array GetMapOffices(const model::Map* data) {
-			json::array result;
+		// записывает json-массив с информацией о офисах по запрошенной карте
+		void WriteMapOffices(JsonWriter& writer, const model::Map* data) {
+			writer.StartArray();
 
 			// бежим по массиву офисов
 			for (auto& office : data->GetOffices()) {
 
 				// записываем параметры офиса
-				json::object pre_result{
-					{ "id", *office.GetId() },
-					{ "x", office.GetPosition().x },
-					{ "y", office.GetPosition().y },
-					{ "offsetX", office.GetOffset().dx },
-					{ "offsetY", office.GetOffset().dy }
-				};
-
-				result.push_back(pre_result);
+				writer.StartObject()
+					.Key("id").String(*office.GetId())
+					.Key("x").Int(office.GetPosition().x)
+					.Key("y").Int(office.GetPosition().y)
+					.Key("offsetX").Int(office.GetOffset().dx)
+					.Key("offsetY").Int(office.GetOffset().dy)
+					.EndObject();
 			}
 
-			return result;
+			writer.EndArray();
 		}
 
-		// возвращает json-массив с информацией о строениях по запрошенной карте
-		json::array GetMapBuilds(const model::Map* data) {
-			json::array result;
+		// записывает json-массив с информацией о строениях по запрошенной карте
+		void WriteMapBuilds(JsonWriter& writer, const model::Map* data) {
+			writer.StartArray();
 
 			// бежим по массиву строений
 			for (auto& build : data->GetBuildings()) {
 
 				// записываем параметры строения
-				json::object pre_result{
-					{ "x", build.GetBounds().position.x },
-					{ "y", build.GetBounds().position.y },
-					{ "w", build.GetBounds().size.width },
-					{ "h", build.GetBounds().size.height }
-				};
-
-				result.push_back(pre_result);
+				writer.StartObject()
+					.Key("x").Int(build.GetBounds().position.x)
+					.Key("y").Int(build.GetBounds().position.y)
+					.Key("w").Int(build.GetBounds().size.width)
+					.Key("h").Int(build.GetBounds().size.height)
+					.EndObject();
 			}
-			
-			return result;
+
+			writer.EndArray();
 		}
 
-		// возвращает json-массив с информацией о дорогах по запрошенной карте
-		json::array GetMapRoads(const model::Map* data) {
-			json::array result;
+		// записывает json-массив с информацией о дорогах по запрошенной карте
+		void WriteMapRoads(JsonWriter& writer, const model::Map* data) {
+			writer.StartArray();
 
 			// бежим по массиву дорог
 			for (auto& road : data->GetRoads()) {
 
 				// записываем координаты начала дороги
-				json::object pre_result{
-					{ "x0", road.GetStart().x },
-					{ "y0", road.GetStart().y },
-				};
+				writer.StartObject()
+					.Key("x0").Int(road.GetStart().x)
+					.Key("y0").Int(road.GetStart().y);
 
 				// добавляем координату конца дороги
 				if (road.IsHorizontal()) {
-					pre_result.emplace("x1", road.GetEnd().x);
+					writer.Key("x1").Int(road.GetEnd().x);
 				}
 				else {
-					pre_result.emplace("y1", road.GetEnd().y);
+					writer.Key("y1").Int(road.GetEnd().y);
 				}
 
-				result.push_back(pre_result);
+				writer.EndObject();
 			}
 
-			return result;
+			writer.EndArray();
 		}
 
-		// возвращает json-массив с информацией о инвентаре игрока
-		json::array GetPlayerBag(const game_handler::Player& player) {
-			json::array result;
+		// записывает json-массив с информацией о инвентаре игрока
+		void WritePlayerBag(JsonWriter& writer, const game_handler::Player& player) {
+			writer.StartArray();
 
 			for (const auto& item : player.GetBag()) {
-				result.push_back(
-					json::object{
-						{"id", item.index_}, {"type", item.loot_->type_}
+				writer.StartObject().Key("id").Uint(item.index_).Key("type").Uint(item.loot_->type_).EndObject();
+			}
+
+			writer.EndArray();
+		}
+
+		// записывает игрока словаря players в ответе о состоянии: ключ id и данные игрока
+		void WritePlayerState(JsonWriter& writer, const game_handler::Player& player) {
+
+			writer.Key(player.GetId()).StartObject();
+
+			game_handler::PlayerPosition pos = player.GetCurrentPosition();
+			writer.Key("pos").StartArray().Double(pos.x_).Double(pos.y_).EndArray();
+
+			game_handler::PlayerSpeed speed = player.GetSpeed();
+			writer.Key("speed").StartArray().Double(speed.xV_).Double(speed.yV_).EndArray();
+
+			writer.Key("dir");
+			switch (player.GetDirection())      // данные по направлению
+			{
+			default:
+				case game_handler::PlayerDirection::NORTH:
+					writer.String("U");
+					break;
+				case game_handler::PlayerDirection::SOUTH:
+					writer.String("D");
+					break;
+				case game_handler::PlayerDirection::WEST:
+					writer.String("L");
+					break;
+				case game_handler::PlayerDirection::EAST:
+					writer.String("R");
+					break;
+				break;
+			}
+
+			// загружаем инвентарь игрока
+			writer.Key("bag");
+			WritePlayerBag(writer, player);
+
+			// загружаем данные о очках игрока
+			writer.Key("score").Uint(player.GetScore());
+
+			writer.EndObject();
+		}
+
+		// записывает предмет словаря lostObjects в ответе о состоянии: ключ id и данные предмета
+		void WriteLootState(JsonWriter& writer, size_t id, const game_handler::GameLoot& loot) {
+			writer.Key(id).StartObject()
+				.Key("type").Uint(loot.type_)
+				.Key("pos").StartArray().Double(loot.pos_.x_).Double(loot.pos_.y_).EndArray()
+				.EndObject();
+		}
+
+		// проходит по игрокам и луту сессии и передаёт их кодировщику, для разности только изменённые
+		template <typename Encoder>
+		void EncodeSessionState(Encoder& encoder, const game_handler::SessionPlayers& players,
+			const game_handler::SessionLoots& loots, const game_handler::StateDelta* delta) {
+
+			encoder.StartState(delta);
+
+			if (!delta) {
+				encoder.StartPlayers(players.size());
+				for (const auto& [token, player] : players) {
+					encoder.Player(player);
+				}
+
+				encoder.StartLoots(loots.size());
+				for (const auto& [id, loot] : loots) {
+					// записываем данные о луте на карте сессии
+					encoder.Loot(id, loot);
+				}
+
+				return encoder.EndState(delta);
+			}
+
+			// в разность попадают только изменённые игроки, которые ещё в сессии
+			auto is_changed = [delta](const game_handler::Player& player) {
+				return std::binary_search(delta->players_.begin(), delta->players_.end(), player.GetId());
+			};
+
+			// двоичной кодировке число записей нужно заранее, поэтому игроки проходятся дважды
+			size_t players_count = delta->players_.empty() ? 0 : std::count_if(players.begin(), players.end(),
+				[&is_changed](const auto& item) { return is_changed(item.second); });
+
+			encoder.StartPlayers(players_count);
+			if (players_count != 0) {
+				for (const auto& [token, player] : players) {
+					if (is_changed(player)) {
+						encoder.Player(player);
 					}
-				);
+				}
+			}
+
+			// лут мог быть подобран в том же окне версий
+			size_t loots_count = std::count_if(delta->loots_.begin(), delta->loots_.end(),
+				[&loots](size_t id) { return loots.count(id) != 0; });
+
+			encoder.StartLoots(loots_count);
+			for (size_t id : delta->loots_) {
+				if (auto it = loots.find(id); it != loots.end()) {
+					encoder.Loot(id, it->second);
+				}
+			}
+
+			encoder.EndState(delta);
+		}
+
+		void JsonStateEncoder::StartState(const game_handler::StateDelta* delta) {
+			writer_.StartObject();
+			if (delta) {
+				writer_.Key("baseVersion").Uint(delta->base_version_).Key("version").Uint(delta->version_);
+			}
+		}
+
+		void JsonStateEncoder::StartPlayers([[maybe_unused]] size_t count) {
+			writer_.Key("players").StartObject();
+		}
+
+		void JsonStateEncoder::Player(const game_handler::Player& player) {
+			WritePlayerState(writer_, player);
+		}
+
+		void JsonStateEncoder::StartLoots([[maybe_unused]] size_t count) {
+			writer_.EndObject().Key("lostObjects").StartObject();
+		}
+
+		void JsonStateEncoder::Loot(size_t id, const game_handler::GameLoot& loot) {
+			WriteLootState(writer_, id, loot);
+		}
+
+		void JsonStateEncoder::EndState(const game_handler::StateDelta* delta) {
+			writer_.EndObject();
+
+			if (delta) {
+				writer_.Key("removedPlayers").StartArray();
+				for (size_t id : delta->removed_players_) {
+					writer_.Uint(id);
+				}
+
+				writer_.EndArray().Key("removedObjects").StartArray();
+				for (size_t id : delta->removed_loots_) {
+					writer_.Uint(id);
+				}
+				writer_.EndArray();
+			}
+
+			writer_.EndObject();
+		}
+
+		void BinaryStateEncoder::StartState(const game_handler::StateDelta* delta) {
+			writer_.Byte(__BINARY_STATE_FORMAT__).Byte(delta ? 1 : 0);
+			if (delta) {
+				writer_.Varint(delta->base_version_).Varint(delta->version_);
 			}
+		}
+
+		void BinaryStateEncoder::StartPlayers(size_t count) {
+			writer_.Varint(count);
+		}
 
-			return result;
+		void BinaryStateEncoder::Player(const game_handler::Player& player) {
+			game_handler::PlayerPosition pos = player.GetCurrentPosition();
+			game_handler::PlayerSpeed speed = player.GetSpeed();
+
+			writer_.Varint(player.GetId())
+				.Fixed(pos.x_).Fixed(pos.y_)
+				.Fixed(speed.xV_).Fixed(speed.yV_)
+				.Byte(static_cast<uint8_t>(player.GetDirection()));
+
+			// инвентарь игрока
+			writer_.Varint(player.GetBagSize());
+			for (const auto& item : player.GetBag()) {
+				writer_.Varint(item.index_).Varint(item.loot_->type_);
+			}
+
+			writer_.Varint(player.GetScore());
+		}
+
+		void BinaryStateEncoder::StartLoots(size_t count) {
+			writer_.Varint(count);
+		}
+
+		void BinaryStateEncoder::Loot(size_t id, const game_handler::GameLoot& loot) {
+			writer_.Varint(id).Varint(loot.type_).Fixed(loot.pos_.x_).Fixed(loot.pos_.y_);
+		}
+
+		void BinaryStateEncoder::EndState(const game_handler::StateDelta* delta) {
+			if (!delta) {
+				return;
+			}
+
+			writer_.Varint(delta->removed_players_.size());
+			for (size_t id : delta->removed_players_) {
+				writer_.Varint(id);
+			}
+
+			writer_.Varint(delta->removed_loots_.size());
+			for (size_t id : delta->removed_loots_) {
+				writer_.Varint(id);
+			}
 		}
 
 	} // namespace detail
@@ -6,12 +6,21 @@
 #include <boost/json.hpp>
 
 #include "domain.h"
+#include "json_writer.h"
+#include "binary_writer.h"
 
 namespace json_detail {
 
 	using namespace std::literals;
 	namespace json = boost::json;
 
+	// начальные оценки размера ответов, чтобы буфер выделялся один раз
+	static constexpr size_t __MAP_INFO_RESERVE__ = 4096;
+	static constexpr size_t __PLAYERS_LIST_ITEM_RESERVE__ = 32;
+	static constexpr size_t __STATE_PLAYER_RESERVE__ = 128;
+	static constexpr size_t __STATE_LOOT_RESERVE__ = 64;
+	static constexpr size_t __RECORDS_ITEM_RESERVE__ = 64;
+
 	// парсер входящей строки из текста в boost::json
 	json::value ParseTextToJSON(std::string_view line);
 
@@ -21,6 +30,8 @@ namespace json_detail {
 	std::string GetErrorString(std::string_view code, std::string_view message);
 	// возвращает строковое представление json-словаря с полной информацией по запрошенной карте
 	std::string GetMapInfo(const model::Map* data);
+	// дописывает в буфер json-словарь с полной информацией по запрошенной карте
+	void WriteMapInfo(std::string& buffer, const model::Map* data);
 	// возвращает строковое представление json-массива с полной информацией по вектору карт игры
 	std::string GetMapsList(const std::vector<model::Map>& maps);
 
@@ -32,8 +43,31 @@ namespace json_detail {
 	std::string GetSessionPlayersList(game_handler::SPIterator begin, game_handler::SPIterator end);
 	// возвращает строковое представление json_словаря с информацией о всех игроках в указанной сессии
 	std::string GetSessionPlayersList(const game_handler::SessionPlayers& players);
+	// дописывает в буфер json_словарь с информацией о всех игроках в указанной сессии
+	void WriteSessionPlayersList(std::string& buffer, const game_handler::SessionPlayers& players);
 	// возвращает строковое представление json_словаря с информацией о состоянии в указанной сессии
 	std::string GetSessionStateList(const game_handler::SessionPlayers& players, const game_handler::SessionLoots& loots);
+
+	/*
+	* Состояние сессии пишется одним проходом по игрокам и луту для обеих кодировок,
+	* кодировка определяет только кодировщик: detail::JsonStateEncoder или detail::BinaryStateEncoder.
+	*
+	* Двоичная кодировка application/x-game-state (см. binary_detail::BinaryWriter), все числа varint:
+	*  байт формата __BINARY_STATE_FORMAT__, байт вида: 0 - полное состояние, 1 - разность
+	*  для разности: базовая версия, версия
+	*  число игроков, на каждого: id, pos x y и speed x y с фиксированной точкой, байт направления (U D L R -> 0 1 2 3),
+	*      число предметов в сумке, на каждый: id и тип, затем очки
+	*  число предметов лута, на каждый: id, тип, pos x y с фиксированной точкой
+	*  для разности: число удалённых игроков и их id, число убранного лута и его id
+	*/
+
+	// дописывает в буфер словарь с информацией о состоянии в указанной сессии, без промежуточного json::object
+	void WriteSessionStateList(std::string& buffer, const game_handler::SessionPlayers& players, const game_handler::SessionLoots& loots,
+		game_handler::StateEncoding encoding = game_handler::StateEncoding::JSON);
+	// дописывает в буфер словарь с изменениями состояния сессии относительно версии delta.base_version_
+	void WriteSessionStateDelta(std::string& buffer, const game_handler::SessionPlayers& players,
+		const game_handler::SessionLoots& loots, const game_handler::StateDelta& delta,
+		game_handler::StateEncoding encoding = game_handler::StateEncoding::JSON);
 	// возвращает строковое представление json_массива с информацией о игровых рекордах
 	std::string GetRecordsTable(const std::optional<std::vector<postgres::detail::DBGameRecord>>& records);
 
@@ -43,14 +77,66 @@ namespace json_detail {
 		json::value GetDebugArgument(std::string_view argument, std::string_view value);
 		// возвращает json-словарь с информацией по коду и сообщению о ошибке
 		json::value GetErrorValue(std::string_view code, std::string_view message);
-		// возвращает json-массив с информацией о офисах по запрошенной карте
-		json::array GetMapOffices(const model::Map* data);
-		// возвращает json-массив с информацией о строениях по запрошенной карте
-		json::array GetMapBuilds(const model::Map* data);
-		// возвращает json-массив с информацией о дорогах по запрошенной карте
-		json::array GetMapRoads(const model::Map* data);
-		// возвращает json-массив с информацией о инвентаре игрока
-		json::array GetPlayerBag(const game_handler::Player& player);
+		// записывает json-массив с информацией о офисах по запрошенной карте
+		void WriteMapOffices(JsonWriter& writer, const model::Map* data);
+		// записывает json-массив с информацией о строениях по запрошенной карте
+		void WriteMapBuilds(JsonWriter& writer, const model::Map* data);
+		// записывает json-массив с информацией о дорогах по запрошенной карте
+		void WriteMapRoads(JsonWriter& writer, const model::Map* data);
+		// записывает json-массив с информацией о инвентаре игрока
+		void WritePlayerBag(JsonWriter& writer, const game_handler::Player& player);
+		// записывает игрока словаря players в ответе о состоянии: ключ id и данные игрока
+		void WritePlayerState(JsonWriter& writer, const game_handler::Player& player);
+		// записывает предмет словаря lostObjects в ответе о состоянии: ключ id и данные предмета
+		void WriteLootState(JsonWriter& writer, size_t id, const game_handler::GameLoot& loot);
+
+		// номер двоичного формата состояния, меняется при несовместимых изменениях
+		static constexpr uint8_t __BINARY_STATE_FORMAT__ = 1;
+
+		// кодировщик состояния сессии в JSON, вид ответа /v1/game/state
+		class JsonStateEncoder {
+		public:
+			explicit JsonStateEncoder(std::string& buffer)
+				: writer_(buffer) {
+			}
+
+			// начинает состояние, для разности delta не nullptr
+			void StartState(const game_handler::StateDelta* delta);
+			void StartPlayers(size_t count);
+			void Player(const game_handler::Player& player);
+			void StartLoots(size_t count);
+			void Loot(size_t id, const game_handler::GameLoot& loot);
+			// заканчивает состояние, для разности дописывает удалённых игроков и лут
+			void EndState(const game_handler::StateDelta* delta);
+
+		private:
+			JsonWriter writer_;
+		};
+
+		// кодировщик состояния сессии в двоичный формат application/x-game-state
+		class BinaryStateEncoder {
+		public:
+			explicit BinaryStateEncoder(std::string& buffer)
+				: writer_(buffer) {
+			}
+
+			// начинает состояние, для разности delta не nullptr
+			void StartState(const game_handler::StateDelta* delta);
+			void StartPlayers(size_t count);
+			void Player(const game_handler::Player& player);
+			void StartLoots(size_t count);
+			void Loot(size_t id, const game_handler::GameLoot& loot);
+			// заканчивает состояние, для разности дописывает удалённых игроков и лут
+			void EndState(const game_handler::StateDelta* delta);
+
+		private:
+			binary_detail::BinaryWriter writer_;
+		};
+
+		// проходит по игрокам и луту сессии и передаёт их кодировщику, для разности только изменённые
+		template <typename Encoder>
+		void EncodeSessionState(Encoder& encoder, const game_handler::SessionPlayers& players,
+			const game_handler::SessionLoots& loots, const game_handler::StateDelta* delta);
 
 	} // namespace detail
 
@@ -1,5 +1,8 @@
 ﻿#include "collision_handler.h"
 
+#include <cmath>
+#include <algorithm>
+
 namespace game_handler {
 
     static const double GetBasePlayerUnitRadius() {
@@ -38,21 +41,159 @@ namespace game_handler {
         return lhs.time < rhs.time;
     }
     
+    // -------------------------- class CollisionBroadphase -------------------
+
+    // перестраивает индекс по текущему луту и офисам провайдера
+    void CollisionBroadphase::Rebuild(const CollisionProvider& provider) {
+
+        items_.clear();
+        items_.reserve(provider.GetLoots().size() + provider.OfficesCount());
+        max_item_radius_ = 0.0;
+
+        for (const auto& [id, loot] : provider.GetLoots()) {
+            items_.push_back({ CollisionEventType::GATHERING, id, loot.pos_, GetBaseLootUnitRadius() });
+        }
+
+        for (size_t i = 0; i != provider.OfficesCount(); ++i) {
+            const model::Office& office = provider.GetOffice(i);
+            items_.push_back({ CollisionEventType::RETURN, i, PlayerPosition{ office.GetPosition() }, GetBaseOfficeUnitRadius() });
+        }
+
+        for (const auto& item : items_) {
+            max_item_radius_ = std::max(max_item_radius_, item.radius);
+        }
+
+        BuildIndex();
+    }
+
+    // возвращает номер целочисленной клетки дороги, в которую попадает координата
+    int CollisionBroadphase::GetCellIndex(double value) {
+        // клетка дороги - квадрат со стороной 1 вокруг целочисленной точки
+        return static_cast<int>(std::floor(value + 0.5));
+    }
+
+    // -------------------------- class UniformGridBroadphase -----------------
+
+    void UniformGridBroadphase::BuildIndex() {
+
+        for (auto& [key, cell] : cells_) {
+            cell.clear();
+        }
+
+        for (size_t i = 0; i != items_.size(); ++i) {
+            cells_[GetCellKey(GetCellIndex(items_[i].position.x_), GetCellIndex(items_[i].position.y_))].push_back(i);
+        }
+    }
+
+    void UniformGridBroadphase::QueryImpl(PlayerPosition from, PlayerPosition to, double reach, std::vector<const CollisionItem*>& result) const {
+
+        // перебираем клетки прямоугольника, охватывающего отрезок с запасом досягаемости
+        int first_x = GetCellIndex(std::min(from.x_, to.x_) - reach);
+        int last_x = GetCellIndex(std::max(from.x_, to.x_) + reach);
+        int first_y = GetCellIndex(std::min(from.y_, to.y_) - reach);
+        int last_y = GetCellIndex(std::max(from.y_, to.y_) + reach);
+
+        for (int y = first_y; y <= last_y; ++y) {
+            for (int x = first_x; x <= last_x; ++x) {
+
+                auto cell = cells_.find(GetCellKey(x, y));
+                if (cell == cells_.end()) {
+                    continue;
+                }
+
+                for (size_t index : cell->second) {
+                    result.push_back(&items_[index]);
+                }
+            }
+        }
+    }
+
+    // возвращает ключ клетки сетки
+    uint64_t UniformGridBroadphase::GetCellKey(int x, int y) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+
+    // -------------------------- class RoadSegmentBroadphase -----------------
+
+    void RoadSegmentBroadphase::BuildIndex() {
+
+        rows_.clear();
+        columns_.clear();
+
+        for (size_t i = 0; i != items_.size(); ++i) {
+            const PlayerPosition& position = items_[i].position;
+            rows_.push_back({ GetCellIndex(position.y_), position.x_, i });
+            columns_.push_back({ GetCellIndex(position.x_), position.y_, i });
+        }
+
+        auto comparator = [](const LineEntry& lhs, const LineEntry& rhs) {
+            return lhs.line < rhs.line || (lhs.line == rhs.line && lhs.coord < rhs.coord);
+        };
+
+        std::sort(rows_.begin(), rows_.end(), comparator);
+        std::sort(columns_.begin(), columns_.end(), comparator);
+    }
+
+    void RoadSegmentBroadphase::QueryImpl(PlayerPosition from, PlayerPosition to, double reach, std::vector<const CollisionItem*>& result) const {
+
+        double min_x = std::min(from.x_, to.x_);
+        double max_x = std::max(from.x_, to.x_);
+        double min_y = std::min(from.y_, to.y_);
+        double max_y = std::max(from.y_, to.y_);
+
+        if (from.x_ == to.x_) {
+            // вертикальное перемещение, смотрим столбцы клеток в пределах досягаемости по X
+            ScanLines(columns_, GetCellIndex(min_x - reach), GetCellIndex(max_x + reach), min_y - reach, max_y + reach, result);
+        }
+        else {
+            // горизонтальное перемещение, а на всякий случай и любое другое, смотрим строки клеток по Y
+            ScanLines(rows_, GetCellIndex(min_y - reach), GetCellIndex(max_y + reach), min_x - reach, max_x + reach, result);
+        }
+    }
+
+    // добавляет в result предметы строк или столбцов с first_line по last_line с координатой в диапазоне [low, high]
+    void RoadSegmentBroadphase::ScanLines(const std::vector<LineEntry>& lines, int first_line, int last_line,
+        double low, double high, std::vector<const CollisionItem*>& result) const {
+
+        for (int line = first_line; line <= last_line; ++line) {
+
+            auto it = std::lower_bound(lines.begin(), lines.end(), LineEntry{ line, low, 0 },
+                [](const LineEntry& lhs, const LineEntry& rhs) {
+                    return lhs.line < rhs.line || (lhs.line == rhs.line && lhs.coord < rhs.coord);
+                });
+
+            for (; it != lines.end() && it->line == line && it->coord <= high; ++it) {
+                result.push_back(&items_[it->item]);
+            }
+        }
+    }
+
+    // -------------------------- FindCollisionEvents -------------------------
+
     std::vector<CollisionEvent> FindCollisionEvents(const CollisionProvider& provider) {
 
         std::vector<CollisionEvent> result;
+        // широкая фаза, если провайдер её предоставляет, и буфер отобранных ею предметов
+        const CollisionBroadphase* broadphase = provider.GetBroadphase();
+        std::vector<const CollisionItem*> candidates;
 
         // будем за O(N(K + M)) проверять возможные коллизии через CheckPossibleCollision
         // где N - число игроков, K - число предметов, M - число офисов
-        // Цикл с индексом только для офисов, данные которых хранятся в обычном векторе
+        // Игроки перебираются линейно по слотам плотного хранилища их состояния
+
+        const PlayersColumns& players = provider.GetPlayers().GetColumns();
 
-        for (const auto& [token, player] : provider.GetPlayers()) {
+        for (size_t slot = 0; slot != players.Size(); ++slot) {
+
+            const Token* token = players.tokens_[slot];
+            const PlayerPosition& current_position = players.current_positions_[slot];
+            const PlayerPosition& future_position = players.future_positions_[slot];
 
             // проверять будем если чубака перемещается
             // для этого должны быть разные позиции текущих и будущих координат
             // иначе в TryCollectPoint() выстрелит ассерт, а нам этого не надо
             // ровно также если чубака уже стоит на точке с коллизией, то он уже собрал предмет или у него забитый мешок
-            if (player.GetCurrentPosition() != player.GetFuturePosition()) {
+            if (current_position != future_position) {
 
                 // так как данный метод только определяет возможные коллизии, 
                 // но никак не влияет на игровое состояние, то не его задача определять
@@ -60,11 +201,29 @@ namespace game_handler {
                 // а уже CollisionProvider сам разберется, что и как исполнять
                 // потому тут нет никаких проверок на вместимости и прочее, пишем все, босс разберется
 
+                if (broadphase) {
+                    // точно проверяем только предметы, отобранные широкой фазой
+                    candidates.clear();
+                    broadphase->Query(current_position, future_position, GetBasePlayerUnitRadius(), candidates);
+
+                    for (const CollisionItem* item : candidates) {
+
+                        auto collision = CheckPossibleCollision(current_position, future_position, item->position);
+
+                        if (collision.IsCollision(GetBasePlayerUnitRadius() + item->radius)) {
+                            // тип эвента, индекс предмета или офиса, индекс чубаки, дистанция, время
+                            result.push_back({ item->type, item->object_id, token, collision.sq_distance, collision.proj_ratio });
+                        }
+                    }
+
+                    continue;
+                }
+
                 for (const auto& loot : provider.GetLoots()) {
 
                     // пробуем проверить возможную коллизию предмета с путём перемещения игрока
                     auto collision = CheckPossibleCollision(
-                        player.GetCurrentPosition(), player.GetFuturePosition(), loot.second.pos_);
+                        current_position, future_position, loot.second.pos_);
 
                     // если удалось свершилась коллизия с предметом
                     if (collision.IsCollision(
@@ -87,7 +246,7 @@ namespace game_handler {
                         static_cast<double>(office.GetPosition().x),  static_cast<double>(office.GetPosition().y) };
                     // пробуем проверить возможную коллизию офиса с путём перемещения игрока
                     auto collision = CheckPossibleCollision(
-                        player.GetCurrentPosition(), player.GetFuturePosition(), office_pos);
+                        current_position, future_position, office_pos);
 
                     // если удалось свершилась коллизия с предметом
                     if (collision.IsCollision(
@@ -3,6 +3,8 @@
 #include "domain.h"
 
 #include <vector>
+#include <cstdint>
+#include <unordered_map>
 
 namespace game_handler {
 
@@ -27,6 +29,8 @@ namespace game_handler {
         double proj_ratio;
     };
 
+    class CollisionBroadphase;
+
     // провайдер данных о игроках, предметах и офисах в функцию определения коллизии
     class CollisionProvider {
     protected:
@@ -39,6 +43,8 @@ namespace game_handler {
         * Смысл в том, что так проще добавлять и удалять элементы динамически в процессе игры
         * Таким образом методы получения элементов массива по индексу бессмысленны.
         * Словарь и так хранит уникальный id в качестве ключа и данные в качестве значения.
+        * Состояние игроков при этом лежит в плотном хранилище SessionPlayers::GetColumns(),
+        * которое FindCollisionEvents проходит линейно по слотам.
         * Офисы же храятся в модели особым образом, но офисы не добавляются и не удаляются в процессе игры
         * GameSession будет наследовать этот интерфейс и выполнять обновления положения игроков,
         * сбор и сдачу предметов, после расчёта всех возможых коллизий в FindCollisionEvents.
@@ -52,6 +58,13 @@ namespace game_handler {
         virtual const SessionPlayers& GetPlayers() const = 0;
         // возвращает ссылку на константную мапу лута
         virtual const SessionLoots& GetLoots() const = 0;
+        /*
+        * Возвращает широкую фазу поиска коллизий, построенную по текущему луту и офисам провайдера.
+        * Если широкой фазы нет, то FindCollisionEvents проверяет каждого игрока с каждым предметом.
+        */
+        virtual const CollisionBroadphase* GetBroadphase() const {
+            return nullptr;
+        }
 
         //// возвращает количество предметов лута на карте игровой сессии
         //virtual size_t LootsCount() const = 0;
@@ -81,11 +94,92 @@ namespace game_handler {
     // компаратор для сортировки массива событий по времени
     bool CollisionEventsTimeComparator(const CollisionEvent& lhs, const CollisionEvent& rhs);
 
+    // предмет, проиндексированный широкой фазой: лут или офис бюро находок
+    struct CollisionItem {
+        CollisionEventType type;        // GATHERING для лута, RETURN для офиса
+        size_t object_id;               // id лута или индекс офиса
+        PlayerPosition position;        // позиция предмета
+        double radius;                  // радиус предмета
+    };
+
+    /*
+    * Широкая фаза определения коллизий.
+    * Индексирует лут и офисы провайдера и по отрезку перемещения игрока отдаёт только предметы,
+    * которые лежат в пределах досягаемости отрезка. Точная проверка остаётся за FindCollisionEvents.
+    * Индекс нужно перестраивать через Rebuild после изменения лута и до поиска коллизий.
+    */
+    class CollisionBroadphase {
+    public:
+        virtual ~CollisionBroadphase() = default;
+
+        // перестраивает индекс по текущему луту и офисам провайдера
+        void Rebuild(const CollisionProvider& provider);
+        // добавляет в result предметы, которые могут попасть в коллизию с игроком, идущим по отрезку from -> to
+        void Query(PlayerPosition from, PlayerPosition to, double player_radius, std::vector<const CollisionItem*>& result) const {
+            QueryImpl(from, to, player_radius + max_item_radius_, result);
+        }
+
+    protected:
+        // строит индекс по собранным в items_ предметам
+        virtual void BuildIndex() = 0;
+        // добавляет в result предметы, лежащие не дальше reach от отрезка from -> to, допускаются лишние
+        virtual void QueryImpl(PlayerPosition from, PlayerPosition to, double reach, std::vector<const CollisionItem*>& result) const = 0;
+
+        // возвращает номер целочисленной клетки дороги, в которую попадает координата
+        static int GetCellIndex(double value);
+
+        std::vector<CollisionItem> items_;                      // лут и офисы провайдера
+        double max_item_radius_ = 0.0;                          // наибольший радиус среди предметов
+    };
+
+    // широкая фаза на равномерной сетке с клетками по целочисленным координатам дорог
+    class UniformGridBroadphase final : public CollisionBroadphase {
+    private:
+        void BuildIndex() override;
+        void QueryImpl(PlayerPosition from, PlayerPosition to, double reach, std::vector<const CollisionItem*>& result) const override;
+
+        // возвращает ключ клетки сетки
+        static uint64_t GetCellKey(int x, int y);
+
+        // индексы предметов по клеткам, пустые клетки не удаляются, чтобы не перевыделять память каждый тик
+        std::unordered_map<uint64_t, std::vector<size_t>> cells_;
+    };
+
+    /*
+    * Широкая фаза по отрезкам дорог.
+    * Игроки двигаются только вдоль осей, поэтому предметы разложены по строкам клеток,
+    * отсортированным по X, для горизонтальных перемещений, и по столбцам клеток,
+    * отсортированным по Y, для вертикальных. Запрос - бинарный поиск в нескольких строках или столбцах.
+    */
+    class RoadSegmentBroadphase final : public CollisionBroadphase {
+    private:
+        // запись индекса: номер строки или столбца клеток и координата вдоль него
+        struct LineEntry {
+            int line;
+            double coord;
+            size_t item;
+        };
+
+        void BuildIndex() override;
+        void QueryImpl(PlayerPosition from, PlayerPosition to, double reach, std::vector<const CollisionItem*>& result) const override;
+
+        // добавляет в result предметы строк или столбцов с first_line по last_line с координатой в диапазоне [low, high]
+        void ScanLines(const std::vector<LineEntry>& lines, int first_line, int last_line,
+            double low, double high, std::vector<const CollisionItem*>& result) const;
+
+        std::vector<LineEntry> rows_;                           // предметы по строкам клеток, упорядочены по Y, затем по X
+        std::vector<LineEntry> columns_;                        // предметы по столбцам клеток, упорядочены по X, затем по Y
+    };
+
+    // проверяет проход отрезка перемещения from -> to мимо точки item, отрезок должен быть ненулевым
+    CollisionResult CheckPossibleCollision(PlayerPosition from, PlayerPosition to, PlayerPosition item);
+
     /*
     * Проверяет возможые коллизии игроков с игровыми прежметами, и игроков с офисами бюро находок
     * Определение коллизий осуществляется только в том случае, если игрок имеет разные текйщие и будущие координаты
     * Запись будущих координат игроков должна быть осуществлена заранее в классе, реализующем интерфейс CollisionProvider
     * Экземпляр интерфейса CollisionProvider подается в качестве константной ссылки
+    * Если провайдер отдаёт широкую фазу, то точная проверка выполняется только для отобранных ею предметов
     */
     std::vector<CollisionEvent> FindCollisionEvents(const CollisionProvider& provider);
 
@@ -6,6 +6,7 @@
 #include "sdk.h"
 #include "player.h"
 #include "postgres/postgers.h"
+#include "request_router.h"
 // boost.beast будет использовать std::string_view вместо boost::string_view
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
@@ -44,23 +45,312 @@ namespace http_handler {
 
     using Strand = net::strand<net::io_context::executor_type>;
 
-    static const std::unordered_map<std::string, char> __ASCII_CODE_TO_CHAR__ = {
-        {"%20", ' '}, {"%21", '!'}, {"%22", '\"'}, {"%23", '#'}, {"%24", '$'}, {"%25", '%'}, {"%26", '&'}, {"%27", '\''}, {"%28", '('}, {"%29", ')'},
-        {"%2a", '*'}, {"%2b", '+'}, {"%2c", ','}, {"%2d", '-'}, {"%2e", '.'}, {"%2f", '/'}, {"%30", '`'}, {"%3a", ':'}, {"%3b", ';'}, {"%3c", '<'},
-        {"%3d", '='}, {"%3e", '>'}, {"%3f", '?'}, {"%40", '@'}, {"%5b", '['}, {"%5c", '\\'}, {"%5d", ']'}, {"%5e", '^'}, {"%5f", '_'}
-    };
-
     // Запрос, тело которого представлено в виде строки
     using StringRequest = http::request<http::string_body>;
     // Ответ, тело которого представлено в виде строки
     using StringResponse = http::response<http::string_body>;
     // Ответ, тело которого представленно в виде файла
     using FileResponse = http::response<http::file_body>;
+
+    /*
+    * Тело ответа, разделяющее один готовый неизменяемый буфер между многими ответами.
+    * Ответ хранит только shared_ptr, буфер не копируется и живёт, пока его пишет хотя бы один ответ.
+    * Применяется для кешированного состояния игровой сессии, которое одинаково для всех опрашивающих игроков.
+    */
+    struct SharedStringBody {
+        using value_type = std::shared_ptr<const std::string>;
+
+        static std::uint64_t size(const value_type& body) {
+            return body ? body->size() : 0;
+        }
+
+        class writer {
+        public:
+            using const_buffers_type = net::const_buffer;
+
+            template <bool isRequest, class Fields>
+            writer(const http::header<isRequest, Fields>&, const value_type& body)
+                : body_(body) {
+            }
+
+            void init(beast::error_code& ec) {
+                ec = {};
+            }
+
+            boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+                ec = {};
+                if (!body_ || body_->empty()) {
+                    return boost::none;
+                }
+                return { { net::const_buffer(body_->data(), body_->size()), false } };
+            }
+
+        private:
+            const value_type& body_;
+        };
+    };
+
+    // Ответ, тело которого разделяется с другими ответами без копирования
+    using SharedResponse = http::response<SharedStringBody>;
+
+    // файлы от этого размера отдаются через sendfile, меньшие дешевле прочитать в буфер file_body
+    static const uint64_t __SENDFILE_MIN_SIZE__ = 64 * 1024;
+
+    /*
+    * Раскладка тела ответа по участкам содержимого файла.
+    * Без частей тело - один участок [offset, offset + size), так отдаётся весь файл или один участок Range.
+    * С частями тело - multipart/byteranges: перед каждым участком идёт заголовок части, в конце - закрывающая граница.
+    * Тело перечисляется сегментами: сегмент - либо текст из памяти, либо участок содержимого.
+    */
+    class BodyRanges {
+    public:
+        struct Segment {
+            bool content = true;        // участок содержимого, иначе текст заголовка части
+            std::string_view text;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+        };
+
+        // тело - один участок содержимого
+        void SetRange(uint64_t offset, uint64_t size) {
+            parts_.clear();
+            suffix_.clear();
+            offset_ = offset;
+            size_ = size;
+        }
+        // добавляет часть multipart/byteranges: заголовок части и участок содержимого
+        void AddPart(std::string header, uint64_t offset, uint64_t size) {
+            parts_.push_back({ std::move(header), offset, size });
+        }
+        // задаёт закрывающую границу multipart/byteranges
+        void SetSuffix(std::string suffix) {
+            suffix_ = std::move(suffix);
+        }
+
+        /*
+        * Раскладывает тело как multipart/byteranges по участкам ranges файла размера file_size:
+        * перед каждым участком идёт заголовок части с content_type и Content-Range, в конце - закрывающая граница.
+        * Возвращает значение заголовка Content-Type ответа.
+        */
+        std::string SetByteRanges(const ByteRanges& ranges, uint64_t file_size, std::string_view content_type,
+            std::string_view boundary) {
+
+            parts_.clear();
+            for (size_t i = 0; i != ranges.count; ++i) {
+                std::string header = (i == 0 ? ""s : "\r\n"s) + "--" + std::string(boundary) + "\r\nContent-Type: "
+                    + std::string(content_type) + "\r\nContent-Range: " + ContentRange(ranges.ranges[i], file_size) + "\r\n\r\n";
+                AddPart(std::move(header), ranges.ranges[i].offset, ranges.ranges[i].size);
+            }
+            SetSuffix("\r\n--" + std::string(boundary) + "--\r\n");
+            return "multipart/byteranges; boundary=" + std::string(boundary);
+        }
+
+        // значение Content-Range для участка файла размера file_size: "bytes 0-99/1000"
+        static std::string ContentRange(const ByteRange& range, uint64_t file_size) {
+            return "bytes "s + std::to_string(range.offset) + '-' + std::to_string(range.offset + range.size - 1)
+                + '/' + std::to_string(file_size);
+        }
+
+        // размер тела вместе с заголовками частей
+        uint64_t Size() const {
+            if (parts_.empty()) {
+                return size_;
+            }
+            uint64_t size = suffix_.size();
+            for (const auto& part : parts_) {
+                size += part.header.size() + part.size;
+            }
+            return size;
+        }
+
+        size_t SegmentCount() const {
+            return parts_.empty() ? 1 : parts_.size() * 2 + 1;
+        }
+        Segment GetSegment(size_t index) const {
+            if (parts_.empty()) {
+                return { true, {}, offset_, size_ };
+            }
+            if (index == parts_.size() * 2) {
+                return { false, suffix_, 0, suffix_.size() };
+            }
+            const Part& part = parts_[index / 2];
+            return index % 2 == 0 ? Segment{ false, part.header, 0, part.header.size() } : Segment{ true, {}, part.offset, part.size };
+        }
+
+    private:
+        struct Part {
+            std::string header;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+        };
+
+        uint64_t offset_ = 0;
+        uint64_t size_ = 0;
+        std::vector<Part> parts_;
+        std::string suffix_;
+    };
+
+    /*
+    * Тело ответа - участки открытого файла, которые сессия на Linux передаёт ядру через sendfile(2),
+    * данные идут из файлового кеша прямо в сокет, минуя буферы процесса.
+    * Сериализатор beast записывает только заголовок, тело отправляет SessionBase::WriteSendFile.
+    * writer нужен для прочих платформ: там тело читается в буфер и пишется обычным http::async_write.
+    */
+    struct SendFileBody {
+        class value_type {
+        public:
+            // открывает файл на чтение, отдаётся файл целиком
+            void Open(const char* path, beast::error_code& ec) {
+                file_.open(path, beast::file_mode::scan, ec);
+                if (!ec) {
+                    file_size_ = file_.size(ec);
+                    ranges_.SetRange(0, file_size_);
+                }
+            }
+
+            beast::file& File() {
+                return file_;
+            }
+            // размер файла, в отличие от Size() не зависит от отдаваемых участков
+            uint64_t FileSize() const {
+                return file_size_;
+            }
+            BodyRanges& Ranges() {
+                return ranges_;
+            }
+            const BodyRanges& Ranges() const {
+                return ranges_;
+            }
+            uint64_t Size() const {
+                return ranges_.Size();
+            }
+
+        private:
+            beast::file file_;
+            uint64_t file_size_ = 0;
+            BodyRanges ranges_;
+        };
+
+        static std::uint64_t size(const value_type& body) {
+            return body.Size();
+        }
+
+        class writer {
+        public:
+            using const_buffers_type = net::const_buffer;
+
+            template <bool isRequest, class Fields>
+            writer(const http::header<isRequest, Fields>&, value_type& body)
+                : body_(body) {
+            }
+
+            void init(beast::error_code& ec) {
+                ec = {};
+            }
+
+            boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+                ec = {};
+                for (; segment_ != body_.Ranges().SegmentCount(); ++segment_, position_ = 0) {
+                    BodyRanges::Segment segment = body_.Ranges().GetSegment(segment_);
+                    if (position_ == segment.size) {
+                        continue;
+                    }
+                    if (!segment.content) {
+                        position_ = segment.size;
+                        return { { net::const_buffer(segment.text.data(), segment.text.size()), true } };
+                    }
+
+                    if (position_ == 0) {
+                        body_.File().seek(segment.offset, ec);
+                        if (ec) {
+                            return boost::none;
+                        }
+                    }
+                    size_t amount = body_.File().read(buffer_,
+                        static_cast<size_t>(std::min<uint64_t>(segment.size - position_, sizeof(buffer_))), ec);
+                    if (ec) {
+                        return boost::none;
+                    }
+                    if (amount == 0) {
+                        // файл стал короче, чем при открытии
+                        ec = http::error::short_read;
+                        return boost::none;
+                    }
+                    position_ += amount;
+                    return { { net::const_buffer(buffer_, amount), true } };
+                }
+                return boost::none;
+            }
+
+        private:
+            value_type& body_;
+            size_t segment_ = 0;
+            uint64_t position_ = 0;
+            char buffer_[4096];
+        };
+    };
+
+    /*
+    * Тело ответа - участки файла из кеша в памяти, буфер файла разделяется с другими ответами без копирования.
+    * Применяется для ответов 206 на запросы Range к файлам, загруженным ResourceHandler::PreloadFiles.
+    */
+    struct SharedRangeBody {
+        struct value_type {
+            std::shared_ptr<const std::string> content;
+            BodyRanges ranges;
+        };
+
+        static std::uint64_t size(const value_type& body) {
+            return body.ranges.Size();
+        }
+
+        class writer {
+        public:
+            using const_buffers_type = net::const_buffer;
+
+            template <bool isRequest, class Fields>
+            writer(const http::header<isRequest, Fields>&, const value_type& body)
+                : body_(body) {
+            }
+
+            void init(beast::error_code& ec) {
+                ec = {};
+            }
+
+            boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+                ec = {};
+                // каждый сегмент отдаётся одним буфером
+                while (segment_ != body_.ranges.SegmentCount()) {
+                    BodyRanges::Segment segment = body_.ranges.GetSegment(segment_++);
+                    if (segment.size == 0) {
+                        continue;
+                    }
+                    if (!segment.content) {
+                        return { { net::const_buffer(segment.text.data(), segment.text.size()), true } };
+                    }
+                    return { { net::const_buffer(body_.content->data() + segment.offset, segment.size), true } };
+                }
+                return boost::none;
+            }
+
+        private:
+            const value_type& body_;
+            size_t segment_ = 0;
+        };
+    };
+
+    // Ответ, тело которого отправляется из файла через sendfile
+    using SendFileResponse = http::response<SendFileBody>;
+    // Ответ, тело которого - участки файла из кеша в памяти
+    using SharedRangeResponse = http::response<SharedRangeBody>;
     // Варианты ответов на запросы
-    using Response = std::variant<std::monostate, StringResponse, FileResponse>;
+    using Response = std::variant<std::monostate, StringResponse, FileResponse, SharedResponse, SendFileResponse, SharedRangeResponse>;
 
 #define IS_FILE_RESPONSE(response) std::holds_alternative<http_handler::FileResponse>(response) 
 #define IS_STRING_RESPONSE(response) std::holds_alternative<http_handler::StringResponse>(response) 
+#define IS_SHARED_RESPONSE(response) std::holds_alternative<http_handler::SharedResponse>(response) 
+#define IS_SENDFILE_RESPONSE(response) std::holds_alternative<http_handler::SendFileResponse>(response) 
+#define IS_SHARED_RANGE_RESPONSE(response) std::holds_alternative<http_handler::SharedRangeResponse>(response) 
 
     struct ContentType {
         ContentType() = delete;
@@ -79,6 +369,7 @@ namespace http_handler {
         constexpr static std::string_view IMAGE_SVG = "image/svg+xml"sv;              // для .svg, .svgz
         constexpr static std::string_view AUDIO_MPEG = "audio/mpeg"sv;                // для .mp3
         constexpr static std::string_view APP_UNKNOW = "application/octet-stream"sv;  // для .unknow
+        constexpr static std::string_view APP_GAME_STATE = "application/x-game-state"sv;  // двоичное состояние сессии
     };
 
     struct Method {
@@ -105,10 +396,29 @@ namespace resource_handler {
         {"svg", ResourceType::svg}, {"svgz", ResourceType::svgz}, {"mp3", ResourceType::mp3}
     };
 
+    /*
+    * Запись индекса статических файлов. Хеш, ETag и Last-Modified считаются один раз при индексации на старте,
+    * а файлы вне кеша при каждом запросе читаются с диска. Поэтому содержимое --www-root не должно меняться,
+    * пока сервер работает: изменённый файл ушёл бы клиентам с валидаторами и отпечатком прежней версии,
+    * и кеш клиента по ответу 304 или по immutable-адресу держал бы смесь версий. Новая статика выкладывается
+    * перезапуском сервера. Записи читаются из всех потоков без блокировок, поэтому переиндексация на лету не делается.
+    */
     struct ResourceItem {
         std::string _name = "";
         std::string _path = "";
         ResourceType _type = ResourceType::unknow;
+        // хеш содержимого файла, он же отпечаток в имени "name.<хеш>.ext"
+        uint64_t _content_hash = 0;
+        // строгий ETag по хешу содержимого, вычисляется при индексации
+        std::string _etag = "";
+        // ETag сжатого варианта: байты ответа другие, поэтому и тег другой
+        std::string _gzip_etag = "";
+        // время изменения файла в формате HTTP-date для Last-Modified
+        std::string _last_modified = "";
+        // содержимое файла, загруженное при старте, не меняется до выключения сервера
+        std::shared_ptr<const std::string> _content = nullptr;
+        // вариант содержимого, сжатый gzip, есть только если сжатие заметно уменьшает файл
+        std::shared_ptr<const std::string> _gzip_content = nullptr;
     };
 
     using ResourcePtr = ResourceItem*;
@@ -144,10 +454,118 @@ namespace game_handler {
     };
 
     using SessionLoots = std::unordered_map<size_t, GameLoot>;
-    using SessionPlayers = std::unordered_map<const Token*, Player, TokenPtrHasher>;
+
+    /*
+    * Изменения состояния игровой сессии между версией base_version_ и version_.
+    * Из них собирается разностный ответ о состоянии: клиент сначала удаляет removed_*,
+    * затем добавляет или заменяет игроков и лут из players_ и loots_.
+    * Идентификаторы могут повторно выдаваться, поэтому один id бывает и в удалённых, и в изменённых.
+    */
+    struct StateDelta {
+        uint64_t base_version_ = 0;
+        uint64_t version_ = 0;
+        std::vector<size_t> players_;                      // изменённые и новые игроки
+        std::vector<size_t> removed_players_;              // игроки, покинувшие сессию
+        std::vector<size_t> loots_;                        // лут, появившийся на карте
+        std::vector<size_t> removed_loots_;                // лут, убранный с карты
+    };
+
+    // кодировка тела ответа о состоянии сессии, выбирается по заголовку Accept
+    enum class StateEncoding {
+        JSON,                                              // application/json, см. json_detail::JsonWriter
+        BINARY                                             // application/x-game-state, см. binary_detail::BinaryWriter
+    };
+    static const size_t __STATE_ENCODINGS_COUNT__ = 2;
     using SessionMapper = std::unordered_map<PosPtr, const Token*, PosPtrHasher>;
 
-    using SPIterator = std::unordered_map<const game_handler::Token* const, game_handler::Player>::const_iterator;
+    /*
+    * Игроки игровой сессии.
+    * Состояние игроков, изменяемое в тике, лежит в плотном хранилище PlayersColumns,
+    * которое циклы тика проходят линейно через GetColumns().
+    * Хеш-таблица по токену хранит объекты игроков со стабильными адресами, игрок знает свой слот.
+    * Интерфейс доступа по токену повторяет std::unordered_map.
+    */
+    class SessionPlayers {
+    public:
+        using Container = std::unordered_map<const Token*, Player, TokenPtrHasher>;
+        using iterator = Container::iterator;
+        using const_iterator = Container::const_iterator;
+
+        SessionPlayers()
+            : columns_(std::make_unique<PlayersColumns>()) {
+        }
+
+        SessionPlayers(const SessionPlayers&) = delete;
+        SessionPlayers& operator=(const SessionPlayers&) = delete;
+
+        // создаёт игрока сразу в хранилище сессии, ранее добавленный игрок с тем же токеном удаляется
+        Player& Add(const Token* token, size_t id, std::string_view name, unsigned capacity) {
+            players_.erase(token);
+            return players_.try_emplace(token, *columns_, token, id, name, token, capacity).first->second;
+        }
+        // добавляет игрока, его состояние переносится в хранилище сессии
+        std::pair<iterator, bool> emplace(std::pair<const Token*, Player>&& value) {
+            auto result = players_.emplace(std::move(value));
+            if (result.second) {
+                result.first->second.AttachTo(*columns_, result.first->first);
+            }
+            return result;
+        }
+
+        // удаляет игрока вместе с его слотом в хранилище
+        size_t erase(const Token* token) {
+            return players_.erase(token);
+        }
+        size_t count(const Token* token) const {
+            return players_.count(token);
+        }
+        Player& at(const Token* token) {
+            return players_.at(token);
+        }
+        const Player& at(const Token* token) const {
+            return players_.at(token);
+        }
+        size_t size() const {
+            return players_.size();
+        }
+        bool empty() const {
+            return players_.empty();
+        }
+
+        iterator begin() {
+            return players_.begin();
+        }
+        iterator end() {
+            return players_.end();
+        }
+        const_iterator begin() const {
+            return players_.begin();
+        }
+        const_iterator end() const {
+            return players_.end();
+        }
+        const_iterator cbegin() const {
+            return players_.cbegin();
+        }
+        const_iterator cend() const {
+            return players_.cend();
+        }
+
+        // возвращает хранилище состояния игроков для линейных проходов
+        PlayersColumns& GetColumns() {
+            return *columns_;
+        }
+        // возвращает хранилище состояния игроков для линейных проходов
+        const PlayersColumns& GetColumns() const {
+            return *columns_;
+        }
+
+    private:
+        std::unique_ptr<PlayersColumns> columns_;       // объявлено раньше игроков, чтобы разрушаться после них
+        Container players_;
+    };
+
+    using SPIterator = SessionPlayers::const_iterator;
 
 	static const std::string __DEFAULT_BACKUP_FILE__ = "../game_backup.gsa";
 
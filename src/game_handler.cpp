@@ -1,12 +1,29 @@
 ﻿#include "game_handler.h"
+#include "logger_handler.h"
 #include <boost/asio.hpp>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <iterator>
+#include <utility>
 
 namespace game_handler {
 
 	namespace fs = std::filesystem;
 	namespace json = boost::json;
 
+	// суммирует время фаз двух профилей
+	TickProfile& TickProfile::operator+=(const TickProfile& other) {
+		future_positions_ += other.future_positions_;
+		collisions_ += other.collisions_;
+		retirement_ += other.retirement_;
+		moving_ += other.moving_;
+		loot_generation_ += other.loot_generation_;
+		updates_ += other.updates_;
+		return *this;
+	}
+
 	// -------------------------- class GameSession --------------------------
 	
 	// задаёт флаг случайной позиции для старта новых игроков
@@ -17,14 +34,16 @@ namespace game_handler {
 
 	// добавляет нового игрока на случайное место на случайной дороге на карте
 	Player* GameSession::AddPlayer(std::string_view name) {
+		// позиция и токен нового игрока берутся из генератора сессии
+		model::Rng::Scope rng_scope(rng_);
 		// смотрим есть ли место в текущей игровой сессии
-		auto id = std::find(players_id_.begin(), players_id_.end(), false);
-		if (id != players_id_.end()) {
+		auto id = players_id_.Acquire();
+		if (id) {
 
 			// если место есть, то запрашиваем уникальный токен
 			const Token* player_token = game_handler_.GetUniqueToken(shared_from_this());
 			// берем свободный уникальный иденнтификатор
-			size_t unique_id = static_cast<size_t>(std::distance(players_id_.begin(), id));
+			size_t unique_id = *id;
 
 			// заготовка под позицию установки нового игрока
 			PlayerPosition position{ session_map_->GetFirstRoadStartPosition() };
@@ -51,6 +70,8 @@ namespace game_handler {
 			return GetPlayer(player_token);
 		}
 		else {
+			// места нет, снимаем резерв сделанный при выборе сессии
+			ReleasePlace();
 			return nullptr;
 		}
 	}
@@ -69,10 +90,16 @@ namespace game_handler {
 			return false;
 		}
 		else {
+			MarkPlayersChanged();
+			NoteRemovedPlayer(session_players_.at(token).GetId());
+			// каналы игрока закрываются, состояние сессии им больше не отправляется
+			RemovePlayerSubscribers(token);
 			// освобождаем id текущего игрока по токену
-			players_id_[session_players_.at(token).GetId()] = false;
+			players_id_.Release(session_players_.at(token).GetId());
 			// удаляем запись о игроке вместе со структурой
 			session_players_.erase(token);
+			// освобождаем место в сессии
+			ReleasePlace();
 			return true;
 		}
 	}
@@ -87,24 +114,51 @@ namespace game_handler {
 	*  5. Генерация лута на карте
 	*/
 	bool GameSession::UpdateState(int time) {
+		// все случайные числа тика, например генерация лута, берутся из генератора сессии
+		model::Rng::Scope rng_scope(rng_);
+		tick_start_version_ = state_version_;
+		// изменения тика и команды до следующего тика записываются в один набор
+		OpenStateChangeSet();
+		// если все стоят, то тик не меняет позиции, а лут и состав игроков отмечают изменения сами
+		MarkMovingPlayers();
+
+		using Clock = std::chrono::steady_clock;
+		Clock::time_point mark = tick_profile_ ? Clock::now() : Clock::time_point{};
+		// добавляет время с предыдущей отметки к фазе профиля, если профилирование включено
+		auto lap = [this, &mark](std::chrono::nanoseconds TickProfile::* phase) {
+			if (tick_profile_) {
+				Clock::time_point now = Clock::now();
+				tick_profile_->*phase += now - mark;
+				mark = now;
+			}
+		};
+
 		try
 		{
 			// 1. Расчёт будущих позиций игроков, время задаётся в миллисекундах
 			UpdateFuturePlayersPositions(time);
+			lap(&TickProfile::future_positions_);
 
 			// 2. Расчёт и выполнение ожидаемых при перемещении коллизий
 			// В процессе исполнения будут рассчитаны коллизии, выполнены действия по подбору и сдаче предметов лута
 			HandlePlayersCollisionsActions();
+			lap(&TickProfile::collisions_);
 
 			// 3. Выполняет удаление всех бездействующих игроков, превысивших лимит времени ожидания
 			UpdateRetirementPlayers();
+			lap(&TickProfile::retirement_);
 
 			// 4. Выполнение перемещения игроков на рассчитанные в пункте 1 будущие координаты
 			UpdateCurrentPlayersPositions();
+			lap(&TickProfile::moving_);
 
 			// 5. Генерация лута на карте
 			UpdateSessionLootsCount(time);
+			lap(&TickProfile::loot_generation_);
 
+			if (tick_profile_) {
+				++tick_profile_->updates_;
+			}
 			return true;
 		}
 		catch (const std::exception& e)
@@ -115,28 +169,32 @@ namespace game_handler {
 
 	// метод добавляет скорость персонажу, вызывается из GameHandler::player_action_response_impl
 	bool GameSession::MovePlayer(const Token* token, PlayerMove move) {
+		Player* player = GetPlayer(token);
+		// повторная команда с тем же направлением состояние сессии не меняет
+		PlayerSpeed speed = player->GetSpeed();
+		PlayerDirection direction = player->GetDirection();
 
 		switch (move)
 		{
 		case game_handler::PlayerMove::UP: // верх скорость {0, -speed}
-			GetPlayer(token)->SetSpeed(0, -session_map_->GetOnMapSpeed()).SetDirection(PlayerDirection::NORTH);
-			return true;
+			player->SetSpeed(0, -session_map_->GetOnMapSpeed()).SetDirection(PlayerDirection::NORTH);
+			break;
 
 		case game_handler::PlayerMove::DOWN: // вниз скорость {0, speed}
-			GetPlayer(token)->SetSpeed(0, session_map_->GetOnMapSpeed()).SetDirection(PlayerDirection::SOUTH);
-			return true;
+			player->SetSpeed(0, session_map_->GetOnMapSpeed()).SetDirection(PlayerDirection::SOUTH);
+			break;
 
 		case game_handler::PlayerMove::LEFT: // влево скорость {-speed, 0}
-			GetPlayer(token)->SetSpeed(-session_map_->GetOnMapSpeed(), 0).SetDirection(PlayerDirection::WEST);
-			return true;
+			player->SetSpeed(-session_map_->GetOnMapSpeed(), 0).SetDirection(PlayerDirection::WEST);
+			break;
 
 		case game_handler::PlayerMove::RIGHT: // влево скорость {speed, 0}
-			GetPlayer(token)->SetSpeed(session_map_->GetOnMapSpeed(), 0).SetDirection(PlayerDirection::EAST);
-			return true;
+			player->SetSpeed(session_map_->GetOnMapSpeed(), 0).SetDirection(PlayerDirection::EAST);
+			break;
 
 		case game_handler::PlayerMove::STAY:
-			GetPlayer(token)->SetSpeed(0, 0);
-			return true;
+			player->SetSpeed(0, 0);
+			break;
 
 		case game_handler::PlayerMove::error:
 			throw std::runtime_error("GameSession::MovePlayer::PlayerMove::error");
@@ -144,14 +202,34 @@ namespace game_handler {
 		default:
 			return false;
 		}
+
+		if (player->GetSpeed() != speed || player->GetDirection() != direction) {
+			MarkStateChanged();
+			NoteChangedPlayer(player->GetId());
+		}
+		return true;
 	}
 
 	// отвечает есть ли в сессии свободное местечко
 	bool GameSession::CheckFreeSpace() {
-		// смотрим есть ли место в текущей игровой сессии
-		auto id = std::find(players_id_.begin(), players_id_.end(), false);
+		// учитываем не только добавленных игроков, но и зарезервированные места
+		return places_taken_.load() < players_id_.Size();
+	}
 
-		return id != players_id_.end();
+	// резервирует место под нового игрока, может вызываться вне стренда сессии
+	bool GameSession::ReservePlace() {
+		size_t taken = places_taken_.load();
+		while (taken < players_id_.Size()) {
+			if (places_taken_.compare_exchange_weak(taken, taken + 1)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// освобождает зарезервированное место
+	void GameSession::ReleasePlace() {
+		places_taken_.fetch_sub(1);
 	}
 
 	// ----------------- блок наследуемых методов CollisionProvider ----------------------------
@@ -173,18 +251,20 @@ namespace game_handler {
 
 	// добавляет нового игрока на карту
 	Player& GameSession::AddPlayerImpl(size_t id, std::string_view name, const Token* token, unsigned capacity) {
-		// добавляем игрока в базу
-		session_players_[token] = std::move(Player{ id,name, token, capacity });
-		players_id_[id] = true;                            // поднимаем флаг на массиве индексов
-		return session_players_.at(token);                // возвращаем созданного игрока
+		MarkPlayersChanged();
+		// добавляем игрока в базу, состояние игрока сразу размещается в хранилище сессии
+		Player& player = session_players_.Add(token, id, name, capacity);
+		NoteChangedPlayer(id);
+		players_id_.Take(id);                              // занимаем индекс, если он ещё не выдан распределителем
+		return player;                                     // возвращаем созданного игрока
 	}
 
 	// проверяет стартовую позицию игрока на предмет совпадения с другими игроками в сессии
 	bool GameSession::CheckStartPositionImpl(PlayerPosition& position) {
 
-		for (const auto& [token, player] : session_players_) {
+		for (const auto& player_position : session_players_.GetColumns().current_positions_) {
 			// если нашли позицию совпадающую с запрошенной то выходим с false
-			if (position == player.GetCurrentPosition()) {
+			if (position == player_position) {
 				return false;
 			}
 		}
@@ -193,9 +273,10 @@ namespace game_handler {
 
 	// генерирует лут с заданым типом, идентификатором и позицией
 	bool GameSession::GenerateSessionLootImpl(size_t type, size_t id, PlayerPosition pos) {
+		NoteAddedLoot(id);
 		session_loots_.emplace(id, std::move(
 			GameLoot{ session_map_->GetLootType(type), type, id, pos }));
-		loots_id_[id] = true;
+		loots_id_.Take(id);
 
 		return true;
 	}
@@ -206,33 +287,37 @@ namespace game_handler {
 		{
 			for (unsigned i = 0; i != count; ++i) {
 
-				// смотрим есть ли место в текущей игровой сессии для единиц лута
-				auto id = std::find(loots_id_.begin(), loots_id_.end(), false);
+				// получаем количество типов лута карты
+				int loot_types_count = static_cast<int>(session_map_->GetLootTypesCount());
 
-				if (id != loots_id_.end()) {
-					// вся генерация выполняется только в том случае, если есть место для размещения
-					// количество лута ограничено, см. конструктор игровой сессии
-
-					// получаем количество типов лута карты
-					int loot_types_count = static_cast<int>(session_map_->GetLootTypesCount());
-
-					if (loot_types_count != 0) {
-						// дальше генерируем если вообще есть какой-то лут, который может быть сгенерирован
+				if (loot_types_count == 0) {
+					// если на карте нет лута, который может быть сгенерирован, то и генерировать нечего
+					break;
+				}
 
-						// получаем случайный индекс из массива типов лута
-						size_t type = static_cast<size_t>(model::GetRandomInteger(0, loot_types_count - 1));
-						// получаем числовое обозначение id для нового предмета
-						size_t unique_id = static_cast<size_t>(std::distance(loots_id_.begin(), id));
-						// получаем случайную позицию на карте и сразу делаем из неё позицию в сессии
-						PlayerPosition position{ session_map_->GetRandomPosition() };
-						// чтобы не размещать вот по целочисленной позиции, прибавляем случайное число от минус дельты до плюс дельты дороги
-						// ВРЕМЕННО ОТКЛЮЧЕНО, чтобы упростить тестирование сбора предметов
-						//position.AddRandomPlusMinusDelta(__ROAD_DELTA__);
+				// смотрим есть ли место в текущей игровой сессии для единиц лута и сразу занимаем его
+				// количество лута ограничено, см. конструктор игровой сессии
+				auto id = loots_id_.Acquire();
 
-						// отправляем на генерацию
-						GenerateSessionLootImpl(type, unique_id, position);
-					}
+				if (!id) {
+					// все места под лут заняты, дальше генерировать некуда
+					break;
 				}
+
+				// получаем случайный индекс из массива типов лута
+				size_t type = static_cast<size_t>(model::GetRandomInteger(0, loot_types_count - 1));
+				// получаем числовое обозначение id для нового предмета
+				size_t unique_id = *id;
+				// получаем случайную позицию на карте и сразу делаем из неё позицию в сессии
+				PlayerPosition position{ session_map_->GetRandomPosition() };
+				// чтобы не размещать вот по целочисленной позиции, прибавляем случайное число от минус дельты до плюс дельты дороги
+				// ВРЕМЕННО ОТКЛЮЧЕНО, чтобы упростить тестирование сбора предметов
+				//position.AddRandomPlusMinusDelta(__ROAD_DELTA__);
+
+				// весь лут тика записывается в один набор изменений
+				MarkTickChanged();
+				// отправляем на генерацию
+				GenerateSessionLootImpl(type, unique_id, position);
 			}
 
 			return true;
@@ -261,9 +346,13 @@ namespace game_handler {
 	// выполняет обновления текущих позиций игроков согласно расчитанных ранее будущих позиций
 	bool GameSession::UpdateCurrentPlayersPositions() {
 
-		for (auto& player : session_players_) {
+		auto& players = session_players_.GetColumns();
+
+		for (size_t slot = 0; slot != players.Size(); ++slot) {
 			// просто обновляем позицию для всех игроков
-			player.second.UpdateCurrentPosition();
+			if (players.current_positions_[slot] != players.future_positions_[slot]) {
+				players.current_positions_[slot] = players.future_positions_[slot];
+			}
 		}
 
 		return true;
@@ -272,24 +361,259 @@ namespace game_handler {
 	// выполняет удаление всех бездействующих игроков, превысивших лимит времени ожидания
 	bool GameSession::UpdateRetirementPlayers() {
 		std::vector<const Token*> to_remove;
+		const auto& players = session_players_.GetColumns();
 
-		for (const auto& [token, player] : session_players_) {
+		for (size_t slot = 0; slot != players.Size(); ++slot) {
 			// перебираем всех игроков и если превышено время простоя
-			if (player.GetRetirementTimeMS() >= game_handler_.GetRetirementTimeMS()) {
+			if (players.retirement_times_ms_[slot] >= game_handler_.GetRetirementTimeMS()) {
 				// добавляем токен в массив на удаление ибо
 				// напрямую удалить отсюда же нельзя, будет несогласованность данных
-				to_remove.push_back(token);
+				to_remove.push_back(players.tokens_[slot]);
 			}
 		}
 
 		for (const auto& token : to_remove) {
-			// предоставим запись результатов и удаление основному обработчику
-			game_handler_.ResetToken(token);
+			// сохраняем данные для записи рекорда, токен и база обрабатываются в фазе фиксации тика
+			const auto& player = session_players_.at(token);
+			retired_players_.push_back({ Token{ std::string(**token) }, std::string(player.GetName())
+				, player.GetScore(), player.GetTotalInGameTimeMS() });
+			RemovePlayer(token);
 		}
 
 		return true;
 	}
 
+	// забирает выбывших за время тика игроков
+	std::vector<RetiredPlayer> GameSession::TakeRetiredPlayers() {
+		return std::exchange(retired_players_, {});
+	}
+
+	// включает накопление времени фаз UpdateState в переданный профиль, nullptr выключает
+	void GameSession::SetTickProfile(TickProfile* profile) {
+		tick_profile_ = profile;
+	}
+
+	// откладывает ответ на долгий опрос состояния, пока версия состояния равна version
+	void GameSession::WaitStateChange(uint64_t version, std::chrono::milliseconds timeout, std::function<void()> complete) {
+		uint64_t id = ++state_waiters_counter_;
+		auto timer = std::make_shared<net::steady_timer>(strand_, timeout);
+		state_waiters_.emplace(id, StateWaiter{ version, timer, std::move(complete) });
+
+		// по истечении времени ответ уходит с тем состоянием, что есть, если тик не успел его завершить раньше
+		timer->async_wait([self = shared_from_this(), id](const sys::error_code& ec) {
+			if (ec) {
+				return;
+			}
+			if (auto it = self->state_waiters_.find(id); it != self->state_waiters_.end()) {
+				auto complete = std::move(it->second.complete_);
+				self->state_waiters_.erase(it);
+				complete();
+			}
+		});
+	}
+
+	// завершает отложенные опросы, для которых версия состояния сменилась, вызывается после тика
+	void GameSession::NotifyStateWaiters() {
+		// ответы собираются отдельно, так как отправка может снова обратиться к сессии
+		std::vector<std::function<void()>> ready;
+		for (auto it = state_waiters_.begin(); it != state_waiters_.end();) {
+			if (it->second.version_ == state_version_) {
+				++it;
+				continue;
+			}
+			it->second.timer_->cancel();
+			ready.push_back(std::move(it->second.complete_));
+			it = state_waiters_.erase(it);
+		}
+
+		for (auto& complete : ready) {
+			complete();
+		}
+	}
+
+	// подключает подписчика игрока token и сразу отправляет ему текущее состояние
+	void GameSession::AddStateSubscriber(const Token* token, std::weak_ptr<StateSubscriber> subscriber) {
+		if (auto locked = subscriber.lock()) {
+			locked->PushState(GetStateBody(), state_version_);
+			state_subscribers_.push_back(StateSubscription{ std::move(subscriber), token });
+		}
+	}
+
+	// снимает подписки игрока token и сообщает подписчикам об удалении игрока
+	void GameSession::RemovePlayerSubscribers(const Token* token) {
+		auto removed = std::stable_partition(state_subscribers_.begin(), state_subscribers_.end(),
+			[token](const StateSubscription& subscription) { return subscription.token_ != token; });
+
+		for (auto it = removed; it != state_subscribers_.end(); ++it) {
+			if (auto locked = it->subscriber_.lock()) {
+				locked->PlayerRemoved();
+			}
+		}
+		state_subscribers_.erase(removed, state_subscribers_.end());
+	}
+
+	// запоминает версию, которую подписчик уже применил, дальше он получает разность относительно неё
+	void GameSession::AckStateSubscriber(const StateSubscriber* subscriber, uint64_t version) {
+		for (auto& subscription : state_subscribers_) {
+			if (auto locked = subscription.subscriber_.lock(); locked.get() == subscriber) {
+				subscription.acked_version_ = version;
+				return;
+			}
+		}
+	}
+
+	// отправляет подписчикам состояние, если оно сменилось с прошлой отправки
+	void GameSession::PushStateSubscribers() {
+		// отключённые каналы убираются при каждой отправке
+		state_subscribers_.erase(std::remove_if(state_subscribers_.begin(), state_subscribers_.end(),
+			[](const StateSubscription& subscription) { return subscription.subscriber_.expired(); }),
+			state_subscribers_.end());
+
+		if (state_subscribers_.empty() || pushed_version_ == state_version_) {
+			return;
+		}
+		pushed_version_ = state_version_;
+
+		// подписчики без подтверждения получают один и тот же буфер полного состояния,
+		// подписчики с одной подтверждённой версией - один и тот же буфер разности
+		for (const auto& subscription : state_subscribers_) {
+			auto locked = subscription.subscriber_.lock();
+			if (!locked) {
+				continue;
+			}
+
+			std::shared_ptr<const std::string> state;
+			if (subscription.acked_version_ != 0) {
+				state = GetStateDeltaBody(subscription.acked_version_);
+			}
+			locked->PushState(state ? std::move(state) : GetStateBody(), state_version_);
+		}
+	}
+
+	// возвращает ETag текущей версии состояния сессии
+	std::string GameSession::GetStateETag(StateEncoding encoding) const {
+		return detail::MakeVersionETag(etag_epoch_, session_id_,
+			encoding == StateEncoding::BINARY ? 'b' : 's', state_version_);
+	}
+
+	// возвращает ETag текущей версии списка игроков сессии
+	std::string GameSession::GetPlayersETag() const {
+		return detail::MakeVersionETag(etag_epoch_, session_id_, 'p', players_version_);
+	}
+
+	// отмечает изменение состояния сессии новой версией и записывает её в открытый набор изменений тика
+	void GameSession::MarkStateChanged() {
+		if (state_changes_.empty()) {
+			// изменения до первого тика, например вход игроков или восстановление сессии
+			OpenStateChangeSet();
+		}
+		++state_version_;
+		state_changes_.back().version_ = state_version_;
+	}
+
+	// открывает набор изменений тика, пустой набор прошлого тика используется повторно
+	void GameSession::OpenStateChangeSet() {
+		if (!state_changes_.empty() && state_changes_.back().version_ == state_changes_.back().from_version_) {
+			return;
+		}
+		state_changes_.push_back(StateChangeSet{ state_version_, state_version_ });
+		if (state_changes_.size() > __STATE_HISTORY_SIZE__) {
+			state_changes_.pop_front();
+		}
+	}
+
+	// отмечает изменение состояния, если в сессии есть движущиеся игроки, и записывает их в набор изменений
+	void GameSession::MarkMovingPlayers() {
+		const auto& columns = session_players_.GetColumns();
+		bool marked = false;
+
+		for (size_t slot = 0; slot != columns.Size(); ++slot) {
+			if (columns.speeds_[slot] == PlayerSpeed{ 0, 0 }) {
+				continue;
+			}
+			// тик двигает игрока, а с ним могут смениться сумка и очки
+			if (!marked) {
+				MarkStateChanged();
+				marked = true;
+			}
+			NoteChangedPlayer(columns.owners_[slot]->GetId());
+		}
+	}
+
+	// собирает изменения между base_version и текущей версией, std::nullopt если версия вне окна истории
+	std::optional<StateDelta> GameSession::CollectStateDelta(uint64_t base_version) const {
+		if (base_version > state_version_) {
+			// версия из будущего, например от прошлого запуска сервера
+			return std::nullopt;
+		}
+
+		// в истории должны быть все изменения после базовой версии
+		// набор, внутри которого лежит базовая версия, берётся целиком: лишние записи в разности безвредны
+		uint64_t oldest = state_changes_.empty() ? state_version_ : state_changes_.front().from_version_;
+		if (base_version < oldest) {
+			return std::nullopt;
+		}
+
+		StateDelta delta{ base_version, state_version_ };
+		for (auto it = state_changes_.rbegin(); it != state_changes_.rend() && it->version_ > base_version; ++it) {
+			delta.players_.insert(delta.players_.end(), it->players_.begin(), it->players_.end());
+			delta.removed_players_.insert(delta.removed_players_.end(), it->removed_players_.begin(), it->removed_players_.end());
+			delta.loots_.insert(delta.loots_.end(), it->loots_.begin(), it->loots_.end());
+			delta.removed_loots_.insert(delta.removed_loots_.end(), it->removed_loots_.begin(), it->removed_loots_.end());
+		}
+
+		// наборы упорядочиваются без повторов, игроки ищутся в них двоичным поиском
+		for (auto* ids : { &delta.players_, &delta.removed_players_, &delta.loots_, &delta.removed_loots_ }) {
+			std::sort(ids->begin(), ids->end());
+			ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+		}
+		return delta;
+	}
+
+	// возвращает тело разностного ответа о состоянии относительно версии base_version
+	std::shared_ptr<const std::string> GameSession::GetStateDeltaBody(uint64_t base_version, StateEncoding encoding) {
+		if (delta_bodies_version_ != state_version_) {
+			for (auto& bodies : delta_bodies_) {
+				bodies.clear();
+			}
+			delta_bodies_version_ = state_version_;
+		}
+
+		auto& bodies = delta_bodies_[static_cast<size_t>(encoding)];
+		if (auto it = bodies.find(base_version); it != bodies.end()) {
+			return it->second;
+		}
+
+		auto delta = CollectStateDelta(base_version);
+		if (!delta) {
+			return nullptr;
+		}
+
+		auto body = std::make_shared<std::string>();
+		json_detail::WriteSessionStateDelta(*body, session_players_, session_loots_, *delta, encoding);
+		bodies.emplace(base_version, body);
+		return body;
+	}
+
+	// возвращает тело ответа о состоянии сессии для текущей версии
+	std::shared_ptr<const std::string> GameSession::GetStateBody(StateEncoding encoding) {
+		StateBody& state = state_bodies_[static_cast<size_t>(encoding)];
+		if (state.body_ && state.version_ == state_version_) {
+			return state.body_;
+		}
+
+		// каждая версия собирается в новый буфер: старый может ещё читаться или освобождаться в потоках ввода-вывода
+		// размер прошлого тела служит только подсказкой для резервирования памяти
+		auto body = std::make_shared<std::string>();
+		body->reserve(state.body_ ? state.body_->size() : 0);
+		json_detail::WriteSessionStateList(*body, session_players_, session_loots_, encoding);
+
+		state.body_ = std::move(body);
+		state.version_ = state_version_;
+
+		return state.body_;
+	}
+
 	// переносит предмет в сумку игрока, удаляет предмет с карты
 	bool GameSession::PutLootInToTheBag(Player& player, size_t loot_id) {
 		
@@ -309,6 +633,7 @@ namespace game_handler {
 			loots_in_bags_.emplace(std::pair{ loot_id, std::move(session_loots_.at(loot_id)) });
 			// удаляем запись из основной мапы лута на карте
 			session_loots_.erase(loot_id);
+			NoteRemovedLoot(loot_id);
 
 			// добавляем игроку указанный предмет в сумку
 			return player.AddLoot(loot_id, &loots_in_bags_.at(loot_id));
@@ -330,7 +655,7 @@ namespace game_handler {
 			loots_in_bags_.erase(loot.index_);
 
 			// снимаем флаг с булевого вектора лута, чтобы можно было снова создать элемент с таким id
-			loots_id_[loot.index_] = false;
+			loots_id_.Release(loot.index_);
 		}
 
 		// очищаем сумки после сдачи предметов
@@ -342,7 +667,8 @@ namespace game_handler {
 	// выполняет расчёт коллизий и выполняет их согласно полученому массиву
 	bool GameSession::HandlePlayersCollisionsActions() {
 
-		// Для начала выполняем поиск коллизий
+		// Для начала перестраиваем широкую фазу по текущему луту и выполняем поиск коллизий
+		broadphase_->Rebuild(*this);
 		auto events = FindCollisionEvents(*this);
 
 		// Выполняем перебор найденых событий с вызовом соответствующих обработчиков
@@ -379,7 +705,7 @@ namespace game_handler {
 	}
 
 	// изменяет координаты игрока при движении параллельно дороге, на которой он стоит
-	bool GameSession::PlayerParallelMovingImpl(Player& player, PlayerDirection direction,
+	bool GameSession::PlayerParallelMovingImpl(PlayersColumns& players, size_t slot, PlayerDirection direction,
 		PlayerPosition&& from, PlayerPosition&& to, const model::Road* road) {
 
 		bool player_keep_moving = true;                // флаг продолжения движения игрока 
@@ -440,14 +766,16 @@ namespace game_handler {
 			return false;
 		}
 		// записываем новые координаты и тормозим если необходимо
-		player_keep_moving ? player.SetFuturePosition(std::move(to)) :
-			player.SetFuturePosition(std::move(to)).SetSpeed(0, 0);
+		players.future_positions_[slot] = std::move(to);
+		if (!player_keep_moving) {
+			players.speeds_[slot] = { 0, 0 };
+		}
 
 		return true;
 	}
 
 	// изменяет координаты игрока при движении перпендикулярно дороге, на которой он стоит
-	bool GameSession::PlayerCrossMovingImpl(Player& player, PlayerDirection direction,
+	bool GameSession::PlayerCrossMovingImpl(PlayersColumns& players, size_t slot, PlayerDirection direction,
 		PlayerPosition&& from, PlayerPosition&& to, const model::Road* road) {
 
 		bool player_keep_moving = true;                // флаг продолжения движения игрока 
@@ -504,42 +832,46 @@ namespace game_handler {
 			return false;
 		}
 		// записываем новые координаты и тормозим если необходимо
-		player_keep_moving ? player.SetFuturePosition(std::move(to)) :
-			player.SetFuturePosition(std::move(to)).SetSpeed(0, 0);
+		players.future_positions_[slot] = std::move(to);
+		if (!player_keep_moving) {
+			players.speeds_[slot] = { 0, 0 };
+		}
 
 		return true;
 	}
 
 	// обновляет позицию выбранного игрока в соответствии с его заданной скоростью, направлением и временем в секундах
 	// принимает время в миллисекундах, перерасчёт будет дальше по коду
-	bool GameSession::CalculateFuturePlayerPositionImpl(Player& player, int time) {
+	bool GameSession::CalculateFuturePlayerPositionImpl(PlayersColumns& players, size_t slot, int time) {
 		
+		const PlayerSpeed speed = players.speeds_[slot];
 		// чтобы лишнего не считать, проверяем, а не стоит ли чубака вообще
-		if (player.IsStay() /*&& delta_pos.x_ == 0 && delta_pos.y_ == 0*/) {
+		if (speed.xV_ == 0 && speed.yV_ == 0 /*&& delta_pos.x_ == 0 && delta_pos.y_ == 0*/) {
 			// если приращения нет, то добавляем время простоя
 			// это возможно если у чубаки нулевая скорость
 			// нулевая скорость становится или после команды {"move": ""}
 			// или после того как чубака уперся в стенку
+			// время простоя также идёт в общее время в игре
 			
-			player.AddRetirementTimeMS(time);
+			players.retirement_times_ms_[slot] += time;
+			players.total_times_ms_[slot] += time;
 			return true;           
 		}
 
-		player.ResetRetirementTime();           // сбрасываем время простоя
+		players.retirement_times_ms_[slot] = 0;           // сбрасываем время простоя
 		double time_in_sec = static_cast<double>(time) / __MS_IN_ONE_SECOND__;
+		// записываем во временную переменную, чтобы не делать лишних вызовов
+		PlayerPosition position = players.current_positions_[slot];
 		// записываем вектор ожидаемого приращения по положению персонажа
-		PlayerPosition delta_pos{ player.GetCurrentPosition().x_ + (player.GetSpeed().xV_ * time_in_sec),
-			player.GetCurrentPosition().y_ + (player.GetSpeed().yV_ * time_in_sec) };
+		PlayerPosition delta_pos{ position.x_ + (speed.xV_ * time_in_sec),
+			position.y_ + (speed.yV_ * time_in_sec) };
 
 		const model::Road* road = nullptr;    // готовим заготовку под "дорогу"
-		// записываем во временную переменную, чтобы не делать лишних вызовов
-		PlayerDirection direction = player.GetDirection();
-		//PlayerDirection direction = player.get_speed_direction();
-		PlayerPosition position = player.GetCurrentPosition();
+		PlayerDirection direction = players.directions_[slot];
 		// округляем позицию до уровня логики model::Map
 		model::Point point{ detail::RoundDoubleMathematic(position.x_), detail::RoundDoubleMathematic(position.y_) };
 		// добавляем проведенное в игре время в миллисекундах
-		player.AddTotalInGameTimeMS(time);
+		players.total_times_ms_[slot] += time;
 
 		// в зависимости от нашего направления запрашиваем дорогу
 		// если игрок смотрит влево или вправо, полагаем, что будет движение по горизонтальной дороге
@@ -555,22 +887,24 @@ namespace game_handler {
 		// то в принципе мы в состоянии спокойно двигаться проверив выход за границы дороги
 		if (road) {
 			// отдаём обработку методу перемещения параллельно дороге
-			return PlayerParallelMovingImpl(player, direction, std::move(position), std::move(delta_pos), road);
+			return PlayerParallelMovingImpl(players, slot, direction, std::move(position), std::move(delta_pos), road);
 		}
 		// если же мы не стоим на требуемой - стоим на дороге перпендикулярной оси движения
 		else {
 			// отдаём обработку методу перемещения перпендикулярно дороге
-			return PlayerCrossMovingImpl(player, direction, std::move(position), std::move(delta_pos), road);
+			return PlayerCrossMovingImpl(players, slot, direction, std::move(position), std::move(delta_pos), road);
 		}
 	}
 
 	// выполняет расчёт и запись будущих позиций игроков в игровой сессии, принимает время в миллисекундах
 	bool GameSession::UpdateFuturePlayersPositions(int time) {
 
-		for (auto& [token, player] : session_players_) {
+		auto& players = session_players_.GetColumns();
+
+		for (size_t slot = 0; slot != players.Size(); ++slot) {
 			// вызываем метод расчёта будущей позиции игрока
 			// это еще НЕ перемещение, это намерения о совершаемом в будущем перемещении
-			CalculateFuturePlayerPositionImpl(player, time);
+			CalculateFuturePlayerPositionImpl(players, slot, time);
 		}
 		return true;
 	}
@@ -606,16 +940,68 @@ namespace game_handler {
 	}
 
 	// Выполняет обновление всех открытых игровых сессий по времени
+	// сессии обновляются параллельно в своих стрендах, после обновления последней сессии
+	// выполняется фиксация тика: удаление токенов выбывших игроков и запись их рекордов
 	void GameHandler::UpdateGameSessions(int time) {
 		if (time > 0) {
-			// запускаем обновление всех игровых сессий во всех игровых инстансах за O(N*K), 
+			// тики нумеруются в общем стренде, номер нужен журналу воспроизведения
+			const uint64_t tick_number = ++tick_counter_;
+			if (recorder_) {
+				recorder_->RecordTick(tick_number, time);
+			}
+
+			std::vector<std::shared_ptr<GameSession>> sessions;
+			// собираем все игровые сессии во всех игровых инстансах за O(N*K), 
 			// где N - количество открытых инстансов, K - количество открытых игровых сессий в инстансе 
 			for (auto& instance : instances_) {
-				// берем сессии из инстанса
-				for (auto& session : instance.second) {
-					// обновляем каждую сессию
-					session->UpdateState(time);
-				}
+				sessions.insert(sessions.end(), instance.second.begin(), instance.second.end());
+			}
+
+			if (sessions.empty()) {
+				return;
+			}
+
+			auto tick = std::make_shared<TickContext>();
+			tick->sessions_left_ = sessions.size();
+
+			for (auto& session : sessions) {
+				// обновляем каждую сессию в её стренде, стренды исполняются потоками io_context параллельно
+				// запросы пришедшие после тика встанут в очередь стренда за обновлением и увидят новое состояние
+				net::dispatch(session->GetStrand(), [this, session, time, tick, tick_number]() {
+					try
+					{
+						session->UpdateState(time);
+					}
+					catch (const std::exception& e)
+					{
+						logger_handler::LogException(e);
+					}
+					session->applied_tick_ = tick_number;
+					// долгие опросы и каналы WebSocket получают состояние сразу после применения тика
+					session->NotifyStateWaiters();
+					session->PushStateSubscribers();
+
+					std::vector<RetiredPlayer> retired;
+					{
+						std::lock_guard tick_lock(tick->mutex_);
+						auto session_retired = session->TakeRetiredPlayers();
+						std::move(session_retired.begin(), session_retired.end(), std::back_inserter(tick->retired_));
+						if (--tick->sessions_left_ != 0) {
+							return;
+						}
+						retired = std::move(tick->retired_);
+					}
+
+					// последняя обновлённая сессия выполняет короткую последовательную фиксацию тика
+					try
+					{
+						CommitRetiredPlayers(std::move(retired));
+					}
+					catch (const std::exception& e)
+					{
+						logger_handler::LogException(e);
+					}
+				});
 			}
 		}
 		else {
@@ -635,8 +1021,10 @@ namespace game_handler {
 			for (auto& instance : instances_) {
 				// берем сессии из инстанса
 				for (auto& session : instance.second) {
-					// обновляем каждую сессию
-					session->SetRandomStartPosition(random_start_position_);
+					// обновляем каждую сессию в её стренде
+					net::dispatch(session->GetStrand(), [session, flag]() {
+						session->SetRandomStartPosition(flag);
+					});
 				}
 			}
 		}
@@ -646,9 +1034,11 @@ namespace game_handler {
 	void GameHandler::ResetGameSessions() {
 		try
 		{
+			std::lock_guard func_lock(mutex_);
 			instances_.clear();            // понадеемся на умное удаление в шаред поинтерах
 			tokens_list_.clear();          // как только все шары самоуничтожатся, сессии прекратят существовать
 			sessions_list_.clear();
+			sessions_id_.ReleaseAll();
 		}
 		catch (const std::exception& e)
 		{
@@ -656,9 +1046,14 @@ namespace game_handler {
 		}
 	}
 
+	// Назначает журнал, в который записываются входы игроков, их действия и тики
+	void GameHandler::SetReplayRecorder(std::shared_ptr<replay_handler::ReplayRecorder> recorder) {
+		recorder_ = std::move(recorder);
+	}
+
 	// Возвращает ответ на запрос по изменению состояния игровой сессии со временем
 	http_handler::Response GameHandler::SessionsUpdateResponse(http_handler::StringRequest&& req) {
-		if (req.method_string() != http_handler::Method::POST) {
+		if (req.method() != http::verb::post) {
 			// если у нас не POST-запрос, то кидаем отбойник
 			return NotAllowedResponseImpl(std::move(req), http_handler::Method::POST);
 		}
@@ -689,7 +1084,7 @@ namespace game_handler {
 
 	// Возвращает ответ на запрос о совершении действий персонажем
 	http_handler::Response GameHandler::PlayerActionResponse(http_handler::StringRequest&& req) {
-		if (req.method_string() != http_handler::Method::POST) {
+		if (req.method() != http::verb::post) {
 			// если у нас не POST-запрос, то кидаем отбойник
 			return NotAllowedResponseImpl(std::move(req), http_handler::Method::POST);
 		}
@@ -725,7 +1120,7 @@ namespace game_handler {
 	// Возвращает ответ на запрос о состоянии игроков в игровой сессии
 	http_handler::Response GameHandler::GameStateResponse(http_handler::StringRequest&& req) {
 
-		if (req.method_string() != http_handler::Method::GET && req.method_string() != http_handler::Method::HEAD) {
+		if (req.method() != http::verb::get && req.method() != http::verb::head) {
 			// если у нас ни гет и ни хед запрос, то кидаем отбойник
 			return NotAllowedResponseImpl(std::move(req), http_handler::Method::GET, http_handler::Method::HEAD);
 		}
@@ -747,7 +1142,7 @@ namespace game_handler {
 	// Возвращает ответ на запрос о списке игроков в данной сессии
 	http_handler::Response GameHandler::PlayersListResponse(http_handler::StringRequest&& req) {
 
-		if (req.method_string() != http_handler::Method::GET && req.method_string() != http_handler::Method::HEAD) {
+		if (req.method() != http::verb::get && req.method() != http::verb::head) {
 			// если у нас ни гет и ни хед запрос, то кидаем отбойник
 			return NotAllowedResponseImpl(std::move(req), http_handler::Method::GET, http_handler::Method::HEAD);
 		}
@@ -766,66 +1161,132 @@ namespace game_handler {
 		}
 	}
 
-	// Возвращает ответ на запрос по присоединению к игре
-	http_handler::Response GameHandler::JoinGameResponse(http_handler::StringRequest&& req) {
+	// Выполняет долгий опрос состояния, ответ отправляется сразу или после тика, сменившего версию состояния
+	void GameHandler::GameStatePollResponse(http_handler::StringRequest&& req, StateRequestParams params, ResponseSender&& send) {
+
+		if (req.method() != http::verb::get && req.method() != http::verb::head) {
+			// если у нас ни гет и ни хед запрос, то кидаем отбойник
+			return send(NotAllowedResponseImpl(std::move(req), http_handler::Method::GET, http_handler::Method::HEAD));
+		}
+
+		try
+		{
+			// в случае успешной авторизации лямбда либо вернёт готовый ответ, либо отложит запрос в сессии
+			auto response = PlayerAuthorizationImpl(std::move(req),
+				[this, params, &send](http_handler::StringRequest&& req, const Token* token) -> std::optional<http_handler::Response> {
+					std::shared_ptr<GameSession> session = GetTokenSession(token);
+
+					if (!params.after_version_ || session->GetStateVersion() != *params.after_version_) {
+						// ждать нечего, либо клиент отстал или пришёл с версией прошлого запуска сервера, отвечаем сразу
+						return this->GameStateResponseImpl(std::move(req), token, params.base_version_);
+					}
+
+					// к моменту ответа игрок может выбыть, поэтому авторизация повторяется заново
+					session->WaitStateChange(*params.after_version_, __STATE_POLL_TIMEOUT__,
+						[this, base_version = params.base_version_, req = std::move(req), send = std::move(send)]() mutable {
+							try
+							{
+								send(this->PlayerAuthorizationImpl(std::move(req),
+									[this, base_version](http_handler::StringRequest&& req, const Token* token) {
+										return this->GameStateResponseImpl(std::move(req), token, base_version);
+									}));
+							}
+							catch (const std::exception& e)
+							{
+								logger_handler::LogException(e);
+								send(this->CommonFailResponseImpl(std::move(req), http::status::internal_server_error,
+									"internalError", "State poll failed"));
+							}
+						});
+					return std::nullopt;
+				});
+
+			if (response) {
+				send(std::move(*response));
+			}
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error("GameHandler::GameStatePollResponse::error" + std::string(e.what()));
+		}
+	}
+
+	// Выполняет запрос по присоединению к игре, выбор сессии выполняется в общем потоке обработчика,
+	// добавление игрока выполняется в стренде выбранной сессии, ответ передаётся в send
+	void GameHandler::JoinGameResponse(http_handler::StringRequest&& req, ResponseSender&& send) {
 
-		if (req.method_string() != http_handler::Method::POST) {
+		if (req.method() != http::verb::post) {
 			// сюда вставить респонс о недопустимом типе
-			return NotAllowedResponseImpl(std::move(req), http_handler::Method::POST);
+			return send(NotAllowedResponseImpl(std::move(req), http_handler::Method::POST));
 		}
 
+		std::string user_name;                   // имя нового игрока
+		std::shared_ptr<GameSession> ref;        // заготовка под указатель на конкретную игровую сессию
+		replay_handler::ReplayStamp stamp;       // отметка входа для журнала воспроизведения
+
 		try
 		{
 			if (req.body().size() == 0) {
 				// если нет тела запроса, тогда запрашиваем
-				return CommonFailResponseImpl(std::move(req), http::status::bad_request,
-					"invalidArgument", "Header body whit two arguments <userName> and <mapId> expected");
+				return send(CommonFailResponseImpl(std::move(req), http::status::bad_request,
+					"invalidArgument", "Header body whit two arguments <userName> and <mapId> expected"));
 			}
 
 			// парсим тело запроса, все исключения в процессе будем ловить в catch_блоке
 			json::value req_data = json_detail::ParseTextToJSON(req.body());
-			
-			{
-				// если в блоке вообще нет графы "userName" или "mapId"
-				if (!req_data.as_object().count("userName") || !req_data.as_object().count("mapId")) {
-					return CommonFailResponseImpl(std::move(req), http::status::bad_request,
-						"invalidArgument", "Two arguments <userName> and <mapId> expected");
-				}
 
-				// если в "userName" пустота
-				if (req_data.as_object().at("userName") == "") {
-					return CommonFailResponseImpl(std::move(req), http::status::bad_request,
-						"invalidArgument", "Invalid name");
-				}
+			// если в блоке вообще нет графы "userName" или "mapId"
+			if (!req_data.as_object().count("userName") || !req_data.as_object().count("mapId")) {
+				return send(CommonFailResponseImpl(std::move(req), http::status::bad_request,
+					"invalidArgument", "Two arguments <userName> and <mapId> expected"));
+			}
 
-				// ищем запрошенную карту
-				auto map = game_.FindMap(
-					model::Map::Id{ std::string(
-						req_data.as_object().at("mapId").as_string()) });
+			// если в "userName" пустота
+			if (req_data.as_object().at("userName") == "") {
+				return send(CommonFailResponseImpl(std::move(req), http::status::bad_request,
+					"invalidArgument", "Invalid name"));
+			}
 
-				if (map == nullptr) {
-					// если карта не найдена, то кидаем отбойник
-					return CommonFailResponseImpl(std::move(req), http::status::not_found,
-						"mapNotFound", "Map not found");
-				}
-				else {
-					// если карта есть и мы получили указатель
-					// передаем управление основной имплементации
-					return JoinGameResponseImpl(std::move(req), std::move(req_data), map);
-				}
+			// ищем запрошенную карту
+			auto map = game_.FindMap(
+				model::Map::Id{ std::string(
+					req_data.as_object().at("mapId").as_string()) });
+
+			if (map == nullptr) {
+				// если карта не найдена, то кидаем отбойник
+				return send(CommonFailResponseImpl(std::move(req), http::status::not_found,
+					"mapNotFound", "Map not found"));
 			}
+
+			user_name = std::string(req_data.as_object().at("userName").as_string());
+			// выбираем сессию и резервируем в ней место
+			ref = ReserveJoinSessionImpl(map);
+			// игрок будет добавлен в стренде сессии после текущего тика и до следующего
+			stamp = { tick_counter_, ++join_counter_ };
 		}
 		catch (const std::exception&)
 		{
-			return CommonFailResponseImpl(std::move(req), http::status::bad_request,
-				"invalidArgument", "Join game request parse error");
+			return send(CommonFailResponseImpl(std::move(req), http::status::bad_request,
+				"invalidArgument", "Join game request parse error"));
+		}
+
+		if (!ref) {
+			// если мест нет, то скажем - увы и ах
+			return send(CommonFailResponseImpl(std::move(req),
+				http::status::service_unavailable, "noPlace", "GameServer has no free place"));
 		}
+
+		// добавление игрока меняет данные сессии, поэтому выполняется в её стренде
+		net::dispatch(ref->GetStrand(), [this, ref, user_name = std::move(user_name), stamp,
+			req = std::move(req), send = std::move(send)]() mutable {
+				send(JoinGameResponseImpl(std::move(req), user_name, ref, stamp));
+			});
 	}
 
 	// Возвращает ответ на запрос по поиску конкретной карты
 	http_handler::Response GameHandler::FindMapResponse(http_handler::StringRequest&& req, std::string_view find_request_line) {
 
-		if (req.method_string() != http_handler::Method::GET && req.method_string() != http_handler::Method::HEAD) {
+		if (req.method() != http::verb::get && req.method() != http::verb::head) {
 			// сюда вставить респонс о недопустимом типе
 			return NotAllowedResponseImpl(std::move(req), http_handler::Method::GET, http_handler::Method::HEAD);
 		}
@@ -876,7 +1337,7 @@ namespace game_handler {
 	// Возвращает ответ со списком рекордов игры с дополнительными параметрами по количеству и отступу
 	http_handler::Response GameHandler::RecordsResponse(http_handler::StringRequest&& req, postgres::detail::ReqParam param) {
 
-		if (req.method_string() != http_handler::Method::GET) {
+		if (req.method() != http::verb::get) {
 			// если у нас ни гет и ни хед запрос, то кидаем отбойник
 			return NotAllowedResponseImpl(std::move(req), http_handler::Method::GET);
 		}
@@ -887,13 +1348,19 @@ namespace game_handler {
 				"invalidArgument", "Records list items count limit is overload");
 		}
 
+		if (!base_) {
+			// обработчик запущен без базы данных
+			return CommonFailResponseImpl(std::move(req), http::status::service_unavailable,
+				"dataBaseUnavailable", "Records data base is not connected");
+		}
+
 		http_handler::StringResponse response(http::status::ok, req.version());
 		response.set(http::field::content_type, http_handler::ContentType::APP_JSON);
 		response.set(http::field::cache_control, "no-cache");
 
 		// заполняем тушку ответа с помощью жисонского метода получив данные с базы
 		// пока пробуем в общем потоке игрового обработчика
-		std::string body_str = json_detail::GetRecordsTable(base_.GetGameRecords(param));
+		std::string body_str = json_detail::GetRecordsTable(base_->GetGameRecords(param));
 		response.set(http::field::content_length, std::to_string(body_str.size()));
 		response.body() = body_str;
 
@@ -943,54 +1410,130 @@ namespace game_handler {
 		return &(insert.first->first);
 	}
 
-	// удаляет токен, игрока и записывает его рекорд в базу SQL
-	bool GameHandler::ResetToken(const Token* token) {
-		std::lock_guard func_lock(mutex_);
-		return ResetTokenImpl(token);
+	// фиксирует тик: удаляет токены выбывших игроков и одной транзакцией пишет их рекорды в базу
+	void GameHandler::CommitRetiredPlayers(std::vector<RetiredPlayer>&& retired) {
+		if (retired.empty()) {
+			return;
+		}
+
+		std::lock_guard commit_lock(commit_mutex_);
+		std::vector<DBGameRecord> records;
+		records.reserve(retired.size());
+		{
+			// игроки уже удалены из сессий в их стрендах, остаётся удалить токены под одной блокировкой
+			std::lock_guard func_lock(mutex_);
+			for (auto& player : retired) {
+				tokens_list_.erase(player.token_);
+				records.push_back({ RecordId::New(), std::move(player.name_), player.score_, player.play_time_ms_ });
+			}
+		}
+
+		// запись в базу идёт уже без блокировки списка токенов
+		if (base_) {
+			base_->AddNewPlayerRecords(records);
+		}
 	}
 
-	// удаляет токен, игрока и записывает его рекорд в базу SQL
-	bool GameHandler::ResetTokenImpl(const Token* token) {
-		Token remove{ std::string(**token) };
+	// возвращает игровую сессию, к которой привязан токен
+	std::shared_ptr<GameSession> GameHandler::GetTokenSession(const Token* token) {
+		std::shared_lock read_lock(mutex_);
+		return tokens_list_.at(*token);
+	}
 
-		if (tokens_list_.count(remove)) {
-			// берем игрока из игровой сессии
-			auto to_delete = tokens_list_.at(remove)->GetPlayer(token);
-			// передаем данные в базу, чтобы записать результат игрока
-			base_.AddNewPlayerRecord(to_delete->GetName(), to_delete->GetScore(), to_delete->GetTotalInGameTimeMS());
-			// удаляем с сессии и из списка токенов
-			tokens_list_.at(remove)->RemovePlayer(token);
-			return tokens_list_.erase(remove);
+	// возвращает токен игрока из базы, если игрок в игре и обращение идёт из стренда его сессии, иначе nullptr
+	const Token* GameHandler::FindPlayerTokenImpl(const Token& token) {
+		// список токенов меняется из стрендов разных сессий, читаем под разделяемой блокировкой
+		std::shared_lock read_lock(mutex_);
+		// данные сессии читаются только в её стренде, если обработка идёт не в нём,
+		// значит токен появился уже после маршрутизации запроса и считается неизвестным
+		// игрок уже может быть удалён из сессии по простою, а токен ещё ждёт фиксации тика
+		if (auto it = tokens_list_.find(token); it != tokens_list_.end()
+			&& it->second->GetStrand().running_in_this_thread() && it->second->GetPlayer(&it->first)) {
+			return &it->first;
 		}
-		else {
+		return nullptr;
+	}
+
+	// возвращает игровую сессию игрока по токену, или nullptr, метод потокобезопасный
+	std::shared_ptr<GameSession> GameHandler::FindTokenSession(const Token& token) {
+		std::shared_lock read_lock(mutex_);
+		if (auto it = tokens_list_.find(token); it != tokens_list_.end()) {
+			return it->second;
+		}
+		return nullptr;
+	}
+
+	// подписывает канал игрока на состояние сессии, подписка выполняется в стренде сессии
+	void GameHandler::SubscribeStateChannel(std::shared_ptr<GameSession> session, const Token& token,
+		std::weak_ptr<StateSubscriber> subscriber) {
+		net::dispatch(session->GetStrand(), [this, session, token, subscriber = std::move(subscriber)]() mutable {
+			// игрок мог выбыть, пока шёл переход на WebSocket
+			const Token* token_ptr = FindPlayerTokenImpl(token);
+			if (!token_ptr || session->GetPlayer(token_ptr) == nullptr) {
+				if (auto locked = subscriber.lock()) {
+					locked->PlayerRemoved();
+				}
+				return;
+			}
+			session->AddStateSubscriber(token_ptr, std::move(subscriber));
+		});
+	}
+
+	// выполняет команду движения из канала, вызывается в стренде сессии, false если игрок уже выбыл
+	bool GameHandler::ChannelPlayerAction(GameSession& session, const Token& token, PlayerMove move) {
+		const Token* token_ptr = FindPlayerTokenImpl(token);
+		if (!token_ptr || session.GetPlayer(token_ptr) == nullptr) {
 			return false;
 		}
+
+		// так же как в PlayerActionResponseImpl, команда попадает в журнал воспроизведения
+		if (session.MovePlayer(token_ptr, move) && recorder_) {
+			recorder_->RecordMove(session.applied_tick_, **token_ptr, move);
+		}
+		return true;
 	}
 
-	// возвращает свободный уникальный идентификатор игровой сессии,
-	// применяется при созданнии новых игровых сессий
-	// Внимание! Метод не ставит флаг true в массиве!
-	std::optional<size_t> GameHandler::GetNewUniqueSessionId() {
+	// запоминает версию, применённую клиентом канала, вызывается в стренде сессии
+	void GameHandler::AckStateChannel(GameSession& session, const StateSubscriber* subscriber, uint64_t version) {
+		session.AckStateSubscriber(subscriber, version);
+	}
 
-		// ищем свободный номер для игровой сессии
-		auto id = std::find(sessions_id_.begin(), sessions_id_.end(), false);
+	// возвращает игровую сессию игрока по токену из заголовка Authorization, или nullptr
+	// метод потокобезопасный, применяется для маршрутизации запроса в стренд сессии
+	std::shared_ptr<GameSession> GameHandler::FindRequestSession(const http_handler::StringRequest& req) {
+		auto auth_iter = req.find("Authorization");
+		if (auth_iter == req.end()) {
+			return nullptr;
+		}
 
-		if (id == sessions_id_.end()) {
-			// если ничего не нашли то возвращаем пустышку
-			return std::nullopt;
+		auto auth_reparse = detail::BearerParser({ auth_iter->value().begin(), auth_iter->value().end() });
+		if (!auth_reparse) {
+			return nullptr;
 		}
 
-		return static_cast<size_t>((std::distance(sessions_id_.begin(), id)));
+		return FindTokenSession(Token{ auth_reparse.value() });
+	}
+
+	// возвращает свободный уникальный идентификатор игровой сессии,
+	// применяется при созданнии новых игровых сессий
+	// Внимание! Метод сразу занимает идентификатор в распределителе!
+	std::optional<size_t> GameHandler::GetNewUniqueSessionId() {
+
+		// ищем свободный номер для игровой сессии, сразу занимая его
+		// повторное занятие в MakeNewGameSessoin ничего не меняет
+		return sessions_id_.Acquire();
 	}
 	// создаёт новую игровую сессию по заданной карте с назначеным id
 	std::shared_ptr<GameSession> GameHandler::MakeNewGameSessoin(size_t id, const model::Map* map) {
 
+		// стренды сессий распределяются по исполнителям по кругу, чтобы сессии работали на разных ядрах
 		auto ref = instances_.at(map)
-			.emplace_back(std::make_shared<GameSession>(id, *this,
+			.emplace_back(std::make_shared<GameSession>(id, *this, executors_[id % executors_.size()],
 				game_.GetLootGenConfig(), map, __DEFAULT_SESSIONS_MAX_PLAYERS__, random_start_position_));
 
 		sessions_list_.emplace(id, ref);                   // сохраняем данные в массиве быстрого поиска 
-		sessions_id_[id] = true;                           // закрываем флаг, чтобы иметь идентификатор
+		sessions_id_.Take(id);                             // занимаем идентификатор, если он ещё не выдан
+		ref->applied_tick_ = tick_counter_;                // первым сессия применит следующий тик
 
 		return ref;
 	}
@@ -1023,15 +1566,8 @@ namespace game_handler {
 					"invalidArgument", "Failed to parse tick request JSON");
 			}
 
-			// запускаем обновление всех игровых сессий во всех игровых инстансах за O(N*K), 
-			// где N - количество открытых инстансов, K - количество открытых игровых сессий в инстансе 
-			for (auto& instance : instances_) {
-				// берем сессии из инстанса
-				for (auto& session : instance.second) {
-					// обновляем каждую сессию
-					session->UpdateState(time);
-				}
-			}
+			// запускаем обновление всех игровых сессий, каждая сессия обновляется в своём стренде
+			UpdateGameSessions(time);
 
 			// подготавливаем и возвращаем ответ о успехе операции
 			http_handler::StringResponse response(http::status::ok, req.version());
@@ -1063,9 +1599,12 @@ namespace game_handler {
 			}
 
 			// получаем сессию где на данный момент "висит" указанный токен
-			std::shared_ptr<GameSession> session = tokens_list_.at(*token);
+			std::shared_ptr<GameSession> session = GetTokenSession(token);
 			// запрашиваем сессию изменить скорость персонажа
-			session->MovePlayer(token, detail::ParsePlayerMove(body.at("move").as_string()));
+			PlayerMove move = detail::ParsePlayerMove(body.at("move").as_string());
+			if (session->MovePlayer(token, move) && recorder_) {
+				recorder_->RecordMove(session->applied_tick_, **token, move);
+			}
 
 			// подготавливаем и возвращаем ответ о успехе операции
 			http_handler::StringResponse response(http::status::ok, req.version());
@@ -1084,20 +1623,53 @@ namespace game_handler {
 	}
 
 	// Возвращает ответ на запрос о состоянии игроков в игровой сессии
-	http_handler::Response GameHandler::GameStateResponseImpl(http_handler::StringRequest&& req, const Token* token) {
+	http_handler::Response GameHandler::GameStateResponseImpl(http_handler::StringRequest&& req, const Token* token,
+		std::optional<uint64_t> base_version) {
 		
 		// получаем сессию где на данный момент "висит" указанный токен
-		std::shared_ptr<GameSession> session = tokens_list_.at(*token);
+		std::shared_ptr<GameSession> session = GetTokenSession(token);
+
+		// от кодировки зависят только тип содержимого, ETag и кодировщик тела
+		StateEncoding encoding = detail::GetAcceptedStateEncoding(req);
+		std::string_view content_type = encoding == StateEncoding::BINARY
+			? http_handler::ContentType::APP_GAME_STATE : http_handler::ContentType::APP_JSON;
+
+		// если у клиента уже есть текущая версия состояния, то тело не собираем и не отправляем
+		std::string etag = session->GetStateETag(encoding);
+		if (auto not_modified = NotModifiedResponseImpl(req, etag, content_type, true)) {
+			return std::move(*not_modified);
+		}
+
+		if (base_version) {
+			// разность относительно версии клиента, если версия выпала из истории, то отдаём полное состояние
+			if (auto delta_body = session->GetStateDeltaBody(*base_version, encoding)) {
+				// у разности нет ETag: её тело зависит от базовой версии, а не только от текущей
+				http_handler::SharedResponse response(http::status::ok, req.version());
+				response.set(http::field::content_type, content_type);
+				response.set(http::field::vary, "Accept");
+				response.set(http::field::cache_control, "no-cache");
+				response.set("X-State-Version", std::to_string(session->GetStateVersion()));
+				response.set("X-State-Base-Version", std::to_string(*base_version));
+
+				response.body() = std::move(delta_body);
+				response.prepare_payload();
+
+				return response;
+			}
+		}
 
 		// подготавливаем и возвращаем ответ
-		http_handler::StringResponse response(http::status::ok, req.version());
-		response.set(http::field::content_type, http_handler::ContentType::APP_JSON);
+		http_handler::SharedResponse response(http::status::ok, req.version());
+		response.set(http::field::content_type, content_type);
+		response.set(http::field::vary, "Accept");
 		response.set(http::field::cache_control, "no-cache");
+		response.set(http::field::etag, etag);
+		// версия для долгого опроса /v1/game/state?afterVersion=N
+		response.set("X-State-Version", std::to_string(session->GetStateVersion()));
 
-		// заполняем тушку ответа с помощью жисонского метода
-		std::string body_str = json_detail::GetSessionStateList(session->GetPlayers(), session->GetLoots());
-		response.set(http::field::content_length, std::to_string(body_str.size()));
-		response.body() = body_str;
+		// тело собирается один раз на версию состояния сессии и кодировку и разделяется между всеми опрашивающими
+		response.body() = session->GetStateBody(encoding);
+		response.prepare_payload();
 
 		return response;
 	}
@@ -1106,12 +1678,19 @@ namespace game_handler {
 	http_handler::Response GameHandler::PlayersListResponseImpl(http_handler::StringRequest&& req, const Token* token) {
 
 		// получаем сессию где на данный момент "висит" указанный токен
-		std::shared_ptr<GameSession> session = tokens_list_.at(*token);
+		std::shared_ptr<GameSession> session = GetTokenSession(token);
+
+		// список меняется только при входе и выходе игроков, повторный опрос обычно заканчивается 304
+		std::string etag = session->GetPlayersETag();
+		if (auto not_modified = NotModifiedResponseImpl(req, etag)) {
+			return std::move(*not_modified);
+		}
 
 		// подготавливаем и возвращаем ответ
 		http_handler::StringResponse response(http::status::ok, req.version());
 		response.set(http::field::content_type, http_handler::ContentType::APP_JSON);
 		response.set(http::field::cache_control, "no-cache");
+		response.set(http::field::etag, etag);
 		// заполняем тушку ответа с помощью жисонского метода
 		std::string body_str = json_detail::GetSessionPlayersList(session->GetPlayers());
 		response.set(http::field::content_length, std::to_string(body_str.size()));
@@ -1120,96 +1699,75 @@ namespace game_handler {
 		return response;
 	}
 
-	// Возвращает ответ, о успешном добавлении игрока в игровую сессию
-	http_handler::Response GameHandler::JoinGameResponseImpl(http_handler::StringRequest&& req, json::value&& body, const model::Map* map) {
-		
-		Player* new_player = nullptr;        // заготовка под нового челика на сервере
-		std::shared_ptr<GameSession> ref;    // заготовка под указатель на конкретную игровую сессию
+	// выбирает сессию со свободным местом на карте или создаёт новую, место в сессии резервируется
+	std::shared_ptr<GameSession> GameHandler::ReserveJoinSessionImpl(const model::Map* map) {
 
 		// смотрим есть ли на данный момент открытый игровой инстанс по данной карте
 		if (instances_.count(map)) {
-			// если инстанс есть, получаем его данные
-			auto instance = instances_.at(map);
 			// начинаем опрашивать все внутренние сессии в инстансе на предмет наличия свободного места
 			// так как инстанс не создаётся без нужды, то хотя бы одна игровая сессия быть должна
-
-			bool have_a_plance = false;      // вводим переменную для отслеживания наличия мест в текущих сессиях
-			for (auto& item : instance) {
-				// если нашли свободное место
-				if (item->CheckFreeSpace()) {
-
-					ref = item;              // записываем ссылку на шару сессии
-					have_a_plance = true;    // ставим флаг, что место нашли
-					break;                   // завершаем цикл за ненадобностью
+			for (auto& item : instances_.at(map)) {
+				// если нашли свободное место, то оно сразу резервируется
+				if (item->ReservePlace()) {
+					return item;
 				}
 			}
+		}
+		else {
+			// добавляем указатель и создаём инстанс со списком сессий
+			instances_.insert(std::make_pair(map, GameInstance()));
+		}
 
-			// если место было найдено, то ничего делать не надо - ref у нас есть, ниже по коду будет добавлен челик и создан ответ
-			if (!have_a_plance) {
-				
-				// если же мест в текущих открытых сессиях НЕ найдено, ну вот нету, значит надо открыть новую
-				std::lock_guard id_lock_(mutex_);                                          // закроем мьютекс на всякий пожарный
-				auto new_session_id = GetNewUniqueSessionId();            // забираем себе новый id для сессии
-
-				if (new_session_id.has_value()) {
-					// если удалось получить идентификатор то создаём новую сессию
-					ref = MakeNewGameSessoin(new_session_id.value(), map);
-					//ref = instances_.at(map)
-					//	.emplace_back(std::make_shared<GameSession>(new_session_id.value(), *this, 
-					//		game_.GetLootGenConfig(), map, __DEFAULT_SESSIONS_MAX_PLAYERS__, random_start_position_));
-
-					//sessions_list_.emplace(new_session_id.value(), ref);     // сохраняем данные в массиве быстрого поиска 
-					//sessions_id_[new_session_id.value()] = true;                           // закрываем флаг, чтобы иметь идентификатор
-				}
-				else {
-					// если местоф нет, то скажем - увы и ах
-					return CommonFailResponseImpl(std::move(req), 
-						http::status::service_unavailable, "noPlace", "GameServer has no free place");
-				}
-			}
+		// если же мест в текущих открытых сессиях НЕ найдено, ну вот нету, значит надо открыть новую
+		auto new_session_id = GetNewUniqueSessionId();            // забираем себе новый id для сессии
+
+		if (!new_session_id.has_value()) {
+			// если местоф нет, то возвращаем пустышку
+			return nullptr;
 		}
 
-		// если нет ни одной открытой сессии на данной карте
-		else {
-			std::lock_guard id_lock_(mutex_);                                          // закроем мьютекс на всякий пожарный
-			auto new_session_id = GetNewUniqueSessionId();            // забираем себе новый id для сессии
-
-			if (new_session_id.has_value()) {
-				// добавляем указатель и создаём инстанс со списком сессий
-				instances_.insert(std::make_pair(map, GameInstance()));
-				// создаём новую сессию
-				ref = MakeNewGameSessoin(new_session_id.value(), map);
-
-				//// так как у нас еще нет никаких сессий то тупо создаём новую внутри 
-				//// c максимумом, для примера, в 200 игроков (см. конструктор GameSession)
-				//// тут же получаем шару на неё, и передаем ей управление по вступлению в игру
-				//ref = instances_.at(map)
-				//	.emplace_back(std::make_shared<GameSession>(new_session_id.value(), *this, 
-				//		game_.GetLootGenConfig(),map, __DEFAULT_SESSIONS_MAX_PLAYERS__, random_start_position_));
-
-				//sessions_list_.emplace(new_session_id.value(), ref);     // сохраняем данные в массиве быстрого поиска 
-				//sessions_id_[new_session_id.value()] = true;                           // закрываем флаг, чтобы иметь идентификатор
-			}
-			else {
-				// если местоф нет, то скажем - увы и ах
+		// если удалось получить идентификатор то создаём новую сессию
+		auto ref = MakeNewGameSessoin(new_session_id.value(), map);
+		ref->ReservePlace();
+
+		return ref;
+	}
+
+	// Возвращает ответ, о успешном добавлении игрока в игровую сессию, вызывается в стренде сессии
+	http_handler::Response GameHandler::JoinGameResponseImpl(http_handler::StringRequest&& req, 
+		std::string_view name, std::shared_ptr<GameSession> session, replay_handler::ReplayStamp stamp) {
+		
+		try
+		{
+			// добавляем челика на сервер и принимаем на него указатель
+			Player* new_player = session->AddPlayer(name);
+
+			if (new_player == nullptr) {
+				// если место в сессии всё же закончилось
 				return CommonFailResponseImpl(std::move(req),
 					http::status::service_unavailable, "noPlace", "GameServer has no free place");
 			}
-		}
 
-		// добавляем челика на сервер и принимаем на него указатель
-		new_player = ref->AddPlayer(body.at("userName").as_string());
+			if (recorder_) {
+				recorder_->RecordJoin(stamp, new_player->GetToken(), *session->GetMap()->GetId(), name);
+			}
 
-		// подготавливаем и возвращаем ответ
-		http_handler::StringResponse response(http::status::ok, req.version());
-		response.set(http::field::content_type, http_handler::ContentType::APP_JSON);
-		response.set(http::field::cache_control, "no-cache");
+			// подготавливаем и возвращаем ответ
+			http_handler::StringResponse response(http::status::ok, req.version());
+			response.set(http::field::content_type, http_handler::ContentType::APP_JSON);
+			response.set(http::field::cache_control, "no-cache");
 
-		std::string body_str = json_detail::GetSessionPlayerJoin(new_player);
-		response.set(http::field::content_length, std::to_string(body_str.size()));
-		response.body() = body_str;
+			std::string body_str = json_detail::GetSessionPlayerJoin(new_player);
+			response.set(http::field::content_length, std::to_string(body_str.size()));
+			response.body() = body_str;
 
-		return response;
+			return response;
+		}
+		catch (const std::exception&)
+		{
+			return CommonFailResponseImpl(std::move(req), http::status::bad_request,
+				"invalidArgument", "Join game request parse error");
+		}
 	}
 
 	// Возвращает ответ, что запрошенный метод не ражрешен, доступный указывается в аргументе allow
@@ -1223,6 +1781,27 @@ namespace game_handler {
 		return response;
 	}
 
+	// Возвращает ответ 304, если версия из If-None-Match совпадает с текущей, иначе std::nullopt
+	std::optional<http_handler::Response> GameHandler::NotModifiedResponseImpl(const http_handler::StringRequest& req, std::string_view etag,
+		std::string_view content_type, bool vary_accept) {
+		auto if_none_match = req.find(http::field::if_none_match);
+		if (if_none_match == req.end() || !detail::IfNoneMatch(if_none_match->value(), etag)) {
+			return std::nullopt;
+		}
+
+		// ответ 304 идёт без тела, но с тем же ETag, чтобы клиент мог продолжать условные запросы
+		http_handler::StringResponse response(http::status::not_modified, req.version());
+		response.set(http::field::content_type, content_type);
+		if (vary_accept) {
+			// 304 повторяет Vary ответа 200, иначе кеш может отдать сохранённое тело другой кодировки
+			response.set(http::field::vary, "Accept");
+		}
+		response.set(http::field::cache_control, "no-cache");
+		response.set(http::field::etag, etag);
+
+		return http_handler::Response(std::move(response));
+	}
+
 	// Возвращает ответ на все варианты неверных и невалидных запросов
 	http_handler::Response GameHandler::CommonFailResponseImpl(http_handler::StringRequest&& req, 
 		http::status status, std::string_view code, std::string_view message) {
@@ -1252,6 +1831,8 @@ namespace game_handler {
 		
 		// восстанавливаем уникальный токен игрока
 		auto token = game_.AddUniqueTokenImpl(player.GetToken(), session_);
+		// занимаем место в сессии под восстановленного игрока
+		session_->ReservePlace();
 		// воссоздаём игрока из полученных данных и токена
 		session_->AddPlayerImpl(player.GetId(), player.GetName(), token, player.GetBagCapacity())
 			.SetCurrentPosition(std::move(player.GetCurrentPosition()))
@@ -1273,6 +1854,7 @@ namespace game_handler {
 	// воссоздаёт игровой лут
 	GameHandler& GameSessionRestoreContext::RestoreGameLoot(const SerializedLoot& loot) {
 		// запрашиваем генерацию лута по заданным параметрам
+		session_->MarkStateChanged();
 		session_->GenerateSessionLootImpl(loot.GetType(), loot.GetId(), loot.GetPosition());
 		// если лут лежал у игрока в инвентаре
 		if (loot.GetToken() != "onMap") {
@@ -1320,6 +1902,124 @@ namespace game_handler {
 			}
 		}
 
+		// собирает строгий ETag вида "эпоха-сессия-тип-версия" в шестнадцатеричном виде
+		std::string MakeVersionETag(uint64_t epoch, size_t session_id, char kind, uint64_t version) {
+			// "ffffffffffffffff-ffffffffffffffff-s-ffffffffffffffff" с кавычками укладывается в 56 символов
+			char buffer[64];
+			int size = std::snprintf(buffer, sizeof(buffer), "\"%llx-%llx-%c-%llx\"",
+				static_cast<unsigned long long>(epoch), static_cast<unsigned long long>(session_id), kind,
+				static_cast<unsigned long long>(version));
+			return std::string(buffer, static_cast<size_t>(size));
+		}
+
+		// сообщает совпадает ли один из тегов заголовка If-None-Match с etag, слабые теги W/ сравниваются без префикса
+		bool IfNoneMatch(std::string_view if_none_match, std::string_view etag) {
+			while (!if_none_match.empty()) {
+				// отделяем очередной тег списка, теги в кавычках запятых не содержат
+				size_t comma = if_none_match.find(',');
+				std::string_view tag = if_none_match.substr(0, comma);
+				if_none_match.remove_prefix(comma == std::string_view::npos ? if_none_match.size() : comma + 1);
+
+				while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) {
+					tag.remove_prefix(1);
+				}
+				while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) {
+					tag.remove_suffix(1);
+				}
+
+				if (tag == "*") {
+					return true;
+				}
+				if (tag.substr(0, 2) == "W/") {
+					tag.remove_prefix(2);
+				}
+				if (tag == etag) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// отрезает пробелы и табуляции по краям строки
+		std::string_view TrimSpaces(std::string_view line) {
+			while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) {
+				line.remove_prefix(1);
+			}
+			while (!line.empty() && (line.back() == ' ' || line.back() == '\t')) {
+				line.remove_suffix(1);
+			}
+			return line;
+		}
+
+		// сравнивает строки без учёта регистра ASCII, типы и параметры Accept регистр не различают
+		bool EqualsNoCase(std::string_view lhs, std::string_view rhs) {
+			return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+				[](char l, char r) { return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r)); });
+		}
+
+		// возвращает вес q из параметров диапазона типов Accept, без параметра вес равен 1
+		// неразборчивый вес тоже считается единицей, как если бы параметра не было
+		double GetAcceptWeight(std::string_view params) {
+			while (!params.empty()) {
+				size_t semicolon = params.find(';');
+				std::string_view param = TrimSpaces(params.substr(0, semicolon));
+				params.remove_prefix(semicolon == std::string_view::npos ? params.size() : semicolon + 1);
+
+				size_t equal = param.find('=');
+				if (equal == std::string_view::npos || !EqualsNoCase(TrimSpaces(param.substr(0, equal)), "q"sv)) {
+					continue;
+				}
+
+				std::string_view value = TrimSpaces(param.substr(equal + 1));
+				double weight = 1.0;
+				auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), weight);
+				if (ec != std::errc{} || ptr != value.data() + value.size()) {
+					return 1.0;
+				}
+				return std::clamp(weight, 0.0, 1.0);
+			}
+			return 1.0;
+		}
+
+		// выбирает кодировку состояния по заголовку Accept, двоичная только по явному application/x-game-state
+		// с ненулевым весом q, не меньшим веса JSON (application/json, application/* или */*)
+		StateEncoding GetAcceptedStateEncoding(const http_handler::StringRequest& req) {
+			auto accept = req.find(http::field::accept);
+			if (accept == req.end()) {
+				return StateEncoding::JSON;
+			}
+
+			double binary_weight = 0.0;
+			double json_weight = 0.0;
+
+			std::string_view types = accept->value();
+			while (!types.empty()) {
+				// отделяем очередной тип списка вместе с параметрами после ';'
+				size_t comma = types.find(',');
+				std::string_view range = types.substr(0, comma);
+				types.remove_prefix(comma == std::string_view::npos ? types.size() : comma + 1);
+
+				size_t semicolon = range.find(';');
+				std::string_view type = TrimSpaces(range.substr(0, semicolon));
+				double weight = semicolon == std::string_view::npos ? 1.0 : GetAcceptWeight(range.substr(semicolon + 1));
+
+				if (EqualsNoCase(type, http_handler::ContentType::APP_GAME_STATE)) {
+					binary_weight = std::max(binary_weight, weight);
+				}
+				else if (EqualsNoCase(type, http_handler::ContentType::APP_JSON)
+					|| EqualsNoCase(type, "application/*"sv) || type == "*/*"sv) {
+					json_weight = std::max(json_weight, weight);
+				}
+			}
+
+			// q=0 означает "не принимаю", такой тип не выбирается никогда
+			if (binary_weight > 0.0 && binary_weight >= json_weight) {
+				return StateEncoding::BINARY;
+			}
+			// */*, application/json и всё прочее получают JSON, как и раньше
+			return StateEncoding::JSON;
+		}
+
 	} // namespace detail
 
 } //namespace game_handler
\ No newline at end of file
@@ -4,13 +4,21 @@
 #include "boost_json.h"
 #include "collision_handler.h"         // через данный хеддер подключается domain.h
 #include "postgres/postgers.h"
+#include "id_allocator.h"
+#include "replay_recorder.h"
+#include "rng.h"
 
 #include <vector>
 #include <memory>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 #include <optional>
+#include <shared_mutex>
 #include <functional>
+#include <deque>
+#include <array>
+#include <type_traits>
 #include <unordered_map>
 
 namespace game_handler {
@@ -19,6 +27,10 @@ namespace game_handler {
 	static const size_t __DEFAULT_SESSIONS_MAX_PLAYERS__ = 200;
 	// базовое максимальное количество игровых сессий
 	static const size_t __DEFAULT_GAME_SESSIONS_MAX_COUNT__ = 50;
+	// предельное время ожидания долгого опроса состояния, должно быть меньше таймаута соединения в http_server
+	static const std::chrono::milliseconds __STATE_POLL_TIMEOUT__{ 20000 };
+	// количество последних тиков, сменивших состояние сессии, относительно версий которых можно получить разностный ответ
+	static const size_t __STATE_HISTORY_SIZE__ = 256;
 
 	namespace fs = std::filesystem;
 	namespace json = boost::json;
@@ -31,6 +43,51 @@ namespace game_handler {
 
 	class GameHandler;                           // forward-definition
 
+	// исполнитель, на котором создаются стренды игровых сессий
+	using SessionExecutor = net::io_context::executor_type;
+	// обработчик, принимающий готовый ответ, когда ответ формируется в стренде игровой сессии
+	using ResponseSender = std::function<void(http_handler::Response&&)>;
+
+	// аргументы запроса /v1/game/state?afterVersion=N&baseVersion=M, хотя бы один из них задан
+	struct StateRequestParams {
+		std::optional<uint64_t> after_version_;   // ждать тика, сменившего эту версию
+		std::optional<uint64_t> base_version_;    // ответить разностью относительно этой версии
+	};
+
+	/*
+	* Подписчик на состояние игровой сессии, например канал WebSocket.
+	* PushState и PlayerRemoved вызываются в стренде сессии, отправку подписчик переносит в свой исполнитель сам.
+	* Сессия держит подписчика по weak_ptr, отписка происходит при его удалении или при удалении его игрока.
+	*/
+	class StateSubscriber {
+	public:
+		virtual ~StateSubscriber() = default;
+		// получает тело ответа о состоянии сессии и его версию
+		virtual void PushState(std::shared_ptr<const std::string> state, uint64_t version) = 0;
+		// сообщает, что игрок подписчика удалён из сессии, состояние ему больше не отправляется
+		virtual void PlayerRemoved() = 0;
+	};
+
+	// игрок, выбывший из сессии по простою, его рекорд записывается в базу при фиксации тика
+	struct RetiredPlayer {
+		Token token_;
+		std::string name_;
+		unsigned score_ = 0;
+		int play_time_ms_ = 0;
+	};
+
+	// время фаз обновления состояния игровой сессии, накапливается при включенном профилировании
+	struct TickProfile {
+		std::chrono::nanoseconds future_positions_{ 0 };     // 1. расчёт будущих позиций
+		std::chrono::nanoseconds collisions_{ 0 };           // 2. коллизии, сбор и сдача лута
+		std::chrono::nanoseconds retirement_{ 0 };           // 3. удаление бездействующих игроков
+		std::chrono::nanoseconds moving_{ 0 };               // 4. перемещение игроков
+		std::chrono::nanoseconds loot_generation_{ 0 };      // 5. генерация лута
+		size_t updates_ = 0;                                 // количество профилированных обновлений
+
+		TickProfile& operator+=(const TickProfile& other);
+	};
+
 	// класс-обработчик текущей игровой сессии
 	class GameSession : public std::enable_shared_from_this<GameSession>, public CollisionProvider {
 		friend class GameHandler;
@@ -46,19 +103,23 @@ namespace game_handler {
 		* сгенерировать новый лут и разместить его на карте, и обязательно с уникальным идентификатором в сессии
 		*/
 
-		GameSession(size_t id, GameHandler& handler, loot_gen::LootGeneratorConfig config, const model::Map* map, size_t max_players) 
+		GameSession(size_t id, GameHandler& handler, SessionExecutor executor, loot_gen::LootGeneratorConfig config, const model::Map* map, size_t max_players) 
 			: session_id_(id)
 			, game_handler_(handler)
+			, strand_(net::make_strand(executor))
 			, loot_gen_{ config/*, []() { return model::GetRandomDouble(); }*/ }
+			, rng_(model::Rng::StreamSeed(id))
 			, session_map_(map)
 			, players_id_(max_players)
 			, loots_id_(max_players * static_cast<size_t>(
 				std::pow(session_map_->GetOnMapBagCapacity(), 2))) {
 		}
-		GameSession(size_t id, GameHandler& handler, loot_gen::LootGeneratorConfig config, const model::Map* map, size_t max_players, bool start_random_position)
+		GameSession(size_t id, GameHandler& handler, SessionExecutor executor, loot_gen::LootGeneratorConfig config, const model::Map* map, size_t max_players, bool start_random_position)
 			: session_id_(id)
 			, game_handler_(handler)
+			, strand_(net::make_strand(executor))
 			, loot_gen_{ config/*, []() { return model::GetRandomDouble(); }*/ }
+			, rng_(model::Rng::StreamSeed(id))
 			, session_map_(map)
 			, players_id_(max_players)
 			, loots_id_(max_players * static_cast<size_t>(
@@ -91,6 +152,10 @@ namespace game_handler {
 		const model::Map* GetMap() const {
 			return session_map_;
 		}
+		// возвращает стренд игровой сессии, все обращения к данным сессии выполняются в нём
+		http_handler::Strand& GetStrand() {
+			return strand_;
+		}
 
 		// ----------------- блок наследуемых методов CollisionProvider ----------------------------
 
@@ -106,6 +171,34 @@ namespace game_handler {
 		const SessionLoots& GetLoots() const override {
 			return session_loots_;
 		}
+		// возвращает широкую фазу поиска коллизий, перестраивается перед каждым поиском
+		const CollisionBroadphase* GetBroadphase() const override {
+			return broadphase_.get();
+		}
+
+		// ----------------- блок кешированного состояния для /v1/game/state ------------------------
+
+		// возвращает версию состояния сессии, растёт при каждом изменении игроков или лута
+		uint64_t GetStateVersion() const {
+			return state_version_;
+		}
+		/*
+		* Возвращает тело ответа о состоянии сессии для текущей версии.
+		* Тело собирается один раз на версию и кодировку, все запросы между изменениями получают один и тот же буфер.
+		* Вызывается только в стренде сессии.
+		*/
+		std::shared_ptr<const std::string> GetStateBody(StateEncoding encoding = StateEncoding::JSON);
+		/*
+		* Возвращает тело разностного ответа о состоянии относительно версии base_version, см. StateDelta.
+		* Если base_version вышла за окно истории __STATE_HISTORY_SIZE__ или неизвестна сессии, возвращает nullptr,
+		* тогда клиенту отправляется полное состояние. Тела кешируются по базовой версии и кодировке до смены состояния.
+		* Вызывается только в стренде сессии.
+		*/
+		std::shared_ptr<const std::string> GetStateDeltaBody(uint64_t base_version, StateEncoding encoding = StateEncoding::JSON);
+		// возвращает ETag текущей версии состояния сессии, у кодировок тела разные теги
+		std::string GetStateETag(StateEncoding encoding = StateEncoding::JSON) const;
+		// возвращает ETag текущей версии списка игроков сессии, он меняется только при входе и выходе игроков
+		std::string GetPlayersETag() const;
 
 	protected:
 
@@ -123,14 +216,37 @@ namespace game_handler {
 		* Запускает полный цикл обработки в следующей последовательности:
 		*  1. Расчёт будущих позиций игроков
 		*  2. Расчёт и выполнение ожидаемых при перемещении коллизий
-		*  3. Выполнение перемещения игроков на будущие координаты
-		*  4. Генерация лута на карте
+		*  3. Удаление засидевшихся игроков, данные о них копятся до фиксации тика
+		*  4. Выполнение перемещения игроков на будущие координаты
+		*  5. Генерация лута на карте
 		*/
 		bool UpdateState(int time);
+		// забирает выбывших за время тика игроков
+		std::vector<RetiredPlayer> TakeRetiredPlayers();
+		// включает накопление времени фаз UpdateState в переданный профиль, nullptr выключает
+		void SetTickProfile(TickProfile* profile);
+		/*
+		* Откладывает ответ на долгий опрос состояния, пока версия состояния равна version.
+		* complete вызывается в стренде сессии после тика, сменившего версию, или по истечении timeout.
+		* Вызывается только в стренде сессии.
+		*/
+		void WaitStateChange(uint64_t version, std::chrono::milliseconds timeout, std::function<void()> complete);
+		// завершает отложенные опросы, для которых версия состояния сменилась, вызывается после тика
+		void NotifyStateWaiters();
+		// подключает подписчика игрока token и сразу отправляет ему текущее состояние, вызывается в стренде сессии
+		void AddStateSubscriber(const Token* token, std::weak_ptr<StateSubscriber> subscriber);
+		// запоминает версию, которую подписчик уже применил, дальше он получает разность относительно неё
+		void AckStateSubscriber(const StateSubscriber* subscriber, uint64_t version);
+		// отправляет подписчикам состояние, если оно сменилось с прошлой отправки, вызывается после тика
+		void PushStateSubscribers();
 		// метод добавляет скорость персонажу, вызывается из GameHandler::player_action_response_impl
 		bool MovePlayer(const Token* token, PlayerMove move);
 		// отвечает есть ли в сессии свободное местечко
 		bool CheckFreeSpace();
+		// резервирует место под нового игрока, может вызываться вне стренда сессии
+		bool ReservePlace();
+		// освобождает зарезервированное место
+		void ReleasePlace();
 
 		const auto cbegin() const {
 			return session_players_.cbegin();
@@ -148,17 +264,120 @@ namespace game_handler {
 	private:
 		size_t session_id_;                                 // идентификатор игровой сессии
 		GameHandler& game_handler_;                         // ссылка на базовый игровой обработчик
+		http_handler::Strand strand_;                       // стренд, в котором выполняются все операции сессии
 		loot_gen::LootGenerator loot_gen_;                  // собственный генератор лута игровой сессии
+		model::Rng rng_;                                    // генератор случайных чисел сессии, зерно зависит от id сессии
+		uint64_t applied_tick_ = 0;                         // номер последнего применённого тика, для журнала воспроизведения
+		TickProfile* tick_profile_ = nullptr;               // профиль фаз обновления, если профилирование включено
 		const model::Map* session_map_;                     // указатель на карту игровой модели
 
-		SessionPlayers session_players_;                    // хешированная мапа с игроками
-		std::vector<bool> players_id_;                      // булевый массив индексов игроков
+		SessionPlayers session_players_;                    // игроки сессии, состояние в плотном хранилище
+		util::IdAllocator players_id_;                      // распределитель индексов игроков
+		std::atomic<size_t> places_taken_ = 0;              // количество занятых и зарезервированных мест
 		SessionLoots session_loots_;                        // хешированная мапа с лутом на карте
-		std::vector<bool> loots_id_;                        // булевый массив индексов лута
+		util::IdAllocator loots_id_;                        // распределитель индексов лута
 		SessionLoots loots_in_bags_;                        // хешированная мапа с лутом в инвентаре игроков
+		std::vector<RetiredPlayer> retired_players_;        // выбывшие по простою игроки, ждущие фиксации тика
+		std::unique_ptr<CollisionBroadphase> broadphase_    // широкая фаза поиска коллизий по отрезкам дорог
+			= std::make_unique<RoadSegmentBroadphase>();
 
 		bool random_start_position_ = true;                 // флаг случайной позиции игрока на старте
 
+		uint64_t state_version_ = 1;                        // версия состояния сессии
+		uint64_t tick_start_version_ = 0;                   // версия состояния на начало текущего тика
+		uint64_t players_version_ = 1;                      // версия списка игроков сессии
+		uint64_t etag_epoch_ = static_cast<uint64_t>(       // метка запуска, чтобы ETag не повторялись после перезапуска
+			std::chrono::system_clock::now().time_since_epoch().count());
+
+		// кешированное тело ответа о состоянии сессии в одной кодировке
+		struct StateBody {
+			uint64_t version_ = 0;                          // версия, для которой собрано тело
+			std::shared_ptr<const std::string> body_;
+		};
+		std::array<StateBody, __STATE_ENCODINGS_COUNT__> state_bodies_;  // тела по кодировкам StateEncoding
+
+		// отложенный ответ на долгий опрос состояния
+		struct StateWaiter {
+			uint64_t version_;                              // версия состояния, известная клиенту
+			std::shared_ptr<net::steady_timer> timer_;      // таймер предельного ожидания
+			std::function<void()> complete_;                // отправка ответа
+		};
+		std::unordered_map<uint64_t, StateWaiter> state_waiters_;
+		uint64_t state_waiters_counter_ = 0;                // счётчик идентификаторов отложенных опросов
+
+		// подписчик на состояние сессии
+		struct StateSubscription {
+			std::weak_ptr<StateSubscriber> subscriber_;
+			const Token* token_ = nullptr;                  // игрок подписчика, при его удалении подписка снимается
+			uint64_t acked_version_ = 0;                    // подтверждённая версия, 0 - только полное состояние
+		};
+		std::vector<StateSubscription> state_subscribers_;  // подписчики на состояние сессии
+		uint64_t pushed_version_ = 0;                       // версия, последней отправленная подписчикам
+
+		/*
+		* Изменения состояния за один тик вместе с командами, пришедшими до следующего тика.
+		* Хранятся кольцом из __STATE_HISTORY_SIZE__ последних тиков, сменивших состояние,
+		* поэтому поток команд между тиками не вытесняет историю, сколько бы версий он ни создал.
+		*/
+		struct StateChangeSet {
+			uint64_t from_version_ = 0;                     // версия перед первым изменением набора
+			uint64_t version_ = 0;                          // последняя версия, в которую перешло состояние
+			std::vector<size_t> players_;                   // изменённые и новые игроки
+			std::vector<size_t> removed_players_;           // удалённые игроки
+			std::vector<size_t> loots_;                     // новый лут
+			std::vector<size_t> removed_loots_;             // убранный с карты лут
+		};
+		std::deque<StateChangeSet> state_changes_;
+		uint64_t delta_bodies_version_ = 0;                 // версия, для которой собраны delta_bodies_
+		// разностные тела по кодировкам StateEncoding и базовым версиям
+		std::array<std::unordered_map<uint64_t, std::shared_ptr<const std::string>>, __STATE_ENCODINGS_COUNT__> delta_bodies_;
+
+		// снимает подписки игрока token и сообщает подписчикам об удалении игрока
+		void RemovePlayerSubscribers(const Token* token);
+		// отмечает изменение состояния сессии новой версией, кешированное тело ответа устаревает
+		// изменения, отмеченные следом через Note*, попадают в открытый набор изменений тика
+		void MarkStateChanged();
+		// открывает набор изменений тика, вызывается в начале UpdateState
+		// пустой набор прошлого тика используется повторно, тики без изменений историю не вытесняют
+		void OpenStateChangeSet();
+		// отмечает вход или выход игрока, меняет и список игроков, и состояние сессии
+		void MarkPlayersChanged() {
+			++players_version_;
+			MarkStateChanged();
+		}
+		// записывает изменение в открытый набор изменений тика
+		void NoteChangedPlayer(size_t id) {
+			if (!state_changes_.empty()) {
+				state_changes_.back().players_.push_back(id);
+			}
+		}
+		void NoteRemovedPlayer(size_t id) {
+			if (!state_changes_.empty()) {
+				state_changes_.back().removed_players_.push_back(id);
+			}
+		}
+		void NoteAddedLoot(size_t id) {
+			if (!state_changes_.empty()) {
+				state_changes_.back().loots_.push_back(id);
+			}
+		}
+		void NoteRemovedLoot(size_t id) {
+			if (!state_changes_.empty()) {
+				state_changes_.back().removed_loots_.push_back(id);
+			}
+		}
+		// отмечает изменение состояния, если в сессии есть движущиеся игроки, и записывает их в набор изменений
+		void MarkMovingPlayers();
+		// отмечает изменение состояния, если в этом тике его ещё не отмечали, вызывается только из UpdateState
+		// так весь лут, появившийся за тик, получает одну версию, а не по версии на предмет
+		void MarkTickChanged() {
+			if (state_version_ == tick_start_version_) {
+				MarkStateChanged();
+			}
+		}
+		// собирает изменения между base_version и текущей версией, std::nullopt если версия вне окна истории
+		std::optional<StateDelta> CollectStateDelta(uint64_t base_version) const;
+
 		// добавляет нового игрока на карту
 		Player& AddPlayerImpl(size_t, std::string_view, const Token*, unsigned);
 
@@ -166,6 +385,7 @@ namespace game_handler {
 		bool CheckStartPositionImpl(PlayerPosition& position);
 
 		// генерирует лут с заданым типом, идентификатором и позицией
+		// набор изменений, в который попадёт предмет, должен быть открыт вызывающим
 		bool GenerateSessionLootImpl(size_t type, size_t id, PlayerPosition pos);
 		// генерирует на карте новые предметы лута в указанном количестве
 		bool GenerateSessionLoots(unsigned count);
@@ -175,7 +395,8 @@ namespace game_handler {
 		// выполняет обновления текущих позиций игроков согласно расчитанных ранее будущих позиций
 		bool UpdateCurrentPlayersPositions();
 		
-		// выполняет удаление всех бездействующих игроков, превысивших лимит времени ожидания
+		// удаляет из сессии всех бездействующих игроков, превысивших лимит времени ожидания
+		// токены и рекорды игроков обрабатывает GameHandler в фазе фиксации тика
 		bool UpdateRetirementPlayers();
 
 		// возвращает предметы в офис бюро находок, удаляет их из инвентаря и начисляет очки
@@ -185,13 +406,13 @@ namespace game_handler {
 		// выполняет расчёт коллизий и выполняет их согласно полученому массиву
 		bool HandlePlayersCollisionsActions();
 
-		// изменяет координаты игрока при движении параллельно дороге, на которой он стоит
-		bool PlayerParallelMovingImpl(Player& player, PlayerDirection direction, PlayerPosition&& from, PlayerPosition&& to, const model::Road* road);
-		// изменяет координаты игрока при движении перпендикулярно дороге, на которой он стоит
-		bool PlayerCrossMovingImpl(Player& player, PlayerDirection direction, PlayerPosition&& from, PlayerPosition&& to, const model::Road* road);
-		// обновляет позицию выбранного игрока в соответствии с его заданной скоростью, направлением и временем в секундах
+		// изменяет координаты игрока в слоте хранилища при движении параллельно дороге, на которой он стоит
+		bool PlayerParallelMovingImpl(PlayersColumns& players, size_t slot, PlayerDirection direction, PlayerPosition&& from, PlayerPosition&& to, const model::Road* road);
+		// изменяет координаты игрока в слоте хранилища при движении перпендикулярно дороге, на которой он стоит
+		bool PlayerCrossMovingImpl(PlayersColumns& players, size_t slot, PlayerDirection direction, PlayerPosition&& from, PlayerPosition&& to, const model::Road* road);
+		// обновляет позицию игрока в слоте хранилища в соответствии с его заданной скоростью, направлением и временем в секундах
 		// принимает время в миллисекундах, перерасчёт будет дальше по коду
-		bool CalculateFuturePlayerPositionImpl(Player& player, int time);
+		bool CalculateFuturePlayerPositionImpl(PlayersColumns& players, size_t slot, int time);
 		// выполняет расчёт и запись будущих позиций игроков в игровой сессии, принимает время в миллисекундах
 		bool UpdateFuturePlayersPositions(int time);
 	};
@@ -255,14 +476,34 @@ namespace game_handler {
 		friend class GameSessionRestoreContext;
 	public:
 		// отдаём создание игровой модели классу обработчику игры
+		// игровые сессии распределяются по переданным исполнителям по кругу
 		explicit GameHandler(const fs::path& configuration
 			, postgres::detail::ConnectionConfig&& base_config
+			, std::vector<SessionExecutor> executors
+			, size_t session_count = __DEFAULT_GAME_SESSIONS_MAX_COUNT__)
+
+			: game_{ json_loader::LoadGameConfiguration(configuration) }
+			, restore_context_(*this)
+			, base_(std::in_place, std::move(base_config))
+			, executors_(std::move(executors))
+			, sessions_id_(session_count) {
+			if (executors_.empty()) {
+				throw std::invalid_argument("GameHandler::GameHandler::Error::Session executors list is empty");
+			}
+		}
+		// игровой обработчик без базы данных, рекорды выбывших игроков никуда не записываются
+		// применяется для безголовых прогонов игровой модели, например в game_bench
+		GameHandler(const fs::path& configuration
+			, std::vector<SessionExecutor> executors
 			, size_t session_count = __DEFAULT_GAME_SESSIONS_MAX_COUNT__)
 
 			: game_{ json_loader::LoadGameConfiguration(configuration) }
-			, sessions_id_(session_count)
 			, restore_context_(*this)
-			, base_(std::move(base_config)) {
+			, executors_(std::move(executors))
+			, sessions_id_(session_count) {
+			if (executors_.empty()) {
+				throw std::invalid_argument("GameHandler::GameHandler::Error::Session executors list is empty");
+			}
 		}
 
 		// ------------------- блок методов сериализатора ----------------------
@@ -273,16 +514,38 @@ namespace game_handler {
 		// ------------------- прочие управляющие методы -----------------------
 
 		// Выполняет обновление всех открытых игровых сессий по времени
+		// сессии обновляются параллельно в своих стрендах, после обновления последней сессии
+		// выполняется фиксация тика: удаление токенов выбывших игроков и запись их рекордов
 		void UpdateGameSessions(int time);
 		// Назначает флаг случайного размещения игроков на картах
 		void SetRandomStartPosition(bool flag);
 		// Сбрасывает и удаляет все активные игровые сессии
 		void ResetGameSessions();
+		// Назначает журнал, в который записываются входы игроков, их действия и тики
+		void SetReplayRecorder(std::shared_ptr<replay_handler::ReplayRecorder> recorder);
 
 		// возвращает массив с игровыми сессиями
 		const GameSessionList& GetSessions() const {
 			return sessions_list_;
 		}
+		// возвращает игровую сессию игрока по токену из заголовка Authorization, или nullptr
+		// метод потокобезопасный, применяется для маршрутизации запроса в стренд сессии
+		std::shared_ptr<GameSession> FindRequestSession(const http_handler::StringRequest& req);
+
+		// ------------------- блок канала WebSocket ---------------------------
+
+		// возвращает игровую сессию игрока по токену, или nullptr, метод потокобезопасный
+		std::shared_ptr<GameSession> FindTokenSession(const Token& token);
+		// подписывает канал игрока на состояние сессии, подписка выполняется в стренде сессии
+		// текущее состояние приходит сразу, дальше после каждого тика, сменившего состояние
+		// если игрок уже выбыл, канал сразу получает PlayerRemoved
+		void SubscribeStateChannel(std::shared_ptr<GameSession> session, const Token& token,
+			std::weak_ptr<StateSubscriber> subscriber);
+		// выполняет команду движения из канала, вызывается в стренде сессии, false если игрок уже выбыл
+		bool ChannelPlayerAction(GameSession& session, const Token& token, PlayerMove move);
+		// запоминает версию, применённую клиентом канала, вызывается в стренде сессии
+		// дальше канал получает разность относительно неё вместо полного состояния
+		void AckStateChannel(GameSession& session, const StateSubscriber* subscriber, uint64_t version);
 		
 		// Возвращает ответ на запрос по изменению состояния игровых сессий со временем
 		http_handler::Response SessionsUpdateResponse(http_handler::StringRequest&& req);
@@ -292,8 +555,13 @@ namespace game_handler {
 		http_handler::Response GameStateResponse(http_handler::StringRequest&& req);
 		// Возвращает ответ на запрос о списке игроков в данной сессии
 		http_handler::Response PlayersListResponse(http_handler::StringRequest&& req);
-		// Возвращает ответ на запрос по присоединению к игре
-		http_handler::Response JoinGameResponse(http_handler::StringRequest&& req);
+		// Выполняет запрос состояния с аргументами: если версия сессии отличается от after_version, ответ отправляется сразу,
+		// иначе запрос ждёт в стренде сессии следующего тика, сменившего версию, но не дольше __STATE_POLL_TIMEOUT__.
+		// С base_version ответ содержит только изменения после неё, если она ещё есть в истории сессии
+		void GameStatePollResponse(http_handler::StringRequest&& req, StateRequestParams params, ResponseSender&& send);
+		// Выполняет запрос по присоединению к игре, выбор сессии выполняется в общем потоке обработчика,
+		// добавление игрока выполняется в стренде выбранной сессии, ответ передаётся в send
+		void JoinGameResponse(http_handler::StringRequest&& req, ResponseSender&& send);
 		// Возвращает ответ на запрос по поиску конкретной карты
 		http_handler::Response FindMapResponse(http_handler::StringRequest&& req, std::string_view find_request_line);
 		// Возвращает ответ со списком загруженных карт
@@ -312,26 +580,39 @@ namespace game_handler {
 		 * Служит для получения уникального токена при добавлении нового игрока.
 		*/
 		const Token* GetUniqueToken(std::shared_ptr<GameSession> session);
-		// удаляет токен, игрока и записывает его рекорд в базу SQL
-		bool ResetToken(const Token* token);
 		// возвращает допустимое время простоя игрока в миллисекундах
 		int GetRetirementTimeMS() const {
 			return game_.GetRetirementTimeMS();
 		}
+		// фиксирует тик: удаляет токены выбывших игроков и одной транзакцией пишет их рекорды в базу
+		void CommitRetiredPlayers(std::vector<RetiredPlayer>&& retired);
 
 	private:
+		// общее состояние одного тика, разделяемое между стрендами сессий
+		struct TickContext {
+			std::mutex mutex_;
+			size_t sessions_left_ = 0;                   // количество сессий, ещё не завершивших обновление
+			std::vector<RetiredPlayer> retired_;         // выбывшие игроки всех сессий
+		};
+
 		model::Game game_;
-		std::mutex mutex_;
+		std::shared_mutex mutex_;                        // защищает список токенов, читается из стрендов сессий
+		std::mutex commit_mutex_;                        // фиксации тиков выполняются строго по одной
 		GameSessionRestoreContext restore_context_;      // контекст восстановления игровых сессий
-		DataBaseHandler base_;                           // PostgreSQL база данных в которую пишутся рекорды
+		std::optional<DataBaseHandler> base_;            // PostgreSQL база данных в которую пишутся рекорды
+		std::vector<SessionExecutor> executors_;         // исполнители для стрендов игровых сессий
 
 		GameMapInstance instances_;                      // игровые инстансы по картам
 		GameTokenList tokens_list_;                      // токены с указателями на конкретные сессии
 		GameSessionList sessions_list_;                  // идентификаторы сессий и указатели на сессии
 
-		std::vector<bool> sessions_id_;                  // булевый массив для id игровых сессий
+		util::IdAllocator sessions_id_;                  // распределитель id игровых сессий
 		bool random_start_position_ = false;             // флаг радндомной позиции игроков на старте
 
+		std::shared_ptr<replay_handler::ReplayRecorder> recorder_;    // журнал воспроизведения, если запись включена
+		uint64_t tick_counter_ = 0;                      // номер последнего тика, меняется только в общем стренде
+		uint64_t join_counter_ = 0;                      // порядковый номер последнего резервирования места при входе
+
 		// возвращает уникальный токен после генерации
 		const Token* GetUniqueTokenImpl(std::shared_ptr<GameSession> session);
 		// добавляет конкретный токен с указателем на игровую сессию
@@ -339,7 +620,12 @@ namespace game_handler {
 		// добавляет конкретный токен с указателем на игровую сессию
 		const Token* AddUniqueTokenImpl(Token&&, std::shared_ptr<GameSession>);
 
-		bool ResetTokenImpl(const Token* token);
+		// возвращает игровую сессию, к которой привязан токен
+		std::shared_ptr<GameSession> GetTokenSession(const Token* token);
+		// возвращает токен игрока из базы, если игрок в игре и обращение идёт из стренда его сессии, иначе nullptr
+		const Token* FindPlayerTokenImpl(const Token& token);
+		// выбирает сессию со свободным местом на карте или создаёт новую, место в сессии резервируется
+		std::shared_ptr<GameSession> ReserveJoinSessionImpl(const model::Map* map);
 
 		// возвращает свободный уникальный идентификатор игровой сессии,
 		// применяется при созданнии новых игровых сессий
@@ -352,21 +638,30 @@ namespace game_handler {
 		// Возвращает ответ на запрос о совершении действий персонажем
 		http_handler::Response PlayerActionResponseImpl(http_handler::StringRequest&& req, const Token* token);
 		// Возвращает ответ на запрос о состоянии игроков в игровой сессии
-		http_handler::Response GameStateResponseImpl(http_handler::StringRequest&& req, const Token* token);
+		// с base_version отвечает разностью относительно неё, если версия вне истории, то полным состоянием
+		http_handler::Response GameStateResponseImpl(http_handler::StringRequest&& req, const Token* token,
+			std::optional<uint64_t> base_version = std::nullopt);
 		// Возвращает ответ на запрос о списке игроков в данной сессии
 		http_handler::Response PlayersListResponseImpl(http_handler::StringRequest&& req, const Token* token);
-		// Возвращает ответ, о успешном добавлении игрока в игровую сессию
-		http_handler::Response JoinGameResponseImpl(http_handler::StringRequest&& req, json::value&& body, const model::Map* map);
+		// Возвращает ответ, о успешном добавлении игрока в игровую сессию, вызывается в стренде сессии
+		http_handler::Response JoinGameResponseImpl(http_handler::StringRequest&& req, std::string_view name, 
+			std::shared_ptr<GameSession> session, replay_handler::ReplayStamp stamp);
 		// Возвращает ответ, что запрошенный метод не разрешен, доступные указывается в аргументе allow
 		http_handler::Response NotAllowedResponseImpl(http_handler::StringRequest&& req, std::string_view allow);
+		// Возвращает ответ 304, если версия из If-None-Match совпадает с текущей, иначе std::nullopt
+		// vary_accept выставляется для ресурсов, тело и ETag которых зависят от заголовка Accept
+		std::optional<http_handler::Response> NotModifiedResponseImpl(const http_handler::StringRequest& req, std::string_view etag,
+			std::string_view content_type = http_handler::ContentType::APP_JSON, bool vary_accept = false);
 
 		// Возвращает ответ на все варианты неверных и невалидных запросов
 		http_handler::Response CommonFailResponseImpl(http_handler::StringRequest&& req, 
 			http::status status, std::string_view code, std::string_view message);
 
 		// Проверяет полученный в запросе токен, если токен корректнен и есть в базе, то управление передается прилагаемому методу
+		// возвращает результат метода, ответ об ошибке авторизации приводится к его типу, например std::optional<Response>
 		template <typename Function>
-		http_handler::Response PlayerAuthorizationImpl(http_handler::StringRequest&& req, Function&& func);
+		std::invoke_result_t<Function, http_handler::StringRequest&&, const Token*>
+			PlayerAuthorizationImpl(http_handler::StringRequest&& req, Function&& func);
 		template <typename ...Methods>
 		// Возвращает ответ, что запрошенные методы не разрешены, доступный указывается в аргументе allow
 		http_handler::Response NotAllowedResponseImpl(http_handler::StringRequest&& req, Methods&& ...methods);
@@ -397,11 +692,20 @@ namespace game_handler {
 
 		std::optional<std::string> BearerParser(const std::string& auth_line);
 
+		// собирает строгий ETag вида "эпоха-сессия-тип-версия" в шестнадцатеричном виде
+		std::string MakeVersionETag(uint64_t epoch, size_t session_id, char kind, uint64_t version);
+		// сообщает совпадает ли один из тегов заголовка If-None-Match с etag, слабые теги W/ сравниваются без префикса
+		bool IfNoneMatch(std::string_view if_none_match, std::string_view etag);
+		// выбирает кодировку состояния по заголовку Accept, двоичная только по явному application/x-game-state
+		// с ненулевым весом q, не меньшим веса JSON
+		StateEncoding GetAcceptedStateEncoding(const http_handler::StringRequest& req);
+
 	} // namespace detail
 
 	// Проверяет полученный в запросе токен, если токен корректнен и есть в базе, то управление передается прилагаемому методу
 	template <typename Function>
-	http_handler::Response GameHandler::PlayerAuthorizationImpl(http_handler::StringRequest&& req, Function&& func) {
+	std::invoke_result_t<Function, http_handler::StringRequest&&, const Token*>
+		GameHandler::PlayerAuthorizationImpl(http_handler::StringRequest&& req, Function&& func) {
 		// ищем тушку авторизации среди хеддеров запроса
 		auto auth_iter = req.find("Authorization");
 		if (auth_iter == req.end()) {
@@ -420,15 +724,17 @@ namespace game_handler {
 				"invalidToken", "Authorization header is missing");
 		}
 
-		Token token{ auth_reparse.value() }; // создаём быстро токен на основе запроса и ищем совпадение во внутреннем массиве
-		if (!tokens_list_.count(token)) {
+		// создаём быстро токен на основе запроса и ищем совпадение во внутреннем массиве
+		const Token* token_ptr = FindPlayerTokenImpl(Token{ auth_reparse.value() });
+
+		if (!token_ptr) {
 			// если заголовок Authorization содержит валидное значение токена, но в игре нет пользователя с таким токеном
 			return CommonFailResponseImpl(std::move(req), http::status::unauthorized,
 				"unknownToken", "Player token has not been found");
 		}
 
 		// вызываем полученный обработчик
-		return func(std::move(req), &tokens_list_.find(token)->first);
+		return func(std::move(req), token_ptr);
 	}
 
 	template <typename ...Methods>
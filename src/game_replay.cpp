@@ -0,0 +1,218 @@
+#include "sdk.h"
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/json/src.hpp>
+#include <boost/program_options.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "logger_handler.h"                          // логгер для исключений игрового обработчика
+#include "serialization_handler.h"                   // подключит game_handler.h
+#include "replay_recorder.h"                         // чтение журнала воспроизведения
+#include "rng.h"                                     // генераторы случайных чисел игровой модели
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace po = boost::program_options;
+namespace json = boost::json;
+namespace http = boost::beast::http;
+
+/*
+* Безголовое воспроизведение журнала, записанного сервером с ключом --record-file.
+* Все события подаются в GameHandler теми же запросами, что и на сервере, но в одном потоке
+* и без ожидания: после каждого события очередь io_context выполняется до конца.
+* Итоговое состояние можно сохранить через --state-file и сравнить с сохранением сервера.
+*/
+
+namespace {
+
+    struct ReplayArguments {
+        bool show_help_list = false;                      // флаг показа листа с помощью
+        std::string config_json_path;                     // путь к конфигурационному файлу config.json
+        std::string replay_file_path;                     // путь к файлу журнала воспроизведения
+        std::string state_file_path;                      // путь к файлу для сохранения итогового состояния
+    };
+
+    // счётчики воспроизведения
+    struct ReplayStatistics {
+        size_t ticks = 0;
+        size_t joins = 0;
+        size_t moves = 0;
+        size_t failed = 0;
+    };
+
+    ReplayArguments ParseReplayCommandLine(int argc, const char* const argv[]) {
+        po::options_description description{ "All options"s };
+        ReplayArguments arguments;
+        description.add_options()
+            ("help,h", "produce help message")
+            ("config-file,c", po::value(&arguments.config_json_path)->value_name("file"), "set config file path")
+            ("replay-file,r", po::value(&arguments.replay_file_path)->value_name("file"), "set recorded replay file path")
+            ("state-file,s", po::value(&arguments.state_file_path)->value_name("state"), "save final game state to file");
+
+        po::variables_map variables_map;
+        po::store(po::parse_command_line(argc, argv, description), variables_map);
+        po::notify(variables_map);
+
+        if (variables_map.contains("help"s)) {
+            std::cout << description;
+            arguments.show_help_list = true;
+            return arguments;
+        }
+
+        if (!variables_map.contains("config-file"s)) {
+            throw std::runtime_error("Config file have not been specified"s);
+        }
+        if (!variables_map.contains("replay-file"s)) {
+            throw std::runtime_error("Replay file have not been specified"s);
+        }
+
+        return arguments;
+    }
+
+    // возвращает строковое обозначение направления, как оно приходит в запросе
+    std::string_view MoveToString(game_handler::PlayerMove move) {
+        for (const auto& [str, type] : game_handler::__PLAYER_MOVE_TYPE__) {
+            if (type == move) {
+                return str;
+            }
+        }
+        return ""sv;
+    }
+
+    http_handler::StringRequest MakeApiRequest(std::string_view target, std::string body, std::string_view token = {}) {
+        http_handler::StringRequest req{ http::verb::post, target, 11 };
+        req.set(http::field::content_type, http_handler::ContentType::APP_JSON);
+        if (!token.empty()) {
+            req.set(http::field::authorization, "Bearer "s + std::string(token));
+        }
+        req.body() = std::move(body);
+        req.prepare_payload();
+        return req;
+    }
+
+    // возвращает тело строкового ответа с кодом 200, или nullopt
+    std::optional<std::string> TakeOkBody(http_handler::Response&& response) {
+        if (!IS_STRING_RESPONSE(response)) {
+            return std::nullopt;
+        }
+        auto& str_response = std::get<http_handler::StringResponse>(response);
+        if (str_response.result() != http::status::ok) {
+            return std::nullopt;
+        }
+        return std::move(str_response.body());
+    }
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+
+    try
+    {
+        logger_handler::detail::BoostLogBaseSetup(std::cout);
+
+        ReplayArguments arguments = ParseReplayCommandLine(argc, argv);
+        if (arguments.show_help_list) {
+            return EXIT_SUCCESS;
+        }
+
+        replay_handler::ReplayLog log = replay_handler::LoadReplay(arguments.replay_file_path);
+
+        // генераторы засеваются так же, как на записывавшем сервере
+        model::Rng::SetGlobalSeed(log.header_.seed_);
+
+        net::io_context ioc(1);
+        // обработчик без базы данных: воспроизведение не должно писать рекорды выбывших игроков в таблицу лидеров
+        auto game = std::make_shared<game_handler::GameHandler>(arguments.config_json_path,
+            std::vector<game_handler::SessionExecutor>{ ioc.get_executor() });
+        game->SetRandomStartPosition(log.header_.random_start_position_);
+
+        // выполняет всё, что событие поставило в стренды сессий
+        auto drain = [&ioc]() {
+            ioc.restart();
+            ioc.run();
+        };
+
+        std::vector<std::string> tokens;                  // токены игроков по порядковому номеру входа
+        ReplayStatistics stat;
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto& event : log.events_) {
+            switch (event.type_)
+            {
+            case replay_handler::ReplayEventType::tick:
+                game->UpdateGameSessions(event.time_delta_);
+                drain();
+                ++stat.ticks;
+                break;
+
+            case replay_handler::ReplayEventType::join:
+            {
+                json::object body{ {"userName", event.name_}, {"mapId", event.map_id_} };
+                std::optional<std::string> answer;
+                game->JoinGameResponse(MakeApiRequest("/api/v1/game/join"sv, json::serialize(body)),
+                    [&answer](http_handler::Response&& response) {
+                        answer = TakeOkBody(std::move(response));
+                    });
+                drain();
+
+                if (tokens.size() <= event.player_) {
+                    tokens.resize(event.player_ + 1);
+                }
+                if (answer) {
+                    tokens[event.player_] = std::string(json::parse(*answer).as_object().at("authToken").as_string());
+                    ++stat.joins;
+                }
+                else {
+                    ++stat.failed;
+                }
+                break;
+            }
+
+            case replay_handler::ReplayEventType::move:
+            {
+                std::string_view token = event.player_ < tokens.size() ? tokens[event.player_] : ""sv;
+                json::object body{ {"move", MoveToString(event.move_)} };
+                auto req = MakeApiRequest("/api/v1/game/player/action"sv, json::serialize(body), token);
+
+                auto session = token.empty() ? nullptr : game->FindRequestSession(req);
+                if (!session) {
+                    ++stat.failed;
+                    break;
+                }
+
+                bool done = false;
+                net::dispatch(session->GetStrand(), [&game, &done, req = std::move(req)]() mutable {
+                    done = TakeOkBody(game->PlayerActionResponse(std::move(req))).has_value();
+                });
+                drain();
+                done ? ++stat.moves : ++stat.failed;
+                break;
+            }
+            }
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        if (!arguments.state_file_path.empty()) {
+            game_handler::SerialHandler(arguments.state_file_path, game).SerializeGameData();
+        }
+
+        double seconds = std::max(elapsed.count(), int64_t{ 1 }) / 1e6;
+        std::cout << "replayed " << log.events_.size() << " events: " << stat.ticks << " ticks, "
+            << stat.joins << " joins, " << stat.moves << " moves, " << stat.failed << " failed" << std::endl;
+        std::cout << "elapsed " << elapsed.count() / 1000.0 << " ms, " 
+            << static_cast<size_t>(log.events_.size() / seconds) << " events/s" << std::endl;
+
+        return stat.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
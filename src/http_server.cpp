@@ -1,6 +1,13 @@
 ﻿#include "http_server.h"
 
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <cerrno>
+#endif
 
 namespace http_server {
 
@@ -11,6 +18,129 @@ namespace http_server {
             beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
     }
 
+    // состояние отправки ответа через sendfile, живёт в куче до окончания записи
+    struct SessionBase::SendFileState {
+        http_handler::SendFileResponse response;
+        http::response_serializer<http_handler::SendFileBody> serializer{ response };
+        size_t segment = 0;               // отправляемый сегмент тела
+        uint64_t position = 0;            // сколько байт сегмента уже отправлено
+        std::size_t bytes_written = 0;    // всего записано в сокет, вместе с заголовком
+        // ожидание готовности сокета не покрыто таймаутом tcp_stream, поэтому его ограничивает свой таймер
+        net::steady_timer timer;
+        uint64_t wait_id = 0;             // номер текущего ожидания, устаревшее срабатывание таймера пропускается
+
+        SendFileState(http_handler::SendFileResponse&& file_response, const tcp::socket::executor_type& executor)
+            : response(std::move(file_response))
+            , timer(executor) {
+        }
+    };
+
+    void SessionBase::WriteSendFile(http_handler::SendFileResponse&& response) {
+#ifdef __linux__
+        LogWrite(response.result_int(), response.at(http::field::content_type));
+
+        // сериализатор и ответ должны жить до окончания записи, поэтому перемещаем их в кучу
+        auto state = std::make_shared<SendFileState>(std::move(response), stream_.socket().get_executor());
+        state->serializer.split(true);
+
+        http::async_write_header(stream_, state->serializer,
+            [state, self = GetSharedThis()](beast::error_code ec, std::size_t bytes_written) {
+                if (ec) {
+                    return self->OnWrite(state->response.need_eof(), ec, bytes_written);
+                }
+                state->bytes_written = bytes_written;
+                self->SendFileChunk(std::move(state));
+            });
+#else
+        Write(std::move(response));
+#endif
+    }
+
+    void SessionBase::SendFileChunk([[maybe_unused]] std::shared_ptr<SendFileState> state) {
+#ifdef __linux__
+        tcp::socket& socket = stream_.socket();
+        const int file = state->response.body().File().native_handle();
+        const http_handler::BodyRanges& ranges = state->response.body().Ranges();
+
+        // sendfile и send с неблокирующим сокетом возвращают EAGAIN, когда буфер сокета заполнен
+        beast::error_code ec;
+        socket.native_non_blocking(true, ec);
+        bool wait = false;
+
+        while (!ec && state->segment != ranges.SegmentCount()) {
+            http_handler::BodyRanges::Segment segment = ranges.GetSegment(state->segment);
+            if (state->position == segment.size) {
+                ++state->segment;
+                state->position = 0;
+                continue;
+            }
+
+            ssize_t sent = 0;
+            if (segment.content) {
+                off_t offset = static_cast<off_t>(segment.offset + state->position);
+                sent = ::sendfile(socket.native_handle(), file, &offset,
+                    static_cast<size_t>(std::min<uint64_t>(segment.size - state->position, 1 << 30)));
+            }
+            else {
+                sent = ::send(socket.native_handle(), segment.text.data() + state->position,
+                    static_cast<size_t>(segment.size - state->position), MSG_NOSIGNAL);
+            }
+
+            if (sent > 0) {
+                state->position += sent;
+                state->bytes_written += sent;
+            }
+            else if (sent == 0) {
+                // файл стал короче, чем при открытии
+                ec = http::error::short_read;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // ждём, пока сокет снова сможет принять данные, и продолжаем с той же позиции
+                wait = true;
+                break;
+            }
+            else if (errno != EINTR) {
+                ec = beast::error_code(errno, boost::system::system_category());
+            }
+        }
+
+        // остальные операции сессии выполняются через asio, возвращаем сокету прежний режим и на время ожидания
+        beast::error_code mode_ec;
+        socket.native_non_blocking(false, mode_ec);
+
+        if (!wait) {
+            return OnWrite(state->response.need_eof(), ec, state->bytes_written);
+        }
+
+        // если клиент не читает ответ, то по таймеру сокет закрывается, и ожидание ниже завершается ошибкой
+        const uint64_t wait_id = ++state->wait_id;
+        state->timer.expires_after(__SEND_FILE_WAIT_TIMEOUT__);
+        state->timer.async_wait([state, wait_id, self = GetSharedThis()](beast::error_code timer_ec) {
+            if (!timer_ec && state->wait_id == wait_id) {
+                beast::error_code close_ec;
+                self->stream_.socket().close(close_ec);
+            }
+        });
+        socket.async_wait(tcp::socket::wait_write,
+            [state, self = GetSharedThis()](beast::error_code wait_ec) mutable {
+                // ожидание завершилось раньше таймера, его срабатывание больше не закрывает сокет
+                ++state->wait_id;
+                state->timer.cancel();
+                if (wait_ec) {
+                    return self->OnWrite(state->response.need_eof(), wait_ec, state->bytes_written);
+                }
+                self->SendFileChunk(std::move(state));
+            });
+#endif
+    }
+
+    // замеряет время получения ответа на запрос и создаёт запись о нём
+    void SessionBase::LogWrite(int code, std::string_view content_type) {
+        end_ts_ = std::chrono::system_clock::now();
+        logger_handler::LogResponse(code, content_type,
+            std::chrono::duration_cast<std::chrono::milliseconds>(end_ts_ - start_ts_).count(), HostAdress());
+    }
+
     std::string SessionBase::HostAdress() const {
         return stream_.socket().remote_endpoint().address().to_string();
     }
@@ -36,6 +166,11 @@ namespace http_server {
 
         // Предварительно логируем полученный запрос
         logger_handler::LogRequest(std::ref(request_), HostAdress());
+
+        // Запрос на переход к WebSocket забирает соединение, дальше им владеет канал
+        if (beast::websocket::is_upgrade(request_)) {
+            return HandleUpgrade(std::move(request_), std::move(stream_));
+        }
         // Активируем временную точку отсчёта времени на выполнение запроса
         start_ts_ = std::chrono::system_clock::now();
         // Передаем выполнение запроса классу-наследнику
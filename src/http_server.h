@@ -3,9 +3,15 @@
 #include "logger_handler.h"
 #include "domain.h"
 
+#include <boost/beast/websocket.hpp>
+
 #include <iostream>
 #include <chrono>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
 namespace http_server {
 
     using namespace std::literals;
@@ -16,6 +22,9 @@ namespace http_server {
     namespace http = beast::http;
     namespace sys = boost::system;
 
+    // наибольшее время ожидания готовности сокета к записи при отправке тела через sendfile, как и таймаут чтения
+    static const std::chrono::seconds __SEND_FILE_WAIT_TIMEOUT__{ 30 };
+
     class SessionBase {
     public:
         // Запрещаем копирование и присваивание объектов SessionBase и его наследников
@@ -33,12 +42,7 @@ namespace http_server {
 
         template <typename Body, typename Fields>
         void Write(http::response<Body, Fields>&& response) {
-            // Как только ответ пришёл в данный метод замеряем время получения ответа на запрос
-            end_ts_ = std::chrono::system_clock::now();
-            // Создаём запись о успешном получении ответа
-            logger_handler::LogResponse(
-                response.result_int(), response.at(http::field::content_type),
-                std::chrono::duration_cast<std::chrono::milliseconds>(end_ts_ - start_ts_).count(), HostAdress());
+            LogWrite(response.result_int(), response.at(http::field::content_type));
 
             // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
             auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
@@ -50,9 +54,20 @@ namespace http_server {
                 });
         }
 
+        /*
+        * Отправляет ответ с телом из файла. На Linux заголовок пишется сериализатором beast,
+        * а тело - вызовами sendfile(2) из файла прямо в сокет, заголовки частей multipart - вызовами send(2).
+        * При заполненном буфере сокета сессия ждёт готовности к записи не дольше __SEND_FILE_WAIT_TIMEOUT__,
+        * затем соединение закрывается. На прочих платформах ответ пишется обычным Write.
+        */
+        void WriteSendFile(http_handler::SendFileResponse&& response);
+
         std::string HostAdress() const;
 
         ~SessionBase() = default;
+
+        // замеряет время получения ответа на запрос и создаёт запись о нём
+        void LogWrite(int code, std::string_view content_type);
     private:
         // tcp_stream содержит внутри себя сокет и добавляет поддержку таймаутов
         beast::tcp_stream stream_;
@@ -69,23 +84,35 @@ namespace http_server {
 
         void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
 
+        struct SendFileState;
+        // отправляет тело файла через sendfile, пока сокет принимает данные
+        void SendFileChunk(std::shared_ptr<SendFileState> state);
+
         // Обработку запроса делегируем подклассу
         virtual void HandleRequest(HttpRequest&& request) = 0;
+        // Запрос на переход к WebSocket вместе с соединением делегируем подклассу, сессия HTTP на этом завершается
+        virtual void HandleUpgrade(HttpRequest&& request, beast::tcp_stream&& stream) = 0;
 
         virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
     };
 
-    template <typename RequestLambda>
-    class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestLambda>> {
+    template <typename RequestLambda, typename UpgradeLambda>
+    class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestLambda, UpgradeLambda>> {
     public:
-        template <typename RLambda>
-        Session(tcp::socket&& socket, RLambda&& request_lambda)
+        template <typename RLambda, typename ULambda>
+        Session(tcp::socket&& socket, RLambda&& request_lambda, ULambda&& upgrade_lambda)
             : SessionBase(std::move(socket))
-            , request_lambda_(std::forward<RLambda>(request_lambda)) {
+            , request_lambda_(std::forward<RLambda>(request_lambda))
+            , upgrade_lambda_(std::forward<ULambda>(upgrade_lambda)) {
         }
 
     private:
         RequestLambda request_lambda_;
+        UpgradeLambda upgrade_lambda_;
+
+        void HandleUpgrade(HttpRequest&& request, beast::tcp_stream&& stream) override {
+            upgrade_lambda_(std::move(request), std::move(stream));
+        }
 
         std::shared_ptr<SessionBase> GetSharedThis() override {
             return this->shared_from_this();
@@ -104,19 +131,60 @@ namespace http_server {
                 else if (IS_FILE_RESPONSE(response)) {
                     self->Write(std::move(std::get<http_handler::FileResponse>(response)));
                 }
+                else if (IS_SHARED_RESPONSE(response)) {
+                    self->Write(std::move(std::get<http_handler::SharedResponse>(response)));
+                }
+                else if (IS_SENDFILE_RESPONSE(response)) {
+                    self->WriteSendFile(std::move(std::get<http_handler::SendFileResponse>(response)));
+                }
+                else if (IS_SHARED_RANGE_RESPONSE(response)) {
+                    self->Write(std::move(std::get<http_handler::SharedRangeResponse>(response)));
+                }
             });
         }
     };
 
-    template <typename RequestLambda>
-    class Listener : public std::enable_shared_from_this<Listener<RequestLambda>> {
+#ifdef __linux__
+    // опция сокета SO_REUSEPORT в виде, который принимает basic_socket::set_option
+    class ReusePort {
     public:
-        template <typename RLambda>
-        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, RLambda&& request_lambda)
+        explicit ReusePort(bool enabled)
+            : value_(enabled ? 1 : 0) {
+        }
+
+        template <typename Protocol>
+        int level(const Protocol&) const {
+            return SOL_SOCKET;
+        }
+        template <typename Protocol>
+        int name(const Protocol&) const {
+            return SO_REUSEPORT;
+        }
+        template <typename Protocol>
+        const int* data(const Protocol&) const {
+            return &value_;
+        }
+        template <typename Protocol>
+        std::size_t size(const Protocol&) const {
+            return sizeof(value_);
+        }
+
+    private:
+        int value_;
+    };
+#endif
+
+    template <typename RequestLambda, typename UpgradeLambda>
+    class Listener : public std::enable_shared_from_this<Listener<RequestLambda, UpgradeLambda>> {
+    public:
+        template <typename RLambda, typename ULambda>
+        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, RLambda&& request_lambda, ULambda&& upgrade_lambda,
+            [[maybe_unused]] bool reuse_port = false)
             : ioc_(ioc)
             // Обработчики асинхронных операций acceptor_ будут вызываться в своём strand
             , acceptor_(net::make_strand(ioc))
-            , request_lambda_(std::forward<RLambda>(request_lambda)) {
+            , request_lambda_(std::forward<RLambda>(request_lambda))
+            , upgrade_lambda_(std::forward<ULambda>(upgrade_lambda)) {
             // Открываем acceptor, используя протокол (IPv4 или IPv6), указанный в endpoint
             acceptor_.open(endpoint.protocol());
 
@@ -125,6 +193,13 @@ namespace http_server {
             // Однако это может помешать повторно открыть сокет в полузакрытом состоянии.
             // Флаг reuse_address разрешает открыть сокет, когда он "наполовину закрыт"
             acceptor_.set_option(net::socket_base::reuse_address(true));
+            // В режиме нескольких акцепторов каждый поток открывает свой сокет на том же порту
+            // Флаг SO_REUSEPORT позволяет ядру распределять входящие соединения между ними
+#ifdef __linux__
+            if (reuse_port) {
+                acceptor_.set_option(ReusePort(true));
+            }
+#endif
             // Привязываем acceptor к адресу и порту endpoint
             acceptor_.bind(endpoint);
             // Переводим acceptor в состояние, в котором он способен принимать новые соединения
@@ -142,6 +217,7 @@ namespace http_server {
         net::io_context& ioc_;
         tcp::acceptor acceptor_;
         RequestLambda request_lambda_;
+        UpgradeLambda upgrade_lambda_;
 
         void DoAccept();
 
@@ -149,12 +225,12 @@ namespace http_server {
         void OnAccept(sys::error_code ec, tcp::socket socket);
 
         void AsyncRunSession(tcp::socket&& socket) {
-            std::make_shared<Session<RequestLambda>>(std::move(socket), request_lambda_)->Run();
+            std::make_shared<Session<RequestLambda, UpgradeLambda>>(std::move(socket), request_lambda_, upgrade_lambda_)->Run();
         }
     };
 
-    template <typename RequestLambda>
-    void Listener<RequestLambda>::DoAccept() {
+    template <typename RequestLambda, typename UpgradeLambda>
+    void Listener<RequestLambda, UpgradeLambda>::DoAccept() {
         acceptor_.async_accept(
             // Передаём последовательный исполнитель, в котором будут вызываться обработчики
             // асинхронных операций сокета
@@ -171,8 +247,8 @@ namespace http_server {
     }
 
     // Метод socket::async_accept создаст сокет и передаст его передан в OnAccept
-    template <typename RequestLambda>
-    void Listener<RequestLambda>::OnAccept(sys::error_code ec, tcp::socket socket) {
+    template <typename RequestLambda, typename UpgradeLambda>
+    void Listener<RequestLambda, UpgradeLambda>::OnAccept(sys::error_code ec, tcp::socket socket) {
 
         if (ec) {
             return logger_handler::LogError(ec, "accept"sv);
@@ -186,15 +262,33 @@ namespace http_server {
     }
 
     // Функция запуска сервера принимает два шаблонных параметра
-    // Лямбда обработки запроса и ссылфку на логгер
+    // Лямбда обработки запроса и лямбда, принимающая запрос на переход к WebSocket вместе с соединением
 
-    template <typename RequestLambda>
-    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestLambda&& lambda) {
+    template <typename RequestLambda, typename UpgradeLambda>
+    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestLambda&& lambda, UpgradeLambda&& upgrade_lambda) {
         // При помощи decay_t исключим ссылки из типа RequestHandler,
         // чтобы Listener хранил RequestHandler по значению
-        using MyListener = Listener<std::decay_t<RequestLambda>>;
+        using MyListener = Listener<std::decay_t<RequestLambda>, std::decay_t<UpgradeLambda>>;
 
-        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestLambda>(lambda))->Run();
+        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestLambda>(lambda),
+            std::forward<UpgradeLambda>(upgrade_lambda))->Run();
+    }
+
+    // Запускает сервер на каждом из переданных io_context, все акцепторы слушают один порт через SO_REUSEPORT
+    // Каждый io_context обслуживается своим потоком, поэтому приём и обработка соединений не делят одну очередь
+    // Без SO_REUSEPORT второй акцептор не займёт порт, поэтому соединения принимает один акцептор первого io_context
+    template <typename Contexts, typename RequestLambda, typename UpgradeLambda>
+    void ServeHttpReusePort(Contexts& contexts, const tcp::endpoint& endpoint, const RequestLambda& lambda,
+        const UpgradeLambda& upgrade_lambda) {
+        using MyListener = Listener<std::decay_t<RequestLambda>, std::decay_t<UpgradeLambda>>;
+
+#ifdef __linux__
+        for (auto& ioc : contexts) {
+            std::make_shared<MyListener>(*ioc, endpoint, lambda, upgrade_lambda, true)->Run();
+        }
+#else
+        std::make_shared<MyListener>(*contexts.front(), endpoint, lambda, upgrade_lambda)->Run();
+#endif
     }
 
 }  // namespace http_server
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <bit>
+#include <limits>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+
+namespace util {
+
+    /**
+     * Распределитель свободных идентификаторов в диапазоне [0, size).
+     * Занятость хранится битовой маской по 64 идентификатора в слове, первый свободный
+     * идентификатор в слове ищется через std::countr_one. Распределитель помнит слово,
+     * раньше которого свободных идентификаторов нет, поэтому выдача идёт за O(1) в среднем,
+     * а полностью занятый распределитель отвечает сразу по счётчику занятых.
+     *
+     * Пример:
+     *
+     *  util::IdAllocator ids(200);
+     *  auto id = ids.Acquire();   // 0
+     *  ids.Take(5);               // занять конкретный id, например при восстановлении
+     *  ids.Release(*id);          // 0 снова свободен
+     */
+    class IdAllocator {
+    public:
+        IdAllocator() = default;
+        explicit IdAllocator(size_t size)
+            : size_(size)
+            , words_((size + __WORD_BITS__ - 1) / __WORD_BITS__, 0) {
+        }
+
+        // возвращает и занимает наименьший свободный идентификатор, или nullopt, если свободных нет
+        std::optional<size_t> Acquire() {
+            if (taken_ == size_) {
+                return std::nullopt;
+            }
+
+            for (size_t word = first_free_word_; word != words_.size(); ++word) {
+                if (words_[word] != __FULL_WORD__) {
+                    size_t id = word * __WORD_BITS__ + static_cast<size_t>(std::countr_one(words_[word]));
+                    if (id >= size_) {
+                        break;
+                    }
+                    first_free_word_ = word;
+                    SetBit(id);
+                    return id;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        // занимает указанный идентификатор, возвращает false, если он уже был занят
+        bool Take(size_t id) {
+            CheckRange(id, "Take");
+            if (IsTaken(id)) {
+                return false;
+            }
+            SetBit(id);
+            return true;
+        }
+
+        // освобождает идентификатор, возвращает false, если он не был занят
+        bool Release(size_t id) {
+            CheckRange(id, "Release");
+            if (!IsTaken(id)) {
+                return false;
+            }
+            words_[id / __WORD_BITS__] &= ~(uint64_t{ 1 } << (id % __WORD_BITS__));
+            first_free_word_ = std::min(first_free_word_, id / __WORD_BITS__);
+            --taken_;
+            return true;
+        }
+
+        // освобождает все идентификаторы
+        void ReleaseAll() {
+            std::fill(words_.begin(), words_.end(), 0);
+            first_free_word_ = 0;
+            taken_ = 0;
+        }
+
+        // сообщает занят ли идентификатор
+        bool IsTaken(size_t id) const {
+            return id < size_ && (words_[id / __WORD_BITS__] >> (id % __WORD_BITS__)) & 1u;
+        }
+        // сообщает есть ли свободный идентификатор
+        bool HasFree() const {
+            return taken_ < size_;
+        }
+        // возвращает количество занятых идентификаторов
+        size_t TakenCount() const {
+            return taken_;
+        }
+        // возвращает размер диапазона идентификаторов
+        size_t Size() const {
+            return size_;
+        }
+
+    private:
+        static constexpr size_t __WORD_BITS__ = std::numeric_limits<uint64_t>::digits;
+        static constexpr uint64_t __FULL_WORD__ = std::numeric_limits<uint64_t>::max();
+
+        size_t size_ = 0;                        // размер диапазона идентификаторов
+        size_t taken_ = 0;                       // количество занятых идентификаторов
+        size_t first_free_word_ = 0;             // раньше этого слова свободных идентификаторов нет
+        std::vector<uint64_t> words_;            // битовая маска занятости
+
+        void SetBit(size_t id) {
+            words_[id / __WORD_BITS__] |= uint64_t{ 1 } << (id % __WORD_BITS__);
+            ++taken_;
+        }
+
+        void CheckRange(size_t id, const char* method) const {
+            if (id >= size_) {
+                throw std::out_of_range(std::string("util::IdAllocator::") + method + "::Error::Id is out of range");
+            }
+        }
+    };
+
+}  // namespace util
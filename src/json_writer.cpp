@@ -0,0 +1,173 @@
+#include "json_writer.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace json_detail {
+
+	JsonWriter& JsonWriter::Key(std::string_view key) {
+		Separate();
+		AppendEscaped(buffer_, key);
+		buffer_.push_back(':');
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::Key(uint64_t key) {
+		Separate();
+		char digits[24];
+		auto result = std::to_chars(digits, digits + sizeof(digits), key);
+		buffer_.push_back('"');
+		buffer_.append(digits, result.ptr);
+		buffer_.append("\":", 2);
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::String(std::string_view value) {
+		Separate();
+		AppendEscaped(buffer_, value);
+		need_comma_ = true;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::Int(int64_t value) {
+		Separate();
+		char digits[24];
+		auto result = std::to_chars(digits, digits + sizeof(digits), value);
+		buffer_.append(digits, result.ptr);
+		need_comma_ = true;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::Uint(uint64_t value) {
+		Separate();
+		char digits[24];
+		auto result = std::to_chars(digits, digits + sizeof(digits), value);
+		buffer_.append(digits, result.ptr);
+		need_comma_ = true;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::Double(double value) {
+		Separate();
+		AppendDouble(buffer_, value);
+		need_comma_ = true;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::Bool(bool value) {
+		Separate();
+		value ? buffer_.append("true", 4) : buffer_.append("false", 5);
+		need_comma_ = true;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::Null() {
+		Separate();
+		buffer_.append("null", 4);
+		need_comma_ = true;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::Value(const json::value& value) {
+		switch (value.kind())
+		{
+		case json::kind::null:
+			return Null();
+		case json::kind::bool_:
+			return Bool(value.get_bool());
+		case json::kind::int64:
+			return Int(value.get_int64());
+		case json::kind::uint64:
+			return Uint(value.get_uint64());
+		case json::kind::double_:
+			return Double(value.get_double());
+		case json::kind::string:
+			return String(value.get_string());
+		case json::kind::array:
+			StartArray();
+			for (const auto& item : value.get_array()) {
+				Value(item);
+			}
+			return EndArray();
+		case json::kind::object:
+			StartObject();
+			for (const auto& item : value.get_object()) {
+				Key(item.key());
+				Value(item.value());
+			}
+			return EndObject();
+		}
+		return *this;
+	}
+
+	void JsonWriter::AppendEscaped(std::string& buffer, std::string_view value) {
+		static constexpr char __HEX_DIGITS__[] = "0123456789abcdef";
+
+		buffer.push_back('"');
+		// участки без спецсимволов копируются целиком
+		size_t plain_start = 0;
+		for (size_t i = 0; i != value.size(); ++i) {
+			unsigned char c = static_cast<unsigned char>(value[i]);
+			if (c >= 0x20 && c != '"' && c != '\\') {
+				continue;
+			}
+
+			buffer.append(value.data() + plain_start, i - plain_start);
+			plain_start = i + 1;
+
+			switch (c)
+			{
+			case '"': buffer.append("\\\"", 2); break;
+			case '\\': buffer.append("\\\\", 2); break;
+			case '\b': buffer.append("\\b", 2); break;
+			case '\f': buffer.append("\\f", 2); break;
+			case '\n': buffer.append("\\n", 2); break;
+			case '\r': buffer.append("\\r", 2); break;
+			case '\t': buffer.append("\\t", 2); break;
+			default:
+				buffer.append("\\u00", 4);
+				buffer.push_back(__HEX_DIGITS__[c >> 4]);
+				buffer.push_back(__HEX_DIGITS__[c & 15]);
+				break;
+			}
+		}
+		buffer.append(value.data() + plain_start, value.size() - plain_start);
+		buffer.push_back('"');
+	}
+
+	void JsonWriter::AppendDouble(std::string& buffer, double value) {
+		// boost::json пишет числа через ryu d2s: кратчайшая мантисса, E без плюса и ведущих нулей в порядке
+		if (std::isnan(value)) {
+			buffer.append("NaN", 3);
+			return;
+		}
+		if (std::isinf(value)) {
+			value < 0 ? buffer.append("-Infinity", 9) : buffer.append("Infinity", 8);
+			return;
+		}
+		if (value == 0) {
+			std::signbit(value) ? buffer.append("-0E0", 4) : buffer.append("0E0", 3);
+			return;
+		}
+
+		// кратчайшее представление std::to_chars совпадает с ryu, отличается только запись порядка: 2.5e-01
+		char digits[32];
+		auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::scientific);
+		std::string_view text(digits, result.ptr - digits);
+		size_t exponent_pos = text.find('e');
+
+		buffer.append(text.data(), exponent_pos);
+		buffer.push_back('E');
+
+		std::string_view exponent = text.substr(exponent_pos + 1);
+		if (exponent.front() == '-') {
+			buffer.push_back('-');
+		}
+		exponent.remove_prefix(1);
+		while (exponent.size() > 1 && exponent.front() == '0') {
+			exponent.remove_prefix(1);
+		}
+		buffer.append(exponent.data(), exponent.size());
+	}
+
+} // namespace json_detail
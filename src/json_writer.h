@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <boost/json.hpp>
+
+namespace json_detail {
+
+	namespace json = boost::json;
+
+	/*
+	* Потоковая запись JSON прямо в строковый буфер, без построения json::object и json::array.
+	* Результат совпадает с json::serialize байт в байт: без пробелов, числа с плавающей точкой
+	* в кратчайшем виде ryu (4E0, 2.5E-1), строки экранируются так же, как в boost::json.
+	* Запятые расставляются сами: ключ или значение после значения или закрытой скобки получает запятую.
+	* Буфер не очищается, запись идёт в конец, поэтому один буфер можно переиспользовать между ответами.
+	*
+	* Пример:
+	*
+	*  std::string buffer;
+	*  JsonWriter writer(buffer);
+	*  writer.StartObject().Key("pos").StartArray().Double(1.0).Double(2.5).EndArray().EndObject();
+	*  // buffer == R"({"pos":[1E0,2.5E0]})"
+	*/
+	class JsonWriter {
+	public:
+		explicit JsonWriter(std::string& buffer)
+			: buffer_(buffer) {
+		}
+
+		JsonWriter& StartObject() {
+			Separate();
+			buffer_.push_back('{');
+			return *this;
+		}
+		JsonWriter& EndObject() {
+			buffer_.push_back('}');
+			need_comma_ = true;
+			return *this;
+		}
+		JsonWriter& StartArray() {
+			Separate();
+			buffer_.push_back('[');
+			return *this;
+		}
+		JsonWriter& EndArray() {
+			buffer_.push_back(']');
+			need_comma_ = true;
+			return *this;
+		}
+
+		// записывает ключ словаря, следом должно идти значение
+		JsonWriter& Key(std::string_view key);
+		// записывает числовой ключ словаря, как id игроков и лута
+		JsonWriter& Key(uint64_t key);
+
+		JsonWriter& String(std::string_view value);
+		JsonWriter& Int(int64_t value);
+		JsonWriter& Uint(uint64_t value);
+		JsonWriter& Double(double value);
+		JsonWriter& Bool(bool value);
+		JsonWriter& Null();
+		// записывает готовое значение boost::json, например сырые данные из конфигурации
+		JsonWriter& Value(const json::value& value);
+
+		// записывает строку в кавычках с экранированием, как json::serialize
+		static void AppendEscaped(std::string& buffer, std::string_view value);
+		// записывает число с плавающей точкой в кратчайшем виде, как json::serialize
+		static void AppendDouble(std::string& buffer, double value);
+
+	private:
+		std::string& buffer_;
+		bool need_comma_ = false;           // предыдущий элемент закончен, перед следующим нужна запятая
+
+		void Separate() {
+			if (need_comma_) {
+				buffer_.push_back(',');
+				need_comma_ = false;
+			}
+		}
+	};
+
+} // namespace json_detail
@@ -1,5 +1,7 @@
 ﻿#include "logger_handler.h"
 
+#include <algorithm>
+
 namespace logger_handler {
 
     void LogShutdown() {
@@ -32,7 +34,7 @@ namespace logger_handler {
         detail::BoostLogConsoleOutput(
             json::value{
                 {"ip"s, std::string(remote_address)},
-                {"URI"s, req.target()},
+                {"URI"s, detail::RedactTarget(req.target())},
                 {"method"s, req.method_string()}
             }, "request received"s);
     }
@@ -58,6 +60,28 @@ namespace logger_handler {
 
     namespace detail {
 
+        // заменяет значение параметра token= в строке запроса, токен канала WebSocket не должен попадать в лог
+        std::string RedactTarget(std::string_view target) {
+            static constexpr std::string_view __PARAM_TOKEN__ = "token="sv;
+
+            std::string result(target);
+            size_t query = result.find('?');
+            if (query == std::string::npos) {
+                return result;
+            }
+
+            for (size_t pos = query + 1; pos < result.size(); ) {
+                size_t end = std::min(result.find('&', pos), result.size());
+                if (std::string_view(result).substr(pos, end - pos).starts_with(__PARAM_TOKEN__)) {
+                    size_t value = pos + __PARAM_TOKEN__.size();
+                    result.replace(value, end - value, "***"sv);
+                    end = value + 3;
+                }
+                pos = end + 1;
+            }
+            return result;
+        }
+
         void BaseFormatter(logging::record_view const& rec, logging::formatting_ostream& strm) {
 
             // згружаем их в общий жидомасон ответа
@@ -48,6 +48,9 @@ namespace logger_handler {
 
     namespace detail {
 
+        // заменяет значение параметра token= в строке запроса на ***
+        std::string RedactTarget(std::string_view target);
+
         void BaseFormatter(logging::record_view const& rec, logging::formatting_ostream& strm);
         void BoostLogBaseSetup(std::ostream& out);
         void BoostLogConsoleOutput(const json::value& data, const std::string& message);
@@ -7,10 +7,19 @@
 #include <thread>
 #include <cassert>
 #include <cstdlib>
+#include <memory>
+#include <vector>
+#include <random>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <csignal>
+#endif
 
 #include "logger_handler.h"                          // базовый инклюд обеспечивающий доступ к логгеру в данном участке кода
 #include "request_handler.h"                         // базовый инклюд открывающий доступ к серверу, обработчику ресурсов
 #include "options.h"                                 // функционал запуска приложения
+#include "rng.h"                                     // генераторы случайных чисел игровой модели
 
 using namespace std::literals;
 namespace net = boost::asio;
@@ -32,6 +41,33 @@ namespace {
         fn();
     }
 
+    // Закрепляет текущий поток за ядром процессора с переданным номером
+    void PinCurrentThread([[maybe_unused]] unsigned core) {
+#ifdef __linux__
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(core % std::max(1u, std::thread::hardware_concurrency()), &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+#endif
+    }
+
+    // Запускает каждый io_context в своём потоке, закреплённом за отдельным ядром
+    // нулевой io_context обслуживается текущим потоком
+    void RunPinnedWorkers(std::vector<std::unique_ptr<net::io_context>>& contexts) {
+        std::vector<std::jthread> workers;
+        workers.reserve(contexts.size() - 1);
+
+        for (unsigned i = 1; i < contexts.size(); ++i) {
+            workers.emplace_back([&ioc = *contexts[i], i] {
+                PinCurrentThread(i);
+                ioc.run();
+                });
+        }
+
+        PinCurrentThread(0);
+        contexts[0]->run();
+    }
+
 }  // namespace
 
 int main(int argc, const char* argv[]) {
@@ -39,6 +75,11 @@ int main(int argc, const char* argv[]) {
     setlocale(LC_ALL, "Russian");
     setlocale(LC_NUMERIC, "English");
 
+#ifdef __linux__
+    // sendfile в закрытое клиентом соединение должен вернуть EPIPE, а не завершить процесс сигналом
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
     try
     {
         // 1. Инициализируем буст-логгер, для базовой инициализации можно подать любой консольный поток
@@ -52,38 +93,85 @@ int main(int argc, const char* argv[]) {
             return EXIT_SUCCESS;
         }
 
+        // журнал воспроизведения имеет смысл только при известном зерне, если оно не задано - выбираем сами
+        if (command_line.game_record && !command_line.fixed_random_seed) {
+            command_line.random_seed = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+            command_line.fixed_random_seed = true;
+        }
+
+        // засеваем генераторы случайных чисел до создания игровой модели и рабочих потоков
+        if (command_line.fixed_random_seed) {
+            model::Rng::SetGlobalSeed(command_line.random_seed);
+        }
+
         // 3. Инициализируем io_context
-        const unsigned num_threads = std::thread::hardware_concurrency();
-        net::io_context ioc(num_threads);
+        // в обычном режиме все потоки делят один io_context,
+        // в режиме SO_REUSEPORT на каждый поток создаётся свой однопоточный io_context
+        const unsigned num_threads = std::max(1u, command_line.server_threads);
+        const bool reuse_port_mode = command_line.reuse_port_mode;
+        const bool game_autosave = command_line.game_autosave;
+
+        std::vector<std::unique_ptr<net::io_context>> contexts;
+        if (reuse_port_mode) {
+            contexts.reserve(num_threads);
+            for (unsigned i = 0; i != num_threads; ++i) {
+                contexts.push_back(std::make_unique<net::io_context>(1));
+            }
+        }
+        else {
+            contexts.push_back(std::make_unique<net::io_context>(num_threads));
+        }
+        // основной io_context, в нём работают обработчик api, таймеры и обработчик сигналов
+        net::io_context& ioc = *contexts.front();
 
         // 4. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
+        signals.async_wait([&contexts](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
             if (!ec) {
-                ioc.stop();
+                for (auto& context : contexts) {
+                    context->stop();
+                }
                 logger_handler::LogShutdown();
             }
             });
 
-        // 5. Создаём обработчик HTTP-запросов в шаре, конструктор обработчика сконфигурирует 
-        // модель игры, статические данные, контекст для api, таймер автообновления по полученным настройкам
-        auto request_handler = std::make_shared<http_handler::RequestHandler>(std::move(command_line), ioc);
+        // 5. Запоминаем адрес сервера, дальше аргументы запуска уходят в обработчик
+        const auto address = net::ip::make_address(command_line.bind_address);
+        const net::ip::port_type port = command_line.server_port;
 
-        // 6. Запускаем веб-сервер делегируя поступающие запросы их обработчику
-        const auto address = net::ip::make_address("0.0.0.0");
-        constexpr net::ip::port_type port = 8080;
+        // 6. Создаём обработчик HTTP-запросов в шаре, конструктор обработчика сконфигурирует 
+        // модель игры, статические данные, контекст для api, таймер автообновления по полученным настройкам
+        // стренды игровых сессий распределяются по всем io_context
+        std::vector<game_handler::SessionExecutor> session_executors;
+        for (auto& context : contexts) {
+            session_executors.push_back(context->get_executor());
+        }
+        auto request_handler = std::make_shared<http_handler::RequestHandler>(
+            std::move(command_line), ioc, std::move(session_executors));
 
-        http_server::ServeHttp(ioc, { address, port }, [request_handler](auto&& req, auto&& send) {
+        auto request_lambda = [request_handler](auto&& req, auto&& send) {
             (*request_handler)(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
-            });
-
-        // 7. Запускаем обработку асинхронных операций
-        RunWorkers(std::max(1u, num_threads), [&ioc] {
-            ioc.run();
-            });
+            };
+        // запросы на переход к WebSocket забирают соединение у HTTP-сессии
+        auto upgrade_lambda = [request_handler](auto&& req, auto&& stream) {
+            request_handler->HandleUpgrade(std::forward<decltype(req)>(req), std::forward<decltype(stream)>(stream));
+            };
+
+        // 7. Запускаем веб-сервер делегируя поступающие запросы их обработчику 
+        // и запускаем обработку асинхронных операций
+        if (reuse_port_mode) {
+            http_server::ServeHttpReusePort(contexts, { address, port }, request_lambda, upgrade_lambda);
+            RunPinnedWorkers(contexts);
+        }
+        else {
+            http_server::ServeHttp(ioc, { address, port }, request_lambda, upgrade_lambda);
+            RunWorkers(num_threads, [&ioc] {
+                ioc.run();
+                });
+        }
 
         // 8. Выполняем базовую сериализацию после завершения работы сервера, если поднят флаг сохранения
-        if (command_line.game_autosave) {
+        if (game_autosave) {
             request_handler->SerializeGameData();
         }
 
@@ -1,41 +1,29 @@
 ﻿#include "model.h"
+#include "rng.h"
 
 #include <stdexcept>
 #include <algorithm>
 #include <optional>
-#include <random>
+#include <cmath>
 
 namespace model {
 
     using namespace std::literals;
 
     int GetRandomInteger(int from, int to) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(from, to);
-        return dis(gen);
+        return Rng::Local().NextInteger(from, to);
     }
 
     double GetRandomDouble() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(0.0, 1.0);
-        return dis(gen);
+        return Rng::Local().NextDouble();
     }
 
     double GetRandomDouble(double from, double to) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(from, to);
-        return dis(gen);
+        return Rng::Local().NextDouble(from, to);
     }
 
     double GetRandomDoubleRoundOne(double from, double to) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(from, to);
-
-        double result = dis(gen);
+        double result = Rng::Local().NextDouble(from, to);
 
         if (result >= 0) {
             return std::floor(result * 10) / 10;
@@ -101,6 +89,7 @@ namespace model {
     // добавляет одну дорогу на карту
     Map& Map::AddRoad(const Road& road) {
         roads_.emplace_back(road);
+        IndexRoad(roads_.size() - 1);
         return *this;
     }
 
@@ -139,6 +128,14 @@ namespace model {
     // устанавливает подготовленный массив дорог на карту
     Map& Map::SetRoads(Roads&& roads) {
         roads_ = std::move(roads);
+
+        // перестраиваем индексы линий в порядке следования дорог
+        horizontal_lines_.clear();
+        vertical_lines_.clear();
+        for (size_t i = 0; i != roads_.size(); ++i) {
+            IndexRoad(i);
+        }
+
         return *this;
     }
 
@@ -197,24 +194,11 @@ namespace model {
             throw std::runtime_error("Map::get_road_by_position::Error::No_Roads_on_Map");
         }
 
-        for (const Road& road : roads_) {
-            // бежим по списку дорог, если вертикальная координата игрока переданной позиции совпадает
-            // с вертикальной координатой начала и конца дороги, значит дорога горизонтальна и мы стоим на ней
-            if (road.GetStart().y == pos.y && road.GetEnd().y == pos.y) {
-                // проверяем совпадение по горизонтальной координате, так как может быть например две и более горизонтальных дорог
-                // находящихся на одной и той же вертикальной координате, например {0,0; 10,0} и {20,0; 30,0}, а pos {22,0}
-                // значит мы должны выбрать другую дорогу, первая в списке {0,0; 10,0} нам не подходит
- 
-                if (std::min(road.GetStart().x, road.GetEnd().x) <= pos.x
-                    && pos.x <= std::max(road.GetStart().x, road.GetEnd().x)) {
-                    // так как координаты дороги могут быть как (start->end) {0,0 -> 10,0}, так и {10,0 -> 0,0}
-                    // то во избежание проблем используем std::min / std::max, координата pos.x должна быть между ними включительно
-                    return &road;
-                }
-            }
-        }
-
-        return nullptr;
+        // берем линию горизонтальных дорог с координатой pos.y и ищем на ней отрезок, покрывающий pos.x
+        // так как на одной линии может быть несколько дорог, например {0,0; 10,0} и {20,0; 30,0}, а pos {22,0}
+        // то отрезки линии упорядочены и ищутся бинарным поиском
+        const RoadSpan* span = FindRoadSpan(horizontal_lines_, pos.y, pos.x);
+        return span ? &roads_[span->road] : nullptr;
     }
 
     // метод возвращает указатель на вертикальную дорогу по переданной позиции
@@ -226,24 +210,9 @@ namespace model {
             throw std::runtime_error("Map::get_road_by_position::Error::No_Roads_on_Map");
         }
 
-        for (const Road& road : roads_) {
-            // бежим по списку дорог, если горизонтальной координата игрока переданной позиции совпадает
-            // с горизонтальной координатой начала и конца дороги, значит дорога вертикальная и мы стоим на ней
-            if (road.GetStart().x == pos.x && road.GetEnd().x == pos.x) {
-                // проверяем совпадение по вертикальной координате, так как может быть например две и более вертикальных дорог
-                // находящихся на одной и той же горизонтальной координате, например {0,0; 0,10} и {0,20; 0,30}, а pos {0,22}
-                // значит мы должны выбрать другую дорогу, первая в списке {0,0; 0,10} нам не подходит
-
-                if (std::min(road.GetStart().y, road.GetEnd().y) <= pos.y
-                    && pos.y <= std::max(road.GetStart().y, road.GetEnd().y)) {
-                    // так как координаты дороги могут быть как (start->end) {0,0 -> 0,10}, так и {0,10 -> 0,0}
-                    // то во избежание проблем используем std::min / std::max, координата pos.y должна быть между ними включительно
-                    return &road;
-                }
-            }
-        }
-
-        return nullptr;
+        // берем линию вертикальных дорог с координатой pos.x и ищем на ней отрезок, покрывающий pos.y
+        const RoadSpan* span = FindRoadSpan(vertical_lines_, pos.x, pos.y);
+        return span ? &roads_[span->road] : nullptr;
     }
 
     // возвращает случайную дорого на карте
@@ -262,6 +231,73 @@ namespace model {
         }
     }
 
+    // добавляет дорогу с указанным индексом в индексы линий
+    void Map::IndexRoad(size_t index) {
+        const Road& road = roads_[index];
+
+        // дорога нулевой длины одновременно и горизонтальная и вертикальная
+        if (road.IsHorizontal()) {
+            // так как координаты дороги могут быть как (start->end) {0,0 -> 10,0}, так и {10,0 -> 0,0}
+            // то отрезок линии строится через std::min / std::max
+            AddRoadSpan(horizontal_lines_[road.GetStart().y],
+                std::min(road.GetStart().x, road.GetEnd().x), std::max(road.GetStart().x, road.GetEnd().x), index);
+        }
+        if (road.IsVertical()) {
+            AddRoadSpan(vertical_lines_[road.GetStart().x],
+                std::min(road.GetStart().y, road.GetEnd().y), std::max(road.GetStart().y, road.GetEnd().y), index);
+        }
+    }
+
+    // закрепляет за дорогой ещё не занятые точки отрезка [begin, end] линии
+    void Map::AddRoadSpan(std::vector<RoadSpan>& line, Coord begin, Coord end, size_t road) {
+
+        // дороги добавляются по порядку, поэтому уже занятые точки остаются за ранее добавленными дорогами
+        // и новая дорога получает только промежутки между имеющимися отрезками
+        std::vector<RoadSpan> gaps;
+        Coord next = begin;
+
+        auto it = std::lower_bound(line.begin(), line.end(), begin,
+            [](const RoadSpan& span, Coord value) {
+                return span.end < value;
+            });
+
+        for (; it != line.end() && it->begin <= end && next <= end; ++it) {
+            if (next < it->begin) {
+                gaps.push_back({ next, it->begin - 1, road });
+            }
+            next = std::max(next, it->end + 1);
+        }
+
+        if (next <= end) {
+            gaps.push_back({ next, end, road });
+        }
+
+        for (const auto& gap : gaps) {
+            line.insert(std::upper_bound(line.begin(), line.end(), gap,
+                [](const RoadSpan& lhs, const RoadSpan& rhs) {
+                    return lhs.begin < rhs.begin;
+                }), gap);
+        }
+    }
+
+    // ищет отрезок линии, покрывающий координату, или возвращает nullptr
+    const Map::RoadSpan* Map::FindRoadSpan(const RoadLines& lines, Coord line, Coord pos) {
+
+        auto line_it = lines.find(line);
+        if (line_it == lines.end()) {
+            return nullptr;
+        }
+
+        // первый отрезок, который заканчивается не раньше pos
+        const auto& spans = line_it->second;
+        auto it = std::lower_bound(spans.begin(), spans.end(), pos,
+            [](const RoadSpan& span, Coord value) {
+                return span.end < value;
+            });
+
+        return it != spans.end() && it->begin <= pos ? &*it : nullptr;
+    }
+
     // добавляет карту в игровую модель
     void Game::AddMap(Map map) {
         const size_t index = maps_.size();
@@ -34,6 +34,8 @@ namespace model {
         Dimension dx, dy;
     };
 
+    // случайные функции ниже работают через генератор текущего потока, см. rng.h
+
     // возвращает случайное целое число в диапазоне from -> to
     int GetRandomInteger(int from, int to);
     // возвращает случайное вещественное число в диапазоне 0.0 -> 1.0
@@ -334,15 +336,30 @@ namespace model {
         // метод возвращает указатель на горизонтальную дорогу по переданной позиции
         // если позиция каким-то образом некорректна, то вернется nullptr
         // требуется передача позиции в формате модели с округлением к int
+        // поиск идёт по индексу дорог за O(log k), где k - число отрезков на линии
         const Road* GetHorizontalRoad(Point pos) const;
         // метод возвращает указатель на вертикальную дорогу по переданной позиции
         // если позиция каким-то образом некорректна, то вернется nullptr
         // требуется передача позиции в формате модели с округлением к int
+        // поиск идёт по индексу дорог за O(log k), где k - число отрезков на линии
         const Road* GetVerticalRoad(Point pos) const;
 
     private:
         using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
 
+        // отрезок линии дорог [begin, end], закреплённый за дорогой с индексом road
+        struct RoadSpan {
+            Coord begin;
+            Coord end;
+            size_t road;
+        };
+        /*
+        * Индекс дорог по линиям: для горизонтальных дорог ключ - координата Y, для вертикальных - X.
+        * Отрезки линии не пересекаются и упорядочены по begin. Точка, покрытая несколькими дорогами,
+        * закреплена за первой из них в порядке добавления, как и при линейном поиске по массиву дорог.
+        */
+        using RoadLines = std::unordered_map<Coord, std::vector<RoadSpan>>;
+
         Id id_;                                                          // Id карты
         std::string name_;                                               // Название карты
         Roads roads_;                                                    // Массив с дорогами на карте
@@ -355,8 +372,17 @@ namespace model {
         Offices offices_;                                                // Массив офисов
         LootTypes loot_types_;                                           // Массив типов лута
 
+        RoadLines horizontal_lines_;                                     // Индекс горизонтальных дорог по Y
+        RoadLines vertical_lines_;                                       // Индекс вертикальных дорог по X
+
         // возвращает случайную дорого на карте
         const Road& GetRandomRoad() const;
+        // добавляет дорогу с указанным индексом в индексы линий
+        void IndexRoad(size_t index);
+        // закрепляет за дорогой ещё не занятые точки отрезка [begin, end] линии
+        static void AddRoadSpan(std::vector<RoadSpan>& line, Coord begin, Coord end, size_t road);
+        // ищет отрезок линии, покрывающий координату, или возвращает nullptr
+        static const RoadSpan* FindRoadSpan(const RoadLines& lines, Coord line, Coord pos);
     };
 
 
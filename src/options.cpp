@@ -3,6 +3,7 @@
 #include <boost/program_options.hpp>
 
 #include <vector>
+#include <algorithm>
 #include <thread>
 #include <cstdlib>
 #include <fstream>
@@ -24,10 +25,17 @@ namespace detail {
             ("tick-period,t", po::value(&arguments_.game_timer_period)->value_name("milliseconds"), "set tick period")
             ("config-file,c", po::value(&arguments_.config_json_path)->value_name("file"), "set config file path")
             ("www-root,w", po::value(&arguments_.static_content_path)->value_name("dir"), "set static files root")
+            ("static-cache-size", po::value(&arguments_.static_cache_size)->value_name("megabytes"), "preload static files up to the budget into memory with gzip variants")
             ("state-file,s", po::value(&arguments_.state_file_path)->value_name("state"), "set serialize file path")
             ("save-state-period,p", po::value(&arguments_.save_state_period)->value_name("milliseconds"), "set serialize period")
             ("randomize-spawn-points", "spawn dogs at random positions")
-            ("db-url,d", po::value(&arguments_.data_base_url)->value_name("dir"), "set SQL data base url ");
+            ("db-url,d", po::value(&arguments_.data_base_url)->value_name("dir"), "set SQL data base url ")
+            ("threads,n", po::value(&arguments_.server_threads)->value_name("count"), "set server worker threads count")
+            ("bind-address,a", po::value(&arguments_.bind_address)->value_name("address"), "set server bind address")
+            ("port,P", po::value(&arguments_.server_port)->value_name("port"), "set server port")
+            ("reuse-port", "run one io_context and SO_REUSEPORT acceptor per thread (Linux)")
+            ("random-seed", po::value(&arguments_.random_seed)->value_name("seed"), "seed game model random generators deterministically")
+            ("record-file", po::value(&arguments_.record_file_path)->value_name("file"), "record joins, moves and ticks for game_replay, starting from an empty game");
 
         po::variables_map variables_map_;
         po::store(po::parse_command_line(argc, argv, description_), variables_map_);
@@ -58,6 +66,11 @@ namespace detail {
         // назначаем количество доступных соединений к базе по числу ядер процессора
         arguments_.db_connection_count = std::thread::hardware_concurrency();
 
+        // если количество потоков не задано или задано нулём, то работаем по числу ядер процессора
+        if (arguments_.server_threads == 0) {
+            arguments_.server_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
         // прочие необязательные флаги
 
         if (variables_map_.contains("randomize-spawn-points"s)) {
@@ -65,6 +78,21 @@ namespace detail {
             arguments_.randomize_spawn_points = true;
         }
 
+        if (variables_map_.contains("reuse-port"s)) {
+            // поднимаем флаг режима нескольких акцепторов на одном порту
+            arguments_.reuse_port_mode = true;
+        }
+
+        if (variables_map_.contains("random-seed"s)) {
+            // поднимаем флаг детерминированного засева генераторов
+            arguments_.fixed_random_seed = true;
+        }
+
+        if (variables_map_.contains("record-file"s)) {
+            // активируем запись журнала воспроизведения
+            arguments_.game_record = true;
+        }
+
         if (variables_map_.contains("state-file"s)) {
             // активируем автосохранение сервера
             arguments_.game_autosave = true;
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <string>
+#include <cstdint>
 
 namespace detail {
 
@@ -8,6 +9,7 @@ namespace detail {
         bool show_help_list = false;                      // флаг показа листа с помощью
         std::string config_json_path;                     // путь к конфигурационному файлу config.json
         std::string static_content_path;                  // путь к статическим файлам web-сервера
+        uint64_t static_cache_size = 0;                   // бюджет кеша статических файлов в памяти, МБ (0 - кеш выключен)
         bool game_timer_launch = false;                   // флаг установки автотаймера системы управления игрой
         std::string game_timer_period;                    // период обновления автотаймера игрового состояния
         bool game_autosave = false;                       // флаг включения автосохранения
@@ -16,6 +18,14 @@ namespace detail {
         bool randomize_spawn_points = false;              // флаг случайного размещения новых персонажей
         std::string data_base_url;                        // URL строка подключения к базе данных PostgreSQL
         unsigned db_connection_count;                     // количество соединений с базой данных
+        unsigned server_threads = 0;                      // количество рабочих потоков сервера (0 - по числу ядер)
+        std::string bind_address = "0.0.0.0";             // адрес, на котором сервер принимает соединения
+        unsigned short server_port = 8080;                // порт, на котором сервер принимает соединения
+        bool reuse_port_mode = false;                     // флаг режима SO_REUSEPORT: свой io_context и acceptor на каждый поток
+        bool fixed_random_seed = false;                   // флаг детерминированного засева генераторов случайных чисел
+        uint64_t random_seed = 0;                         // зерно генераторов случайных чисел игровой модели
+        bool game_record = false;                         // флаг записи журнала воспроизведения
+        std::string record_file_path;                     // путь к файлу журнала воспроизведения
     };
 
     [[nodiscard]] Arguments ParseCommandLine(int argc, const char* const argv[]);
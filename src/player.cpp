@@ -1,6 +1,7 @@
 ﻿#include "player.h"
 
 #include <algorithm>
+#include <utility>
 
 namespace game_handler {
 
@@ -47,6 +48,176 @@ namespace game_handler {
         return *this;
     }
 
+    // ----------- хранилище состояния игроков ---------------------------------
+
+    // добавляет слот игроку с указанными ключом и вместимостью сумки, возвращает индекс слота
+    size_t PlayersColumns::AddSlot(Player* owner, const Token* token, unsigned bag_capacity) {
+        ReserveBag(bag_capacity);
+
+        owners_.push_back(owner);
+        tokens_.push_back(token);
+        current_positions_.push_back({ 0.0, 0.0 });
+        future_positions_.push_back({ 0.0, 0.0 });
+        speeds_.push_back({ 0, 0 });
+        directions_.push_back(PlayerDirection::NORTH);
+        total_times_ms_.push_back(0);
+        retirement_times_ms_.push_back(0);
+        bag_sizes_.push_back(0);
+        bag_slots_.resize(Size() * bag_stride_);
+
+        return Size() - 1;
+    }
+
+    // удаляет слот, на его место переносится последний слот хранилища
+    void PlayersColumns::RemoveSlot(size_t slot) {
+
+        if (slot >= Size()) {
+            throw std::out_of_range("game_handler::PlayersColumns::RemoveSlot::Error::Slot is out of range");
+        }
+
+        size_t last = Size() - 1;
+        if (slot != last) {
+            // переносим последний слот на место удаляемого и сообщаем владельцу новый индекс
+            owners_[slot] = owners_[last];
+            tokens_[slot] = tokens_[last];
+            current_positions_[slot] = current_positions_[last];
+            future_positions_[slot] = future_positions_[last];
+            speeds_[slot] = speeds_[last];
+            directions_[slot] = directions_[last];
+            total_times_ms_[slot] = total_times_ms_[last];
+            retirement_times_ms_[slot] = retirement_times_ms_[last];
+            bag_sizes_[slot] = bag_sizes_[last];
+            std::copy_n(GetBagSlots(last), bag_stride_, GetBagSlots(slot));
+
+            owners_[slot]->slot_ = slot;
+        }
+
+        owners_.pop_back();
+        tokens_.pop_back();
+        current_positions_.pop_back();
+        future_positions_.pop_back();
+        speeds_.pop_back();
+        directions_.pop_back();
+        total_times_ms_.pop_back();
+        retirement_times_ms_.pop_back();
+        bag_sizes_.pop_back();
+        bag_slots_.resize(Size() * bag_stride_);
+    }
+
+    // копирует состояние слота из другого хранилища
+    void PlayersColumns::CopySlot(size_t slot, const PlayersColumns& other, size_t other_slot) {
+
+        if (other.bag_sizes_[other_slot] > bag_stride_) {
+            throw std::out_of_range("game_handler::PlayersColumns::CopySlot::Error::Bag size is out of range");
+        }
+
+        current_positions_[slot] = other.current_positions_[other_slot];
+        future_positions_[slot] = other.future_positions_[other_slot];
+        speeds_[slot] = other.speeds_[other_slot];
+        directions_[slot] = other.directions_[other_slot];
+        total_times_ms_[slot] = other.total_times_ms_[other_slot];
+        retirement_times_ms_[slot] = other.retirement_times_ms_[other_slot];
+        bag_sizes_[slot] = other.bag_sizes_[other_slot];
+        std::copy_n(other.GetBagSlots(other_slot), other.bag_sizes_[other_slot], GetBagSlots(slot));
+    }
+
+    // увеличивает количество ячеек сумки на слот, если запрошенная вместимость больше текущей
+    void PlayersColumns::ReserveBag(unsigned bag_capacity) {
+
+        if (bag_capacity <= bag_stride_) {
+            return;
+        }
+
+        // раскладываем занятые ячейки всех слотов по новому шагу
+        std::vector<BagItem> bag_slots(Size() * bag_capacity);
+        for (size_t slot = 0; slot != Size(); ++slot) {
+            std::copy_n(GetBagSlots(slot), bag_sizes_[slot], bag_slots.data() + slot * bag_capacity);
+        }
+
+        bag_slots_ = std::move(bag_slots);
+        bag_stride_ = bag_capacity;
+    }
+
+    // ----------- игрок ------------------------------------------------------
+
+    Player::Player(size_t id, std::string_view name, const Token* token, unsigned capacity)
+        : id_(id), name_(name), token_(token), bag_capacity_(capacity)
+        , own_columns_(std::make_unique<PlayersColumns>()) {
+        columns_ = own_columns_.get();
+        slot_ = columns_->AddSlot(this, token, capacity);
+    }
+
+    // создаёт игрока сразу в слоте общего хранилища, key - ключ игрока в игровой сессии
+    Player::Player(PlayersColumns& columns, const Token* key, size_t id, std::string_view name, const Token* token, unsigned capacity)
+        : id_(id), name_(name), token_(token), bag_capacity_(capacity), columns_(&columns) {
+        slot_ = columns_->AddSlot(this, key, capacity);
+    }
+
+    Player::Player(Player&& other) noexcept
+        : id_(other.id_), name_(std::move(other.name_)), token_(other.token_)
+        , bag_capacity_(other.bag_capacity_), score_(other.score_)
+        , columns_(std::exchange(other.columns_, nullptr)), slot_(other.slot_)
+        , own_columns_(std::move(other.own_columns_)) {
+        if (columns_) {
+            // слот теперь принадлежит новому объекту
+            columns_->owners_[slot_] = this;
+        }
+    }
+
+    Player& Player::operator=(Player&& other) noexcept {
+        if (this != &other) {
+            Detach();
+
+            id_ = other.id_;
+            name_ = std::move(other.name_);
+            token_ = other.token_;
+            bag_capacity_ = other.bag_capacity_;
+            score_ = other.score_;
+            columns_ = std::exchange(other.columns_, nullptr);
+            slot_ = other.slot_;
+            own_columns_ = std::move(other.own_columns_);
+
+            if (columns_) {
+                // слот теперь принадлежит новому объекту
+                columns_->owners_[slot_] = this;
+            }
+        }
+        return *this;
+    }
+
+    Player::~Player() {
+        Detach();
+    }
+
+    // переносит состояние игрока в новый слот общего хранилища, key - ключ игрока в игровой сессии
+    Player& Player::AttachTo(PlayersColumns& columns, const Token* key) {
+
+        if (columns_ == &columns) {
+            columns.tokens_[slot_] = key;
+            return *this;
+        }
+
+        size_t slot = columns.AddSlot(this, key, bag_capacity_);
+        columns.CopySlot(slot, *columns_, slot_);
+
+        Detach();
+        columns_ = &columns;
+        slot_ = slot;
+
+        return *this;
+    }
+
+    // освобождает слот игрока в хранилище
+    void Player::Detach() {
+        if (own_columns_) {
+            own_columns_.reset();
+        }
+        else if (columns_) {
+            columns_->RemoveSlot(slot_);
+        }
+        columns_ = nullptr;
+    }
+
     // назначает id игрока
     Player& Player::SetId(size_t id) {
         id_ = id;
@@ -68,6 +239,7 @@ namespace game_handler {
     // назначает вместимость сумки игрока
     Player& Player::SetBagCapacity(unsigned capacity) {
         bag_capacity_ = capacity;
+        columns_->ReserveBag(capacity);
         return *this;
     }
 
@@ -86,17 +258,20 @@ namespace game_handler {
     */
     bool Player::AddLoot(size_t index, GameLootPtr loot) {
 
-        if (bag_.size() == bag_capacity_) {
+        size_t bag_size = GetBagSize();
+
+        if (bag_size == bag_capacity_) {
             // если сумка заполнена ничего не делаем
             return false; 
         }
-        else if (bag_.size() > bag_capacity_) {
+        else if (bag_size > bag_capacity_) {
             // если сумка даже переполнена, чего быть не должнно, сигнализируем о ошибке
             throw std::out_of_range("game_handler::Player::AddGameLoot::Error::Bag size is out of range");
         }
         
-        loot->SetPlayerPrt(this);           // назначаем текущего игрока "владельцем" вещи
-        bag_.push_back({ index, loot });      // добавляем вещь в рюкзак
+        loot->SetPlayerPrt(this);                                       // назначаем текущего игрока "владельцем" вещи
+        columns_->GetBagSlots(slot_)[bag_size] = { index, loot };       // добавляем вещь в рюкзак
+        ++columns_->bag_sizes_[slot_];
 
         return true;
     }
@@ -109,12 +284,15 @@ namespace game_handler {
             throw std::out_of_range("game_handler::Player::RemoveLoot::Error::index is out of bag capacity range");
         }
 
-        else if (index >= bag_.size()) {
+        else if (index >= GetBagSize()) {
             // если индекс больше или равен текущей заполненности рюкзака, то кидаем исключение
             throw std::out_of_range("game_handler::Player::RemoveLoot::Error::index is out of current bag size range");
         }
 
-        bag_.erase(bag_.begin() + index);
+        // сдвигаем следующие за удаляемой ячейки на её место
+        BagItem* bag = columns_->GetBagSlots(slot_);
+        std::move(bag + index + 1, bag + GetBagSize(), bag + index);
+        --columns_->bag_sizes_[slot_];
         return true;
     }
     // Сдаёт предмет из сумки по индексу в векторе в бюро находок, при этом прибавляются очки
@@ -125,15 +303,15 @@ namespace game_handler {
             throw std::out_of_range("game_handler::Player::RemoveLoot::Error::index is out of bag capacity range");
         }
 
-        else if (index >= bag_.size()) {
+        else if (index >= GetBagSize()) {
             // если индекс больше или равен текущей заполненности рюкзака, то кидаем исключение
             throw std::out_of_range("game_handler::Player::RemoveLoot::Error::index is out of current bag size range");
         }
 
         // если индекс не указывает на nullptr
-        if (!bag_[index].IsDummy()) {
+        if (!GetBag()[index].IsDummy()) {
             
-            BagItem result = bag_[index];                // изымаем указатель обратно
+            BagItem result = GetBag()[index];            // изымаем указатель обратно
             score_ += result.loot_->GetRawValue();       // прибавляем очки к счету игрока
             // удалять будем всё скопом потом
             //RemoveLoot(index);                           // затираем данные о элементе
@@ -145,7 +323,7 @@ namespace game_handler {
 
     // Очищает все записи в рюкзаке и обнуляет его
     Player& Player::ClearBag() {
-        bag_.clear();
+        columns_->bag_sizes_[slot_] = 0;
         return *this;
     }
     /*
@@ -161,7 +339,7 @@ namespace game_handler {
 
         unsigned result = 0;
 
-        for (const auto& item : bag_) {
+        for (const auto& item : GetBag()) {
             // записываем сумму всех предметов в рюкзаке, если элемент не указывает на nullptr
             if (!item.IsDummy()) {
                 result += item.loot_->GetRawValue();
@@ -175,29 +353,31 @@ namespace game_handler {
 
     // назначает текущую позицию игрока
     Player& Player::SetCurrentPosition(PlayerPosition&& position) {
-        current_position_ = std::move(position);
+        columns_->current_positions_[slot_] = std::move(position);
         return *this;
     }
     // назначает текущую позицию игрока
     Player& Player::SetCurrentPosition(double x, double y) {
-        current_position_.x_ = x; current_position_.y_ = y;
+        columns_->current_positions_[slot_] = { x, y };
         return *this;
     }
     // назначает будущую позицию игрока
     Player& Player::SetFuturePosition(PlayerPosition&& position) {
-        future_position_ = std::move(position);
+        columns_->future_positions_[slot_] = std::move(position);
         return *this;
     }
     // назначает будущую позицию игрока
     Player& Player::SetFuturePosition(double x, double y) {
-        future_position_.x_ = x; future_position_.y_ = y;
+        columns_->future_positions_[slot_] = { x, y };
         return *this;
     }
     // назначает текущую позицию из будущей позиции
     // применяется обработчиком игровой сессии после работы детектора коллизий
     Player& Player::UpdateCurrentPosition() {
-        if (current_position_ != future_position_) {
-            current_position_ = future_position_;
+        PlayerPosition& current_position = columns_->current_positions_[slot_];
+        const PlayerPosition& future_position = columns_->future_positions_[slot_];
+        if (current_position != future_position) {
+            current_position = future_position;
         }
         return *this;
     }
@@ -211,61 +391,65 @@ namespace game_handler {
     // рассчитывает и назначает будущую позицию согласно текущей позиции, скорости и переданного времени
     Player& Player::UpdateFuturePosition(double time) {
 
-        future_position_.x_ = (speed_.xV_ != 0) ? 
-            current_position_.x_ + (speed_.xV_ * time) :
-            current_position_.x_;
+        const PlayerPosition& current_position = columns_->current_positions_[slot_];
+        const PlayerSpeed& speed = columns_->speeds_[slot_];
+        PlayerPosition& future_position = columns_->future_positions_[slot_];
+
+        future_position.x_ = (speed.xV_ != 0) ? 
+            current_position.x_ + (speed.xV_ * time) :
+            current_position.x_;
 
-        future_position_.y_ = (speed_.yV_ != 0) ?
-            current_position_.y_ + (speed_.yV_ * time) :
-            current_position_.y_;
+        future_position.y_ = (speed.yV_ != 0) ?
+            current_position.y_ + (speed.yV_ * time) :
+            current_position.y_;
 
         return *this;
     }
     // назачает скорость движения игрока
     Player& Player::SetSpeed(PlayerSpeed&& speed) {
-        speed_ = std::move(speed);
+        columns_->speeds_[slot_] = std::move(speed);
         return *this;
     }
     // назачает скорость движения игрока
     Player& Player::SetSpeed(double xV, double yV) {
-        speed_.xV_ = xV; speed_.yV_ = yV;
+        columns_->speeds_[slot_] = { xV, yV };
         return *this;
     }
     // назначает направление игрока
     Player& Player::SetDirection(PlayerDirection&& direction) {
-        direction_ = std::move(direction);
+        columns_->directions_[slot_] = std::move(direction);
         return *this;
     }
 
     // назначает общее игровое время в миллисекундах, используется при сериализации
     Player& Player::SetTotalInGameTimeMS(int time_ms) {
-        total_time_ms_ = time_ms;
+        columns_->total_times_ms_[slot_] = time_ms;
         return *this;
     }
 
     // добавляет общее игровое время в миллисекундах
     Player& Player::AddTotalInGameTimeMS(int time_ms) {
-        total_time_ms_ += time_ms;
+        columns_->total_times_ms_[slot_] += time_ms;
         return *this;
     }
 
     // назначает время простоя в миллисекундах, используется при сериализации
     Player& Player::SetRetirementTimeMS(int time_ms) {
-        retirement_time_ms_ = time_ms;
+        columns_->retirement_times_ms_[slot_] = time_ms;
         return *this;
     }
 
     // добавляет время простоя в игре в миллисекундах
     // также увеличивает общее время в игре на указанную величину
     Player& Player::AddRetirementTimeMS(int time_ms) {
-        retirement_time_ms_ += time_ms;
-        total_time_ms_ += time_ms;
+        columns_->retirement_times_ms_[slot_] += time_ms;
+        columns_->total_times_ms_[slot_] += time_ms;
         return *this;
     }
 
     // сбрасывает время простоя в игре в ноль
     Player& Player::ResetRetirementTime() {
-        retirement_time_ms_ = 0;
+        columns_->retirement_times_ms_[slot_] = 0;
         return *this;
     }
 
@@ -2,6 +2,8 @@
 #include "token.h"
 #include "model.h"
 
+#include <span>
+#include <memory>
 #include <vector>
 #include <stdexcept>
 #include <unordered_map>
@@ -116,26 +118,100 @@ namespace game_handler {
         GameLootPtr loot_ = nullptr;
     };
 
-    using PlayerBag = std::vector<BagItem>;
+    // рюкзак игрока - занятые ячейки сумки в хранилище состояния игроков
+    using PlayerBag = std::span<const BagItem>;
+
+    /*
+    * Плотное хранилище изменяемого в тике состояния игроков в виде структуры массивов.
+    * Каждому игроку выделяется слот - один и тот же индекс во всех массивах,
+    * сумка игрока занимает GetBagStride() подряд идущих ячеек в массиве ячеек.
+    * Циклы тика игровой сессии проходят массивы линейно, не обходя узлы хеш-таблицы.
+    * При удалении слота на его место переносится последний, владелец получает новый индекс.
+    */
+    class PlayersColumns {
+    public:
+        PlayersColumns() = default;
+
+        PlayersColumns(const PlayersColumns&) = delete;
+        PlayersColumns& operator=(const PlayersColumns&) = delete;
+
+        // добавляет слот игроку с указанными ключом и вместимостью сумки, возвращает индекс слота
+        size_t AddSlot(Player* owner, const Token* token, unsigned bag_capacity);
+        // удаляет слот, на его место переносится последний слот хранилища
+        void RemoveSlot(size_t slot);
+        // копирует состояние слота из другого хранилища
+        void CopySlot(size_t slot, const PlayersColumns& other, size_t other_slot);
+        // увеличивает количество ячеек сумки на слот, если запрошенная вместимость больше текущей
+        void ReserveBag(unsigned bag_capacity);
+
+        // возвращает количество занятых слотов
+        size_t Size() const {
+            return owners_.size();
+        }
+        // возвращает количество ячеек сумки, выделенных на один слот
+        unsigned GetBagStride() const {
+            return bag_stride_;
+        }
+        // возвращает указатель на первую ячейку сумки слота
+        BagItem* GetBagSlots(size_t slot) {
+            return bag_slots_.data() + slot * bag_stride_;
+        }
+        // возвращает указатель на первую ячейку сумки слота
+        const BagItem* GetBagSlots(size_t slot) const {
+            return bag_slots_.data() + slot * bag_stride_;
+        }
 
+        // ---------------------- массивы состояния, индекс - слот игрока ------------
+
+        std::vector<Player*> owners_;                           // игроки-владельцы слотов
+        std::vector<const Token*> tokens_;                      // ключи игроков в игровой сессии
+        std::vector<PlayerPosition> current_positions_;         // текущие позиции
+        std::vector<PlayerPosition> future_positions_;          // будущие позиции
+        std::vector<PlayerSpeed> speeds_;                       // скорости
+        std::vector<PlayerDirection> directions_;               // направления
+        std::vector<int> total_times_ms_;                       // время проведенное в игре
+        std::vector<int> retirement_times_ms_;                  // время простоя с момента остановки
+        std::vector<unsigned> bag_sizes_;                       // количество предметов в сумках
+
+    private:
+        unsigned bag_stride_ = 0;                               // ячеек сумки на один слот
+        std::vector<BagItem> bag_slots_;                        // ячейки сумок всех слотов подряд
+    };
+
+    /*
+    * Игрок хранит у себя редко изменяемые данные, а состояние - в слоте хранилища PlayersColumns.
+    * Созданный отдельно игрок владеет собственным хранилищем на один слот,
+    * игроки игровой сессии переносятся в общее хранилище сессии через AttachTo.
+    */
     class Player {
+        friend class PlayersColumns;
     public:
-        Player() = default;
+        Player()
+            : Player(65535, "dummy"sv) {
+        };
 
         Player(const Player&) = delete;
         Player& operator=(const Player&) = delete;
-        Player(Player&&) = default;
-        Player& operator=(Player&&) = default;
+        Player(Player&&) noexcept;
+        Player& operator=(Player&&) noexcept;
+        ~Player();
 
         Player(size_t id, std::string_view name)
-            : id_(id), name_(name) {
+            : Player(id, name, nullptr, 0) {
         };
         Player(size_t id, std::string_view name, const Token* token)
-            : id_(id), name_(name), token_(token) {
-        };
-        Player(size_t id, std::string_view name, const Token* token, unsigned capacity)
-            : id_(id), name_(name), token_(token), bag_capacity_(capacity) {
+            : Player(id, name, token, 0) {
         };
+        Player(size_t id, std::string_view name, const Token* token, unsigned capacity);
+        // создаёт игрока сразу в слоте общего хранилища, key - ключ игрока в игровой сессии
+        Player(PlayersColumns& columns, const Token* key, size_t id, std::string_view name, const Token* token, unsigned capacity);
+
+        // переносит состояние игрока в новый слот общего хранилища, key - ключ игрока в игровой сессии
+        Player& AttachTo(PlayersColumns& columns, const Token* key);
+        // возвращает индекс слота игрока в хранилище состояния
+        size_t GetSlot() const {
+            return slot_;
+        }
 
         // ----------- геттеры и сеттеры общих данных игрока ----------------------
 
@@ -168,7 +244,7 @@ namespace game_handler {
         }
         // возвращает количество предметов в рюкзаке
         size_t GetBagSize() const {
-            return bag_.size();
+            return columns_->bag_sizes_[slot_];
         }
         // возвращает текущую сумму очков игрока
         unsigned GetScore() const {
@@ -195,9 +271,9 @@ namespace game_handler {
         BagItem ReturnLoot(size_t index);
         // Очищает все записи в рюкзаке и обнуляет его
         Player& ClearBag();
-        // возвращает константную ссылку на рюкзак
-        const PlayerBag& GetBag() const {
-            return bag_;
+        // возвращает занятые ячейки рюкзака
+        PlayerBag GetBag() const {
+            return PlayerBag(columns_->GetBagSlots(slot_), GetBagSize());
         }
         /*
         * Возвращает, сдаёт все предметы из инвентаря в бюро
@@ -215,7 +291,7 @@ namespace game_handler {
         Player& SetCurrentPosition(double x, double y);
         // возвращает текущую позицию игрока
         PlayerPosition GetCurrentPosition() const {
-            return current_position_;
+            return columns_->current_positions_[slot_];
         }
 
         // назначает будущую позицию игрока
@@ -224,7 +300,7 @@ namespace game_handler {
         Player& SetFuturePosition(double x, double y);
         // возвращает будущую позицию игрока
         PlayerPosition GetFuturePosition() const {
-            return future_position_;
+            return columns_->future_positions_[slot_];
         }
 
         // назначает текущую позицию из будущей позиции
@@ -242,18 +318,18 @@ namespace game_handler {
         Player& SetSpeed(double xV, double yV);
         // возвращает текущую скорость игрока
         PlayerSpeed GetSpeed() const {
-            return speed_;
+            return columns_->speeds_[slot_];
         }
         // возвращает флаг что у чубаки нулевая скорость
         bool IsStay() const {
-            return speed_.xV_ == 0 && speed_.yV_ == 0;
+            return GetSpeed().xV_ == 0 && GetSpeed().yV_ == 0;
         }
 
         // назначает направление игрока
         Player& SetDirection(PlayerDirection&& direction);
         // возвращает текущее направление игрока
         PlayerDirection GetDirection() const {
-            return direction_;
+            return columns_->directions_[slot_];
         }
 
         // ----------- геттеры и сеттеры времени нахождения в игре ----------------
@@ -264,7 +340,7 @@ namespace game_handler {
         Player& AddTotalInGameTimeMS(int time_ms);
         // возвращает общее время проведенное в игре в миллисекундах
         int GetTotalInGameTimeMS() const {
-            return total_time_ms_;
+            return columns_->total_times_ms_[slot_];
         }
 
         // назначает время простоя в миллисекундах, используется при сериализации
@@ -276,7 +352,7 @@ namespace game_handler {
         Player& ResetRetirementTime();
         // возвращает время простоя в игре в миллисекундах
         int GetRetirementTimeMS() const {
-            return retirement_time_ms_;
+            return columns_->retirement_times_ms_[slot_];
         }
 
     private:
@@ -285,17 +361,15 @@ namespace game_handler {
         const Token* token_ = nullptr;                          // уникальный токен
         unsigned bag_capacity_ = 0;                             // вместимость рюкзака игрока
         unsigned score_ = 0;                                    // общая сумма набранных очков
-        PlayerBag bag_ = {};                                    // рюкзак игрока
-        
-        int total_time_ms_ = 0;                                 // время проведенное в игре
-        int retirement_time_ms_ = 0;                            // время простоя с момента остановки
 
         // ---------------------- блок атрибутов состояния персонажа -----------------
-        
-        PlayerSpeed speed_ = { 0, 0 };                          // скорость игрока
-        PlayerPosition current_position_ = { 0, 0 };            // текущая позиция игрока
-        PlayerPosition future_position_ = { 0, 0 };             // будущая позиция игрока
-        PlayerDirection direction_ = PlayerDirection::NORTH;    // направление игрока
+
+        PlayersColumns* columns_ = nullptr;                     // хранилище состояния игрока
+        size_t slot_ = 0;                                       // слот игрока в хранилище
+        std::unique_ptr<PlayersColumns> own_columns_;           // собственное хранилище отдельно созданного игрока
+
+        // освобождает слот игрока в хранилище
+        void Detach();
     };
 
     namespace detail {
@@ -64,6 +64,37 @@ namespace postgres {
 		}
 	}
 
+	// добавляет пачку рекордов в базу одной транзакцией
+	void DataBaseHandler::AddNewPlayerRecords(const std::vector<DBGameRecord>& records) {
+		if (records.empty()) {
+			return;
+		}
+
+		try
+		{
+			// берем свободное соединение
+			auto conn = pool_.GetConnection();
+			// открываем транзакцию
+			Transaction work(*conn);
+
+			for (const auto& record : records) {
+				// добавляем новый рекорд
+				work.GetTransaction().exec_prepared(__ADD_NEW_USER_RECORD__
+					, record.id_.ToString()
+					, record.name_
+					, static_cast<int>(record.score_)
+					, record.time_ms_);
+			}
+
+			// пересчитываем индексы один раз на всю пачку
+			work.GetTransaction().exec_prepared(__UPDATE_IDX_MULTI__);
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error("DataBaseHandler::AddNewPlayerRecords::ERROR::" + std::string(e.what()));
+		}
+	}
+
 	// возвращает топ рекордов с отступом от наивысшего вниз по списку
 	std::optional<std::vector<DBGameRecord>> DataBaseHandler::GetGameRecords(ReqParam param) {
 		return GetGameRecords(param.limit_.value_or(__RECORDS_LIMIT__), param.offset_.value_or(0));
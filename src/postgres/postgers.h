@@ -81,6 +81,8 @@ namespace postgres {
         void AddNewPlayerRecord(std::string_view name, unsigned score, int time_ms);
         // добавляет новый рекорд в базу
         void AddNewPlayerRecord(const std::string& name, unsigned score, int time_ms);
+        // добавляет пачку рекордов в базу одной транзакцией
+        void AddNewPlayerRecords(const std::vector<DBGameRecord>& records);
         // возвращает топ рекордов с отступом от наивысшего вниз по списку
         std::optional<std::vector<DBGameRecord>> GetGameRecords(ReqParam param);
         // возвращает топ рекордов с отступом от наивысшего вниз по списку
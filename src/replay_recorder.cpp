@@ -0,0 +1,220 @@
+#include "replay_recorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <optional>
+#include <tuple>
+
+namespace replay_handler {
+
+	namespace {
+
+		constexpr char __REPLAY_SIGNATURE__[4] = { 'G', 'S', 'R', 'P' };
+		constexpr uint8_t __REPLAY_VERSION__ = 1;
+		constexpr uint8_t __RANDOM_START_FLAG__ = 1;
+
+		// последовательное чтение журнала, nullopt означает конец данных
+		class ReplayReader {
+		public:
+			explicit ReplayReader(std::ifstream& in)
+				: in_(in) {
+			}
+
+			std::optional<uint8_t> ReadByte() {
+				char c;
+				if (!in_.get(c)) {
+					return std::nullopt;
+				}
+				return static_cast<uint8_t>(c);
+			}
+
+			std::optional<uint64_t> ReadVarint() {
+				uint64_t value = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					auto byte = ReadByte();
+					if (!byte) {
+						return std::nullopt;
+					}
+					value |= static_cast<uint64_t>(*byte & 0x7F) << shift;
+					if (!(*byte & 0x80)) {
+						return value;
+					}
+				}
+				throw std::runtime_error("replay_handler::LoadReplay::Error::Varint is too long");
+			}
+
+			std::optional<std::string> ReadString() {
+				auto size = ReadVarint();
+				if (!size) {
+					return std::nullopt;
+				}
+				std::string str(*size, '\0');
+				if (!in_.read(str.data(), static_cast<std::streamsize>(str.size()))) {
+					return std::nullopt;
+				}
+				return str;
+			}
+
+		private:
+			std::ifstream& in_;
+		};
+
+	} // namespace
+
+	ReplayRecorder::ReplayRecorder(const fs::path& path, const ReplayHeader& header)
+		: out_(path, std::ios::binary | std::ios::trunc) {
+
+		if (!out_) {
+			throw std::runtime_error("ReplayRecorder::ReplayRecorder::Error::Failed to open file {" + path.string() + "}");
+		}
+
+		out_.write(__REPLAY_SIGNATURE__, sizeof(__REPLAY_SIGNATURE__));
+		out_.put(static_cast<char>(__REPLAY_VERSION__));
+		out_.put(static_cast<char>(header.random_start_position_ ? __RANDOM_START_FLAG__ : 0));
+		for (int i = 0; i != 8; ++i) {
+			out_.put(static_cast<char>((header.seed_ >> (i * 8)) & 0xFF));
+		}
+		out_.flush();
+	}
+
+	// записывает обновление игровых сессий, буфер файла сбрасывается на каждом тике
+	void ReplayRecorder::RecordTick(uint64_t tick, int time_delta) {
+		std::lock_guard lock(mutex_);
+		out_.put(static_cast<char>(ReplayEventType::tick));
+		WriteVarint(tick);
+		WriteVarint(static_cast<uint64_t>(time_delta));
+		out_.flush();
+	}
+
+	// записывает вход игрока, токен запоминается для последующих действий
+	void ReplayRecorder::RecordJoin(const ReplayStamp& stamp, std::string_view token, std::string_view map_id, std::string_view name) {
+		std::lock_guard lock(mutex_);
+		players_.emplace(std::string(token), static_cast<uint32_t>(players_.size()));
+		out_.put(static_cast<char>(ReplayEventType::join));
+		WriteVarint(stamp.tick_);
+		WriteVarint(stamp.order_);
+		WriteString(map_id);
+		WriteString(name);
+	}
+
+	// записывает действие игрока, возвращает false если токен не был записан при входе
+	bool ReplayRecorder::RecordMove(uint64_t tick, std::string_view token, game_handler::PlayerMove move) {
+		std::lock_guard lock(mutex_);
+		auto player = players_.find(std::string(token));
+		if (player == players_.end()) {
+			return false;
+		}
+		out_.put(static_cast<char>(ReplayEventType::move));
+		WriteVarint(tick);
+		WriteVarint(player->second);
+		out_.put(static_cast<char>(move));
+		return true;
+	}
+
+	// сбрасывает буфер файла
+	void ReplayRecorder::Flush() {
+		std::lock_guard lock(mutex_);
+		out_.flush();
+	}
+
+	void ReplayRecorder::WriteVarint(uint64_t value) {
+		while (value >= 0x80) {
+			out_.put(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		out_.put(static_cast<char>(value));
+	}
+
+	void ReplayRecorder::WriteString(std::string_view str) {
+		WriteVarint(str.size());
+		out_.write(str.data(), static_cast<std::streamsize>(str.size()));
+	}
+
+	// читает журнал и упорядочивает события в порядке применения
+	ReplayLog LoadReplay(const fs::path& path) {
+
+		std::ifstream in(path, std::ios::binary);
+		if (!in) {
+			throw std::runtime_error("replay_handler::LoadReplay::Error::Failed to open file {" + path.string() + "}");
+		}
+
+		char signature[sizeof(__REPLAY_SIGNATURE__)];
+		if (!in.read(signature, sizeof(signature)) || !std::equal(std::begin(signature), std::end(signature), __REPLAY_SIGNATURE__)) {
+			throw std::runtime_error("replay_handler::LoadReplay::Error::File {" + path.string() + "} is not a replay");
+		}
+
+		ReplayReader reader(in);
+		ReplayLog log;
+
+		auto version = reader.ReadByte();
+		auto flags = reader.ReadByte();
+		if (!version || *version != __REPLAY_VERSION__ || !flags) {
+			throw std::runtime_error("replay_handler::LoadReplay::Error::Unsupported replay version");
+		}
+		log.header_.random_start_position_ = *flags & __RANDOM_START_FLAG__;
+		for (int i = 0; i != 8; ++i) {
+			auto byte = reader.ReadByte();
+			if (!byte) {
+				throw std::runtime_error("replay_handler::LoadReplay::Error::Replay header is truncated");
+			}
+			log.header_.seed_ |= static_cast<uint64_t>(*byte) << (i * 8);
+		}
+
+		uint32_t joins = 0;            // порядковый номер очередного вошедшего игрока
+		uint64_t moves = 0;            // порядковый номер очередного действия
+
+		while (auto type = reader.ReadByte()) {
+			ReplayEvent event;
+			event.type_ = static_cast<ReplayEventType>(*type);
+
+			auto tick = reader.ReadVarint();
+			if (!tick) {
+				break;
+			}
+			event.tick_ = *tick;
+
+			if (event.type_ == ReplayEventType::tick) {
+				auto delta = reader.ReadVarint();
+				if (!delta) {
+					break;
+				}
+				event.time_delta_ = static_cast<int>(*delta);
+			}
+			else if (event.type_ == ReplayEventType::join) {
+				auto order = reader.ReadVarint();
+				auto map_id = order ? reader.ReadString() : std::nullopt;
+				auto name = map_id ? reader.ReadString() : std::nullopt;
+				if (!name) {
+					break;
+				}
+				event.order_ = *order;
+				event.player_ = joins++;
+				event.map_id_ = std::move(*map_id);
+				event.name_ = std::move(*name);
+			}
+			else if (event.type_ == ReplayEventType::move) {
+				auto player = reader.ReadVarint();
+				auto move = player ? reader.ReadByte() : std::nullopt;
+				if (!move) {
+					break;
+				}
+				event.order_ = moves++;
+				event.player_ = static_cast<uint32_t>(*player);
+				event.move_ = static_cast<game_handler::PlayerMove>(*move);
+			}
+			else {
+				throw std::runtime_error("replay_handler::LoadReplay::Error::Unknown event type {" + std::to_string(*type) + "}");
+			}
+
+			log.events_.push_back(std::move(event));
+		}
+
+		// тик N раньше событий, применённых после него, затем входы по порядку резервирования, затем действия
+		std::stable_sort(log.events_.begin(), log.events_.end(), [](const ReplayEvent& lhs, const ReplayEvent& rhs) {
+			return std::tie(lhs.tick_, lhs.type_, lhs.order_) < std::tie(rhs.tick_, rhs.type_, rhs.order_);
+		});
+
+		return log;
+	}
+
+} // namespace replay_handler
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "player.h"                    // PlayerMove
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+
+namespace replay_handler {
+
+	namespace fs = std::filesystem;
+
+	/*
+	* Журнал входных событий игрового сервера для детерминированного воспроизведения.
+	* Файл начинается с заголовка (сигнатура "GSRP", версия, флаги запуска, зерно генераторов),
+	* далее идут события: тип, номер тика, данные. Числа записываются в LEB128, строки - длиной и байтами.
+	*
+	* События привязаны к номеру тика, после которого они были применены в сессии:
+	* тик с номером N применяется раньше всех событий с номером N, события между тиками
+	* упорядочиваются сначала входы по порядку резервирования мест, затем действия по порядку записи.
+	* Такой порядок сохраняется при любом количестве рабочих потоков сервера.
+	*/
+
+	// тип события журнала
+	enum class ReplayEventType : uint8_t {
+		tick = 1,                       // обновление игровых сессий
+		join = 2,                       // вход игрока в игру
+		move = 3                        // действие игрока
+	};
+
+	// заголовок журнала
+	struct ReplayHeader {
+		uint64_t seed_ = 0;                              // зерно генераторов случайных чисел
+		bool random_start_position_ = false;             // флаг случайной позиции игроков на старте
+	};
+
+	// отметка входа игрока: номер тика и порядковый номер резервирования места
+	struct ReplayStamp {
+		uint64_t tick_ = 0;
+		uint64_t order_ = 0;
+	};
+
+	// событие журнала
+	struct ReplayEvent {
+		ReplayEventType type_ = ReplayEventType::tick;
+		uint64_t tick_ = 0;                              // номер тика, после которого применено событие
+		uint64_t order_ = 0;                             // порядок применения событий внутри тика
+		int time_delta_ = 0;                             // tick: время обновления в миллисекундах
+		uint32_t player_ = 0;                            // join, move: порядковый номер вошедшего игрока
+		game_handler::PlayerMove move_ = game_handler::PlayerMove::STAY;  // move: направление
+		std::string map_id_;                             // join: идентификатор карты
+		std::string name_;                               // join: имя игрока
+	};
+
+	// прочитанный журнал с событиями в порядке применения
+	struct ReplayLog {
+		ReplayHeader header_;
+		std::vector<ReplayEvent> events_;
+	};
+
+	// потокобезопасная запись журнала, события приходят из стрендов игровых сессий
+	class ReplayRecorder {
+	public:
+		ReplayRecorder(const fs::path& path, const ReplayHeader& header);
+
+		ReplayRecorder(const ReplayRecorder&) = delete;
+		ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+		// записывает обновление игровых сессий, буфер файла сбрасывается на каждом тике
+		void RecordTick(uint64_t tick, int time_delta);
+		// записывает вход игрока, токен запоминается для последующих действий
+		void RecordJoin(const ReplayStamp& stamp, std::string_view token, std::string_view map_id, std::string_view name);
+		// записывает действие игрока, возвращает false если токен не был записан при входе
+		bool RecordMove(uint64_t tick, std::string_view token, game_handler::PlayerMove move);
+		// сбрасывает буфер файла
+		void Flush();
+
+	private:
+		std::mutex mutex_;
+		std::ofstream out_;
+		std::unordered_map<std::string, uint32_t> players_;    // токены вошедших игроков и их порядковые номера
+
+		void WriteVarint(uint64_t value);
+		void WriteString(std::string_view str);
+	};
+
+	// читает журнал и упорядочивает события в порядке применения,
+	// оборванное в конце файла событие отбрасывается
+	ReplayLog LoadReplay(const fs::path& path);
+
+} // namespace replay_handler
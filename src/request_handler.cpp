@@ -1,22 +1,23 @@
 ﻿#include "request_handler.h"
 #include "boost_json.h"
 
+#include <charconv>
+
 namespace http_handler {
 
-    // простые запросы без доп парсинга
+    // пути запросов к api перечислены в таблицах request_router.h
 
-    static const std::string __REST_API_MAPS__ = "/v1/maps";
-    static const std::string __REST_API_JOIN__ = "/v1/game/join";
-    static const std::string __REST_API_PLAYERS__ = "/v1/game/players";
-    static const std::string __REST_API_TICK__ = "/v1/game/tick";
-    static const std::string __REST_API_STATE__ = "/v1/game/state";
-    static const std::string __REST_API_PLAYER_ACTION__ = "/v1/game/player/action";
-    static const std::string __REST_API_RECORDS__ = "/v1/game/records";
+    // принимает запрос на переход к WebSocket вместе с соединением
+    void RequestHandler::HandleUpgrade(StringRequest&& req, beast::tcp_stream&& stream) {
 
-    // запросы с дополнительной информацией
+        // токен может прийти параметром, маршрутизатор сравнивает путь без строки запроса
+        if (RouteMatch route = MatchRoute(req.target()); route.route != Route::channel) {
+            return websocket_handler::RejectUpgrade(std::move(req), std::move(stream), http::status::not_found,
+                "badRequest"sv, "Invalid endpoint"sv);
+        }
 
-    static const std::string __REST_API_FIND_MAP__ = "/v1/maps/";
-    static const std::string __REST_API_RECORDS_PARAMS__ = "/v1/game/records?";
+        websocket_handler::RunGameChannel(std::move(req), std::move(stream), game_);
+    }
 
     // включает выполнение автотаймера, выкидывает исклоючение, если таймер уже включен
     RequestHandler& RequestHandler::StartGameTimer() {
@@ -83,6 +84,12 @@ namespace http_handler {
         return *this;
     }
 
+    // выполняет запись данных игрового сервера во время работы, снимок сессий делается в их стрендах
+    RequestHandler& RequestHandler::AsyncSerializeGameData() {
+        serializer_->AsyncSerializeGameData();
+        return *this;
+    }
+
     // метод настройки игрового таймера, генерирует команды для обработки
     RequestHandler& RequestHandler::TimerConfigurationPipeline() {
 
@@ -107,7 +114,7 @@ namespace http_handler {
             if (arguments_.game_autosave && !arguments_.save_state_period.empty()) {
                 // конфигурируем метод сериализации игровых состояний
                 auto serialization = std::make_shared<time::OnTimeCommand<void*>>(
-                    [this](void*) { this->SerializeGameData(); }, (void*) nullptr
+                    [this](void*) { this->AsyncSerializeGameData(); }, (void*) nullptr
                 );
                 // загружаем метод сериализации игровых состояний
                 timer_->AddCommand(arguments_.save_state_period, std::move(serialization));
@@ -129,7 +136,7 @@ namespace http_handler {
             postgres::detail::ConnectionConfig db_config{ arguments_.data_base_url, arguments_.db_connection_count };
 
             // загружаем настройки игровой модели
-            game_ = std::make_shared<game::GameHandler>(arguments_.config_json_path, std::move(db_config));
+            game_ = std::make_shared<game::GameHandler>(arguments_.config_json_path, std::move(db_config), session_executors_);
 
             // задаём игровой обработчик в сериализатор
             serializer_ = std::make_shared<game::SerialHandler>(game_);
@@ -143,8 +150,18 @@ namespace http_handler {
             // устанавливаем флаг рандомной позиции игроков на старте
             game_->SetRandomStartPosition(arguments_.randomize_spawn_points);
 
+            // если задан файл журнала, то записываем в него входы игроков, их действия и тики
+            if (arguments_.game_record) {
+                game_->SetReplayRecorder(std::make_shared<replay_handler::ReplayRecorder>(arguments_.record_file_path,
+                    replay_handler::ReplayHeader{ arguments_.random_seed, arguments_.randomize_spawn_points }));
+            }
+
             // загружаем статические данные в менеджер файлов
             resource_ = std::make_shared<res::ResourceHandler>(arguments_.static_content_path);
+            // при заданном бюджете часто запрашиваемые файлы отдаются из памяти вместе со сжатыми вариантами
+            if (arguments_.static_cache_size != 0) {
+                resource_->PreloadFiles(arguments_.static_cache_size * 1024 * 1024);
+            }
 
             return TimerConfigurationPipeline();
         }
@@ -155,114 +172,263 @@ namespace http_handler {
     }
 
     // возвращает запрошенный документ
-    Response RequestHandler::StaticFileBodyResponse(StringRequest&& req, const resource_handler::ResourcePtr resource) {
-        FileResponse response(http::status::ok, req.version());
+    Response RequestHandler::StaticFileBodyResponse(StringRequest&& req, const resource_handler::ResourcePtr resource, bool immutable) {
+        // файл из кеша отдаётся из памяти без обращения к диску
+        if (resource->_content) {
+            return StaticCachedResponse(std::move(req), resource, immutable);
+        }
 
-        // в огромном свиче выбираем тип контента
-        switch (resource->_type)
-        {
-        case resource_handler::ResourceType::html:
-        case resource_handler::ResourceType::htm:
-            response.set(http::field::content_type, ContentType::TEXT_HTML);
-            break;
-
-        case resource_handler::ResourceType::txt:
-        case resource_handler::ResourceType::folder:
-            response.set(http::field::content_type, ContentType::TEXT_TXT);
-            break;
-
-        case resource_handler::ResourceType::css:
-            response.set(http::field::content_type, ContentType::TEXT_CSS);
-            break;
-
-        case resource_handler::ResourceType::js:
-            response.set(http::field::content_type, ContentType::TEXT_JS);
-            break;
-
-        case resource_handler::ResourceType::json:
-            response.set(http::field::content_type, ContentType::APP_JSON);
-            break;
-
-        case resource_handler::ResourceType::xml:
-            response.set(http::field::content_type, ContentType::APP_XML);
-            break;
-
-        case resource_handler::ResourceType::png:
-            response.set(http::field::content_type, ContentType::IMAGE_PNG);
-            break;
-
-        case resource_handler::ResourceType::jpg:
-        case resource_handler::ResourceType::jpe:
-        case resource_handler::ResourceType::jpeg:
-            response.set(http::field::content_type, ContentType::IMAGE_JPEG);
-            break;
-
-        case resource_handler::ResourceType::gif:
-            response.set(http::field::content_type, ContentType::IMAGE_GIF);
-            break;
-
-        case resource_handler::ResourceType::bmp:
-            response.set(http::field::content_type, ContentType::IMAGE_BMP);
-            break;
-
-        case resource_handler::ResourceType::ico:
-            response.set(http::field::content_type, ContentType::IMAGE_ICO);
-            break;
-
-        case resource_handler::ResourceType::tif:
-        case resource_handler::ResourceType::tiff:
-            response.set(http::field::content_type, ContentType::IMAGE_TIFF);
-            break;
-
-        case resource_handler::ResourceType::svg:
-        case resource_handler::ResourceType::svgz:
-            response.set(http::field::content_type, ContentType::IMAGE_SVG);
-            break;
-
-        case resource_handler::ResourceType::mp3:
-            response.set(http::field::content_type, ContentType::AUDIO_MPEG);
-            break;
-
-        case resource_handler::ResourceType::unknow:
-            response.set(http::field::content_type, ContentType::APP_UNKNOW);
-            break;
+        // файл открывается до сборки ответа, путь в индексе уже завершён нулём
+        SendFileBody::value_type file;
+        if (sys::error_code ec; file.Open(resource->_path.c_str(), ec), ec) {
+            std::cerr << "Failed to open file "sv << resource->_path << std::endl;
+            return StaticNotFoundResponse(std::move(req));
+        }
 
-        default:
-            break;
+        // участки файла из запроса Range тоже передаются через sendfile, при любом размере файла
+        if (auto ranges = StaticRequestedRanges(req, resource, file.FileSize())) {
+            if (ranges->status == ByteRanges::Status::unsatisfiable) {
+                return StaticRangeNotSatisfiableResponse(std::move(req), file.FileSize());
+            }
+
+            SendFileResponse response(http::status::partial_content, req.version());
+            StaticPartialHeaders(response.base(), file.Ranges(), *ranges, resource, file.FileSize(), immutable);
+
+            response.body() = std::move(file);
+            response.prepare_payload();
+
+            return response;
+        }
+
+        // большие файлы сессия передаёт через sendfile без копирования в буферы процесса
+        if (file.FileSize() >= __SENDFILE_MIN_SIZE__) {
+            SendFileResponse response(http::status::ok, req.version());
+            response.set(http::field::content_type, StaticContentType(resource->_type));
+            StaticCacheHeaders(response.base(), resource, immutable, false);
+
+            response.body() = std::move(file);
+            response.prepare_payload();
+
+            return response;
         }
 
-        // открываем файл
-        http::file_body::value_type file;
-        if (sys::error_code ec; file.open(resource->_path.data(), beast::file_mode::read, ec), ec) {
+        // маленькие файлы читаются в буфер file_body, открытый файл передаётся без повторного открытия
+        http::file_body::value_type body;
+        if (sys::error_code ec; body.reset(std::move(file.File()), ec), ec) {
             std::cerr << "Failed to open file "sv << resource->_path << std::endl;
-            assert(false);
+            return StaticNotFoundResponse(std::move(req));
         }
 
-        response.body() = std::move(file);
+        FileResponse response(http::status::ok, req.version());
+        response.set(http::field::content_type, StaticContentType(resource->_type));
+        StaticCacheHeaders(response.base(), resource, immutable, false);
+
+        response.body() = std::move(body);
         response.prepare_payload();
 
         return response;
     }
 
-    // возвращает index.html основной страницы
-    Response RequestHandler::StaticRootIndexResponse(StringRequest&& req) {
-        FileResponse response(http::status::ok, req.version());
-        response.set(http::field::content_type, ContentType::TEXT_HTML);
+    // возвращает документ из кеша в памяти, сжатый вариант выбирается по Accept-Encoding
+    Response RequestHandler::StaticCachedResponse(StringRequest&& req, const resource_handler::ResourcePtr resource, bool immutable) {
+        // участки отдаются из несжатого варианта, буфер кеша не копируется
+        if (auto ranges = StaticRequestedRanges(req, resource, resource->_content->size())) {
+            if (ranges->status == ByteRanges::Status::unsatisfiable) {
+                return StaticRangeNotSatisfiableResponse(std::move(req), resource->_content->size());
+            }
 
-        std::string path_line = std::string(resource_->GetRootPath()) + "index.html";
+            SharedRangeResponse response(http::status::partial_content, req.version());
+            response.body().content = resource->_content;
+            StaticPartialHeaders(response.base(), response.body().ranges, *ranges, resource, resource->_content->size(), immutable);
+            response.prepare_payload();
 
-        http::file_body::value_type file;
-        if (sys::error_code ec; file.open(path_line.data(), beast::file_mode::read, ec), ec) {
-            std::cerr << "Failed to open file "sv << path_line << std::endl;
-            assert(false);
+            return response;
         }
 
-        response.body() = std::move(file);
+        SharedResponse response(http::status::ok, req.version());
+        response.set(http::field::content_type, StaticContentType(resource->_type));
+
+        bool gzip = resource->_gzip_content && AcceptsGzip(req);
+        StaticCacheHeaders(response.base(), resource, immutable, gzip);
+        if (gzip) {
+            response.set(http::field::content_encoding, "gzip");
+        }
+
+        response.body() = gzip ? resource->_gzip_content : resource->_content;
         response.prepare_payload();
 
         return response;
     }
 
+    // возвращает ответ 304, если у клиента актуальная версия файла, иначе std::nullopt
+    std::optional<Response> RequestHandler::StaticNotModifiedResponse(const StringRequest& req,
+        const resource_handler::ResourcePtr resource, bool immutable) {
+
+        // If-None-Match главнее If-Modified-Since, второй проверяется, только если первого нет
+        // теги обоих вариантов подходят: клиенту всё равно, в каком виде он получил те же байты файла
+        if (auto if_none_match = req.find(http::field::if_none_match); if_none_match != req.end()) {
+            if (!game::detail::IfNoneMatch(if_none_match->value(), resource->_etag)
+                && (resource->_gzip_etag.empty() || !game::detail::IfNoneMatch(if_none_match->value(), resource->_gzip_etag))) {
+                return std::nullopt;
+            }
+        }
+        else if (auto if_modified_since = req.find(http::field::if_modified_since); if_modified_since != req.end()) {
+            // клиент возвращает дату из Last-Modified без изменений, поэтому даты сравниваются как строки
+            if (if_modified_since->value() != resource->_last_modified) {
+                return std::nullopt;
+            }
+        }
+        else {
+            return std::nullopt;
+        }
+
+        // ответ 304 идёт без тела, но с теми же валидаторами, что и полный ответ
+        StringResponse response(http::status::not_modified, req.version());
+        response.set(http::field::content_type, StaticContentType(resource->_type));
+        StaticCacheHeaders(response.base(), resource, immutable, resource->_gzip_content && AcceptsGzip(req));
+
+        return Response(std::move(response));
+    }
+
+    // добавляет в ответ валидаторы файла и политику кеширования, immutable - для адреса с отпечатком содержимого
+    void RequestHandler::StaticCacheHeaders(http::response_header<>& header, const resource_handler::ResourcePtr resource,
+        bool immutable, bool gzip) {
+
+        header.set(http::field::etag, gzip ? resource->_gzip_etag : resource->_etag);
+        header.set(http::field::last_modified, resource->_last_modified);
+        // содержимое по адресу с отпечатком не меняется, по обычному адресу клиент каждый раз сверяет валидаторы
+        header.set(http::field::cache_control, immutable ? "public, max-age=31536000, immutable" : "no-cache");
+        // клиент может докачивать файл и загружать его частями параллельно
+        header.set(http::field::accept_ranges, "bytes");
+        if (resource->_gzip_content) {
+            // ответ зависит от Accept-Encoding, промежуточные кеши должны это учитывать
+            header.set(http::field::vary, "Accept-Encoding");
+        }
+    }
+
+    // возвращает участки файла из заголовка Range, либо std::nullopt, если отдаётся весь файл
+    std::optional<ByteRanges> RequestHandler::StaticRequestedRanges(const StringRequest& req,
+        const resource_handler::ResourcePtr resource, uint64_t size) {
+
+        auto range = req.find(http::field::range);
+        if (range == req.end()) {
+            return std::nullopt;
+        }
+
+        // If-Range: участки отдаются, только если у клиента та же версия файла, иначе файл отдаётся целиком
+        if (auto if_range = req.find(http::field::if_range); if_range != req.end()) {
+            std::string_view validator = if_range->value();
+            bool is_etag = !validator.empty() && (validator.front() == '"' || validator.substr(0, 2) == "W/"sv);
+            // сравнение только строгое, слабый тег W/ не совпадает никогда
+            if (is_etag ? validator != resource->_etag : validator != resource->_last_modified) {
+                return std::nullopt;
+            }
+        }
+
+        ByteRanges ranges = ParseByteRanges(range->value(), size);
+        if (ranges.status == ByteRanges::Status::ignore) {
+            return std::nullopt;
+        }
+        return ranges;
+    }
+
+    // раскладывает участки по телу ответа 206 и добавляет его заголовки, несколько участков идут частями multipart/byteranges
+    void RequestHandler::StaticPartialHeaders(http::response_header<>& header, BodyRanges& body, const ByteRanges& ranges,
+        const resource_handler::ResourcePtr resource, uint64_t size, bool immutable) {
+
+        StaticCacheHeaders(header, resource, immutable, false);
+        std::string_view content_type = StaticContentType(resource->_type);
+
+        if (ranges.count == 1) {
+            body.SetRange(ranges.ranges[0].offset, ranges.ranges[0].size);
+            header.set(http::field::content_type, content_type);
+            header.set(http::field::content_range, BodyRanges::ContentRange(ranges.ranges[0], size));
+            return;
+        }
+
+        // граница частей строится из хеша содержимого и постоянна для файла
+        std::string boundary = "range_"s + resource->_etag.substr(1, resource->_etag.size() - 2);
+        header.set(http::field::content_type, body.SetByteRanges(ranges, size, content_type, boundary));
+    }
+
+    // ответ 416 - ни один участок Range не попадает в файл
+    Response RequestHandler::StaticRangeNotSatisfiableResponse(StringRequest&& req, uint64_t size) {
+        StringResponse response(http::status::range_not_satisfiable, req.version());
+        response.set(http::field::content_type, ContentType::TEXT_TXT);
+        response.set(http::field::content_range, "bytes */" + std::to_string(size));
+        response.body() = json_detail::GetErrorString("RangeNotSatisfiable"sv, "requested range is outside the file"sv);
+        response.prepare_payload();
+
+        return response;
+    }
+
+    // возвращает тип контента по типу файла
+    std::string_view RequestHandler::StaticContentType(res::ResourceType type) {
+        switch (type)
+        {
+        case res::ResourceType::html:
+        case res::ResourceType::htm:
+            return ContentType::TEXT_HTML;
+
+        case res::ResourceType::txt:
+        case res::ResourceType::folder:
+            return ContentType::TEXT_TXT;
+
+        case res::ResourceType::css:
+            return ContentType::TEXT_CSS;
+
+        case res::ResourceType::js:
+            return ContentType::TEXT_JS;
+
+        case res::ResourceType::json:
+            return ContentType::APP_JSON;
+
+        case res::ResourceType::xml:
+            return ContentType::APP_XML;
+
+        case res::ResourceType::png:
+            return ContentType::IMAGE_PNG;
+
+        case res::ResourceType::jpg:
+        case res::ResourceType::jpe:
+        case res::ResourceType::jpeg:
+            return ContentType::IMAGE_JPEG;
+
+        case res::ResourceType::gif:
+            return ContentType::IMAGE_GIF;
+
+        case res::ResourceType::bmp:
+            return ContentType::IMAGE_BMP;
+
+        case res::ResourceType::ico:
+            return ContentType::IMAGE_ICO;
+
+        case res::ResourceType::tif:
+        case res::ResourceType::tiff:
+            return ContentType::IMAGE_TIFF;
+
+        case res::ResourceType::svg:
+        case res::ResourceType::svgz:
+            return ContentType::IMAGE_SVG;
+
+        case res::ResourceType::mp3:
+            return ContentType::AUDIO_MPEG;
+
+        case res::ResourceType::unknow:
+            return ContentType::APP_UNKNOW;
+
+        default:
+            return ContentType::APP_UNKNOW;
+        }
+
+    }
+
+    // подтверждает, что клиент принимает ответ, сжатый gzip
+    bool RequestHandler::AcceptsGzip(const StringRequest& req) {
+        auto accept = req.find(http::field::accept_encoding);
+        return accept != req.end() && AcceptsGzipCoding(accept->value());
+    }
+
     // базовый ответ 404 - not found
     Response RequestHandler::StaticNotFoundResponse(StringRequest&& req) {
         StringResponse response(http::status::not_found, req.version());
@@ -433,196 +599,185 @@ namespace http_handler {
     }
 
     // обработчик для запросов к статическим данным
-    Response RequestHandler::HandleStaticRequest(StringRequest&& req) {
-        // если у нас просто переход по адресу, или с указанием странички index.html
-        if (req.target() == "/"sv || req.target() == "/index.html"sv) {
-            return StaticRootIndexResponse(std::move(req));
-        }
-
-        // для начала сделаем репарсинг полученной строки запроса, отсекаем первый слеш за ненадобностью
-        std::string reparse_line = ParseRequestTarget(req.target().begin() + 1, req.target().end());
-
-        // ищем выход за пределы рута, в левом запросе будет так или иначе в начале присутствовать замаскированный обратный слеш
-        if (reparse_line.find("..%5C") != std::string::npos
-            || reparse_line.find("/../") != std::string::npos) {
+    Response RequestHandler::HandleStaticRequest(StringRequest&& req, const RouteMatch& route) {
+        // путь декодируется и приводится к виду от корня в буфере на стеке, до открытия файла память не выделяется
+        StaticPathBuffer buffer;
+        std::optional<std::string_view> relative_path = route.route == Route::static_index
+            ? std::optional<std::string_view>("index.html"sv) : DecodeStaticPath(route.path, buffer);
+
+        // битые %-коды, обратный слеш и выход за пределы рута
+        if (!relative_path) {
             return StaticBadRequestResponse(std::move(req));
         }
 
-        // если на краю слеш - то будем искать файл index.html в крайнем каталоге
-        if (reparse_line.size() != 0 && *(reparse_line.end() - 1) == '/') {
-            reparse_line += "index.html";
+        resource_handler::ResourcePtr resource = resource_->FindFile(*relative_path);
+        bool immutable = false;
+        if (!resource && route.route != Route::static_index) {
+            // адрес с отпечатком "name.<хеш>.ext" отдаёт name.ext, только пока хеш совпадает с содержимым файла
+            if (auto fingerprint = CutStaticFingerprint(buffer, *relative_path)) {
+                resource = resource_->FindFile(fingerprint->path);
+                if (resource && resource->_content_hash != fingerprint->hash) {
+                    resource = nullptr;
+                }
+                immutable = resource != nullptr;
+            }
         }
 
-        // берем путь до основной директории
-        std::string root_path = std::string(resource_->GetRootPath());
-
-        // если запрос валидный, то проверяем наличие файла по пути
-        if (resource_handler::ResourcePtr resource = resource_->GetItem(fs::path(root_path + reparse_line)); !resource) {
+        if (!resource) {
             // если упоминания о файле во внутренних каталогах нет отвечаем, что отдать нечего
             return StaticNotFoundResponse(std::move(req));
         }
-        else {
-            return StaticFileBodyResponse(std::move(req), resource);
+        // повторный визит стоит только обмена заголовками
+        if (auto not_modified = StaticNotModifiedResponse(req, resource, immutable)) {
+            return std::move(*not_modified);
         }
+        return StaticFileBodyResponse(std::move(req), resource, immutable);
     }
 
     // обработчик запросов для к api-игрового сервера
-    Response RequestHandler::HandleApiRequest(StringRequest&& req, std::string_view api_request_line) {
-
-        if (api_request_line.size() == 0) {
-            // если предается голое "api", то вызываем ответ по ошибке
-            return DebugCommonFailResponse(std::move(req), http::status::bad_request, "badRequest"sv, "Bad request"sv, ""sv);
-        }
+    Response RequestHandler::HandleApiRequest(StringRequest&& req, const RouteMatch& route) {
 
-        if (api_request_line == __REST_API_MAPS__) {
+        switch (route.route)
+        {
+        case Route::maps:
             // выводим список доступных карт
             return game_->MapsListResponse(std::move(req));
-        }
 
-        if (api_request_line == __REST_API_JOIN__) {
-            // обрабатываем запрос по присоединению к игре
-            return game_->JoinGameResponse(std::move(req));
-        }
+        case Route::find_map:
+            // отправляемся на поиски запрошенной карты, id карты - остаток пути после "/v1/maps/"
+            return game_->FindMapResponse(std::move(req), route.param);
 
-        if (api_request_line == __REST_API_PLAYERS__) {
+        case Route::players:
             // обрабатываем запрос по выдаче информации о подключенных игроках к сессии
             return game_->PlayersListResponse(std::move(req));
-        }
 
-        if (api_request_line == __REST_API_TICK__) {
+        case Route::tick:
             if (timer_enable_) {
                 // если активирован таймер, то кидаем отбойник на подобный запрос
                 return DebugCommonFailResponse(std::move(req), http::status::bad_request, "badRequest"sv, "Invalid endpoint"sv, ""sv);
             }
             // обрабатываем запрос по изменению состояния игровой сессии со временем
-            return HandleSpecialCoopMethods(std::move(this->SerializeGameData()),
+            return HandleSpecialCoopMethods(std::move(this->AsyncSerializeGameData()),
                 std::move(game_->SessionsUpdateResponse(std::move(req))));
-        }
 
-        if (api_request_line == __REST_API_STATE__) {
+        case Route::state:
             // обрабатываем запрос по получению инфы о игровом состоянии персонажей
             return game_->GameStateResponse(std::move(req));
-        }
 
-        if (api_request_line == __REST_API_PLAYER_ACTION__) {
+        case Route::player_action:
             // обрабатываем запрос по совершению действий персонажем
             return game_->PlayerActionResponse(std::move(req));
-        }
 
-        if (api_request_line == __REST_API_RECORDS__) {
+        case Route::records:
+            if (route.has_query) {
+                // обрабатываем запрос на выдачу таблицы рекордов с параметрами
+                return game_->RecordsResponse(std::move(req), ParseDataBaseRequest(route.query));
+            }
             // обрабатываем запрос на выдачу таблицы рекордов без параметров
             return game_->RecordsResponse(std::move(req));
-        }
 
-        // важный момент парсинга - блок сработает только если строка больше 9 символов и первые слова "/v1/maps/"
-        // по идее сюда можно добавлять разные элементы, если их будет много то имеет смысл сделать специализированный парсер
-        if (api_request_line.size() >= (__REST_API_FIND_MAP__.size()) 
-            && std::string{ api_request_line.begin(),  api_request_line.begin() + __REST_API_FIND_MAP__.size() } == __REST_API_FIND_MAP__) {
-            // отправляемся на поиски запрошенной карты
-            return game_->FindMapResponse(std::move(req),
-                { api_request_line.begin() + __REST_API_FIND_MAP__.size()
-                , api_request_line.end() });
+        default:
+            // голое "api", неизвестный путь или канал без перехода на WebSocket - запрос плохой
+            return DebugCommonFailResponse(std::move(req), http::status::bad_request, "badRequest"sv, "Bad request"sv, ""sv);
         }
+    }
 
-        if (api_request_line.size() >= __REST_API_RECORDS_PARAMS__.size() 
-            && std::string{api_request_line.begin(),  api_request_line.begin() + __REST_API_RECORDS_PARAMS__.size() } == __REST_API_RECORDS_PARAMS__) {
-            // обрабатываем запрос на выдачу таблицы рекордов с параметрами
-            return game_->RecordsResponse(std::move(req)
-                , ParseDataBaseRequest({ api_request_line.begin() + __REST_API_RECORDS_PARAMS__.size()
-                    , api_request_line.end() }));
+    // обработчик долгого опроса состояния, ответ передаётся в send сразу или после тика
+    void RequestHandler::HandleStatePollRequest(StringRequest&& req, std::string_view query, game::ResponseSender&& send) {
+
+        // строка указывает в цель запроса, поэтому разбирается до передачи запроса дальше
+        auto params = ParseStatePollRequest(query);
+        if (!params) {
+            return send(DebugCommonFailResponse(std::move(req), http::status::bad_request,
+                "invalidArgument"sv, "Argument <afterVersion> or <baseVersion> expected"sv, ""sv));
         }
 
-        // на крайний случай просто скажем, что запрос плохой
-        return DebugCommonFailResponse(std::move(req), http::status::bad_request, "badRequest"sv, "Bad request"sv, ""sv);
+        game_->GameStatePollResponse(std::move(req), *params, std::move(send));
     }
 
     // обработчик для конфигурационных запросов от тестовой системы
-    Response RequestHandler::HandleTestRequest(StringRequest&& req, std::string_view debug_request_line) {
+    Response RequestHandler::HandleTestRequest(StringRequest&& req, const RouteMatch& route) {
 
-        if (debug_request_line.size() == 0) {
-            // если предается голое "api", то вызываем ответ по ошибке
-            return DebugCommonFailResponse(std::move(req), http::status::bad_request,  "badRequest"sv, "Bad request"sv, ""sv);
-        }
-
-        if (debug_request_line == "/reset"sv) {
+        switch (route.route)
+        {
+        case Route::test_reset:
             // обрабатываем запрос на сброс и удаление всех игровых сессий, нужно для тестов
             // в случае успешной авторизации, лямбда вызовет нужный обработчик
             return DebugAuthorizationImpl(std::move(req),
                 [this](http_handler::StringRequest&& req) {
                     return this->DebugSessionsResetResponse(std::move(req));
                 });
-        }
 
-        if (debug_request_line == "/position"sv) {
+        case Route::test_position:
             // обрабатываем запрос на установку флага случайной позиции на старте
             // в случае успешной авторизации, лямбда вызовет нужный обработчик
             return DebugAuthorizationImpl(std::move(req),
                 [this](http_handler::StringRequest&& req) {
                     return this->DebugStartPositionResponse(std::move(req));
                 });
-        }
 
-        if (debug_request_line == "/position/default"sv) {
+        case Route::test_position_default:
             // обрабатываем запрос на установку флага случайной позиции на старте
             // в случае успешной авторизации, лямбда вызовет нужный обработчик
             return DebugAuthorizationImpl(std::move(req),
                 [this](http_handler::StringRequest&& req) {
                     return this->DebugDefaultPositionResponse(std::move(req));
                 });
-        }
 
-        if (debug_request_line == "/test_end"sv) {
+        case Route::test_end:
             // обрабатываем отчёт о завершении тестов
             // в случае успешной авторизации, лямбда вызовет нужный обработчик
             return DebugAuthorizationImpl(std::move(req),
                 [this](http_handler::StringRequest&& req) {
                     return this->DebugUnitTestsEndResponse(std::move(req));
                 });
-        }
 
-        return DebugCommonFailResponse(std::move(req), http::status::bad_request, "badRequest"sv, "Bad request"sv, ""sv);
+        default:
+            // голое "test_frame" или неизвестный путь
+            return DebugCommonFailResponse(std::move(req), http::status::bad_request, "badRequest"sv, "Bad request"sv, ""sv);
+        }
     }
 
-    static const std::string __PARAM_OFFSET__ = "start=";
-    static const std::string __PARAM_LIMIT__ = "maxItems=";
+    static constexpr std::string_view __PARAM_OFFSET__ = "start="sv;
+    static constexpr std::string_view __PARAM_LIMIT__ = "maxItems="sv;
 
     // парсит дополнительные аргументы URL запроса к базе данных
     postgres::detail::ReqParam RequestHandler::ParseDataBaseRequest(std::string_view line) {
         postgres::detail::ReqParam result;
 
-        auto offset_pos = line.find(__PARAM_OFFSET__);
-        auto limit_pos = line.find(__PARAM_LIMIT__);
-
-        if (offset_pos != std::string::npos) {
-            std::string_view offset_sub{ line.begin() + offset_pos + __PARAM_OFFSET__.size(), line.end() };
-
-            auto sep_pos = offset_sub.find("&");
-            if (sep_pos != std::string::npos) {
-                result.offset_ = std::stoi(std::string(offset_sub.begin(), offset_sub.begin() + sep_pos));
-            }
-            else {
-                result.offset_ = std::stoi(std::string(offset_sub.begin(), offset_sub.end()));
+        // разбирает число как std::stoi, но без временной строки, нечисловое значение - исключение
+        auto parse_int = [](std::string_view value) {
+            int number = 0;
+            if (auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), number); ec != std::errc{}) {
+                throw std::invalid_argument("RequestHandler::ParseDataBaseRequest::Error::Invalid numeric argument");
             }
-        }
+            return number;
+        };
 
         /*
         * Если будет больше параметров, то можно сделать функцию которая будет парсить параметры беря их заготовки из константной мапы
         * Пока параметра всего два и мы точно знаем какие, можно ограничиться этим решением.
         */
 
-        if (limit_pos != std::string::npos) {
-            std::string_view limit_sub{ line.begin() + limit_pos + __PARAM_LIMIT__.size(), line.end() };
+        if (auto offset = FindQueryParam(line, __PARAM_OFFSET__)) {
+            result.offset_ = parse_int(*offset);
+        }
 
-            auto sep_pos = limit_sub.find("&");
-            if (sep_pos != std::string::npos) {
-                result.limit_ = std::stoi(std::string(limit_sub.begin(), limit_sub.begin() + sep_pos));
-            }
-            else {
-                result.limit_ = std::stoi(std::string(limit_sub.begin(), limit_sub.end()));
-            }
+        if (auto limit = FindQueryParam(line, __PARAM_LIMIT__)) {
+            result.limit_ = parse_int(*limit);
         }
 
         return result;
     }
 
+    // парсит версии состояния из аргументов afterVersion и baseVersion, std::nullopt если нет ни одной
+    std::optional<game::StateRequestParams> RequestHandler::ParseStatePollRequest(std::string_view line) {
+        // заданный аргумент с неверным значением считается ошибкой, см. ParseStateQuery
+        auto query = ParseStateQuery(line);
+        if (!query) {
+            return std::nullopt;
+        }
+        return game::StateRequestParams{ query->after_version, query->base_version };
+    }
+
 }  // namespace http_handler
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include "resource_handler.h"
 #include "time_handler.h"
 #include "serialization_handler.h"             // подключит game_handler.h, boost_json.h, json_loader.h и прочее
+#include "websocket_handler.h"                 // канал WebSocket для действий игрока и состояния сессии
 #include "options.h"                           // подключит аргументы запуска
+#include "request_router.h"                    // таблицы маршрутов запросов
 #include "domain.h"                            // базовый инклюд с разными объявлениями
 
 namespace http_handler {
@@ -20,7 +22,14 @@ namespace http_handler {
     class RequestHandler : public std::enable_shared_from_this<RequestHandler> {
     public:
         RequestHandler(detail::Arguments&& arguments, net::io_context& ioc)
-            : arguments_(std::move(arguments)), api_strand_(net::make_strand(ioc)) {
+            : api_strand_(net::make_strand(ioc)), arguments_(std::move(arguments))
+            , session_executors_{ ioc.get_executor() } {
+            ConfigurationPipeline();
+        }
+        // игровые сессии будут распределены по переданным исполнителям
+        RequestHandler(detail::Arguments&& arguments, net::io_context& ioc, std::vector<game::SessionExecutor> session_executors)
+            : api_strand_(net::make_strand(ioc)), arguments_(std::move(arguments))
+            , session_executors_(std::move(session_executors)) {
             ConfigurationPipeline();
         }
         
@@ -32,6 +41,8 @@ namespace http_handler {
             // передаем обработку в парсер вместе с CallBack&&, чтобы в случае чего передать обработку запроса к api в api_strand_
             HandleRequest(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
         }
+        // принимает запрос на переход к WebSocket вместе с соединением, см. http_server::SessionBase::HandleUpgrade
+        void HandleUpgrade(StringRequest&& req, beast::tcp_stream&& stream);
 
         // включает выполнение автотаймера, выкидывает исключение, если таймер уже включен
         RequestHandler& StartGameTimer();
@@ -47,6 +58,7 @@ namespace http_handler {
     private:
         Strand api_strand_;
         detail::Arguments arguments_;
+        std::vector<game::SessionExecutor> session_executors_;
 
         std::shared_ptr<res::ResourceHandler> resource_ = nullptr;
         std::shared_ptr<game::GameHandler> game_ = nullptr;
@@ -56,6 +68,8 @@ namespace http_handler {
         bool timer_enable_ = false;              // флаг активации таймера автоизменения состояния
         bool autosave_enable_ = false;           // флаг активации автосохранения состояния
 
+        // выполняет запись данных игрового сервера во время работы, снимок сессий делается в их стрендах
+        RequestHandler& AsyncSerializeGameData();
         // метод настройки игрового таймера, генерирует команды для обработки
         RequestHandler& TimerConfigurationPipeline();
         // базовая функция активации всех элементов вызываемая в конструкторе по переданным параметрам
@@ -64,9 +78,27 @@ namespace http_handler {
         // ------------------------------ блок работы с запросами к static data -------------------------
 
         // возвращает запрошенный документ
-        Response StaticFileBodyResponse(StringRequest&& req, const resource_handler::ResourcePtr file_path);
-        // возвращает index.html основной страницы
-        Response StaticRootIndexResponse(StringRequest&& req);
+        Response StaticFileBodyResponse(StringRequest&& req, const resource_handler::ResourcePtr file_path, bool immutable);
+        // возвращает документ из кеша в памяти, сжатый вариант выбирается по Accept-Encoding
+        Response StaticCachedResponse(StringRequest&& req, const resource_handler::ResourcePtr resource, bool immutable);
+        // возвращает ответ 304, если у клиента актуальная версия файла, иначе std::nullopt
+        std::optional<Response> StaticNotModifiedResponse(const StringRequest& req, const resource_handler::ResourcePtr resource,
+            bool immutable);
+        // добавляет в ответ валидаторы файла и политику кеширования, immutable - для адреса с отпечатком содержимого
+        static void StaticCacheHeaders(http::response_header<>& header, const resource_handler::ResourcePtr resource,
+            bool immutable, bool gzip);
+        // возвращает участки файла из заголовка Range, либо std::nullopt, если отдаётся весь файл
+        static std::optional<ByteRanges> StaticRequestedRanges(const StringRequest& req, const resource_handler::ResourcePtr resource,
+            uint64_t size);
+        // раскладывает участки по телу ответа 206 и добавляет его заголовки, несколько участков идут частями multipart/byteranges
+        static void StaticPartialHeaders(http::response_header<>& header, BodyRanges& body, const ByteRanges& ranges,
+            const resource_handler::ResourcePtr resource, uint64_t size, bool immutable);
+        // ответ 416 - ни один участок Range не попадает в файл
+        Response StaticRangeNotSatisfiableResponse(StringRequest&& req, uint64_t size);
+        // возвращает тип контента по типу файла
+        static std::string_view StaticContentType(resource_handler::ResourceType type);
+        // подтверждает, что клиент принимает ответ, сжатый gzip
+        static bool AcceptsGzip(const StringRequest& req);
         // базовый ответ 404 - not found
         Response StaticNotFoundResponse(StringRequest&& req);
         // базовый ответ 400 - bad request
@@ -109,19 +141,20 @@ namespace http_handler {
         // ------------------------------ внутренние обработчики базовой системы ------------------------
 
         // обработчик для запросов к статическим данным
-        Response HandleStaticRequest(StringRequest&& req);
+        Response HandleStaticRequest(StringRequest&& req, const RouteMatch& route);
         // обработчик для запросов к api-игрового сервера
-        Response HandleApiRequest(StringRequest&& req, std::string_view api_request_line);
+        Response HandleApiRequest(StringRequest&& req, const RouteMatch& route);
         // обработчик для конфигурационных запросов от тестовой системы
-        Response HandleTestRequest(StringRequest&& req, std::string_view api_request_line);
+        Response HandleTestRequest(StringRequest&& req, const RouteMatch& route);
+        // обработчик долгого опроса состояния, ответ передаётся в send сразу или после тика
+        void HandleStatePollRequest(StringRequest&& req, std::string_view query, game::ResponseSender&& send);
 
         // ------------------------------ блок парсинга и базовой обработки -----------------------------
 
         // парсит дополнительные аргументы URL запроса к базе данных
         postgres::detail::ReqParam ParseDataBaseRequest(std::string_view line);
-
-        template <typename Iterator>
-        std::string ParseRequestTarget(Iterator begin, Iterator end);
+        // парсит версии состояния из аргументов afterVersion и baseVersion, std::nullopt если нет ни одной
+        std::optional<game::StateRequestParams> ParseStatePollRequest(std::string_view line);
 
         template <typename Send>
         void HandleRequest(StringRequest&& req, Send&& send);
@@ -130,7 +163,7 @@ namespace http_handler {
     template <typename Function>
     Response RequestHandler::DebugAuthorizationImpl(StringRequest&& req, Function&& func) {
         // проверяем корректность метода запроса
-        if (req.method_string() != http_handler::Method::POST) {
+        if (req.method() != http::verb::post) {
             // если у нас не POST-запрос, то кидаем отбойник
             return DebugCommonFailResponse(std::move(req), http::status::method_not_allowed,
                 "invalidMethod", "Request method not allowed", http_handler::Method::POST);
@@ -175,94 +208,82 @@ namespace http_handler {
         return Response(std::move(returned));
     }
 
-    template <typename Iterator>
-    std::string RequestHandler::ParseRequestTarget(Iterator begin, Iterator end) {
+    template <typename Send>
+    void RequestHandler::HandleRequest(StringRequest&& req, Send&& send) {
 
-        std::string result = ""s;                // строка с результатом работы
-        bool IsASCII = false;                    // если появится ASCII-код
-        std::string ascii_code = ""s;            // набранный ASCII-код
+        // дерево, маршрут и очередь определяются по таблицам из request_router.h без выделения памяти
+        RouteMatch route = MatchRoute(req.target());
 
-        // итерируемся по переданному диапазону
-        for (auto it = begin; it != end; it++) {
+        switch (route.tree)
+        {
+        case RouteTree::api:
+            break;
 
-            // пока не встретился ASCII-код
-            if (!IsASCII) {
+        case RouteTree::test_frame:
+            // Старая сквозная тест система полностью отключена и доступ по REST API "/test_frame" закрыт
+            // если тестовая система не заявлена в конфигурации и не поднят её флаг, то доступ закрыт
+            return send(DebugCommonFailResponse(std::move(req), http::status::bad_request, "badRequest"sv, "Invalid endpoint"sv, ""sv));
 
-                if (*it == '%') {
-                    IsASCII = true;              // подымаем флаг
-                    ascii_code += *it;           // записываем элемент в символ
-                }
-                else if (*it == '+') {
-                    result += ' ';               // для корректной обработки запроса file%20with+spaces
-                }
-                else {
-                    result += *it;
-                }
-            }
-            else {
+        default:
+            // если обращение не к api, то уходим в обработку запросов к статическим данным
+            return send(HandleStaticRequest(std::move(req), route));
+        }
 
-                // пока не набрали три символа в ASCII-коде
-                if (ascii_code.size() < 2) {
-                    ascii_code += *it;           // записываем элемент в код
-                }
+        // запросы к данным конкретной сессии сразу уходят в стренд этой сессии, минуя общий стренд
+        if (route.lane == ApiLane::session || route.lane == ApiLane::poll) {
+            if (auto session = game_->FindRequestSession(req)) {
+
+                auto handle = [self = shared_from_this(), send, request = std::forward<StringRequest&&>(req)]() mutable {
+                    try {
+                        // строки маршрута указывают в цель запроса, поэтому маршрут разбирается заново у перенесённого запроса
+                        RouteMatch route = MatchRoute(request.target());
 
-                else {
-                    ascii_code += *it;        // дописываем третий элемент в код
+                        // долгий опрос может отложить ответ до тика, поэтому получает send целиком
+                        if (route.lane == ApiLane::poll) {
+                            return self->HandleStatePollRequest(std::forward<StringRequest&&>(request), route.query, send);
+                        }
 
-                    if (__ASCII_CODE_TO_CHAR__.count(ascii_code)) {
-                        // если код есть в таблице, то дописываем в результирующий файл
-                        result.push_back(__ASCII_CODE_TO_CHAR__.at(ascii_code));
+                        return send(self->HandleApiRequest(std::forward<StringRequest&&>(request), route));
                     }
-                    // очищаем строку ASCII-кода и снимаем флаг
-                    ascii_code.clear(); IsASCII = false;
-                }
+                    catch (...) {
+                        send(self->StaticBadRequestResponse(std::forward<StringRequest&&>(request)));
+                    }
+                };
+
+                return net::dispatch(session->GetStrand(), handle);
             }
+            // если сессия по токену не найдена, то ответ об ошибке сформируется в общем стренде
         }
 
-        return result;
-    }
-
-    template <typename Send>
-    void RequestHandler::HandleRequest(StringRequest&& req, Send&& send) {
+        // создаём лямбду с шароварным указателем на экземпляр класса (экземпляр должен быть в куче, иначе все упадет!)
+        // + Callback&&, плюс реквест. Чтобы не создавать экземпляр реквеста (лямбда по дефолту преобразует в const Type
+        // в std::forward указываем конкретный тип и задаем его "mutable"
+        auto handle = [self = shared_from_this(), send, request = std::forward<StringRequest&&>(req)]() mutable {
 
-        // либо строка содержит только "api", либо имеет продолжение вида "api/"
-        if (req.target().substr(0, 4) == "/api"sv && req.target().size() == 4
-            || req.target().substr(0, 5) == "/api/"sv) {
+            try {
+                // Этот assert не выстрелит, так как лямбда-функция будет выполняться внутри strand
+                assert(self->api_strand_.running_in_this_thread());
 
-            // создаём лямбду с шароварным указателем на экземпляр класса (экземпляр должен быть в куче, иначе все упадет!)
-            // + Callback&&, плюс реквест. Чтобы не создавать экземпляр реквеста (лямбда по дефолту преобразует в const Type
-            // в std::forward указываем конкретный тип и задаем его "mutable"
-            auto handle = [self = shared_from_this(), send, request = std::forward<StringRequest&&>(req)]() mutable {
+                RouteMatch route = MatchRoute(request.target());
 
-                try {
-                    // Этот assert не выстрелит, так как лямбда-функция будет выполняться внутри strand
-                    assert(self->api_strand_.running_in_this_thread());
-                    return send(self->HandleApiRequest(std::forward<StringRequest&&>(request),
-                        { request.target().begin() + 4, request.target().end() }));
+                // вход в игру заканчивается в стренде выбранной сессии, ответ отправится оттуда
+                if (route.lane == ApiLane::join) {
+                    return self->game_->JoinGameResponse(std::forward<StringRequest&&>(request), send);
                 }
-                catch (...) {
-                    send(self->StaticBadRequestResponse(std::forward<StringRequest&&>(request)));
+                // сюда долгий опрос попадает только с неизвестным токеном, ответ об ошибке уйдёт сразу
+                if (route.lane == ApiLane::poll) {
+                    return self->HandleStatePollRequest(std::forward<StringRequest&&>(request), route.query, send);
                 }
-            };
-            
-            // важно не забыть задиспатчить всё что происходит в стренде. по сути похоже на футур
-            return net::dispatch(api_strand_, handle);
-        }
-
-        // либо строка содержит только "test_frame", либо имеет продолжение вида "test_frame/"
-        else if (req.target().substr(0, 11) == "/test_frame"sv && req.target().size() == 11
-            || req.target().substr(0, 12) == "/test_frame/"sv) {
-
-            // Старая сквозная тест система полностью отключена и доступ по REST API "/test_frame" закрыт
 
-            // если тестовая система не заявлена в конфигурации и не поднят её флаг, то доступ закрыт
-            return send(DebugCommonFailResponse(std::move(req), http::status::bad_request, "badRequest"sv, "Invalid endpoint"sv, ""sv));
-        }
-
-        else {
-            // если обращение не к api, то уходим в обработку запросов к статическим данным
-            return send(HandleStaticRequest(std::move(req)));
-        }
+                return send(self->HandleApiRequest(std::forward<StringRequest&&>(request), route));
+            }
+            catch (...) {
+                send(self->StaticBadRequestResponse(std::forward<StringRequest&&>(request)));
+            }
+        };
+        
+        // важно не забыть задиспатчить всё что происходит в стренде. по сути похоже на футур
+        return net::dispatch(api_strand_, handle);
     }
 
 }  // namespace http_handler
\ No newline at end of file
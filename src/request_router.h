@@ -0,0 +1,666 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+namespace http_handler {
+
+    using namespace std::literals;
+
+    // очередь, в которой выполняется запрос к api
+    enum class ApiLane {
+        global,       // общий стренд обработчика: тик, карты, рекорды, отладка
+        join,         // вход в игру: сессия выбирается в общем стренде, игрок добавляется в стренде сессии
+        session,      // стренд игровой сессии игрока: состояние, список игроков, действия
+        poll          // долгий опрос состояния в стренде сессии, ответ может ждать следующего тика
+    };
+
+    // дерево маршрутов, выбирается по первому сегменту цели запроса
+    enum class RouteTree {
+        api,          // "/api" и "/api/..."
+        test_frame,   // "/test_frame" и "/test_frame/..."
+        static_data   // всё остальное - файлы из --www-root
+    };
+
+    // маршрут запроса внутри дерева
+    enum class Route {
+        not_found,
+        // дерево api
+        api_root, maps, find_map, join, players, tick, state, player_action, records, channel,
+        // дерево test_frame
+        test_root, test_reset, test_position, test_position_default, test_end,
+        // дерево static_data
+        static_index, static_file
+    };
+
+    // запись таблицы маршрутов, '*' в конце шаблона принимает остаток пути параметром
+    struct RouteEntry {
+        std::string_view pattern;
+        Route route = Route::not_found;
+        ApiLane lane = ApiLane::global;
+    };
+
+    // результат разбора цели запроса, все строки указывают в цель запроса и живут, пока жив запрос
+    struct RouteMatch {
+        RouteTree tree = RouteTree::static_data;
+        Route route = Route::not_found;
+        ApiLane lane = ApiLane::global;
+        std::string_view path;        // путь внутри дерева без префикса дерева и строки запроса, для статики - путь цели
+        std::string_view param;       // остаток пути для шаблона с '*'
+        std::string_view query;       // строка запроса после '?'
+        bool has_query = false;       // в цели есть '?', даже с пустой строкой запроса
+    };
+
+    namespace route_detail {
+
+        static constexpr uint64_t __ROUTE_HASH_BASIS__ = 14695981039346656037ull;
+        static constexpr uint64_t __ROUTE_HASH_PRIME__ = 1099511628211ull;
+
+        // шаг FNV-1a, хеш можно продолжать посимвольно без склейки строк
+        constexpr uint64_t RouteHashStep(uint64_t hash, char c) {
+            return (hash ^ static_cast<unsigned char>(c)) * __ROUTE_HASH_PRIME__;
+        }
+
+        constexpr uint64_t RouteHash(std::string_view line, uint64_t seed) {
+            uint64_t hash = __ROUTE_HASH_BASIS__ ^ seed;
+            for (char c : line) {
+                hash = RouteHashStep(hash, c);
+            }
+            return hash;
+        }
+
+        /*
+        * Таблица маршрутов с совершенным хешем, строится при компиляции.
+        * Зерно хеша подбирается так, чтобы каждый шаблон получил свою ячейку, поэтому поиск - один хеш
+        * и одно сравнение строк. Если зерно не найдено, то компиляция останавливается на исключении в constexpr.
+        * Шаблон с '*' ищется по префиксу пути до очередного '/' с продолжением хеша символом '*',
+        * проверяются только позиции '/', поэтому поиск обходится без выделения памяти.
+        */
+        template <size_t N, size_t Slots = 64>
+        class RouteTable {
+            static_assert((Slots & (Slots - 1)) == 0, "RouteTable::Error::Slots must be a power of two");
+            static_assert(N <= Slots / 2, "RouteTable::Error::Too many routes for the slots");
+
+        public:
+            constexpr explicit RouteTable(const std::array<RouteEntry, N>& entries) {
+                for (uint64_t seed = 0; seed != __MAX_SEED__; ++seed) {
+                    if (TryBuild(entries, seed)) {
+                        return;
+                    }
+                }
+                throw "RouteTable::Error::Perfect hash seed has not been found";
+            }
+
+            // возвращает запись маршрута для пути и параметр шаблона с '*', или nullptr
+            constexpr const RouteEntry* Find(std::string_view path, std::string_view& param) const {
+                if (const RouteEntry* entry = At(RouteHash(path, seed_)); entry && entry->pattern == path) {
+                    return entry;
+                }
+
+                // от самого длинного префикса к короткому: "/v1/maps/map1" -> "/v1/maps/*" -> "/v1/*" -> "/*"
+                for (size_t pos = path.rfind('/'); pos != std::string_view::npos; pos = pos ? path.rfind('/', pos - 1) : std::string_view::npos) {
+                    std::string_view prefix = path.substr(0, pos + 1);
+                    const RouteEntry* entry = At(RouteHashStep(RouteHash(prefix, seed_), '*'));
+                    if (entry && entry->pattern.size() == prefix.size() + 1
+                        && entry->pattern.back() == '*' && entry->pattern.substr(0, prefix.size()) == prefix) {
+                        param = path.substr(prefix.size());
+                        return entry;
+                    }
+                }
+                return nullptr;
+            }
+
+        private:
+            static constexpr uint64_t __MAX_SEED__ = 1024;
+
+            std::array<RouteEntry, N> entries_{};
+            std::array<uint8_t, Slots> slots_{};          // номер записи + 1, 0 - пустая ячейка
+            uint64_t seed_ = 0;
+
+            constexpr bool TryBuild(const std::array<RouteEntry, N>& entries, uint64_t seed) {
+                std::array<uint8_t, Slots> slots{};
+                for (size_t i = 0; i != N; ++i) {
+                    uint8_t& slot = slots[RouteHash(entries[i].pattern, seed) & (Slots - 1)];
+                    if (slot != 0) {
+                        return false;
+                    }
+                    slot = static_cast<uint8_t>(i + 1);
+                }
+
+                entries_ = entries;
+                slots_ = slots;
+                seed_ = seed;
+                return true;
+            }
+
+            constexpr const RouteEntry* At(uint64_t hash) const {
+                uint8_t slot = slots_[hash & (Slots - 1)];
+                return slot == 0 ? nullptr : &entries_[slot - 1];
+            }
+        };
+
+        // маршруты дерева api, пути указываются без "/api"
+        inline constexpr RouteTable __API_ROUTES__(std::array{
+            RouteEntry{ ""sv, Route::api_root },
+            RouteEntry{ "/v1/maps"sv, Route::maps },
+            RouteEntry{ "/v1/maps/*"sv, Route::find_map },
+            RouteEntry{ "/v1/game/join"sv, Route::join, ApiLane::join },
+            RouteEntry{ "/v1/game/players"sv, Route::players, ApiLane::session },
+            RouteEntry{ "/v1/game/tick"sv, Route::tick },
+            RouteEntry{ "/v1/game/state"sv, Route::state, ApiLane::session },
+            RouteEntry{ "/v1/game/player/action"sv, Route::player_action, ApiLane::session },
+            RouteEntry{ "/v1/game/records"sv, Route::records },
+            RouteEntry{ "/v1/game/channel"sv, Route::channel }
+        });
+
+        // маршруты дерева test_frame, пути указываются без "/test_frame"
+        inline constexpr RouteTable __TEST_FRAME_ROUTES__(std::array{
+            RouteEntry{ ""sv, Route::test_root },
+            RouteEntry{ "/reset"sv, Route::test_reset },
+            RouteEntry{ "/position"sv, Route::test_position },
+            RouteEntry{ "/position/default"sv, Route::test_position_default },
+            RouteEntry{ "/test_end"sv, Route::test_end }
+        });
+
+        // отделяет префикс дерева: либо строка равна prefix, либо продолжается "prefix/" или "prefix?"
+        constexpr bool CutTreePrefix(std::string_view& target, std::string_view prefix) {
+            if (target.substr(0, prefix.size()) != prefix) {
+                return false;
+            }
+            if (target.size() != prefix.size() && target[prefix.size()] != '/' && target[prefix.size()] != '?') {
+                return false;
+            }
+            target.remove_prefix(prefix.size());
+            return true;
+        }
+
+    } // namespace route_detail
+
+    /*
+    * Разбирает цель запроса по деревьям и таблицам маршрутов, без выделения памяти.
+    * Путь сравнивается без строки запроса, строка запроса и параметр пути возвращаются как string_view в цель.
+    * Запрос к статическим данным только классифицируется: "/" и "/index.html" - главная страница, прочее - файл,
+    * путь файла затем разбирается DecodeStaticPath.
+    * Для /v1/game/state со строкой запроса возвращается очередь долгого опроса ApiLane::poll.
+    */
+    constexpr RouteMatch MatchRoute(std::string_view target) {
+        RouteMatch match;
+
+        std::string_view tree_target = target;
+        if (route_detail::CutTreePrefix(tree_target, "/api"sv)) {
+            match.tree = RouteTree::api;
+        }
+        else if (route_detail::CutTreePrefix(tree_target, "/test_frame"sv)) {
+            match.tree = RouteTree::test_frame;
+        }
+        else {
+            match.tree = RouteTree::static_data;
+        }
+
+        size_t query_pos = tree_target.find('?');
+        match.path = tree_target.substr(0, query_pos);
+        if (query_pos != std::string_view::npos) {
+            match.query = tree_target.substr(query_pos + 1);
+            match.has_query = true;
+        }
+
+        if (match.tree == RouteTree::static_data) {
+            match.route = match.path == "/"sv || match.path == "/index.html"sv ? Route::static_index : Route::static_file;
+            return match;
+        }
+
+        const RouteEntry* entry = match.tree == RouteTree::api
+            ? route_detail::__API_ROUTES__.Find(match.path, match.param)
+            : route_detail::__TEST_FRAME_ROUTES__.Find(match.path, match.param);
+        if (entry) {
+            match.route = entry->route;
+            match.lane = entry->lane;
+        }
+
+        if (match.route == Route::state && match.has_query) {
+            // долгий опрос и разность состояния /v1/game/state?afterVersion=N&baseVersion=M
+            match.lane = ApiLane::poll;
+        }
+        return match;
+    }
+
+    // наибольшая длина пути к статическому файлу после декодирования, более длинные пути отклоняются
+    static constexpr size_t __STATIC_PATH_MAX_SIZE__ = 512;
+    // буфер для пути к статическому файлу, размещается на стеке обработчика
+    using StaticPathBuffer = std::array<char, __STATIC_PATH_MAX_SIZE__>;
+
+    namespace route_detail {
+
+        // значения шестнадцатеричных цифр по коду символа, -1 для прочих символов
+        inline constexpr std::array<int8_t, 256> __HEX_DIGITS__ = [] {
+            std::array<int8_t, 256> digits{};
+            for (auto& digit : digits) {
+                digit = -1;
+            }
+            for (int i = 0; i != 10; ++i) {
+                digits['0' + i] = static_cast<int8_t>(i);
+            }
+            for (int i = 0; i != 6; ++i) {
+                digits['a' + i] = digits['A' + i] = static_cast<int8_t>(10 + i);
+            }
+            return digits;
+        }();
+
+        // декодирует %XX и '+' в буфер, отклоняет неполные коды, нулевой символ и обратный слеш
+        constexpr std::optional<size_t> DecodePercent(std::string_view line, StaticPathBuffer& buffer) {
+            size_t size = 0;
+            for (size_t i = 0; i != line.size(); ++i) {
+                char c = line[i];
+                if (c == '%') {
+                    if (i + 2 >= line.size()) {
+                        return std::nullopt;
+                    }
+                    int8_t high = __HEX_DIGITS__[static_cast<unsigned char>(line[i + 1])];
+                    int8_t low = __HEX_DIGITS__[static_cast<unsigned char>(line[i + 2])];
+                    if (high < 0 || low < 0) {
+                        return std::nullopt;
+                    }
+                    c = static_cast<char>(high * 16 + low);
+                    i += 2;
+                }
+                else if (c == '+') {
+                    // для корректной обработки запроса file%20with+spaces
+                    c = ' ';
+                }
+
+                if (c == '\0' || c == '\\' || size == buffer.size()) {
+                    return std::nullopt;
+                }
+                buffer[size++] = c;
+            }
+            return size;
+        }
+
+    } // namespace route_detail
+
+    /*
+    * Приводит путь цели запроса к статическому файлу к пути относительно --www-root без ведущего слеша.
+    * Сначала декодируются %XX, затем в том же буфере схлопываются повторные '/', убираются сегменты "."
+    * и сегменты ".." вместе с предыдущим сегментом. Выход выше корня, обратный слеш и нулевой символ
+    * (в том числе закодированные) отклоняются - возвращается std::nullopt, как и для слишком длинного пути.
+    * Путь, оканчивающийся каталогом, дополняется "index.html". Результат указывает в переданный буфер.
+    *
+    * Пример: "/images/../css/%2e/main%20v2.css" -> "css/main v2.css", "/docs/" -> "docs/index.html".
+    */
+    constexpr std::optional<std::string_view> DecodeStaticPath(std::string_view path, StaticPathBuffer& buffer) {
+        if (path.empty() || path.front() != '/') {
+            return std::nullopt;
+        }
+
+        auto decoded = route_detail::DecodePercent(path, buffer);
+        if (!decoded) {
+            return std::nullopt;
+        }
+
+        // запись идёт в тот же буфер, позиция записи всегда не правее позиции чтения
+        const size_t size = *decoded;
+        const bool trailing_slash = buffer[size - 1] == '/';
+        bool directory = false;
+        size_t write = 0;
+
+        for (size_t read = 0; read != size;) {
+            if (buffer[read] == '/') {
+                ++read;
+                continue;
+            }
+
+            size_t end = read;
+            while (end != size && buffer[end] != '/') {
+                ++end;
+            }
+            std::string_view segment(buffer.data() + read, end - read);
+
+            if (segment == "."sv) {
+                directory = true;
+            }
+            else if (segment == ".."sv) {
+                if (write == 0) {
+                    return std::nullopt;
+                }
+                // откатываемся к началу последнего записанного сегмента вместе с его разделителем
+                while (write != 0 && buffer[write - 1] != '/') {
+                    --write;
+                }
+                write = write == 0 ? 0 : write - 1;
+                directory = true;
+            }
+            else {
+                if (write != 0) {
+                    buffer[write++] = '/';
+                }
+                for (size_t i = read; i != end; ++i) {
+                    buffer[write++] = buffer[i];
+                }
+                directory = false;
+            }
+            read = end;
+        }
+
+        if (directory || trailing_slash) {
+            constexpr std::string_view index = "index.html"sv;
+            if (write + 1 + index.size() > buffer.size()) {
+                return std::nullopt;
+            }
+            if (write != 0) {
+                buffer[write++] = '/';
+            }
+            for (char c : index) {
+                buffer[write++] = c;
+            }
+        }
+        return std::string_view(buffer.data(), write);
+    }
+
+    // путь к файлу без отпечатка и отпечаток содержимого из имени "name.<хеш>.ext"
+    struct StaticFingerprint {
+        std::string_view path;        // путь без отпечатка, указывает в буфер
+        uint64_t hash = 0;            // 16 шестнадцатеричных цифр хеша содержимого
+    };
+
+    /*
+    * Убирает из имени файла отпечаток содержимого: "js/three.0123456789abcdef.js" -> "js/three.js".
+    * path - результат DecodeStaticPath, он начинается с начала того же буфера, расширение сдвигается на место отпечатка.
+    * Для имени без отпечатка возвращает std::nullopt и буфер не меняет.
+    */
+    constexpr std::optional<StaticFingerprint> CutStaticFingerprint(StaticPathBuffer& buffer, std::string_view path) {
+        constexpr size_t hash_size = 16;
+
+        const size_t name_begin = path.rfind('/') == std::string_view::npos ? 0 : path.rfind('/') + 1;
+        const size_t extension = path.rfind('.');
+        // перед отпечатком должно остаться непустое имя: "<имя>.<хеш>.<расширение>"
+        if (extension == std::string_view::npos || extension < name_begin + hash_size + 2
+            || path[extension - hash_size - 1] != '.') {
+            return std::nullopt;
+        }
+
+        uint64_t hash = 0;
+        for (size_t i = extension - hash_size; i != extension; ++i) {
+            int8_t digit = route_detail::__HEX_DIGITS__[static_cast<unsigned char>(path[i])];
+            if (digit < 0) {
+                return std::nullopt;
+            }
+            hash = hash << 4 | static_cast<uint64_t>(digit);
+        }
+
+        // сдвигаем ".ext" на место ".<хеш>"
+        const size_t cut_begin = extension - hash_size - 1;
+        for (size_t i = extension; i != path.size(); ++i) {
+            buffer[cut_begin + i - extension] = buffer[i];
+        }
+        return StaticFingerprint{ std::string_view(buffer.data(), path.size() - (extension - cut_begin)), hash };
+    }
+
+    // наибольшее число участков в одном заголовке Range, запрос с большим числом участков получает весь файл
+    static constexpr size_t __MAX_BYTE_RANGES__ = 16;
+
+    // участок файла [offset, offset + size)
+    struct ByteRange {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    // результат разбора заголовка Range
+    struct ByteRanges {
+        enum class Status {
+            ignore,           // заголовок с ошибкой или участков слишком много - отдаётся весь файл
+            unsatisfiable,    // ни один участок не попадает в файл - ответ 416
+            partial           // есть участки в пределах файла - ответ 206
+        };
+
+        Status status = Status::ignore;
+        std::array<ByteRange, __MAX_BYTE_RANGES__> ranges{};
+        size_t count = 0;
+    };
+
+    namespace route_detail {
+
+        // разбирает десятичное число без знака, пустая строка, посторонние символы и переполнение - ошибка
+        constexpr std::optional<uint64_t> ParseDecimal(std::string_view line) {
+            if (line.empty()) {
+                return std::nullopt;
+            }
+            uint64_t value = 0;
+            for (char c : line) {
+                if (c < '0' || c > '9' || value > (std::numeric_limits<uint64_t>::max() - (c - '0')) / 10) {
+                    return std::nullopt;
+                }
+                value = value * 10 + static_cast<uint64_t>(c - '0');
+            }
+            return value;
+        }
+
+    } // namespace route_detail
+
+    /*
+    * Разбирает заголовок Range вида "bytes=0-99, 200-, -500" для файла размером size (RFC 7233).
+    * Участки за пределами файла пропускаются, конец участка обрезается по размеру файла,
+    * "-N" - последние N байт файла. Синтаксическая ошибка делает весь заголовок недействительным.
+    * Участки отдаются в порядке запроса, без слияния, поэтому их число ограничено __MAX_BYTE_RANGES__.
+    */
+    constexpr ByteRanges ParseByteRanges(std::string_view header, uint64_t size) {
+        if (header.substr(0, 6) != "bytes="sv) {
+            return ByteRanges{};
+        }
+        header.remove_prefix(6);
+
+        ByteRanges result;
+        bool has_specs = false;
+        while (!header.empty()) {
+            // отделяем очередной участок списка, пустые элементы списка допускаются
+            size_t comma = header.find(',');
+            std::string_view spec = header.substr(0, comma);
+            header.remove_prefix(comma == std::string_view::npos ? header.size() : comma + 1);
+
+            while (!spec.empty() && (spec.front() == ' ' || spec.front() == '\t')) {
+                spec.remove_prefix(1);
+            }
+            while (!spec.empty() && (spec.back() == ' ' || spec.back() == '\t')) {
+                spec.remove_suffix(1);
+            }
+            if (spec.empty()) {
+                continue;
+            }
+
+            size_t dash = spec.find('-');
+            if (dash == std::string_view::npos) {
+                return ByteRanges{};
+            }
+
+            uint64_t offset = 0;
+            uint64_t end = 0;             // позиция за последним байтом участка
+            if (dash == 0) {
+                // последние N байт файла
+                auto suffix = route_detail::ParseDecimal(spec.substr(1));
+                if (!suffix) {
+                    return ByteRanges{};
+                }
+                has_specs = true;
+                if (*suffix == 0 || size == 0) {
+                    continue;
+                }
+                offset = size - std::min(*suffix, size);
+                end = size;
+            }
+            else {
+                auto first = route_detail::ParseDecimal(spec.substr(0, dash));
+                auto last = dash + 1 == spec.size()
+                    ? std::optional<uint64_t>(std::numeric_limits<uint64_t>::max()) : route_detail::ParseDecimal(spec.substr(dash + 1));
+                if (!first || !last || *last < *first) {
+                    return ByteRanges{};
+                }
+                has_specs = true;
+                if (*first >= size) {
+                    continue;
+                }
+                offset = *first;
+                end = std::min(*last, size - 1) + 1;
+            }
+
+            if (result.count == result.ranges.size()) {
+                return ByteRanges{};
+            }
+            result.ranges[result.count++] = ByteRange{ offset, end - offset };
+        }
+
+        if (!has_specs) {
+            return ByteRanges{};
+        }
+        result.status = result.count != 0 ? ByteRanges::Status::partial : ByteRanges::Status::unsatisfiable;
+        return result;
+    }
+
+    /*
+    * Возвращает значение аргумента строки запроса до '&', std::nullopt если аргумента нет.
+    * param задаётся вместе с '=', например "token=". Аргумент ищется только в начале строки запроса
+    * или сразу после '&', поэтому "xtoken=..." и значение "foo=token=..." за аргумент не принимаются.
+    */
+    constexpr std::optional<std::string_view> FindQueryParam(std::string_view query, std::string_view param) {
+        while (!query.empty()) {
+            size_t amp = query.find('&');
+            std::string_view arg = query.substr(0, amp);
+            if (arg.substr(0, param.size()) == param) {
+                return arg.substr(param.size());
+            }
+            query.remove_prefix(amp == std::string_view::npos ? query.size() : amp + 1);
+        }
+        return std::nullopt;
+    }
+
+    // версии состояния из строки запроса /v1/game/state?afterVersion=N&baseVersion=M
+    struct StateQuery {
+        std::optional<uint64_t> after_version;     // ждать тика, сменившего эту версию
+        std::optional<uint64_t> base_version;      // ответить разностью относительно этой версии
+    };
+
+    /*
+    * Разбирает аргументы afterVersion и baseVersion строки запроса к /v1/game/state.
+    * Возвращает std::nullopt, если нет ни одного из них или значение заданного аргумента - не десятичное число.
+    */
+    constexpr std::optional<StateQuery> ParseStateQuery(std::string_view query) {
+        StateQuery result;
+
+        auto after = FindQueryParam(query, "afterVersion="sv);
+        if (after && !(result.after_version = route_detail::ParseDecimal(*after))) {
+            return std::nullopt;
+        }
+        auto base = FindQueryParam(query, "baseVersion="sv);
+        if (base && !(result.base_version = route_detail::ParseDecimal(*base))) {
+            return std::nullopt;
+        }
+
+        if (!after && !base) {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    namespace route_detail {
+
+        // убирает пробелы и табуляции по краям строки
+        constexpr std::string_view TrimSpaces(std::string_view line) {
+            while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) {
+                line.remove_prefix(1);
+            }
+            while (!line.empty() && (line.back() == ' ' || line.back() == '\t')) {
+                line.remove_suffix(1);
+            }
+            return line;
+        }
+
+        // сравнивает строки без учёта регистра латинских букв
+        constexpr bool EqualsNoCase(std::string_view lhs, std::string_view rhs) {
+            if (lhs.size() != rhs.size()) {
+                return false;
+            }
+            for (size_t i = 0; i != lhs.size(); ++i) {
+                char l = lhs[i] >= 'A' && lhs[i] <= 'Z' ? static_cast<char>(lhs[i] - 'A' + 'a') : lhs[i];
+                char r = rhs[i] >= 'A' && rhs[i] <= 'Z' ? static_cast<char>(rhs[i] - 'A' + 'a') : rhs[i];
+                if (l != r) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /*
+        * Разбирает вес q из параметров кодирования после ';' в тысячных долях, без параметра q вес равен 1000.
+        * Значение задаётся по RFC 9110: "0", "0.5", "0.125", "1", "1.000". Прочие значения, например "." или "2",
+        * дают std::nullopt.
+        */
+        constexpr std::optional<int> ParseQValue(std::string_view params) {
+            int weight = 1000;
+            while (!params.empty()) {
+                size_t semicolon = params.find(';');
+                std::string_view param = TrimSpaces(params.substr(0, semicolon));
+                params.remove_prefix(semicolon == std::string_view::npos ? params.size() : semicolon + 1);
+                if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=') {
+                    continue;
+                }
+
+                std::string_view value = param.substr(2);
+                if (value.empty() || (value[0] != '0' && value[0] != '1')) {
+                    return std::nullopt;
+                }
+                weight = (value[0] - '0') * 1000;
+                if (value.size() > 1) {
+                    if (value[1] != '.' || value.size() > 5) {
+                        return std::nullopt;
+                    }
+                    int scale = 100;
+                    for (size_t i = 2; i != value.size(); ++i, scale /= 10) {
+                        if (value[i] < '0' || value[i] > '9') {
+                            return std::nullopt;
+                        }
+                        weight += (value[i] - '0') * scale;
+                    }
+                }
+                if (weight > 1000) {
+                    return std::nullopt;
+                }
+            }
+            return weight;
+        }
+
+    } // namespace route_detail
+
+    /*
+    * Подтверждает, что значение заголовка Accept-Encoding разрешает ответ, сжатый gzip.
+    * Просматривается весь список: явный вес gzip или x-gzip важнее веса '*', поэтому "*, gzip;q=0" gzip запрещает,
+    * а "gzip;q=0.5, *;q=0" разрешает. Кодирования с неразборчивым весом пропускаются.
+    */
+    constexpr bool AcceptsGzipCoding(std::string_view codings) {
+        std::optional<int> gzip_weight;
+        std::optional<int> any_weight;
+        while (!codings.empty()) {
+            // отделяем очередное кодирование вместе с параметрами после ';'
+            size_t comma = codings.find(',');
+            std::string_view coding = codings.substr(0, comma);
+            codings.remove_prefix(comma == std::string_view::npos ? codings.size() : comma + 1);
+
+            size_t semicolon = coding.find(';');
+            auto weight = route_detail::ParseQValue(semicolon == std::string_view::npos ? ""sv : coding.substr(semicolon + 1));
+            coding = route_detail::TrimSpaces(coding.substr(0, semicolon));
+            if (!weight) {
+                continue;
+            }
+
+            if (route_detail::EqualsNoCase(coding, "gzip"sv) || route_detail::EqualsNoCase(coding, "x-gzip"sv)) {
+                gzip_weight = std::max(gzip_weight.value_or(0), *weight);
+            }
+            else if (coding == "*"sv) {
+                any_weight = std::max(any_weight.value_or(0), *weight);
+            }
+        }
+        return gzip_weight ? *gzip_weight > 0 : any_weight.value_or(0) > 0;
+    }
+
+}  // namespace http_handler
@@ -1,5 +1,12 @@
 ﻿#include "resource_handler.h"
 
+#include <boost/beast/zlib/deflate_stream.hpp>
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 
 namespace resource_handler {
@@ -26,16 +33,33 @@ namespace resource_handler {
 		// также обновляем записи в словарях для быстрого поиска
 		_name_to_data_ptr.insert( { ref._name, &ref });
 		_path_to_data_ptr.insert({ ref._path, &ref });
+
+		// файлы дополнительно индексируются по пути от корня, по нему ищутся запросы к статике
+		if (ref._type != ResourceType::root && ref._type != ResourceType::folder) {
+			std::string_view relative = std::string_view(ref._path).substr(GetRootPath().size());
+			if (!relative.empty() && relative.front() == '/') {
+				relative.remove_prefix(1);      // корень мог быть задан без завершающего слеша
+			}
+			_relative_to_data_ptr.insert({ relative, &ref });
+		}
 	}
 
 	// возвращает указатель на данные по имени файла
 	ResourcePtr ResourceHandler::GetItem(std::string_view file_name) const {
-		return !Count(file_name) ? nullptr : _name_to_data_ptr.at(file_name);
+		auto it = _name_to_data_ptr.find(file_name);
+		return it == _name_to_data_ptr.end() ? nullptr : it->second;
 	}
 
 	// возвращает указатель на данные по пути к файлу
 	ResourcePtr ResourceHandler::GetItem(const fs::path& file_path) const {
-		return !Count(file_path) ? nullptr : _path_to_data_ptr.at(file_path.generic_string());
+		auto it = _path_to_data_ptr.find(file_path.generic_string());
+		return it == _path_to_data_ptr.end() ? nullptr : it->second;
+	}
+
+	// возвращает файл по пути относительно корня без ведущего слеша, один поиск без выделения памяти
+	ResourcePtr ResourceHandler::FindFile(std::string_view relative_path) const {
+		auto it = _relative_to_data_ptr.find(relative_path);
+		return it == _relative_to_data_ptr.end() ? nullptr : it->second;
 	}
 
 	// подтверждает наличие файла по имени
@@ -48,6 +72,50 @@ namespace resource_handler {
 		return _path_to_data_ptr.count(file_path.generic_string());
 	}
 
+	// загружает в память файлы, укладывающиеся в бюджет байт, и готовит для них вариант, сжатый gzip
+	uint64_t ResourceHandler::PreloadFiles(uint64_t budget) {
+		// собираем размеры файлов, меньшие файлы кешируем первыми, так в бюджет попадает больше файлов
+		std::vector<std::pair<uint64_t, ResourcePtr>> files;
+		for (auto& item : _resource_base) {
+			if (item._type == ResourceType::root || item._type == ResourceType::folder) {
+				continue;
+			}
+			std::error_code ec;
+			if (uint64_t size = fs::file_size(item._path, ec); !ec) {
+				files.emplace_back(size, &item);
+			}
+		}
+		std::stable_sort(files.begin(), files.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.first < rhs.first;
+		});
+
+		uint64_t used = 0;
+		for (auto [size, item] : files) {
+			if (size > budget - used) {
+				break;
+			}
+
+			std::string content(size, '\0');
+			if (std::ifstream file(item->_path, std::ios::binary); !file.read(content.data(), content.size())) {
+				std::cerr << "Failed to preload file " << item->_path << std::endl;
+				continue;
+			}
+			used += size;
+
+			if (detail::IsCompressible(item->_type)) {
+				std::string gzip = detail::GzipCompress(content);
+				if (detail::IsGzipWorthwhile(content.size(), gzip.size()) && gzip.size() <= budget - used) {
+					used += gzip.size();
+					item->_gzip_content = std::make_shared<const std::string>(std::move(gzip));
+					item->_gzip_etag = detail::MakeContentETag(item->_content_hash, "-gzip");
+				}
+			}
+			item->_content = std::make_shared<const std::string>(std::move(content));
+		}
+
+		return used;
+	}
+
 	void ResourceHandler::SetRoot(const fs::path& file_path) {
 		//  в данную функцию должен придти путь к основному руту с файлами
 		if (!fs::is_directory(file_path)) {
@@ -116,6 +184,10 @@ namespace resource_handler {
 				file._path = dir_entry.path().generic_string();
 				file._name = dir_entry.path().filename().string();
 				file._type = ParseFileExtension(file._name);
+				// валидаторы для условных запросов считаются один раз при индексации, статика до перезапуска не меняется
+				file._content_hash = detail::HashFileContent(dir_entry.path());
+				file._etag = detail::MakeContentETag(file._content_hash);
+				file._last_modified = detail::FormatHttpDate(dir_entry.last_write_time());
 				// добавляем запись о файле
 				AddItem(std::move(file));
 			}
@@ -135,6 +207,112 @@ namespace resource_handler {
 			return resource_handler::ResourceHandler(path_line);
 		}
 
+		// сжимает данные в формат gzip (RFC 1952) встроенным в boost.beast deflate
+		std::string GzipCompress(std::string_view data) {
+			namespace zlib = boost::beast::zlib;
+
+			// заголовок gzip: сигнатура, метод deflate, без флагов и времени, ОС unix
+			std::string result = { '\x1f', '\x8b', '\x08', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\x03' };
+			const size_t header_size = result.size();
+
+			zlib::deflate_stream stream;
+			// поток beast пишет deflate без обёртки zlib, заголовок и концевик gzip добавляются вручную
+			stream.reset(6, 15, 8, zlib::Strategy::normal);
+			result.resize(header_size + stream.upper_bound(data.size()));
+
+			zlib::z_params params;
+			params.next_in = data.data();
+			params.avail_in = data.size();
+			params.next_out = result.data() + header_size;
+			params.avail_out = result.size() - header_size;
+
+			boost::system::error_code ec;
+			stream.write(params, zlib::Flush::finish, ec);
+			if (ec && ec != zlib::error::end_of_stream) {
+				throw std::runtime_error("ResourceHandler::GzipCompress::Error::" + ec.message());
+			}
+			result.resize(header_size + params.total_out);
+
+			// концевик gzip: CRC-32 и размер исходных данных по модулю 2^32, оба little-endian
+			boost::crc_32_type crc;
+			crc.process_bytes(data.data(), data.size());
+			for (uint32_t value : { static_cast<uint32_t>(crc.checksum()), static_cast<uint32_t>(data.size()) }) {
+				for (int i = 0; i != 4; ++i) {
+					result.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+				}
+			}
+			return result;
+		}
+
+		// считает FNV-1a 64 содержимого файла, файл читается блоками
+		uint64_t HashFileContent(const fs::path& file_path) {
+			uint64_t hash = 14695981039346656037ull;
+
+			std::ifstream file(file_path, std::ios::binary);
+			char block[64 * 1024];
+			while (file.read(block, sizeof(block)) || file.gcount() > 0) {
+				for (std::streamsize i = 0; i != file.gcount(); ++i) {
+					hash = (hash ^ static_cast<unsigned char>(block[i])) * 1099511628211ull;
+				}
+			}
+			return hash;
+		}
+
+		// собирает строгий ETag из хеша содержимого: "<16 hex><suffix>"
+		std::string MakeContentETag(uint64_t hash, std::string_view suffix) {
+			char buffer[20];
+			int size = std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+
+			std::string etag = "\"";
+			etag.append(buffer, static_cast<size_t>(size)).append(suffix).push_back('"');
+			return etag;
+		}
+
+		// переводит время изменения файла в HTTP-date: "Sun, 06 Nov 1994 08:49:37 GMT"
+		std::string FormatHttpDate(fs::file_time_type time) {
+			// названия дней и месяцев не зависят от локали, поэтому strftime не используется
+			static const char* const __WEEK_DAYS__[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+			static const char* const __MONTHS__[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+				"Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+			auto sys_time = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::file_clock::to_sys(time));
+			auto days = std::chrono::floor<std::chrono::days>(sys_time);
+			std::chrono::year_month_day date{ days };
+			std::chrono::hh_mm_ss clock{ sys_time - days };
+			std::chrono::weekday week_day{ days };
+
+			char buffer[32];
+			int size = std::snprintf(buffer, sizeof(buffer), "%s, %02u %s %04d %02d:%02d:%02d GMT",
+				__WEEK_DAYS__[week_day.c_encoding()], static_cast<unsigned>(date.day()),
+				__MONTHS__[static_cast<unsigned>(date.month()) - 1], static_cast<int>(date.year()),
+				static_cast<int>(clock.hours().count()), static_cast<int>(clock.minutes().count()),
+				static_cast<int>(clock.seconds().count()));
+			return std::string(buffer, static_cast<size_t>(size));
+		}
+
+		// подтверждает, что сжатый вариант хотя бы на восьмую часть меньше исходного и его стоит хранить
+		bool IsGzipWorthwhile(uint64_t size, uint64_t gzip_size) {
+			return gzip_size + gzip_size / 8 < size;
+		}
+
+		// подтверждает, что файл такого типа имеет смысл сжимать, уже сжатые форматы пропускаются
+		bool IsCompressible(ResourceType type) {
+			switch (type)
+			{
+			case ResourceType::png:
+			case ResourceType::jpg:
+			case ResourceType::jpe:
+			case ResourceType::jpeg:
+			case ResourceType::gif:
+			case ResourceType::svgz:
+			case ResourceType::mp3:
+				return false;
+
+			default:
+				return true;
+			}
+		}
+
 	} // namespace detail
 
 } // namespace resourse_handler
\ No newline at end of file
@@ -30,6 +30,16 @@ namespace resource_handler {
 		ResourcePtr GetItem(std::string_view file_name) const;
 		// возвращает указатель на данные по пути к файлу
 		ResourcePtr GetItem(const fs::path& file_path) const;
+		// возвращает файл по пути относительно корня без ведущего слеша, один поиск без выделения памяти
+		ResourcePtr FindFile(std::string_view relative_path) const;
+
+		/*
+		* Загружает в память файлы, укладывающиеся в бюджет байт, и готовит для них вариант, сжатый gzip.
+		* Меньшие файлы загружаются первыми, сжатый вариант тоже расходует бюджет.
+		* Вызывается один раз при старте, до начала работы потоков сервера: после загрузки записи не меняются
+		* и читаются из всех потоков без блокировок. Возвращает число байт, занятых кешем.
+		*/
+		uint64_t PreloadFiles(uint64_t budget);
 
 		// подтверждает наличие файла по имени
 		bool Count(std::string_view file_name) const;
@@ -41,6 +51,8 @@ namespace resource_handler {
 
 		FileIndexNameToPath _name_to_data_ptr;
 		FileIndexPathToName _path_to_data_ptr;
+		// файлы по пути относительно корня, ключи указывают в _path записей
+		FileIndexPathToName _relative_to_data_ptr;
 
 		void SetRoot(const fs::path& file_path);
 		// парсит расширение файла и возвращает тип
@@ -52,6 +64,18 @@ namespace resource_handler {
 	namespace detail {
 		// базовый препроцессор-индексатор файлов
 		resource_handler::ResourceHandler LoadFiles(const char* file_path);
+		// сжимает данные в формат gzip (RFC 1952) встроенным в boost.beast deflate
+		std::string GzipCompress(std::string_view data);
+		// подтверждает, что сжатый вариант хотя бы на восьмую часть меньше исходного и его стоит хранить
+		bool IsGzipWorthwhile(uint64_t size, uint64_t gzip_size);
+		// подтверждает, что файл такого типа имеет смысл сжимать, уже сжатые форматы пропускаются
+		bool IsCompressible(ResourceType type);
+		// считает FNV-1a 64 содержимого файла, файл читается блоками
+		uint64_t HashFileContent(const fs::path& file_path);
+		// собирает строгий ETag из хеша содержимого: "<16 hex><suffix>"
+		std::string MakeContentETag(uint64_t hash, std::string_view suffix = {});
+		// переводит время изменения файла в HTTP-date: "Sun, 06 Nov 1994 08:49:37 GMT"
+		std::string FormatHttpDate(fs::file_time_type time);
 
 	} // namespace detail
 
@@ -0,0 +1,127 @@
+#include "rng.h"
+
+#include <atomic>
+#include <bit>
+#include <random>
+
+namespace model {
+
+    namespace {
+
+        std::atomic<bool> global_seed_set{ false };
+        std::atomic<uint64_t> global_seed{ 0 };
+        // порядковый номер очередного генератора, созданного при заданном глобальном зерне
+        std::atomic<uint64_t> local_ordinal{ 0 };
+        // генератор, подменённый через Rng::Scope в текущем потоке
+        thread_local Rng* scoped_rng = nullptr;
+
+        // splitmix64, рекомендованный способ развернуть одно число в состояние xoshiro
+        uint64_t SplitMix64(uint64_t& x) {
+            uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t MakeLocalSeed() {
+            if (global_seed_set.load(std::memory_order_acquire)) {
+                return global_seed.load(std::memory_order_relaxed)
+                    + local_ordinal.fetch_add(1, std::memory_order_relaxed) * 0xD1B54A32D192ED03ull;
+            }
+            std::random_device rd;
+            return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+        }
+
+    } // namespace
+
+    Rng::Scope::Scope(Rng& rng)
+        : previous_(scoped_rng) {
+        scoped_rng = &rng;
+    }
+
+    Rng::Scope::~Scope() {
+        scoped_rng = previous_;
+    }
+
+    Rng::Rng(uint64_t seed) {
+        Seed(seed);
+    }
+
+    Rng& Rng::Local() {
+        if (scoped_rng) {
+            return *scoped_rng;
+        }
+        thread_local Rng rng{ MakeLocalSeed() };
+        return rng;
+    }
+
+    uint64_t Rng::StreamSeed(uint64_t stream) {
+        if (global_seed_set.load(std::memory_order_acquire)) {
+            uint64_t x = global_seed.load(std::memory_order_relaxed) ^ (stream * 0xA0761D6478BD642Full);
+            return SplitMix64(x);
+        }
+        return Local()();
+    }
+
+    void Rng::SetGlobalSeed(uint64_t seed) {
+        global_seed.store(seed, std::memory_order_relaxed);
+        local_ordinal.store(0, std::memory_order_relaxed);
+        global_seed_set.store(true, std::memory_order_release);
+    }
+
+    std::optional<uint64_t> Rng::GetGlobalSeed() {
+        if (global_seed_set.load(std::memory_order_acquire)) {
+            return global_seed.load(std::memory_order_relaxed);
+        }
+        return std::nullopt;
+    }
+
+    void Rng::Seed(uint64_t seed) {
+        for (auto& word : state_) {
+            word = SplitMix64(seed);
+        }
+    }
+
+    uint64_t Rng::operator()() {
+        const uint64_t result = std::rotl(state_[1] * 5, 7) * 9;
+        const uint64_t t = state_[1] << 17;
+
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = std::rotl(state_[3], 45);
+
+        return result;
+    }
+
+    int Rng::NextInteger(int from, int to) {
+        if (to <= from) {
+            return from;
+        }
+        // диапазон переводим в беззнаковый, чтобы не переполниться на [INT_MIN, INT_MAX]
+        const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(to) - from) + 1;
+        // умножение со сдвигом (Lemire) с отбраковкой, чтобы распределение было равномерным
+        unsigned __int128 product = static_cast<unsigned __int128>((*this)()) * range;
+        uint64_t low = static_cast<uint64_t>(product);
+        if (low < range) {
+            const uint64_t threshold = -range % range;
+            while (low < threshold) {
+                product = static_cast<unsigned __int128>((*this)()) * range;
+                low = static_cast<uint64_t>(product);
+            }
+        }
+        return static_cast<int>(from + static_cast<int64_t>(product >> 64));
+    }
+
+    double Rng::NextDouble() {
+        // старшие 53 бита в мантиссу
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    double Rng::NextDouble(double from, double to) {
+        return from + (to - from) * NextDouble();
+    }
+
+} // namespace model
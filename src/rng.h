@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace model {
+
+    /**
+     * Быстрый генератор псевдослучайных чисел xoshiro256** для игровой модели.
+     * У каждого потока свой экземпляр (см. Rng::Local), поэтому выдача числа не требует
+     * ни блокировок, ни обращения к std::random_device, а состояние занимает 32 байта.
+     * Если задано глобальное зерно (Rng::SetGlobalSeed), генераторы потоков засеваются
+     * детерминированно: из зерна и порядкового номера потока, в котором генератор создан.
+     * Без зерна каждый генератор один раз засевается из std::random_device.
+     * Rng::Scope подменяет генератор потока на время работы, так игровая сессия тратит
+     * случайные числа из собственного генератора, независимо от того, в каком потоке она исполняется.
+     *
+     * Пример:
+     *
+     *  model::Rng::SetGlobalSeed(42);            // до запуска рабочих потоков
+     *  int road = model::Rng::Local().NextInteger(0, 9);
+     */
+    class Rng {
+    public:
+        using result_type = uint64_t;
+
+        // подменяет генератор потока на переданный до конца области видимости
+        class Scope {
+        public:
+            explicit Scope(Rng& rng);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            Rng* previous_;
+        };
+
+        explicit Rng(uint64_t seed);
+
+        // возвращает генератор текущего потока, или подменённый через Rng::Scope
+        static Rng& Local();
+        /*
+        * Возвращает зерно для отдельного потока случайных чисел с номером stream.
+        * При заданном глобальном зерне результат зависит только от него и номера потока,
+        * иначе зерно берётся из генератора текущего потока.
+        */
+        static uint64_t StreamSeed(uint64_t stream);
+
+        // назначает глобальное зерно для генераторов, которые будут созданы после вызова
+        static void SetGlobalSeed(uint64_t seed);
+        // возвращает глобальное зерно, если оно было назначено
+        static std::optional<uint64_t> GetGlobalSeed();
+
+        // перезасевает генератор
+        void Seed(uint64_t seed);
+
+        // возвращает следующее 64-битное случайное число
+        uint64_t operator()();
+
+        // возвращает случайное целое число в диапазоне from -> to включительно
+        int NextInteger(int from, int to);
+        // возвращает случайное вещественное число в диапазоне [0.0, 1.0)
+        double NextDouble();
+        // возвращает случайное вещественное число в диапазоне [from, to)
+        double NextDouble(double from, double to);
+
+        static constexpr uint64_t min() { return 0; }
+        static constexpr uint64_t max() { return UINT64_MAX; }
+
+    private:
+        uint64_t state_[4];
+    };
+
+}  // namespace model
@@ -78,24 +78,69 @@ namespace game_handler {
 
 	//  ,    
 	SerialHandler& SerialHandler::SerializeGameData(const fs::path& path) {
+		/* 1.         */
+		return WriteBackupData(MakeSessionsVector(game_->GetSessions()), path);
+	}
 
-		std::fstream stream;      //     
-		//        
-		if (OpenBackupOutputFile(stream, path)) {
+	//     ,     
+	SerialHandler& SerialHandler::SerializeGameData(std::ostream& stream) {
+		std::lock_guard func_lock(mutex_);
+		WriteBackupArchive(MakeSessionsVector(game_->GetSessions()), stream);
+		return *this;
+	}
+
+	//      ,       ,
+	//     ,   
+	SerialHandler& SerialHandler::AsyncSerializeGameData() {
+
+		//      ,    
+		if (temp_path_.empty()) {
+			return *this;
+		}
 
-			/* 1.      */
-			sessions_ = MakeSessionsVector(game_->GetSessions());
+		const GameSessionList& sessions = game_->GetSessions();
+		if (sessions.empty()) {
+			//    ,    
+			return SerializeGameData();
+		}
 
-			/* 2.    */
-			boost::archive::binary_oarchive ar{stream};
+		auto snapshot = std::make_shared<SessionsSnapshot>();
+		snapshot->left_ = sessions.size();
 
-			/* 3.     */
-			ar << sessions_count_;
+		for (const auto& [id, session] : sessions) {
+			net::dispatch(session->GetStrand(), [this, snapshot, session]() {
+				try
+				{
+					SerializedSession serialized{ *session };
 
-			/* 4.      */
-			for (const auto& session : sessions_) {
-				ar << session;
-			}
+					std::lock_guard snapshot_lock(snapshot->mutex_);
+					snapshot->sessions_.push_back(std::move(serialized));
+
+					if (--snapshot->left_ == 0) {
+						//     
+						WriteBackupData(std::move(snapshot->sessions_), temp_path_);
+					}
+				}
+				catch (const std::exception& e)
+				{
+					logger_handler::LogException(e);
+				}
+			});
+		}
+
+		return *this;
+	}
+
+	//      
+	SerialHandler& SerialHandler::WriteBackupData(std::vector<SerializedSession>&& sessions, const fs::path& path) {
+
+		std::lock_guard func_lock(mutex_);
+		std::fstream stream;      //     
+		//        
+		if (OpenBackupOutputFile(stream, path)) {
+
+			/* 2. - 4.    */
+			WriteBackupArchive(std::move(sessions), stream);
 
 			/* 5.      */
 			CloseBackupFile(stream);
@@ -107,6 +152,24 @@ namespace game_handler {
 		return *this;
 	}
 
+	//      
+	void SerialHandler::WriteBackupArchive(std::vector<SerializedSession>&& sessions, std::ostream& stream) {
+
+		sessions_ = std::move(sessions);
+		sessions_count_ = sessions_.size();
+
+		/* 2.    */
+		boost::archive::binary_oarchive ar{stream};
+
+		/* 3.     */
+		ar << sessions_count_;
+
+		/* 4.      */
+		for (const auto& session : sessions_) {
+			ar << session;
+		}
+	}
+
 	//     
 	SerialHandler& SerialHandler::DeserializeGameData() {
 		return DeserializeGameData(main_path_);
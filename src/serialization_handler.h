@@ -110,12 +110,24 @@ namespace game_handler {
 		SerialHandler& SerializeGameData();
 		// выполняет сериализацию, запись данных в бекап
 		SerialHandler& SerializeGameData(const fs::path&);
+		// выполняет сериализацию в переданный поток, без временного файла и переименования
+		SerialHandler& SerializeGameData(std::ostream&);
+		// выполняет сериализацию во время работы сервера, снимок каждой сессии делается в её стренде,
+		// запись в файл выполняет сессия, последней завершившая снимок
+		SerialHandler& AsyncSerializeGameData();
 		// выполняет восстановление данных из бекапа
 		SerialHandler& DeserializeGameData();
 		// выполняет восстановление данных из бекапа
 		SerialHandler& DeserializeGameData(const fs::path&);
 
 	private:
+		// снимок игровых сессий, собираемый из стрендов сессий
+		struct SessionsSnapshot {
+			std::mutex mutex_;
+			size_t left_ = 0;                              // количество сессий, ещё не сделавших снимок
+			std::vector<SerializedSession> sessions_;
+		};
+
 		fs::path main_path_;
 		fs::path temp_path_;
 		std::shared_ptr<GameHandler> game_;
@@ -128,6 +140,10 @@ namespace game_handler {
 		SerialHandler& UploadBackupData();
 		// создаёт вектор с запущенными в игре игровыми сессиями
 		std::vector<SerializedSession> MakeSessionsVector(const GameSessionList&);
+		// записывает переданные сессии в файл бекапа
+		SerialHandler& WriteBackupData(std::vector<SerializedSession>&& sessions, const fs::path&);
+		// записывает переданные сессии архивом в поток
+		void WriteBackupArchive(std::vector<SerializedSession>&& sessions, std::ostream&);
 
 		// открывает файл для записи
 		bool OpenBackupOutputFile(std::fstream&, fs::path);
@@ -1,18 +1,33 @@
 ﻿#include "token.h"
 
 #include <iomanip>                   // для работы std::hex
+#include <random>
 #include <sstream>
 
 namespace game_handler {
 
 	namespace detail {
 
+		namespace {
+
+			// генератор токенов потока, засеянный из std::random_device
+			// не зависит от зерна игровой модели, поэтому токены нельзя вычислить по журналу воспроизведения
+			std::mt19937_64& TokenGenerator() {
+				thread_local std::mt19937_64 generator{ [] {
+					std::random_device device;
+					return (uint64_t{ device() } << 32) | device();
+				}() };
+				return generator;
+			}
+
+		}  // namespace
+
 		uint64_t GenerateLowerTokenPart() {
-			return __LOWER_GENERATOR__();
+			return TokenGenerator()();
 		}
 
 		uint64_t GenerateUpperTokenPart() {
-			return __UPPER_GENERATOR__();
+			return TokenGenerator()();
 		}
 		
 		std::string GenerateToken32Hex() {
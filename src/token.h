@@ -1,7 +1,7 @@
 ﻿#pragma once
 
 #include <string>
-#include <random>
+#include <cstdint>
 #include "tagged.h"
 
 using namespace std::literals;
@@ -10,18 +10,8 @@ namespace game_handler {
 
 	namespace detail {
 
-		static std::random_device __RANDOM_DEVICE__;
-
-		static std::mt19937_64 __LOWER_GENERATOR__{ [] {
-			std::uniform_int_distribution<std::mt19937_64::result_type> dist;
-			return dist(__RANDOM_DEVICE__);
-		}() };
-
-		static std::mt19937_64 __UPPER_GENERATOR__{ [] {
-			std::uniform_int_distribution<std::mt19937_64::result_type> dist;
-			return dist(__RANDOM_DEVICE__);
-		}() };
-
+		// части токена берутся из отдельного генератора потока, засеянного из std::random_device,
+		// зерно игровой модели (--random-seed) на токены не влияет
 		uint64_t GenerateLowerTokenPart();
 
 		uint64_t GenerateUpperTokenPart();
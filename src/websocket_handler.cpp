@@ -0,0 +1,228 @@
+#include "websocket_handler.h"
+#include "logger_handler.h"
+#include "request_router.h"
+
+namespace websocket_handler {
+
+    static const std::string_view __PARAM_TOKEN__ = "token="sv;
+
+    // выполняет переход на WebSocket и подписывает канал на состояние сессии игрока
+    void GameChannel::Run(http_handler::StringRequest&& request, std::shared_ptr<game::GameSession> session) {
+        session_ = std::move(session);
+        // подписка держит канал по weak_ptr, текущее состояние придёт сразу после перехода
+        game_->SubscribeStateChannel(session_, token_, weak_from_this());
+
+        // таймаут tcp_stream заменяется встроенными в websocket пингами простоя
+        beast::get_lowest_layer(ws_).expires_never();
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.read_message_max(__CHANNEL_MESSAGE_MAX_SIZE__);
+
+        // запрос должен жить до завершения перехода
+        upgrade_request_ = std::move(request);
+        ws_.async_accept(upgrade_request_, beast::bind_front_handler(&GameChannel::OnAccept, shared_from_this()));
+    }
+
+    // получает состояние из стренда сессии, отправка выполняется в стренде соединения
+    void GameChannel::PushState(std::shared_ptr<const std::string> state, [[maybe_unused]] uint64_t version) {
+        net::post(ws_.get_executor(), [self = shared_from_this(), state = std::move(state)]() mutable {
+            // неотправленное состояние просто заменяется новым
+            self->pending_state_ = std::move(state);
+            self->Write();
+        });
+    }
+
+    // получает удаление игрока из стренда сессии, закрытие выполняется в стренде соединения
+    void GameChannel::PlayerRemoved() {
+        net::post(ws_.get_executor(), [self = shared_from_this()]() {
+            // игрок выбыл по простою, неотправленное состояние уже не нужно
+            self->pending_state_.reset();
+            self->Close(websocket::close_code::normal, "Player has left the game session"sv);
+        });
+    }
+
+    void GameChannel::OnAccept(beast::error_code ec) {
+        upgrade_request_ = {};
+        if (ec) {
+            return logger_handler::LogError(ec, "websocket accept"sv);
+        }
+
+        accepted_ = true;
+        // состояние могло прийти из сессии раньше, чем закончился переход
+        Write();
+        Read();
+    }
+
+    void GameChannel::Read() {
+        buffer_.clear();
+        ws_.async_read(buffer_, beast::bind_front_handler(&GameChannel::OnRead, shared_from_this()));
+    }
+
+    void GameChannel::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+        if (ec == websocket::error::closed) {
+            // нормальная ситуация - клиент закрыл канал
+            return;
+        }
+        if (ec) {
+            return logger_handler::LogError(ec, "websocket read"sv);
+        }
+
+        // ParseTextToJSON читает строку до нуля, поэтому сообщение копируется в std::string
+        HandleMessage(beast::buffers_to_string(buffer_.data()));
+        Read();
+    }
+
+    // выполняет команду движения или подтверждение версии в стренде сессии
+    void GameChannel::HandleMessage(std::string_view message) {
+        game::PlayerMove move = game::PlayerMove::STAY;
+        try
+        {
+            json::value body = json_detail::ParseTextToJSON(message);
+            if (body.as_object().count("ack")) {
+                // подтверждение версии, которую клиент применил к своему состоянию
+                int64_t version = body.as_object().at("ack").as_int64();
+                if (version < 0) {
+                    throw std::invalid_argument("GameChannel::HandleMessage::Error::Negative version");
+                }
+                net::dispatch(session_->GetStrand(), [self = shared_from_this(), version]() {
+                    self->game_->AckStateChannel(*self->session_, self.get(), static_cast<uint64_t>(version));
+                });
+                return;
+            }
+
+            // команда имеет тот же вид, что и тело запроса /v1/game/player/action
+            const auto& move_line = body.as_object().at("move").as_string();
+            if (!game::detail::CheckPlayerMove(move_line)) {
+                throw std::invalid_argument("GameChannel::HandleMessage::Error::Unknown move");
+            }
+            move = game::detail::ParsePlayerMove(move_line);
+        }
+        catch (const std::exception&)
+        {
+            // ответ сверх предела очереди отбрасывается, см. PendingMessages
+            pending_messages_.Push(json_detail::GetErrorString("invalidArgument"sv, "Failed to parse action or ack"sv));
+            return Write();
+        }
+
+        net::dispatch(session_->GetStrand(), [self = shared_from_this(), move]() {
+            if (!self->game_->ChannelPlayerAction(*self->session_, self->token_, move)) {
+                // игрок выбыл из сессии по простою или сессии сброшены
+                net::post(self->ws_.get_executor(), [self]() {
+                    self->Close(websocket::close_code::policy_error, "Player token has not been found"sv);
+                });
+            }
+        });
+    }
+
+    // начинает следующую запись, если соединение свободно
+    void GameChannel::Write() {
+        if (!accepted_ || writing_) {
+            return;
+        }
+
+        if (closing_) {
+            writing_ = true;
+            return ws_.async_close(close_reason_, [self = shared_from_this()](beast::error_code ec) {
+                if (ec) {
+                    logger_handler::LogError(ec, "websocket close"sv);
+                }
+            });
+        }
+
+        ws_.text(true);
+        if (!pending_messages_.Empty()) {
+            writing_ = true;
+            writing_message_ = pending_messages_.Pop();
+            return ws_.async_write(net::buffer(writing_message_),
+                beast::bind_front_handler(&GameChannel::OnWrite, shared_from_this()));
+        }
+
+        if (pending_state_) {
+            writing_ = true;
+            writing_state_ = std::move(pending_state_);
+            pending_state_.reset();
+            return ws_.async_write(net::buffer(*writing_state_),
+                beast::bind_front_handler(&GameChannel::OnWrite, shared_from_this()));
+        }
+    }
+
+    void GameChannel::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+        writing_ = false;
+        writing_state_.reset();
+
+        if (ec) {
+            return logger_handler::LogError(ec, "websocket write"sv);
+        }
+        Write();
+    }
+
+    // закрывает канал после завершения текущей записи
+    void GameChannel::Close(websocket::close_code code, std::string_view reason) {
+        if (closing_) {
+            return;
+        }
+        closing_ = true;
+        close_reason_ = websocket::close_reason(code, reason);
+        Write();
+    }
+
+    // проверяет токен запроса на переход к WebSocket и запускает канал игрока
+    void RunGameChannel(http_handler::StringRequest&& request, beast::tcp_stream&& stream,
+        std::shared_ptr<game::GameHandler> game) {
+
+        std::optional<std::string> token = detail::FindChannelToken(request);
+        if (!token) {
+            return RejectUpgrade(std::move(request), std::move(stream), http::status::unauthorized,
+                "invalidToken"sv, "Authorization header is missing"sv);
+        }
+
+        game::Token player_token{ std::move(*token) };
+        auto session = game->FindTokenSession(player_token);
+        if (!session) {
+            return RejectUpgrade(std::move(request), std::move(stream), http::status::unauthorized,
+                "unknownToken"sv, "Player token has not been found"sv);
+        }
+
+        auto channel = std::make_shared<GameChannel>(std::move(stream), std::move(game), std::move(player_token));
+        channel->Run(std::move(request), std::move(session));
+    }
+
+    // отвечает на запрос перехода к WebSocket ошибкой по HTTP и закрывает соединение
+    void RejectUpgrade(http_handler::StringRequest&& request, beast::tcp_stream&& stream,
+        http::status status, std::string_view code, std::string_view message) {
+
+        auto response = std::make_shared<http_handler::StringResponse>(status, request.version());
+        response->set(http::field::content_type, http_handler::ContentType::APP_JSON);
+        response->set(http::field::cache_control, "no-cache");
+        response->body() = json_detail::GetErrorString(code, message);
+        response->keep_alive(false);
+        response->prepare_payload();
+
+        // соединение и ответ живут в куче до окончания записи
+        auto safe_stream = std::make_shared<beast::tcp_stream>(std::move(stream));
+        http::async_write(*safe_stream, *response, [safe_stream, response](beast::error_code ec, std::size_t) {
+            if (ec) {
+                logger_handler::LogError(ec, "websocket reject"sv);
+            }
+            safe_stream->socket().shutdown(net::ip::tcp::socket::shutdown_send, ec);
+        });
+    }
+
+    namespace detail {
+
+        // возвращает токен запроса на переход к WebSocket из заголовка Authorization или параметра token=, или std::nullopt
+        std::optional<std::string> FindChannelToken(const http_handler::StringRequest& request) {
+            if (auto auth_iter = request.find(http::field::authorization); auth_iter != request.end()) {
+                return game::detail::BearerParser({ auth_iter->value().begin(), auth_iter->value().end() });
+            }
+
+            // параметр ищется только целым аргументом строки запроса, "xtoken=" и "foo=token=" не подходят
+            auto value = http_handler::FindQueryParam(http_handler::MatchRoute(request.target()).query, __PARAM_TOKEN__);
+            if (!value || value->size() != 32) {
+                return std::nullopt;
+            }
+            return std::string(*value);
+        }
+
+    }  // namespace detail
+
+}  // namespace websocket_handler
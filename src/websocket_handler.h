@@ -0,0 +1,137 @@
+#pragma once
+
+#include "game_handler.h"                      // подключит domain.h, boost_json.h и прочее
+
+#include <boost/beast/websocket.hpp>
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace websocket_handler {
+
+    using namespace std::literals;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    namespace websocket = beast::websocket;
+    namespace net = boost::asio;
+    namespace json = boost::json;
+    namespace game = game_handler;
+
+    // максимальный размер входящего сообщения, команда движения укладывается в пару десятков байт
+    static const size_t __CHANNEL_MESSAGE_MAX_SIZE__ = 1024;
+    // максимальное количество неотправленных ответов на ошибочные команды, лишние ответы отбрасываются
+    static const size_t __CHANNEL_PENDING_MESSAGES_MAX__ = 16;
+
+    /*
+    * Очередь ответов канала на ошибочные команды.
+    * Клиент, который не читает ответы, не должен раздувать очередь, поэтому сообщения
+    * сверх __CHANNEL_PENDING_MESSAGES_MAX__ отбрасываются.
+    */
+    class PendingMessages {
+    public:
+        // добавляет сообщение в конец очереди, false если очередь заполнена и сообщение отброшено
+        bool Push(std::string message) {
+            if (messages_.size() == __CHANNEL_PENDING_MESSAGES_MAX__) {
+                return false;
+            }
+            messages_.push_back(std::move(message));
+            return true;
+        }
+        // забирает первое сообщение очереди, очередь не должна быть пустой
+        std::string Pop() {
+            std::string message = std::move(messages_.front());
+            messages_.pop_front();
+            return message;
+        }
+
+        bool Empty() const {
+            return messages_.empty();
+        }
+        size_t Size() const {
+            return messages_.size();
+        }
+
+    private:
+        std::deque<std::string> messages_;
+    };
+
+    /*
+    * Канал WebSocket игрока, работает параллельно с REST API /v1/game/state и /v1/game/player/action.
+    * Токен проверяется один раз при переходе на WebSocket, дальше запросы не проходят авторизацию и маршрутизацию.
+    * Клиент присылает команды движения в формате тела /v1/game/player/action: {"move": "L"}.
+    * Сервер после каждого тика, сменившего состояние, присылает то же, что отдаёт /v1/game/state.
+    * Клиент может подтвердить применённую версию сообщением {"ack": N}, тогда вместо полного состояния
+    * приходит разность относительно N в формате /v1/game/state?baseVersion=N.
+    * Если клиент не успевает читать, промежуточные состояния пропускаются и уходит только последнее,
+    * а очередь ответов на ошибочные команды ограничена __CHANNEL_PENDING_MESSAGES_MAX__.
+    * Когда сессия удаляет игрока, канал закрывается с кодом normal.
+    * Все операции с соединением выполняются в стренде соединения, команды переносятся в стренд сессии.
+    */
+    class GameChannel : public game::StateSubscriber, public std::enable_shared_from_this<GameChannel> {
+    public:
+        GameChannel(beast::tcp_stream&& stream, std::shared_ptr<game::GameHandler> game, game::Token token)
+            : ws_(std::move(stream)), game_(std::move(game)), token_(std::move(token)) {
+        }
+
+        GameChannel(const GameChannel&) = delete;
+        GameChannel& operator=(const GameChannel&) = delete;
+
+        // выполняет переход на WebSocket и подписывает канал на состояние сессии игрока
+        void Run(http_handler::StringRequest&& request, std::shared_ptr<game::GameSession> session);
+        // получает состояние из стренда сессии, отправка выполняется в стренде соединения
+        void PushState(std::shared_ptr<const std::string> state, uint64_t version) override;
+        // получает удаление игрока из стренда сессии, закрытие выполняется в стренде соединения
+        void PlayerRemoved() override;
+
+    private:
+        websocket::stream<beast::tcp_stream> ws_;
+        std::shared_ptr<game::GameHandler> game_;
+        std::shared_ptr<game::GameSession> session_;
+        game::Token token_;
+        beast::flat_buffer buffer_;
+        http_handler::StringRequest upgrade_request_;            // запрос на переход, нужен до окончания перехода
+
+        std::shared_ptr<const std::string> pending_state_;       // последнее состояние, ждущее отправки
+        PendingMessages pending_messages_;                        // ответы на ошибочные команды
+        std::shared_ptr<const std::string> writing_state_;       // держит буфер состояния на время записи
+        std::string writing_message_;                             // сообщение на время записи
+        bool accepted_ = false;                                   // переход на WebSocket завершён
+        bool writing_ = false;                                    // идёт запись в соединение
+        bool closing_ = false;                                    // канал закрывается, новые записи не начинаются
+        websocket::close_reason close_reason_;                    // причина закрытия со стороны сервера
+
+        void OnAccept(beast::error_code ec);
+        void Read();
+        void OnRead(beast::error_code ec, std::size_t bytes_read);
+        // выполняет команду движения или подтверждение версии в стренде сессии
+        void HandleMessage(std::string_view message);
+        // начинает следующую запись, если соединение свободно
+        void Write();
+        void OnWrite(beast::error_code ec, std::size_t bytes_written);
+        // закрывает канал после завершения текущей записи
+        void Close(websocket::close_code code, std::string_view reason);
+    };
+
+    /*
+    * Проверяет токен запроса на переход к WebSocket и запускает канал игрока.
+    * Токен берётся из заголовка Authorization: Bearer <токен>, либо из параметра token=<токен>,
+    * так как браузерный WebSocket не умеет задавать заголовки. Значение параметра в лог запросов
+    * не пишется, см. logger_handler::detail::RedactTarget. Без токена отвечает 401 по HTTP.
+    */
+    void RunGameChannel(http_handler::StringRequest&& request, beast::tcp_stream&& stream,
+        std::shared_ptr<game::GameHandler> game);
+    // отвечает на запрос перехода к WebSocket ошибкой по HTTP и закрывает соединение
+    void RejectUpgrade(http_handler::StringRequest&& request, beast::tcp_stream&& stream,
+        http::status status, std::string_view code, std::string_view message);
+
+    namespace detail {
+
+        // возвращает токен запроса на переход к WebSocket из заголовка Authorization или параметра token=, или std::nullopt
+        std::optional<std::string> FindChannelToken(const http_handler::StringRequest& request);
+
+    }  // namespace detail
+
+}  // namespace websocket_handler
@@ -6,6 +6,8 @@
 #include <catch2/matchers/catch_matchers_predicate.hpp>
 
 #include <sstream>
+#include <memory>
+#include <tuple>
 
 using namespace std::literals;
 using namespace game_handler;
@@ -92,7 +94,7 @@ namespace Catch {
 */
 
 static const std::vector<Token> __TEST_TOKENS__ = {
-    Token{"first_token"}, Token{"second_token"}
+    Token{"first_token"}, Token{"second_token"}, Token{"third_token"}, Token{"fourth_token"}, Token{"fifth_token"}
 };
 
 class TestGameSession : public game_handler::CollisionProvider {
@@ -116,6 +118,13 @@ public:
         return *this;
     }
 
+    //            
+    inline TestGameSession& SetBroadphase(std::unique_ptr<CollisionBroadphase>&& broadphase) {
+        broadphase_ = std::move(broadphase);
+        broadphase_->Rebuild(*this);
+        return *this;
+    }
+
     // -----------------      ------------
 
     //         
@@ -136,13 +145,32 @@ public:
     const SessionLoots& GetLoots() const override {
         return loots_;
     }
+    //   ,   
+    const CollisionBroadphase* GetBroadphase() const override {
+        return broadphase_.get();
+    }
 
 private:
     SessionPlayers players_;
     SessionLoots loots_;
     model::Offices offices_;
+    std::unique_ptr<CollisionBroadphase> broadphase_;
 };
 
+//    ,   ,        
+static std::vector<CollisionEvent> SortEventsById(std::vector<CollisionEvent> events) {
+    std::sort(events.begin(), events.end(), [](const CollisionEvent& lhs, const CollisionEvent& rhs) {
+        return std::tie(**lhs.player_token, lhs.type, lhs.object_id) < std::tie(**rhs.player_token, rhs.type, rhs.object_id);
+    });
+    return events;
+}
+
+static bool EqualEventsSets(const std::vector<CollisionEvent>& lhs, const std::vector<CollisionEvent>& rhs) {
+    auto sorted_lhs = SortEventsById(lhs);
+    auto sorted_rhs = SortEventsById(rhs);
+    return std::equal(sorted_lhs.begin(), sorted_lhs.end(), sorted_rhs.begin(), sorted_rhs.end(), Catch::Comparator);
+}
+
 static const std::vector<model::LootType> __LOOT_TYPES__ = {
     model::LootType{"key", "assets/key.obj", "obj", 90, "#338844", 0.03, 10},
     model::LootType{"wallet", "assets/wallet.obj", "obj", 0, "#883344", 0.01, 30},
@@ -349,4 +377,65 @@ SCENARIO("TestCollisionProvider", "[TestCollisionProvider]") {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+SCENARIO("CollisionBroadphase", "[CollisionBroadphase]") {
+
+    GIVEN("A TestGameSesion with roads grid full of loot, offices and moving players") {
+
+        TestGameSession session;
+
+        //      x = 0, 10, 20  y = 0, 10, 20     
+        static const double __OFFSETS__[] = { -0.4, -0.2, 0.0, 0.2, 0.4 };
+        size_t loot_id = 0;
+        for (int line = 0; line <= 20; line += 10) {
+            for (int coord = 0; coord <= 20; ++coord) {
+                double offset = __OFFSETS__[coord % 5];
+                session.AddLoot(loot_id, GameLoot{ __LOOT_TYPES__[loot_id % 4], loot_id % 4, loot_id, { double(coord), line + offset } });
+                ++loot_id;
+                session.AddLoot(loot_id, GameLoot{ __LOOT_TYPES__[loot_id % 4], loot_id % 4, loot_id, { line + offset, double(coord) } });
+                ++loot_id;
+            }
+        }
+
+        session
+            .AddOffice(model::Office{ model::Office::Id{"Buro"}, {15, 0}, {5, 0} })
+            .AddOffice(model::Office{ model::Office::Id{"Buro"}, {10, 7}, {5, 0} })
+            .AddPlayer(&__TEST_TOKENS__[0],
+                std::move(Player{ 0, "Vasiliy", nullptr, 3 }.SetCurrentPosition(0, 0.3).SetFuturePosition(20.4, 0.3)))
+            .AddPlayer(&__TEST_TOKENS__[1],
+                std::move(Player{ 1, "Mariya", nullptr, 3 }.SetCurrentPosition(10.2, 20).SetFuturePosition(10.2, 1.5)))
+            .AddPlayer(&__TEST_TOKENS__[2],
+                std::move(Player{ 2, "Petr", nullptr, 3 }.SetCurrentPosition(20, 13.7).SetFuturePosition(3.1, 13.7)))
+            .AddPlayer(&__TEST_TOKENS__[3],
+                std::move(Player{ 3, "Olga", nullptr, 3 }.SetCurrentPosition(-0.4, 4.6).SetFuturePosition(-0.4, 19.9)))
+            .AddPlayer(&__TEST_TOKENS__[4],
+                std::move(Player{ 4, "Ivan", nullptr, 3 }.SetCurrentPosition(5, 10).SetFuturePosition(5, 10)));
+
+        std::vector<CollisionEvent> reference = FindCollisionEvents(session);
+
+        THEN("Brute force search finds events") {
+            CHECK(!reference.empty());
+        }
+
+        THEN("Uniform grid gives the same events as the brute force search") {
+
+            session.SetBroadphase(std::make_unique<UniformGridBroadphase>());
+            std::vector<CollisionEvent> result = FindCollisionEvents(session);
+
+            CHECK(result.size() == reference.size());
+            CHECK(EqualEventsSets(reference, result));
+            CHECK(std::is_sorted(result.begin(), result.end(), CollisionEventsTimeComparator));
+        }
+
+        THEN("Road segment index gives the same events as the brute force search") {
+
+            session.SetBroadphase(std::make_unique<RoadSegmentBroadphase>());
+            std::vector<CollisionEvent> result = FindCollisionEvents(session);
+
+            CHECK(result.size() == reference.size());
+            CHECK(EqualEventsSets(reference, result));
+            CHECK(std::is_sorted(result.begin(), result.end(), CollisionEventsTimeComparator));
+        }
+    }
+}
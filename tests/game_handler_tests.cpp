@@ -0,0 +1,373 @@
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/json/src.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "../src/game_handler.h"
+
+using namespace std::literals;
+using namespace game_handler;
+namespace net = boost::asio;
+
+// одна прямая дорога, игроки стартуют в её начале, лут не появляется: состояние меняют только игроки
+static const std::string __TEST_CONFIG__ = R"({
+	"defaultDogSpeed": 1.0,
+	"dogRetirementTime": 1000.0,
+	"lootGeneratorConfig": { "period": 5.0, "probability": 0.0 },
+	"maps": [ {
+		"id": "map1",
+		"name": "Map 1",
+		"lootTypes": [ { "name": "key", "file": "assets/key.obj", "type": "obj", "scale": 0.03, "value": 10 } ],
+		"roads": [ { "x0": 0, "y0": 0, "x1": 100 } ],
+		"buildings": [],
+		"offices": [ { "id": "o0", "x": 100, "y": 0, "offsetX": 5, "offsetY": 0 } ]
+	} ]
+})"s;
+
+/*
+* Игровой обработчик без базы данных, запросы подаются так же, как в game_replay:
+* в одном потоке, после каждого запроса очередь io_context выполняется до конца.
+*/
+class TestGame {
+public:
+	TestGame()
+		: game_(WriteConfig(), std::vector<SessionExecutor>{ ioc_.get_executor() }) {
+	}
+
+	// добавляет игрока на карту и возвращает его токен
+	std::string Join(std::string_view name) {
+		std::optional<http_handler::Response> answer;
+		game_.JoinGameResponse(MakeRequest(http::verb::post, "/api/v1/game/join"sv, {},
+			R"({"userName": ")"s + std::string(name) + R"(", "mapId": "map1"})"s),
+			[&answer](http_handler::Response&& response) {
+				answer = std::move(response);
+			});
+		Drain();
+
+		REQUIRE(answer);
+		REQUIRE(IS_STRING_RESPONSE(*answer));
+		auto body = json::parse(std::get<http_handler::StringResponse>(*answer).body());
+		return std::string(body.as_object().at("authToken").as_string());
+	}
+
+	// отправляет команду движения игрока
+	bool Move(std::string_view token, std::string_view move) {
+		auto response = InSession(MakeRequest(http::verb::post, "/api/v1/game/player/action"sv, token,
+			R"({"move": ")"s + std::string(move) + R"("})"s),
+			[this](http_handler::StringRequest&& req) {
+				return game_.PlayerActionResponse(std::move(req));
+			});
+		return IS_STRING_RESPONSE(response) && std::get<http_handler::StringResponse>(response).result() == http::status::ok;
+	}
+
+	// выполняет тик всех игровых сессий
+	void Tick(int time) {
+		game_.UpdateGameSessions(time);
+		Drain();
+	}
+
+	// возвращает ответ /v1/game/state, fields - дополнительные заголовки запроса
+	http_handler::Response State(std::string_view token,
+		std::initializer_list<std::pair<http::field, std::string_view>> fields = {}) {
+
+		auto req = MakeRequest(http::verb::get, "/api/v1/game/state"sv, token);
+		for (const auto& [field, value] : fields) {
+			req.set(field, value);
+		}
+		return InSession(std::move(req), [this](http_handler::StringRequest&& req) {
+			return game_.GameStateResponse(std::move(req));
+		});
+	}
+
+	// возвращает ответ /v1/game/state?baseVersion=N, разность относительно версии base_version
+	http_handler::Response StateDelta(std::string_view token, uint64_t base_version) {
+		auto req = MakeRequest(http::verb::get, "/api/v1/game/state?baseVersion="s + std::to_string(base_version), token);
+		return InSession(std::move(req), [this, base_version](http_handler::StringRequest&& req) {
+			// без afterVersion ответ отправляется сразу
+			http_handler::Response response;
+			game_.GameStatePollResponse(std::move(req), StateRequestParams{ std::nullopt, base_version },
+				[&response](http_handler::Response&& answer) {
+					response = std::move(answer);
+				});
+			return response;
+		});
+	}
+
+	// возвращает ответ /v1/game/players, fields - дополнительные заголовки запроса
+	http_handler::Response Players(std::string_view token,
+		std::initializer_list<std::pair<http::field, std::string_view>> fields = {}) {
+
+		auto req = MakeRequest(http::verb::get, "/api/v1/game/players"sv, token);
+		for (const auto& [field, value] : fields) {
+			req.set(field, value);
+		}
+		return InSession(std::move(req), [this](http_handler::StringRequest&& req) {
+			return game_.PlayersListResponse(std::move(req));
+		});
+	}
+
+private:
+	net::io_context ioc_{ 1 };
+	GameHandler game_;
+
+	static std::filesystem::path WriteConfig() {
+		auto path = std::filesystem::temp_directory_path() / "game_handler_tests.json";
+		std::ofstream(path) << __TEST_CONFIG__;
+		return path;
+	}
+
+	static http_handler::StringRequest MakeRequest(http::verb verb, std::string_view target,
+		std::string_view token, std::string body = {}) {
+
+		http_handler::StringRequest req{ verb, target, 11 };
+		if (!body.empty()) {
+			req.set(http::field::content_type, http_handler::ContentType::APP_JSON);
+		}
+		if (!token.empty()) {
+			req.set(http::field::authorization, "Bearer "s + std::string(token));
+		}
+		req.body() = std::move(body);
+		req.prepare_payload();
+		return req;
+	}
+
+	// выполняет запрос в стренде сессии игрока, как это делает обработчик запросов
+	template <typename Function>
+	http_handler::Response InSession(http_handler::StringRequest&& req, Function&& func) {
+		auto session = game_.FindRequestSession(req);
+		REQUIRE(session);
+
+		http_handler::Response response;
+		net::dispatch(session->GetStrand(), [&response, &func, req = std::move(req)]() mutable {
+			response = func(std::move(req));
+		});
+		Drain();
+		return response;
+	}
+
+	// выполняет всё, что запрос поставил в стренды сессий
+	void Drain() {
+		ioc_.restart();
+		ioc_.run();
+	}
+};
+
+// возвращает буфер тела разделяемого ответа
+static std::shared_ptr<const std::string> SharedBody(const http_handler::Response& response) {
+	REQUIRE(IS_SHARED_RESPONSE(response));
+	return std::get<http_handler::SharedResponse>(response).body();
+}
+
+// возвращает заголовок ответа любого вида
+static const http::response_header<>& Header(const http_handler::Response& response) {
+	return std::visit([](const auto& value) -> const http::response_header<>& {
+		if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::monostate>) {
+			throw std::logic_error("Header::Error::Empty response");
+		}
+		else {
+			return value;
+		}
+	}, response);
+}
+
+SCENARIO("Game state snapshot test module", "[GameState]") {
+
+	GIVEN("a game session with a player") {
+
+		TestGame game;
+		std::string token = game.Join("Alice"sv);
+		auto body = SharedBody(game.State(token));
+		REQUIRE(body);
+
+		THEN("requests within one version share the body buffer") {
+
+			CHECK(SharedBody(game.State(token)) == body);
+			CHECK(SharedBody(game.State(token)) == body);
+		}
+
+		THEN("encodings have their own body buffers") {
+
+			auto binary = SharedBody(game.State(token, { { http::field::accept, http_handler::ContentType::APP_GAME_STATE } }));
+			CHECK(binary != body);
+			CHECK(*binary != *body);
+		}
+
+		THEN("a new version gets a fresh buffer and the old one stays intact") {
+
+			const std::string old_body = *body;
+			REQUIRE(game.Move(token, "R"sv));
+			game.Tick(1000);
+
+			auto new_body = SharedBody(game.State(token));
+			CHECK(new_body != body);
+			CHECK(*new_body != old_body);
+			// прежний буфер мог ещё отправляться другим клиентам
+			CHECK(*body == old_body);
+		}
+
+		THEN("a tick without changes keeps the buffer") {
+
+			game.Tick(1);
+			CHECK(SharedBody(game.State(token)) == body);
+		}
+	}
+}
+
+SCENARIO("Game state ETag test module", "[GameStateETag]") {
+
+	GIVEN("a version ETag") {
+
+		const std::string etag = detail::MakeVersionETag(0x1f, 2, 's', 10);
+		CHECK(etag == "\"1f-2-s-a\""s);
+
+		THEN("If-None-Match matches it in a list, as a weak tag and by a star") {
+
+			CHECK(detail::IfNoneMatch(etag, etag));
+			CHECK(detail::IfNoneMatch("\"1f-2-s-9\", \"1f-2-s-a\""sv, etag));
+			CHECK(detail::IfNoneMatch(" \"1f-2-s-9\" ,\t\"1f-2-s-a\"\t"sv, etag));
+			CHECK(detail::IfNoneMatch("W/\"1f-2-s-a\""sv, etag));
+			CHECK(detail::IfNoneMatch("*"sv, etag));
+		}
+
+		THEN("other versions, kinds and broken tags do not match") {
+
+			CHECK_FALSE(detail::IfNoneMatch(""sv, etag));
+			CHECK_FALSE(detail::IfNoneMatch("\"1f-2-s-9\""sv, etag));
+			CHECK_FALSE(detail::IfNoneMatch("\"1f-2-b-a\""sv, etag));
+			CHECK_FALSE(detail::IfNoneMatch("1f-2-s-a"sv, etag));
+			CHECK_FALSE(detail::IfNoneMatch("\"1f-2-s-a"sv, etag));
+			CHECK_FALSE(detail::IfNoneMatch("\"1f-2-s-a\"x"sv, etag));
+		}
+	}
+
+	GIVEN("a game session with a player") {
+
+		TestGame game;
+		std::string token = game.Join("Alice"sv);
+
+		auto first = game.State(token);
+		std::string etag(Header(first)[http::field::etag]);
+		REQUIRE(!etag.empty());
+
+		THEN("the same version answers 304 with the same ETag and no body") {
+
+			auto response = game.State(token, { { http::field::if_none_match, etag } });
+			REQUIRE(IS_STRING_RESPONSE(response));
+			CHECK(Header(response).result() == http::status::not_modified);
+			CHECK(Header(response)[http::field::etag] == etag);
+			CHECK(std::get<http_handler::StringResponse>(response).body().empty());
+
+			CHECK(Header(game.State(token, { { http::field::if_none_match, "W/" + etag } })).result() == http::status::not_modified);
+		}
+
+		THEN("a changed state answers 200 with a new ETag") {
+
+			REQUIRE(game.Move(token, "R"sv));
+			game.Tick(1000);
+
+			auto response = game.State(token, { { http::field::if_none_match, etag } });
+			CHECK(Header(response).result() == http::status::ok);
+			CHECK(Header(response)[http::field::etag] != etag);
+			CHECK(SharedBody(response));
+		}
+
+		THEN("the binary and JSON encodings have their own ETags") {
+
+			auto binary = game.State(token, { { http::field::accept, http_handler::ContentType::APP_GAME_STATE } });
+			std::string binary_etag(Header(binary)[http::field::etag]);
+			REQUIRE(!binary_etag.empty());
+			CHECK(binary_etag != etag);
+			CHECK(Header(binary)[http::field::vary] == "Accept");
+
+			// ETag кодировки JSON не подходит для двоичного ответа той же версии
+			auto response = game.State(token, { { http::field::accept, http_handler::ContentType::APP_GAME_STATE },
+				{ http::field::if_none_match, etag } });
+			CHECK(Header(response).result() == http::status::ok);
+			CHECK(Header(response)[http::field::etag] == binary_etag);
+
+			response = game.State(token, { { http::field::accept, http_handler::ContentType::APP_GAME_STATE },
+				{ http::field::if_none_match, binary_etag } });
+			CHECK(Header(response).result() == http::status::not_modified);
+			CHECK(Header(response)[http::field::vary] == "Accept");
+			CHECK(std::string(Header(response)[http::field::content_type]) == http_handler::ContentType::APP_GAME_STATE);
+
+			response = game.State(token, { { http::field::if_none_match, etag } });
+			CHECK(Header(response).result() == http::status::not_modified);
+			CHECK(Header(response)[http::field::vary] == "Accept");
+		}
+
+		THEN("the players list ETag changes only when players join or leave") {
+
+			std::string players_etag(Header(game.Players(token))[http::field::etag]);
+			REQUIRE(!players_etag.empty());
+			CHECK(players_etag != etag);
+
+			REQUIRE(game.Move(token, "R"sv));
+			game.Tick(1000);
+			auto not_modified = game.Players(token, { { http::field::if_none_match, players_etag } });
+			CHECK(Header(not_modified).result() == http::status::not_modified);
+			CHECK(Header(not_modified)[http::field::vary].empty());
+
+			game.Join("Bob"sv);
+			auto response = game.Players(token, { { http::field::if_none_match, players_etag } });
+			CHECK(Header(response).result() == http::status::ok);
+			CHECK(Header(response)[http::field::etag] != players_etag);
+		}
+	}
+}
+
+SCENARIO("Game state delta test module", "[GameStateDelta]") {
+
+	GIVEN("a game session with two players") {
+
+		TestGame game;
+		std::string alice = game.Join("Alice"sv);
+		std::string bob = game.Join("Bob"sv);
+
+		const std::string base(Header(game.State(alice))["X-State-Version"]);
+		REQUIRE(!base.empty());
+		const uint64_t base_version = std::stoull(base);
+
+		THEN("a delta survives hundreds of commands within a few ticks") {
+
+			// каждая смена направления - новая версия, но история считает тики, а не версии
+			for (int tick = 0; tick != 3; ++tick) {
+				for (int i = 0; i != 100; ++i) {
+					REQUIRE(game.Move(alice, i % 2 ? "L"sv : "R"sv));
+				}
+				game.Tick(10);
+			}
+			CHECK(std::stoull(std::string(Header(game.State(alice))["X-State-Version"])) > base_version + __STATE_HISTORY_SIZE__);
+
+			auto response = game.StateDelta(bob, base_version);
+			CHECK(Header(response).result() == http::status::ok);
+			CHECK(Header(response)["X-State-Base-Version"] == base);
+			CHECK(Header(response)[http::field::etag].empty());
+		}
+
+		THEN("a base version older than the history answers the full state") {
+
+			for (size_t tick = 0; tick != __STATE_HISTORY_SIZE__ + 1; ++tick) {
+				REQUIRE(game.Move(alice, tick % 2 ? "L"sv : "R"sv));
+				game.Tick(10);
+			}
+
+			auto response = game.StateDelta(bob, base_version);
+			CHECK(Header(response).result() == http::status::ok);
+			CHECK(Header(response)["X-State-Base-Version"].empty());
+			CHECK(!Header(response)[http::field::etag].empty());
+		}
+	}
+}
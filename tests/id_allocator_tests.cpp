@@ -0,0 +1,59 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/id_allocator.h"
+
+using namespace util;
+
+SCENARIO("IdAllocator test module", "[IdAllocator]") {
+
+	GIVEN("an allocator wider than one bit word") {
+
+		IdAllocator ids(130);
+
+		THEN("ids are handed out from the smallest one") {
+
+			for (size_t i = 0; i != 130; ++i) {
+				auto id = ids.Acquire();
+				REQUIRE(id.has_value());
+				CHECK(*id == i);
+			}
+
+			CHECK_FALSE(ids.HasFree());
+			CHECK_FALSE(ids.Acquire().has_value());
+			CHECK(ids.TakenCount() == 130);
+
+			THEN("released id is handed out again") {
+
+				CHECK(ids.Release(70));
+				CHECK_FALSE(ids.Release(70));
+				CHECK(ids.Release(3));
+
+				CHECK(*ids.Acquire() == 3);
+				CHECK(*ids.Acquire() == 70);
+				CHECK_FALSE(ids.Acquire().has_value());
+			}
+
+			THEN("all ids can be released at once") {
+
+				ids.ReleaseAll();
+				CHECK(ids.TakenCount() == 0);
+				CHECK(*ids.Acquire() == 0);
+			}
+		}
+
+		THEN("the explicitly taken id is skipped by acquire") {
+
+			CHECK(ids.Take(0));
+			CHECK_FALSE(ids.Take(0));
+			CHECK(ids.IsTaken(0));
+			CHECK(*ids.Acquire() == 1);
+		}
+
+		THEN("out of range id is rejected") {
+
+			CHECK_THROWS_AS(ids.Take(130), std::out_of_range);
+			CHECK_THROWS_AS(ids.Release(130), std::out_of_range);
+			CHECK_FALSE(ids.IsTaken(130));
+		}
+	}
+}
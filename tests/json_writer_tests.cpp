@@ -0,0 +1,382 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../src/boost_json.h"
+
+using namespace std::literals;
+using namespace game_handler;
+namespace json = boost::json;
+
+/*
+* Эталонные ответы строятся через boost::json DOM и json::serialize так же,
+* как это делал сервер до перехода на JsonWriter. Потоковая запись должна совпадать с ними байт в байт.
+*/
+namespace reference {
+
+	json::array GetPlayerBag(const Player& player) {
+		json::array result;
+		for (const auto& item : player.GetBag()) {
+			result.push_back(json::object{ {"id", item.index_}, {"type", item.loot_->type_} });
+		}
+		return result;
+	}
+
+	std::string GetSessionStateList(const SessionPlayers& players, const SessionLoots& loots) {
+		static const char* __DIRECTIONS__[] = { "U", "D", "L", "R" };
+
+		json::object players_list;
+		for (const auto& [token, player] : players) {
+			json::object player_data;
+			player_data.emplace("pos", json::array{ player.GetCurrentPosition().x_, player.GetCurrentPosition().y_ });
+			player_data.emplace("speed", json::array{ player.GetSpeed().xV_, player.GetSpeed().yV_ });
+			player_data.emplace("dir", __DIRECTIONS__[static_cast<int>(player.GetDirection())]);
+			player_data.emplace("bag", GetPlayerBag(player));
+			player_data.emplace("score", player.GetScore());
+			players_list.emplace(std::to_string(player.GetId()), player_data);
+		}
+
+		json::object loots_list;
+		for (const auto& [id, loot] : loots) {
+			json::array pos{ loot.pos_.x_, loot.pos_.y_ };
+			loots_list.emplace(std::to_string(id), json::object{ {"type", loot.type_}, {"pos", pos} });
+		}
+
+		return json::serialize(json::object{ {"players", players_list}, {"lostObjects", loots_list } });
+	}
+
+	std::string GetSessionPlayersList(const SessionPlayers& players) {
+		json::object result;
+		for (const auto& it : players) {
+			result.emplace(std::to_string(it.second.GetId()), json::object{ {"name", it.second.GetName()} });
+		}
+		return json::serialize(result);
+	}
+
+	std::string GetRecordsTable(const std::optional<std::vector<postgres::detail::DBGameRecord>>& records) {
+		json::array result;
+		if (records.has_value()) {
+			for (const auto& record : records.value()) {
+				json::object item;
+				item.emplace("name", record.name_);
+				item.emplace("score", record.score_);
+				item.emplace("playTime", (static_cast<double>(record.time_ms_) / __MS_IN_ONE_SECOND__));
+				result.push_back(item);
+			}
+		}
+		return json::serialize(result);
+	}
+
+	std::string GetMapInfo(const model::Map* data) {
+		json::object result;
+		result.emplace("id", *data->GetId());
+		result.emplace("name", data->GetName());
+
+		json::array roads;
+		for (auto& road : data->GetRoads()) {
+			json::object item{ { "x0", road.GetStart().x }, { "y0", road.GetStart().y } };
+			if (road.IsHorizontal()) {
+				item.emplace("x1", road.GetEnd().x);
+			}
+			else {
+				item.emplace("y1", road.GetEnd().y);
+			}
+			roads.push_back(item);
+		}
+		result.emplace("roads", roads);
+
+		json::array builds;
+		for (auto& build : data->GetBuildings()) {
+			builds.push_back(json::object{
+				{ "x", build.GetBounds().position.x }, { "y", build.GetBounds().position.y },
+				{ "w", build.GetBounds().size.width }, { "h", build.GetBounds().size.height } });
+		}
+		result.emplace("buildings", builds);
+
+		json::array offices;
+		for (auto& office : data->GetOffices()) {
+			offices.push_back(json::object{
+				{ "id", *office.GetId() }, { "x", office.GetPosition().x }, { "y", office.GetPosition().y },
+				{ "offsetX", office.GetOffset().dx }, { "offsetY", office.GetOffset().dy } });
+		}
+		result.emplace("offices", offices);
+
+		result.emplace("lootTypes", data->GetRawExtraDataAs<boost::json::array>("lootTypes"));
+		return json::serialize(result);
+	}
+
+	// значение после перевода в фиксированную точку двоичной кодировки и обратно
+	double Quantize(double value) {
+		return static_cast<double>(std::llround(value * binary_detail::__FIXED_POINT_SCALE__)) / binary_detail::__FIXED_POINT_SCALE__;
+	}
+
+	// последовательно читает числа двоичной кодировки состояния, см. binary_detail::BinaryWriter
+	class BinaryReader {
+	public:
+		explicit BinaryReader(std::string_view buffer)
+			: buffer_(buffer) {
+		}
+
+		uint8_t Byte() {
+			return static_cast<uint8_t>(buffer_.at(pos_++));
+		}
+		uint64_t Varint() {
+			uint64_t result = 0;
+			for (int shift = 0;; shift += 7) {
+				uint8_t byte = Byte();
+				result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+				if (!(byte & 0x80)) {
+					return result;
+				}
+			}
+		}
+		double Fixed() {
+			uint64_t value = Varint();
+			int64_t decoded = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+			return static_cast<double>(decoded) / binary_detail::__FIXED_POINT_SCALE__;
+		}
+		bool AtEnd() const {
+			return pos_ == buffer_.size();
+		}
+
+	private:
+		std::string_view buffer_;
+		size_t pos_ = 0;
+	};
+
+} // namespace reference
+
+SCENARIO("Json writer test module", "[JsonWriter]") {
+
+	GIVEN("scalar values") {
+
+		WHEN("doubles are written") {
+			const std::vector<double> values = {
+				0.0, -0.0, 1.0, -1.0, 4.0, 0.5, 2.5, 0.1, 0.3, 1.0 / 3.0, 10.0, 100.0, 123456.789,
+				1e-7, 5e-324, 1e21, 1e22, -2.75e-12, 1.7976931348623157e308, 2.2250738585072014e-308,
+				std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()
+			};
+
+			THEN("every value matches json::serialize") {
+				for (double value : values) {
+					std::string buffer;
+					json_detail::JsonWriter(buffer).Double(value);
+					CHECK(buffer == json::serialize(json::value(value)));
+				}
+			}
+		}
+
+		WHEN("strings with special characters are written") {
+			const std::vector<std::string> values = {
+				""s, "Harry"s, "quote \" and backslash \\"s, "tab\tnew\nline\rfeed\fback\b"s,
+				"\x01\x1f control"s, "slash / and del \x7f"s, "\xd0\x9f\xd1\x91\xd1\x81 utf-8"s, std::string("zero\0byte", 9)
+			};
+
+			THEN("every value matches json::serialize") {
+				for (const auto& value : values) {
+					std::string buffer;
+					json_detail::JsonWriter(buffer).String(value);
+					CHECK(buffer == json::serialize(json::value(value)));
+				}
+			}
+		}
+
+		WHEN("an arbitrary boost::json value is written") {
+			json::value value = json::parse(
+				R"({"a":[1,-2,3.5,true,false,null,"s"],"b":{"c":{},"d":[]},"e":18446744073709551615,"f":-0.25})");
+			std::string buffer;
+			json_detail::JsonWriter(buffer).Value(value);
+
+			THEN("it matches json::serialize") {
+				CHECK(buffer == json::serialize(value));
+			}
+		}
+
+		WHEN("binary numbers are written") {
+			std::string buffer;
+			binary_detail::BinaryWriter(buffer).Varint(0).Varint(127).Varint(300).Zigzag(-1).Zigzag(1).Fixed(-2.5).Fixed(0.0004);
+
+			THEN("they use varint, zigzag and fixed point rounding") {
+				CHECK(buffer == std::string("\x00\x7f\xac\x02\x01\x02\x87\x27\x00", 9));
+			}
+		}
+
+		WHEN("values are written into a non-empty buffer") {
+			std::string buffer = "prefix"s;
+			json_detail::JsonWriter writer(buffer);
+			writer.StartObject().Key("a").StartArray().EndArray().Key(7u).StartObject().EndObject().Key("b").Int(-3).EndObject();
+
+			THEN("they are appended with commas only between elements") {
+				CHECK(buffer == R"(prefix{"a":[],"7":{},"b":-3})"s);
+			}
+		}
+	}
+
+	GIVEN("a game session with players and loot") {
+
+		const model::LootType loot_type{ "key", "assets/key.obj", "obj", 90, "#338844", 0.03, 10 };
+		std::vector<Token> tokens = {
+			Token{ "0123456789abcdef0123456789abcdef"s }, Token{ "fedcba9876543210fedcba9876543210"s }, Token{ "00000000000000000000000000000001"s }
+		};
+
+		SessionLoots loots;
+		loots.emplace(0, GameLoot(loot_type, 0, 0, PlayerPosition{ 1.0, 0.5 }));
+		loots.emplace(7, GameLoot(loot_type, 2, 7, PlayerPosition{ 12.125, -0.0 }));
+		loots.emplace(3, GameLoot(loot_type, 1, 3, PlayerPosition{ 0.1, 40.0 }));
+
+		SessionPlayers players;
+		players.Add(&tokens[0], 0, "Harry"sv, 3).SetCurrentPosition(0.0, 0.0).SetSpeed(0.0, 0.0);
+		players.Add(&tokens[1], 5, "Ron \"the\" Weasley"sv, 3).SetCurrentPosition(10.4, 3.0).SetSpeed(-2.5, 0.0)
+			.SetDirection(PlayerDirection::WEST);
+		players.Add(&tokens[2], 12, "Hermione"sv, 3).SetCurrentPosition(1e-3, 123456.789).SetSpeed(0.0, 1.0 / 3.0)
+			.SetDirection(PlayerDirection::SOUTH);
+
+		auto player = players.begin();
+		++player;
+		REQUIRE(player->second.AddLoot(0, &loots.at(0)));
+		REQUIRE(player->second.AddLoot(7, &loots.at(7)));
+
+		THEN("the state response matches the DOM serializer") {
+			CHECK(json_detail::GetSessionStateList(players, loots) == reference::GetSessionStateList(players, loots));
+		}
+		THEN("the players list matches the DOM serializer") {
+			CHECK(json_detail::GetSessionPlayersList(players) == reference::GetSessionPlayersList(players));
+			CHECK(json_detail::GetSessionPlayersList(players.begin(), players.end()) == reference::GetSessionPlayersList(players));
+		}
+		THEN("an empty session matches the DOM serializer") {
+			CHECK(json_detail::GetSessionStateList({}, {}) == reference::GetSessionStateList({}, {}));
+			CHECK(json_detail::GetSessionStateList({}, {}) == R"({"players":{},"lostObjects":{}})"s);
+		}
+		THEN("the state is appended to a reused buffer") {
+			std::string buffer;
+			json_detail::WriteSessionStateList(buffer, players, loots);
+			buffer.clear();
+			json_detail::WriteSessionStateList(buffer, players, loots);
+			CHECK(buffer == reference::GetSessionStateList(players, loots));
+		}
+		THEN("a delta holds only changed players and loot that are still in the session") {
+			// игрок 40 и лут 99 изменились в окне версий, но уже выбыли из сессии
+			StateDelta delta{ 3, 9, { 5, 40 }, { 2 }, { 7, 99 }, { 1 } };
+			std::string buffer;
+			json_detail::WriteSessionStateDelta(buffer, players, loots, delta);
+
+			json::value full = json::parse(reference::GetSessionStateList(players, loots));
+			json::object expected{ {"baseVersion", 3}, {"version", 9} };
+			expected.emplace("players", json::object{ {"5", full.at("players").at("5")} });
+			expected.emplace("lostObjects", json::object{ {"7", full.at("lostObjects").at("7")} });
+			expected.emplace("removedPlayers", json::array{ 2 });
+			expected.emplace("removedObjects", json::array{ 1 });
+			CHECK(buffer == json::serialize(expected));
+		}
+		THEN("the binary state holds the same data and is much smaller than JSON") {
+			std::string buffer;
+			json_detail::WriteSessionStateList(buffer, players, loots, StateEncoding::BINARY);
+			CHECK(buffer.size() * 3 < json_detail::GetSessionStateList(players, loots).size());
+
+			reference::BinaryReader reader(buffer);
+			CHECK(reader.Byte() == json_detail::detail::__BINARY_STATE_FORMAT__);
+			CHECK(reader.Byte() == 0);
+
+			REQUIRE(reader.Varint() == players.size());
+			for (const auto& [token, player] : players) {
+				CHECK(reader.Varint() == player.GetId());
+				CHECK(reader.Fixed() == reference::Quantize(player.GetCurrentPosition().x_));
+				CHECK(reader.Fixed() == reference::Quantize(player.GetCurrentPosition().y_));
+				CHECK(reader.Fixed() == reference::Quantize(player.GetSpeed().xV_));
+				CHECK(reader.Fixed() == reference::Quantize(player.GetSpeed().yV_));
+				CHECK(reader.Byte() == static_cast<uint8_t>(player.GetDirection()));
+				REQUIRE(reader.Varint() == player.GetBagSize());
+				for (const auto& item : player.GetBag()) {
+					CHECK(reader.Varint() == item.index_);
+					CHECK(reader.Varint() == item.loot_->type_);
+				}
+				CHECK(reader.Varint() == player.GetScore());
+			}
+
+			REQUIRE(reader.Varint() == loots.size());
+			for (const auto& [id, loot] : loots) {
+				CHECK(reader.Varint() == id);
+				CHECK(reader.Varint() == loot.type_);
+				CHECK(reader.Fixed() == reference::Quantize(loot.pos_.x_));
+				CHECK(reader.Fixed() == reference::Quantize(loot.pos_.y_));
+			}
+			CHECK(reader.AtEnd());
+		}
+		THEN("the binary delta holds only changed records and removed ids") {
+			StateDelta delta{ 3, 300, { 5, 40 }, { 2 }, { 7, 99 }, { 1 } };
+			std::string buffer;
+			json_detail::WriteSessionStateDelta(buffer, players, loots, delta, StateEncoding::BINARY);
+
+			reference::BinaryReader reader(buffer);
+			CHECK(reader.Byte() == json_detail::detail::__BINARY_STATE_FORMAT__);
+			CHECK(reader.Byte() == 1);
+			CHECK(reader.Varint() == 3);
+			CHECK(reader.Varint() == 300);
+
+			// только игрок 5, с двумя предметами в сумке
+			REQUIRE(reader.Varint() == 1);
+			CHECK(reader.Varint() == 5);
+			CHECK(reader.Fixed() == 10.4);
+			CHECK(reader.Fixed() == 3.0);
+			CHECK(reader.Fixed() == -2.5);
+			CHECK(reader.Fixed() == 0.0);
+			CHECK(reader.Byte() == static_cast<uint8_t>(PlayerDirection::WEST));
+			REQUIRE(reader.Varint() == 2);
+			CHECK(reader.Varint() == 0);
+			CHECK(reader.Varint() == 0);
+			CHECK(reader.Varint() == 7);
+			CHECK(reader.Varint() == 2);
+			CHECK(reader.Varint() == 0);
+
+			// только лут 7, лут 99 уже нет на карте
+			REQUIRE(reader.Varint() == 1);
+			CHECK(reader.Varint() == 7);
+			CHECK(reader.Varint() == 2);
+			CHECK(reader.Fixed() == 12.125);
+			CHECK(reader.Fixed() == 0.0);
+
+			// удалённые игроки и лут
+			CHECK(reader.Varint() == 1);
+			CHECK(reader.Varint() == 2);
+			CHECK(reader.Varint() == 1);
+			CHECK(reader.Varint() == 1);
+			CHECK(reader.AtEnd());
+		}
+		THEN("an empty delta has only versions and empty sets") {
+			std::string buffer;
+			json_detail::WriteSessionStateDelta(buffer, players, loots, StateDelta{ 4, 4 });
+			CHECK(buffer == R"({"baseVersion":4,"version":4,"players":{},"lostObjects":{},"removedPlayers":[],"removedObjects":[]})"s);
+		}
+	}
+
+	GIVEN("a records table") {
+		std::vector<postgres::detail::DBGameRecord> records = {
+			{ {}, "Harry"s, 120, 65432 }, { {}, "Ron"s, 0, 0 }, { {}, "Hermione \\ Granger"s, 4294967295u, 100 }
+		};
+
+		THEN("it matches the DOM serializer") {
+			CHECK(json_detail::GetRecordsTable(records) == reference::GetRecordsTable(records));
+			CHECK(json_detail::GetRecordsTable(std::nullopt) == reference::GetRecordsTable(std::nullopt));
+		}
+	}
+
+	GIVEN("a map with loot types") {
+		model::Map map(model::Map::Id{ "map1" }, "Map 1");
+		map.AddRoad(model::Road(model::Road::HORIZONTAL, { 0, 0 }, 40));
+		map.AddRoad(model::Road(model::Road::VERTICAL, { 40, 0 }, 30));
+		map.AddRoad(model::Road(model::Road::HORIZONTAL, { 40, 30 }, -10));
+		map.AddBuilding(model::Building({ { 5, 5 }, { 30, 20 } }));
+		map.AddOffice(model::Office(model::Office::Id{ "o0" }, { 40, 30 }, { 5, -5 }));
+
+		json::array loot_types = json::parse(
+			R"([{"name":"key","file":"assets/key.obj","type":"obj","rotation":90,"color":"#338844","scale":0.03,"value":10},)"
+			R"({"name":"wallet","file":"assets/wallet.obj","type":"obj","rotation":0,"color":"#883344","scale":1E-2,"value":30}])").as_array();
+		map.AddExtraArrayData("lootTypes", std::move(loot_types));
+
+		THEN("the map info matches the DOM serializer") {
+			CHECK(json_detail::GetMapInfo(&map) == reference::GetMapInfo(&map));
+		}
+	}
+}
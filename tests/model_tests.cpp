@@ -3,6 +3,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "../src/model.h"
+#include "../src/rng.h"
 
 using namespace std::literals;
 
@@ -41,6 +42,41 @@ SCENARIO("Model test module") {
 				}
 			}
 
+			AND_THEN("we can find roads by position, the first added road wins on overlaps") {
+
+				map.AddRoad(Road(Road::HORIZONTAL, { 0, 0 }, 10));
+				map.AddRoad(Road(Road::HORIZONTAL, { 30, 0 }, 20));
+				map.AddRoad(Road(Road::HORIZONTAL, { 5, 0 }, 25));
+				map.AddRoad(Road(Road::VERTICAL, { 10, 0 }, 10));
+				map.AddRoad(Road(Road::VERTICAL, { 10, 20 }, 5));
+				map.AddRoad(Road(Road::HORIZONTAL, { 40, 40 }, 40));
+
+				const auto& roads = map.GetRoads();
+
+				CHECK(map.GetHorizontalRoad({ 0, 0 }) == &roads[0]);
+				CHECK(map.GetHorizontalRoad({ 10, 0 }) == &roads[0]);
+				CHECK(map.GetHorizontalRoad({ 15, 0 }) == &roads[2]);
+				CHECK(map.GetHorizontalRoad({ 22, 0 }) == &roads[1]);
+				CHECK(map.GetHorizontalRoad({ 30, 0 }) == &roads[1]);
+				CHECK(map.GetHorizontalRoad({ 31, 0 }) == nullptr);
+				CHECK(map.GetHorizontalRoad({ -1, 0 }) == nullptr);
+				CHECK(map.GetHorizontalRoad({ 10, 5 }) == nullptr);
+
+				CHECK(map.GetVerticalRoad({ 10, 0 }) == &roads[3]);
+				CHECK(map.GetVerticalRoad({ 10, 7 }) == &roads[3]);
+				CHECK(map.GetVerticalRoad({ 10, 15 }) == &roads[4]);
+				CHECK(map.GetVerticalRoad({ 10, 21 }) == nullptr);
+				CHECK(map.GetVerticalRoad({ 5, 0 }) == nullptr);
+
+				CHECK(map.GetHorizontalRoad({ 40, 40 }) == &roads[5]);
+				CHECK(map.GetVerticalRoad({ 40, 40 }) == &roads[5]);
+
+				AND_THEN("the index survives a map copy") {
+					Map copy = map;
+					CHECK(copy.GetHorizontalRoad({ 15, 0 }) == &copy.GetRoads()[2]);
+				}
+			}
+
 			AND_THEN("we can set default dog speed on map, and check that") {
 				map.SetOnMapSpeed(10);
 				CHECK(map.GetOnMapSpeed() == 10);
@@ -121,4 +157,50 @@ SCENARIO("Model test module") {
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+SCENARIO("Model random generator", "[Rng]") {
+
+	using model::Rng;
+
+	GIVEN("two generators with the same seed") {
+
+		Rng first(42);
+		Rng second(42);
+
+		THEN("they produce the same sequence") {
+
+			for (int i = 0; i != 100; ++i) {
+				CHECK(first() == second());
+			}
+		}
+
+		THEN("numbers stay inside the requested ranges") {
+
+			bool low_seen = false, high_seen = false;
+			for (int i = 0; i != 1000; ++i) {
+				int value = first.NextInteger(-3, 3);
+				REQUIRE(value >= -3);
+				REQUIRE(value <= 3);
+				low_seen |= value == -3;
+				high_seen |= value == 3;
+
+				double real = first.NextDouble(-0.4, 0.4);
+				REQUIRE(real >= -0.4);
+				REQUIRE(real < 0.4);
+			}
+			CHECK(low_seen);
+			CHECK(high_seen);
+			CHECK(first.NextInteger(5, 5) == 5);
+		}
+	}
+
+	GIVEN("a generator with another seed") {
+
+		Rng first(42);
+		Rng other(43);
+
+		THEN("the sequences differ") {
+			CHECK(first() != other());
+		}
+	}
+}
@@ -3,6 +3,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "../src/player.h"
+#include "../src/domain.h"
 
 using namespace std::literals;
 using namespace game_handler;
@@ -185,4 +186,125 @@ SCENARIO("GamePlayer test module", "[GamePlayer]") {
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+
+SCENARIO("PlayersColumns test module", "[PlayersColumns]") {
+
+	GIVEN("a SessionPlayers with three players") {
+
+		const Token first_token{ "00000000000000000000000000000001"s };
+		const Token second_token{ "00000000000000000000000000000002"s };
+		const Token third_token{ "00000000000000000000000000000003"s };
+
+		SessionPlayers players;
+		players.Add(&first_token, 0, "first"sv, 3).SetCurrentPosition(1.0, 1.0);
+		players.Add(&second_token, 1, "second"sv, 3).SetCurrentPosition(2.0, 2.0);
+		players.Add(&third_token, 2, "third"sv, 3).SetCurrentPosition(3.0, 3.0);
+
+		const PlayersColumns& columns = players.GetColumns();
+		REQUIRE(columns.Size() == 3);
+		REQUIRE(players.at(&second_token).GetSlot() == 1);
+
+		THEN("removing the middle player keeps the others in place") {
+
+			CHECK(players.erase(&second_token) == 1);
+			CHECK(columns.Size() == 2);
+
+			// последний слот переносится на место удалённого
+			CHECK(players.at(&first_token).GetSlot() == 0);
+			CHECK(players.at(&third_token).GetSlot() == 1);
+
+			CHECK(players.at(&first_token).GetCurrentPosition() == PlayerPosition{ 1.0, 1.0 });
+			CHECK(players.at(&third_token).GetCurrentPosition() == PlayerPosition{ 3.0, 3.0 });
+			CHECK(columns.current_positions_[1] == PlayerPosition{ 3.0, 3.0 });
+			CHECK(columns.owners_[1] == &players.at(&third_token));
+		}
+
+		THEN("token to slot lookup works after removal") {
+
+			players.erase(&first_token);
+			CHECK(players.count(&first_token) == 0);
+			CHECK_THROWS_AS(players.at(&first_token), std::out_of_range);
+
+			for (const Token* token : { &second_token, &third_token }) {
+				const Player& player = players.at(token);
+				CHECK(columns.tokens_[player.GetSlot()] == token);
+				CHECK(columns.owners_[player.GetSlot()] == &player);
+			}
+			CHECK(players.at(&second_token).GetCurrentPosition() == PlayerPosition{ 2.0, 2.0 });
+			CHECK(players.at(&third_token).GetCurrentPosition() == PlayerPosition{ 3.0, 3.0 });
+		}
+
+		THEN("bag growth past the initial stride keeps items of every slot") {
+
+			std::vector<GameLoot> loots = {
+				GameLoot{__LOOT_TYPES__[0], 0, 0, {0.0, 0.0}}, GameLoot{__LOOT_TYPES__[1], 1, 1, {3.0, 3.0}},
+				GameLoot{__LOOT_TYPES__[2], 2, 2, {6.0, 6.0}}, GameLoot{__LOOT_TYPES__[3], 3, 3, {7.0, 9.0}}
+			};
+			players.at(&first_token).AddLoot(0, &loots[0]);
+			players.at(&second_token).AddLoot(1, &loots[1]);
+			players.at(&third_token).AddLoot(2, &loots[2]);
+			players.at(&third_token).AddLoot(3, &loots[3]);
+			REQUIRE(columns.GetBagStride() == 3);
+
+			const Token fourth_token{ "00000000000000000000000000000004"s };
+			players.Add(&fourth_token, 3, "fourth"sv, 8);
+			CHECK(columns.GetBagStride() == 8);
+
+			CHECK(players.at(&first_token).GetBagSize() == 1);
+			CHECK(players.at(&first_token).GetBag()[0].loot_ == &loots[0]);
+			CHECK(players.at(&second_token).GetBagSize() == 1);
+			CHECK(players.at(&second_token).GetBag()[0].loot_ == &loots[1]);
+			CHECK(players.at(&third_token).GetBagSize() == 2);
+			CHECK(players.at(&third_token).GetBag()[0].loot_ == &loots[2]);
+			CHECK(players.at(&third_token).GetBag()[1].loot_ == &loots[3]);
+			CHECK(players.at(&fourth_token).GetBagSize() == 0);
+
+			AND_THEN("the grown bag takes more items") {
+
+				players.at(&first_token).SetBagCapacity(5);
+				CHECK(players.at(&first_token).AddLoot(1, &loots[1]));
+				CHECK(players.at(&first_token).GetBagSize() == 2);
+				CHECK(players.at(&first_token).GetBag()[0].loot_ == &loots[0]);
+				CHECK(players.at(&third_token).GetBag()[1].loot_ == &loots[3]);
+			}
+		}
+	}
+
+	GIVEN("a standalone player") {
+
+		const Token token{ "0000000000000000000000000000000a"s };
+
+		Player player(7, "moved"sv, &token, 2);
+		player.SetCurrentPosition(__TEST_POSITION__.x_, __TEST_POSITION__.y_);
+		player.SetSpeed(__TEST_SPEED__.xV_, __TEST_SPEED__.yV_);
+
+		THEN("a moved player still resolves its columns") {
+
+			Player moved(std::move(player));
+			CHECK(moved.GetCurrentPosition() == __TEST_POSITION__);
+			CHECK(moved.GetSpeed() == __TEST_SPEED__);
+			CHECK(moved.GetBagSize() == 0);
+
+			Player assigned;
+			assigned = std::move(moved);
+			CHECK(assigned.GetId() == 7);
+			CHECK(assigned.GetCurrentPosition() == __TEST_POSITION__);
+			CHECK(assigned.GetSpeed() == __TEST_SPEED__);
+
+			AND_THEN("it is attached to the session columns with its state") {
+
+				SessionPlayers players;
+				players.emplace({ &token, std::move(assigned) });
+
+				const Player& attached = players.at(&token);
+				const PlayersColumns& columns = players.GetColumns();
+				CHECK(columns.Size() == 1);
+				CHECK(columns.owners_[attached.GetSlot()] == &attached);
+				CHECK(columns.tokens_[attached.GetSlot()] == &token);
+				CHECK(attached.GetCurrentPosition() == __TEST_POSITION__);
+				CHECK(attached.GetSpeed() == __TEST_SPEED__);
+			}
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#include <filesystem>
+#include <fstream>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/replay_recorder.h"
+
+using namespace std::literals;
+using namespace replay_handler;
+
+static const std::string __TOKEN_ONE__ = "0123456789abcdef0123456789abcdef"s;
+static const std::string __TOKEN_TWO__ = "fedcba9876543210fedcba9876543210"s;
+
+SCENARIO("Replay recorder test module", "[ReplayRecorder]") {
+
+	GIVEN("a recorded replay file") {
+
+		auto path = fs::temp_directory_path() / "replay_recorder_tests.bin";
+		{
+			ReplayRecorder recorder(path, ReplayHeader{ 0xDEADBEEFCAFEull, true });
+
+			recorder.RecordTick(1, 50);
+			// второй игрок зарезервировал место позже, но был записан раньше
+			recorder.RecordJoin({ 1, 2 }, __TOKEN_TWO__, "town", "Bob");
+			recorder.RecordJoin({ 1, 1 }, __TOKEN_ONE__, "map1", "Alice");
+			// действие первого игрока применено уже после второго тика, но записано раньше тика
+			CHECK(recorder.RecordMove(2, __TOKEN_ONE__, game_handler::PlayerMove::LEFT));
+			CHECK_FALSE(recorder.RecordMove(2, "unknown", game_handler::PlayerMove::UP));
+			recorder.RecordTick(2, 300000);
+		}
+
+		THEN("the header is restored") {
+
+			ReplayLog log = LoadReplay(path);
+			CHECK(log.header_.seed_ == 0xDEADBEEFCAFEull);
+			CHECK(log.header_.random_start_position_);
+
+			THEN("events are ordered by tick, joins by reservation, moves last") {
+
+				REQUIRE(log.events_.size() == 5);
+
+				CHECK(log.events_[0].type_ == ReplayEventType::tick);
+				CHECK(log.events_[0].time_delta_ == 50);
+
+				CHECK(log.events_[1].type_ == ReplayEventType::join);
+				CHECK(log.events_[1].name_ == "Alice");
+				CHECK(log.events_[1].map_id_ == "map1");
+				CHECK(log.events_[1].player_ == 1);
+
+				CHECK(log.events_[2].type_ == ReplayEventType::join);
+				CHECK(log.events_[2].name_ == "Bob");
+				CHECK(log.events_[2].player_ == 0);
+
+				CHECK(log.events_[3].type_ == ReplayEventType::tick);
+				CHECK(log.events_[3].time_delta_ == 300000);
+
+				CHECK(log.events_[4].type_ == ReplayEventType::move);
+				CHECK(log.events_[4].player_ == 1);
+				CHECK(log.events_[4].move_ == game_handler::PlayerMove::LEFT);
+			}
+		}
+
+		THEN("a truncated last event is dropped") {
+
+			auto size = fs::file_size(path);
+			fs::resize_file(path, size - 1);
+
+			ReplayLog log = LoadReplay(path);
+			CHECK(log.events_.size() == 4);
+		}
+
+		THEN("a foreign file is rejected") {
+
+			std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a replay";
+			CHECK_THROWS_AS(LoadReplay(path), std::runtime_error);
+		}
+	}
+}
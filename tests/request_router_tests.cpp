@@ -0,0 +1,316 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/request_router.h"
+
+#include <string>
+
+using namespace http_handler;
+
+// маршруты разбираются и при компиляции
+static_assert(MatchRoute("/api/v1/game/state").route == Route::state);
+static_assert(MatchRoute("/api/v1/maps/town").param == "town");
+static_assert(ParseByteRanges("bytes=0-99", 1000).ranges[0].size == 100);
+static_assert(ParseStateQuery("afterVersion=7")->after_version == 7u);
+static_assert(!AcceptsGzipCoding("*, gzip;q=0"));
+
+// приводит путь к статическому файлу к строке, пустая строка - путь отклонён
+static std::string DecodePath(std::string_view path) {
+	StaticPathBuffer buffer;
+	auto result = DecodeStaticPath(path, buffer);
+	return result ? std::string(*result) : std::string();
+}
+
+// записывает участки разбора заголовка Range строкой "offset:size,offset:size"
+static std::string RangesLine(const ByteRanges& ranges) {
+	std::string line;
+	for (size_t i = 0; i != ranges.count; ++i) {
+		line += (i ? "," : "") + std::to_string(ranges.ranges[i].offset) + ":" + std::to_string(ranges.ranges[i].size);
+	}
+	return line;
+}
+
+// убирает отпечаток из пути к статическому файлу, пустая строка - отпечатка нет
+static std::string CutFingerprint(std::string_view path, uint64_t& hash) {
+	StaticPathBuffer buffer;
+	auto decoded = DecodeStaticPath(path, buffer);
+	auto result = decoded ? CutStaticFingerprint(buffer, *decoded) : std::nullopt;
+	hash = result ? result->hash : 0;
+	return result ? std::string(result->path) : std::string();
+}
+
+SCENARIO("Request router test module", "[RequestRouter]") {
+
+	GIVEN("api targets") {
+
+		THEN("exact paths are matched with their lanes") {
+
+			CHECK(MatchRoute("/api/v1/maps").route == Route::maps);
+			CHECK(MatchRoute("/api/v1/game/join").lane == ApiLane::join);
+			CHECK(MatchRoute("/api/v1/game/players").lane == ApiLane::session);
+			CHECK(MatchRoute("/api/v1/game/player/action").lane == ApiLane::session);
+			CHECK(MatchRoute("/api/v1/game/tick").lane == ApiLane::global);
+			CHECK(MatchRoute("/api/v1/game/records").route == Route::records);
+			CHECK(MatchRoute("/api/v1/game/channel").route == Route::channel);
+
+			auto match = MatchRoute("/api/v1/game/state");
+			CHECK(match.tree == RouteTree::api);
+			CHECK(match.route == Route::state);
+			CHECK(match.lane == ApiLane::session);
+			CHECK(match.path == "/v1/game/state");
+			CHECK_FALSE(match.has_query);
+		}
+
+		THEN("the query is split off the path") {
+
+			auto match = MatchRoute("/api/v1/game/records?start=0&maxItems=10");
+			CHECK(match.route == Route::records);
+			CHECK(match.has_query);
+			CHECK(match.query == "start=0&maxItems=10");
+
+			auto empty = MatchRoute("/api/v1/game/records?");
+			CHECK(empty.has_query);
+			CHECK(empty.query.empty());
+		}
+
+		THEN("the state with a query goes to the poll lane") {
+
+			auto match = MatchRoute("/api/v1/game/state?afterVersion=3");
+			CHECK(match.route == Route::state);
+			CHECK(match.lane == ApiLane::poll);
+			CHECK(match.query == "afterVersion=3");
+		}
+
+		THEN("the rest of the map path is a parameter") {
+
+			CHECK(MatchRoute("/api/v1/maps/map1").param == "map1");
+			CHECK(MatchRoute("/api/v1/maps/").param.empty());
+			CHECK(MatchRoute("/api/v1/maps/").route == Route::find_map);
+			CHECK(MatchRoute("/api/v1/maps/a/b").param == "a/b");
+			CHECK(MatchRoute("/api/v1/maps/town?x=1").param == "town");
+		}
+
+		THEN("bare and unknown paths are reported") {
+
+			CHECK(MatchRoute("/api").route == Route::api_root);
+			CHECK(MatchRoute("/api/").route == Route::not_found);
+			CHECK(MatchRoute("/api/v1/game").route == Route::not_found);
+			CHECK(MatchRoute("/api/v1/game/state/").route == Route::not_found);
+			CHECK(MatchRoute("/api/v1/mapsx").route == Route::not_found);
+		}
+	}
+
+	GIVEN("test frame targets") {
+
+		THEN("they are matched in their own tree") {
+
+			CHECK(MatchRoute("/test_frame").route == Route::test_root);
+			CHECK(MatchRoute("/test_frame/reset").route == Route::test_reset);
+			CHECK(MatchRoute("/test_frame/position").route == Route::test_position);
+			CHECK(MatchRoute("/test_frame/position/default").route == Route::test_position_default);
+			CHECK(MatchRoute("/test_frame/test_end").tree == RouteTree::test_frame);
+			CHECK(MatchRoute("/test_frame/v1/maps").route == Route::not_found);
+		}
+	}
+
+	GIVEN("static targets") {
+
+		THEN("everything outside the trees is static data") {
+
+			CHECK(MatchRoute("/").route == Route::static_index);
+			CHECK(MatchRoute("/index.html").route == Route::static_index);
+			CHECK(MatchRoute("/images/cube.svg").route == Route::static_file);
+			CHECK(MatchRoute("/apix/index.html").tree == RouteTree::static_data);
+			CHECK(MatchRoute("/test_framework").tree == RouteTree::static_data);
+			CHECK(MatchRoute("/images/cube.svg").path == "/images/cube.svg");
+			CHECK(MatchRoute("/images/cube.svg?v=2").path == "/images/cube.svg");
+			CHECK(MatchRoute("/index.html?v=2").route == Route::static_index);
+		}
+
+		THEN("escapes are decoded and the path is made relative to the root") {
+
+			CHECK(DecodePath("/images/cube.svg") == "images/cube.svg");
+			CHECK(DecodePath("/file%20with+spaces%21%5Bv2%5d.png") == "file with spaces![v2].png");
+			CHECK(DecodePath("/%30%41") == "0A");
+			CHECK(DecodePath("//images///./cube.svg") == "images/cube.svg");
+			CHECK(DecodePath("/images/../css/main.css") == "css/main.css");
+			CHECK(DecodePath("/images/%2e%2e/css/main.css") == "css/main.css");
+		}
+
+		THEN("directories are completed with index.html") {
+
+			CHECK(DecodePath("/docs/") == "docs/index.html");
+			CHECK(DecodePath("/docs/.") == "docs/index.html");
+			CHECK(DecodePath("/docs/..") == "index.html");
+			CHECK(DecodePath("/docs/a/..") == "docs/index.html");
+		}
+
+		THEN("traversal and broken escapes are rejected") {
+
+			CHECK(DecodePath("/../etc/passwd").empty());
+			CHECK(DecodePath("/images/../../etc/passwd").empty());
+			CHECK(DecodePath("/%2e%2e/etc/passwd").empty());
+			CHECK(DecodePath("/..%2fetc/passwd").empty());
+			CHECK(DecodePath("/..%5Cetc/passwd").empty());
+			CHECK(DecodePath("/file%00.txt").empty());
+			CHECK(DecodePath("/file%2").empty());
+			CHECK(DecodePath("/file%zz").empty());
+			CHECK(DecodePath("images/cube.svg").empty());
+			CHECK(DecodePath("/" + std::string(__STATIC_PATH_MAX_SIZE__, 'a')).empty());
+		}
+
+		THEN("the content fingerprint is cut from the file name") {
+
+			uint64_t hash = 0;
+			CHECK(CutFingerprint("/js/three.0123456789abcdef.js", hash) == "js/three.js");
+			CHECK(hash == 0x0123456789abcdefull);
+			CHECK(CutFingerprint("/app.min.FFFFFFFFFFFFFFFF.css", hash) == "app.min.css");
+			CHECK(hash == 0xffffffffffffffffull);
+
+			CHECK(CutFingerprint("/js/three.js", hash).empty());
+			CHECK(CutFingerprint("/js/.0123456789abcdef.js", hash).empty());
+			CHECK(CutFingerprint("/js/three.0123456789abcdeg.js", hash).empty());
+			CHECK(CutFingerprint("/js/three.0123456789abcde.js", hash).empty());
+			CHECK(CutFingerprint("/js.0123456789abcdef/three.js", hash).empty());
+		}
+	}
+
+	GIVEN("range headers") {
+
+		THEN("single, open and suffix ranges are clamped to the file") {
+
+			auto single = ParseByteRanges("bytes=0-99", 1000);
+			CHECK(single.status == ByteRanges::Status::partial);
+			CHECK(RangesLine(single) == "0:100");
+			CHECK(RangesLine(ParseByteRanges("bytes=200-", 1000)) == "200:800");
+			CHECK(RangesLine(ParseByteRanges("bytes=-500", 1000)) == "500:500");
+			CHECK(RangesLine(ParseByteRanges("bytes=-5000", 1000)) == "0:1000");
+			CHECK(RangesLine(ParseByteRanges("bytes=900-5000", 1000)) == "900:100");
+		}
+
+		THEN("several ranges keep the requested order") {
+
+			auto multi = ParseByteRanges("bytes=0-4, 10-14,,-3", 100);
+			CHECK(multi.status == ByteRanges::Status::partial);
+			CHECK(RangesLine(multi) == "0:5,10:5,97:3");
+			CHECK(RangesLine(ParseByteRanges("bytes=50-59,0-9,5000-", 100)) == "50:10,0:10");
+		}
+
+		THEN("ranges outside the file are unsatisfiable") {
+
+			CHECK(ParseByteRanges("bytes=1000-", 1000).status == ByteRanges::Status::unsatisfiable);
+			CHECK(ParseByteRanges("bytes=-0", 1000).status == ByteRanges::Status::unsatisfiable);
+			CHECK(ParseByteRanges("bytes=0-", 0).status == ByteRanges::Status::unsatisfiable);
+		}
+
+		THEN("broken headers are ignored") {
+
+			CHECK(ParseByteRanges("items=0-99", 1000).status == ByteRanges::Status::ignore);
+			CHECK(ParseByteRanges("bytes=", 1000).status == ByteRanges::Status::ignore);
+			CHECK(ParseByteRanges("bytes=99-0", 1000).status == ByteRanges::Status::ignore);
+			CHECK(ParseByteRanges("bytes=a-9", 1000).status == ByteRanges::Status::ignore);
+			CHECK(ParseByteRanges("bytes=0-9,x", 1000).status == ByteRanges::Status::ignore);
+			CHECK(ParseByteRanges("bytes=0-99999999999999999999", 1000).status == ByteRanges::Status::ignore);
+
+			std::string many = "bytes=0-0";
+			for (size_t i = 1; i != __MAX_BYTE_RANGES__ + 1; ++i) {
+				many += "," + std::to_string(i) + "-" + std::to_string(i);
+			}
+			CHECK(ParseByteRanges(many, 1000).status == ByteRanges::Status::ignore);
+		}
+	}
+
+	GIVEN("query strings") {
+
+		THEN("an argument is found only at the start of the query or after '&'") {
+
+			CHECK(FindQueryParam("token=abc", "token=") == "abc");
+			CHECK(FindQueryParam("a=1&token=abc&b=2", "token=") == "abc");
+			CHECK(FindQueryParam("token=&b=2", "token=") == "");
+
+			CHECK_FALSE(FindQueryParam("", "token="));
+			CHECK_FALSE(FindQueryParam("xtoken=abc", "token="));
+			CHECK_FALSE(FindQueryParam("foo=token=abc", "token="));
+			CHECK_FALSE(FindQueryParam("a=1&xtoken=abc", "token="));
+			CHECK_FALSE(FindQueryParam("token", "token="));
+		}
+
+		THEN("state versions are parsed from afterVersion and baseVersion") {
+
+			auto after = ParseStateQuery("afterVersion=12");
+			REQUIRE(after);
+			CHECK(after->after_version == 12u);
+			CHECK_FALSE(after->base_version);
+
+			auto base = ParseStateQuery("baseVersion=5");
+			REQUIRE(base);
+			CHECK_FALSE(base->after_version);
+			CHECK(base->base_version == 5u);
+
+			auto both = ParseStateQuery("baseVersion=5&afterVersion=18446744073709551615");
+			REQUIRE(both);
+			CHECK(both->after_version == 18446744073709551615ull);
+			CHECK(both->base_version == 5u);
+
+			// посторонние аргументы не мешают
+			auto other = ParseStateQuery("x=1&afterVersion=3&y=2");
+			REQUIRE(other);
+			CHECK(other->after_version == 3u);
+		}
+
+		THEN("a query without versions or with a broken version is rejected") {
+
+			CHECK_FALSE(ParseStateQuery(""));
+			CHECK_FALSE(ParseStateQuery("x=1"));
+			CHECK_FALSE(ParseStateQuery("xafterVersion=3"));
+			CHECK_FALSE(ParseStateQuery("afterVersion="));
+			CHECK_FALSE(ParseStateQuery("afterVersion=-1"));
+			CHECK_FALSE(ParseStateQuery("afterVersion=1x"));
+			CHECK_FALSE(ParseStateQuery("afterVersion=1&baseVersion=b"));
+			CHECK_FALSE(ParseStateQuery("afterVersion=18446744073709551616"));
+		}
+	}
+
+	GIVEN("accept encodings") {
+
+		THEN("gzip is accepted by name, by x-gzip and by a star") {
+
+			CHECK(AcceptsGzipCoding("gzip"));
+			CHECK(AcceptsGzipCoding("deflate, gzip;q=1.0, br"));
+			CHECK(AcceptsGzipCoding("x-gzip"));
+			CHECK(AcceptsGzipCoding("GZip ; q=0.001"));
+			CHECK(AcceptsGzipCoding("br, *"));
+			CHECK(AcceptsGzipCoding("gzip;q=0.5, *;q=0"));
+			CHECK(AcceptsGzipCoding("gzip;q=0, x-gzip;q=0.3"));
+			CHECK(AcceptsGzipCoding("gzip;level=1;q=0.8"));
+		}
+
+		THEN("an explicit gzip weight wins over a star in any order") {
+
+			CHECK_FALSE(AcceptsGzipCoding("*, gzip;q=0"));
+			CHECK_FALSE(AcceptsGzipCoding("gzip;q=0, *"));
+			CHECK_FALSE(AcceptsGzipCoding("x-gzip;q=0.000, *;q=1"));
+		}
+
+		THEN("weights are parsed as numbers") {
+
+			CHECK_FALSE(AcceptsGzipCoding("gzip;q=0"));
+			CHECK_FALSE(AcceptsGzipCoding("gzip;q=0."));
+			CHECK_FALSE(AcceptsGzipCoding("gzip;q=0.000"));
+			CHECK_FALSE(AcceptsGzipCoding("*;q=0"));
+
+			// неразборчивый вес пропускает кодирование целиком, а не запрещает его
+			CHECK_FALSE(AcceptsGzipCoding("gzip;q=."));
+			CHECK_FALSE(AcceptsGzipCoding("gzip;q=2"));
+			CHECK_FALSE(AcceptsGzipCoding("gzip;q=0.0001"));
+			CHECK(AcceptsGzipCoding("gzip;q=., *"));
+		}
+
+		THEN("other codings do not accept gzip") {
+
+			CHECK_FALSE(AcceptsGzipCoding(""));
+			CHECK_FALSE(AcceptsGzipCoding("identity"));
+			CHECK_FALSE(AcceptsGzipCoding("deflate, br"));
+			CHECK_FALSE(AcceptsGzipCoding("gzipx, xgzip"));
+		}
+	}
+}
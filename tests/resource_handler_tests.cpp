@@ -0,0 +1,152 @@
+#include <boost/beast/zlib/inflate_stream.hpp>
+#include <boost/crc.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <string>
+
+#include "../src/resource_handler.h"
+
+using namespace std::literals;
+using namespace resource_handler;
+
+// размер заголовка gzip без имени файла и комментария
+static const size_t __GZIP_HEADER_SIZE__ = 10;
+// размер концевика gzip: CRC-32 и размер исходных данных
+static const size_t __GZIP_TRAILER_SIZE__ = 8;
+
+// читает 32-битное little-endian число из концевика gzip
+static uint32_t ReadLittleEndian(std::string_view data) {
+	uint32_t value = 0;
+	for (size_t i = 4; i != 0; --i) {
+		value = (value << 8) | static_cast<unsigned char>(data[i - 1]);
+	}
+	return value;
+}
+
+// распаковывает поток deflate между заголовком и концевиком gzip
+static std::string Inflate(std::string_view gzip, size_t size) {
+	namespace zlib = boost::beast::zlib;
+
+	std::string result(size, '\0');
+	std::string_view deflate = gzip.substr(__GZIP_HEADER_SIZE__, gzip.size() - __GZIP_HEADER_SIZE__ - __GZIP_TRAILER_SIZE__);
+
+	zlib::inflate_stream stream;
+	stream.reset(15);
+
+	zlib::z_params params;
+	params.next_in = deflate.data();
+	params.avail_in = deflate.size();
+	params.next_out = result.data();
+	params.avail_out = result.size();
+
+	boost::system::error_code ec;
+	stream.write(params, zlib::Flush::finish, ec);
+	REQUIRE((!ec || ec == zlib::error::end_of_stream));
+	// весь поток deflate прочитан, за ним в файле идёт только концевик
+	CHECK(params.avail_in == 0);
+	result.resize(params.total_out);
+	return result;
+}
+
+SCENARIO("Static resource gzip test module", "[ResourceGzip]") {
+
+	GIVEN("data to compress") {
+
+		std::string text;
+		for (int i = 0; i != 1000; ++i) {
+			text += "<div class=\"row\">" + std::to_string(i) + "</div>\n";
+		}
+
+		THEN("the gzip member has a header, the deflate data and a CRC and size trailer") {
+
+			for (const std::string& data : { text, ""s, "x"s }) {
+				std::string gzip = detail::GzipCompress(data);
+				REQUIRE(gzip.size() >= __GZIP_HEADER_SIZE__ + __GZIP_TRAILER_SIZE__);
+				CHECK(gzip.substr(0, 4) == "\x1f\x8b\x08\x00"s);
+
+				CHECK(Inflate(gzip, data.size() + 1) == data);
+
+				boost::crc_32_type crc;
+				crc.process_bytes(data.data(), data.size());
+				std::string_view trailer = std::string_view(gzip).substr(gzip.size() - __GZIP_TRAILER_SIZE__);
+				CHECK(ReadLittleEndian(trailer) == crc.checksum());
+				CHECK(ReadLittleEndian(trailer.substr(4)) == data.size());
+			}
+		}
+
+		THEN("repetitive text is worth keeping compressed") {
+
+			CHECK(detail::IsGzipWorthwhile(text.size(), detail::GzipCompress(text).size()));
+		}
+	}
+
+	GIVEN("sizes of the original and the compressed variant") {
+
+		THEN("the compressed variant is kept only when it saves more than an eighth of itself") {
+
+			CHECK(detail::IsGzipWorthwhile(1000, 800));
+			CHECK(detail::IsGzipWorthwhile(1000, 888));
+			CHECK_FALSE(detail::IsGzipWorthwhile(1000, 889));
+			CHECK_FALSE(detail::IsGzipWorthwhile(1000, 1000));
+			CHECK_FALSE(detail::IsGzipWorthwhile(1000, 1200));
+			CHECK_FALSE(detail::IsGzipWorthwhile(0, 0));
+		}
+	}
+}
+
+// собирает тело из сегментов, участки содержимого берутся из content
+static std::string JoinSegments(const http_handler::BodyRanges& body, std::string_view content) {
+	std::string result;
+	for (size_t i = 0; i != body.SegmentCount(); ++i) {
+		auto segment = body.GetSegment(i);
+		result += segment.content ? content.substr(segment.offset, segment.size) : segment.text;
+	}
+	return result;
+}
+
+SCENARIO("Static byte ranges test module", "[ResourceRanges]") {
+
+	GIVEN("a file content and ranges of a Range header") {
+
+		const std::string content = "0123456789abcdefghij"s;
+		auto ranges = http_handler::ParseByteRanges("bytes=0-3, 10-, -2", content.size());
+		REQUIRE(ranges.status == http_handler::ByteRanges::Status::partial);
+		REQUIRE(ranges.count == 3);
+
+		THEN("a multipart body lays out part headers, ranges and the closing boundary") {
+
+			http_handler::BodyRanges body;
+			std::string content_type = body.SetByteRanges(ranges, content.size(), "text/plain"sv, "range_0f"sv);
+			CHECK(content_type == "multipart/byteranges; boundary=range_0f"s);
+			REQUIRE(body.SegmentCount() == 7);
+
+			const std::string expected =
+				"--range_0f\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-3/20\r\n\r\n0123"
+				"\r\n--range_0f\r\nContent-Type: text/plain\r\nContent-Range: bytes 10-19/20\r\n\r\nabcdefghij"
+				"\r\n--range_0f\r\nContent-Type: text/plain\r\nContent-Range: bytes 18-19/20\r\n\r\nij"
+				"\r\n--range_0f--\r\n"s;
+			CHECK(JoinSegments(body, content) == expected);
+			// Content-Length ответа считается по Size и должен совпасть с тем, что уйдёт в сокет
+			CHECK(body.Size() == expected.size());
+
+			// участки содержимого идут через sendfile, заголовки частей - из памяти
+			CHECK_FALSE(body.GetSegment(0).content);
+			CHECK(body.GetSegment(1).content);
+			CHECK(body.GetSegment(3).offset == 10);
+			CHECK(body.GetSegment(3).size == 10);
+			CHECK_FALSE(body.GetSegment(6).content);
+		}
+
+		THEN("a single range is one content segment with its Content-Range") {
+
+			http_handler::BodyRanges body;
+			body.SetByteRanges(ranges, content.size(), "text/plain"sv, "range_0f"sv);
+			body.SetRange(ranges.ranges[1].offset, ranges.ranges[1].size);
+			CHECK(body.SegmentCount() == 1);
+			CHECK(body.Size() == 10);
+			CHECK(JoinSegments(body, content) == "abcdefghij"s);
+			CHECK(http_handler::BodyRanges::ContentRange(ranges.ranges[1], content.size()) == "bytes 10-19/20"s);
+		}
+	}
+}
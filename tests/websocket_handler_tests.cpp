@@ -0,0 +1,78 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include "../src/websocket_handler.h"
+
+using namespace std::literals;
+using namespace websocket_handler;
+
+static const std::string __TOKEN__ = "0123456789abcdef0123456789abcdef"s;
+
+// запрос на переход к WebSocket с целью target
+static http_handler::StringRequest MakeUpgradeRequest(std::string_view target) {
+	http_handler::StringRequest req{ http::verb::get, target, 11 };
+	req.set(http::field::upgrade, "websocket");
+	return req;
+}
+
+SCENARIO("WebSocket game channel test module", "[GameChannel]") {
+
+	GIVEN("a queue of pending channel messages") {
+
+		PendingMessages messages;
+		CHECK(messages.Empty());
+
+		THEN("messages over the limit are dropped") {
+
+			for (size_t i = 0; i != __CHANNEL_PENDING_MESSAGES_MAX__; ++i) {
+				CHECK(messages.Push(std::to_string(i)));
+			}
+			CHECK_FALSE(messages.Push("dropped"s));
+			CHECK_FALSE(messages.Push("dropped"s));
+			CHECK(messages.Size() == __CHANNEL_PENDING_MESSAGES_MAX__);
+
+			AND_THEN("messages leave in order and free the place") {
+
+				CHECK(messages.Pop() == "0"s);
+				CHECK(messages.Pop() == "1"s);
+				CHECK(messages.Push("last"s));
+				CHECK(messages.Size() == __CHANNEL_PENDING_MESSAGES_MAX__ - 1);
+
+				std::string last;
+				while (!messages.Empty()) {
+					last = messages.Pop();
+				}
+				CHECK(last == "last"s);
+			}
+		}
+	}
+
+	GIVEN("upgrade requests") {
+
+		THEN("the token is taken from the Authorization header") {
+
+			auto req = MakeUpgradeRequest("/api/v1/game/channel"sv);
+			req.set(http::field::authorization, "Bearer " + __TOKEN__);
+			CHECK(detail::FindChannelToken(req) == __TOKEN__);
+
+			req.set(http::field::authorization, "Bearer 0123"s);
+			CHECK_FALSE(detail::FindChannelToken(req));
+		}
+
+		THEN("the token is taken from a whole token argument of the query") {
+
+			CHECK(detail::FindChannelToken(MakeUpgradeRequest("/api/v1/game/channel?token=" + __TOKEN__)) == __TOKEN__);
+			CHECK(detail::FindChannelToken(MakeUpgradeRequest("/api/v1/game/channel?a=1&token=" + __TOKEN__ + "&b=2")) == __TOKEN__);
+		}
+
+		THEN("look-alike arguments and broken tokens are rejected") {
+
+			CHECK_FALSE(detail::FindChannelToken(MakeUpgradeRequest("/api/v1/game/channel"sv)));
+			CHECK_FALSE(detail::FindChannelToken(MakeUpgradeRequest("/api/v1/game/channel?xtoken=" + __TOKEN__)));
+			CHECK_FALSE(detail::FindChannelToken(MakeUpgradeRequest("/api/v1/game/channel?foo=token=" + __TOKEN__)));
+			CHECK_FALSE(detail::FindChannelToken(MakeUpgradeRequest("/api/v1/game/channel?token=0123")));
+			CHECK_FALSE(detail::FindChannelToken(MakeUpgradeRequest("/api/v1/game/channel?token=" + __TOKEN__ + "0")));
+		}
+	}
+}